@@ -167,17 +167,6 @@ namespace piracer {
         static AlgorithmType select_best_algorithm(
             size_t digits, 
             const AlgorithmConfig& config);
-        
-        // Configuration optimization
-        static AlgorithmConfig optimize_config(
-            size_t digits, 
-            const AlgorithmConfig& base_config);
-        
-        // Performance prediction
-        static double predict_performance(
-            AlgorithmType algo, 
-            size_t digits, 
-            const AlgorithmConfig& config);
     };
 
     // Performance comparison utility
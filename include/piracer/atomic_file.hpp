@@ -0,0 +1,16 @@
+#pragma once
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace piracer {
+
+    // Replaces `path` with what `fill` writes to the (binary, seekable)
+    // stream it is given. The bytes go to "<path>.tmp", which is flushed to
+    // the device and then renamed over `path`, so readers, and a restart
+    // after a crash, find either the old file or the whole new one. False
+    // on I/O errors or if `fill` returns false; `path` is then left as it
+    // was and the temporary file removed.
+    bool write_file_atomically(const std::string& path, const std::function<bool(std::ostream&)>& fill);
+
+} // namespace piracer
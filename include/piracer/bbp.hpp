@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace piracer {
+    class ThreadPool;
+
+    // Hex digits of pi at any position by Bailey-Borwein-Plouffe digit
+    // extraction, without the digits before them: a cross-check for big runs
+    // that costs time linear in the position (four modular exponentiations
+    // per preceding hex digit, spread over `pool`) and constant memory.
+    // Every term is carried to 320 bits, so up to kBBPMaxDigits digits come
+    // out of one evaluation.
+    constexpr std::size_t kBBPMaxDigits = 64;
+
+    // `count` (at most kBBPMaxDigits) lowercase hex digits of pi starting
+    // `position` digits after the point (position 0: the "2" of 3.243f...).
+    // Throws std::invalid_argument for larger counts, and where the target
+    // lacks 128-bit integer support.
+    std::string pi_hex_digits_bbp(std::uint64_t position, std::size_t count, ThreadPool* pool = nullptr);
+} // namespace piracer
@@ -1,51 +1,152 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <gmpxx.h>
+#include "piracer/memory_pool.hpp"
+#include <memory>
+#include <new>
 #include <vector>
 
 namespace piracer {
-    // NTT/CRT backend for large integer multiplication
-    // This is a stub interface for future implementation
-    
-    // Forward declarations
-    struct NTTContext;
-    struct CRTContext;
-    
-    // NTT context for a specific modulus and size
+    class ThreadPool;
+
+    // NTT/CRT backend for large integer multiplication.
+    // Three primes p = k*2^s + 1 in (2^62, 2^63) with s >= 55 and Montgomery
+    // arithmetic: 64-bit limbs are used directly as transform coefficients and
+    // every convolution coefficient (< n * 2^128) is recovered exactly by CRT
+    // below p1*p2*p3 ~ 2^186, for transforms of up to 2^55 points.
+
+    // Number of primes in the CRT set
+    constexpr int kNTTPrimes = 3;
+
+    // The CRT prime set used by mul_ntt
+    const std::vector<std::uint64_t>& ntt_default_moduli();
+
+    // Allocator handing out 64-byte aligned storage, so twiddle tables and
+    // transform buffers start on a cache line and are never shared with
+    // unrelated data. Blocks past the pool's small sizes come from
+    // g_memory_pool's large blocks (aligned to their size) while the pool is
+    // active, which reuses resident pages across multiplications.
+    template<typename T>
+    struct CacheAlignedAllocator {
+        using value_type = T;
+        static constexpr std::size_t alignment = 64;
+
+        CacheAlignedAllocator() = default;
+        template<typename U>
+        CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+        static bool pooled(std::size_t bytes) {
+            return bytes > MemoryPool::kMaxSmallBytes && g_memory_pool.active();
+        }
+
+        T* allocate(std::size_t n) {
+            const std::size_t bytes = n * sizeof(T);
+            if (pooled(bytes)) return static_cast<T*>(g_memory_pool.allocate(bytes));
+            return static_cast<T*>(::operator new(bytes, std::align_val_t(alignment)));
+        }
+        void deallocate(T* p, std::size_t n) {
+            const std::size_t bytes = n * sizeof(T);
+            if (pooled(bytes)) {
+                g_memory_pool.deallocate(p, bytes);
+                return;
+            }
+            ::operator delete(p, std::align_val_t(alignment));
+        }
+
+        template<typename U>
+        bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+        template<typename U>
+        bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+    };
+
+    using AlignedWords = std::vector<std::uint64_t, CacheAlignedAllocator<std::uint64_t>>;
+
+    // NTT context for a specific modulus and power-of-two size.
+    // Twiddles are stored per butterfly level (entry h + j holds w_{2h}^j) in
+    // Montgomery form; data vectors stay in the normal residue domain.
     struct NTTContext {
-        mpz_class modulus;
+        std::uint64_t modulus;
         std::size_t size;
-        std::vector<mpz_class> roots_of_unity;
-        std::vector<mpz_class> inv_roots_of_unity;
-        
-        NTTContext(mpz_class mod, std::size_t sz);
+        std::uint64_t mont_inv;       // p^-1 mod 2^64
+        std::uint64_t inv_size;       // Montgomery form of 1/size
+        std::uint64_t product_scale;  // Montgomery form of R/size (also undoes pointwise R^-1)
+        AlignedWords roots_of_unity;
+        AlignedWords inv_roots_of_unity;
+
+        // Throws std::invalid_argument if `sz` is not a power of two dividing mod - 1
+        NTTContext(std::uint64_t mod, std::size_t sz);
         ~NTTContext() = default;
     };
-    
-    // CRT context for multiple moduli
+
+    // CRT context for the three-prime set (Garner constants, Montgomery form)
     struct CRTContext {
-        std::vector<mpz_class> moduli;
-        std::vector<mpz_class> crt_coeffs;
-        
-        CRTContext(const std::vector<mpz_class>& mods);
+        std::vector<std::uint64_t> moduli;
+        std::vector<std::uint64_t> crt_coeffs;
+
+        // Throws std::invalid_argument unless given kNTTPrimes moduli
+        CRTContext(const std::vector<std::uint64_t>& mods);
         ~CRTContext() = default;
     };
-    
-    // Multiply two large integers using NTT/CRT
-    // This is the main entry point for the backend
-    void mul_ntt(const mpz_class& a, const mpz_class& b, mpz_class& out);
-    
-    // Alternative: multiply with explicit context
+
+    // Everything a multiplication of one transform length needs: a context
+    // per prime and the CRT constants. Plans are immutable once built and
+    // shared read-only between threads.
+    struct NTTPlan {
+        std::size_t size;
+        std::vector<NTTContext> primes;  // same order as crt.moduli
+        CRTContext crt;
+
+        NTTPlan(std::size_t sz, const std::vector<std::uint64_t>& moduli);
+    };
+
+    // Process-wide plan cache keyed by (transform length, prime set).
+    // The first caller of a key builds its tables; concurrent callers of the
+    // same key wait for that build instead of repeating it.
+    std::shared_ptr<const NTTPlan> get_ntt_plan(std::size_t size);
+    std::shared_ptr<const NTTPlan> get_ntt_plan(std::size_t size, const std::vector<std::uint64_t>& moduli);
+
+    // Drop cached plans (memory held by in-use plans is freed with their last user)
+    void clear_ntt_plan_cache();
+
+    // Multiply two large integers using NTT/CRT.
+    // This is the main entry point for the backend; with a pool the three
+    // prime transforms run concurrently.
+    void mul_ntt(const mpz_class& a, const mpz_class& b, mpz_class& out, ThreadPool* pool = nullptr);
+
+    // Alternative: multiply with explicit contexts (one NTT context per CRT
+    // modulus, all of a size >= limbs(a) + limbs(b))
     void mul_ntt_with_context(const mpz_class& a, const mpz_class& b, mpz_class& out,
-                             const NTTContext& ntt_ctx, const CRTContext& crt_ctx);
-    
-    // Utility functions for NTT operations
-    void ntt_forward(std::vector<mpz_class>& data, const NTTContext& ctx);
-    void ntt_inverse(std::vector<mpz_class>& data, const NTTContext& ctx);
-    
-    // CRT reconstruction
-    mpz_class crt_reconstruct(const std::vector<mpz_class>& residues, const CRTContext& ctx);
-    
-    // Factory functions for common configurations
-    NTTContext create_ntt_context(std::size_t size, const mpz_class& modulus);
-    CRTContext create_crt_context(const std::vector<mpz_class>& moduli);
-} // namespace piracer 
\ No newline at end of file
+                              const std::vector<NTTContext>& ntt_ctx, const CRTContext& crt_ctx,
+                              ThreadPool* pool = nullptr);
+    void mul_ntt_with_plan(const mpz_class& a, const mpz_class& b, mpz_class& out,
+                           const NTTPlan& plan, ThreadPool* pool = nullptr);
+
+    // Utility functions for NTT operations.
+    // Forward: natural order in, bit-reversed order out.
+    // Inverse: bit-reversed order in, natural order out, scaled by 1/size.
+    void ntt_forward(std::vector<std::uint64_t>& data, const NTTContext& ctx);
+    void ntt_inverse(std::vector<std::uint64_t>& data, const NTTContext& ctx);
+
+    // CRT reconstruction of one coefficient from its residues
+    mpz_class crt_reconstruct(const std::vector<std::uint64_t>& residues, const CRTContext& ctx);
+
+    // The product from its cyclic convolutions mod each prime of `crt`
+    // (residues[i]: natural order, at least `len` coefficients), as `len`
+    // limbs with the given sign. For backends that run the transforms
+    // elsewhere (the GPU multiplier).
+    void crt_to_product(mpz_class& out, std::size_t len, const std::uint64_t* const* residues,
+                        const CRTContext& crt, bool negative);
+
+    // Factory functions for common configurations (uncached: prefer get_ntt_plan)
+    NTTContext create_ntt_context(std::size_t size, std::uint64_t modulus);
+    CRTContext create_crt_context(const std::vector<std::uint64_t>& moduli);
+
+    // Smaller-operand size (limbs) from which mul_big switches to mul_ntt.
+    // Defaults to the measured crossover for the active SIMD kernel; 0 restores it.
+    std::size_t ntt_threshold_limbs();
+    void set_ntt_threshold_limbs(std::size_t limbs);
+
+    // out = a * b, using GMP's mpz_mul below the NTT threshold and mul_ntt above
+    void mul_big(mpz_class& out, const mpz_class& a, const mpz_class& b, ThreadPool* pool = nullptr);
+} // namespace piracer
@@ -1,9 +1,18 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <gmpxx.h>
 #include <memory>
+#include <string>
+#include <vector>
 #include "piracer/progress.hpp"
+#include "piracer/series.hpp"
 
 namespace piracer {
+    class CancelToken;
+    class GPUMultiplier;
+    class ThreadPool;
+
     // Minimal tuple used by binary-splitting.
     struct BSplitTriplet {
         mpz_class P;  // product of numerator polynomials
@@ -14,12 +23,117 @@ namespace piracer {
     // Binary-splitting specialized for the Chudnovsky series on [a, b).
     BSplitTriplet bsplit_chudnovsky(long a, long b);
 
-    // Same as above but reports progress at each leaf (terms).
-    BSplitTriplet bsplit_chudnovsky(long a, long b, Progress* prog);
-    
-    // Parallel binary-splitting with real thread pool
-    BSplitTriplet bsplit_chudnovsky_parallel(long a, long b, int num_threads, Progress* prog = nullptr);
-    
+    // Same as above but reports progress: every leaf range and merge adds
+    // its share of bsplit_work(a, b) to `prog` as it finishes.
+    // With need_p = false the caller promises never to read P: the product is
+    // skipped at the root and along the right spine, and P is returned as 0.
+    // A non-null `cancel` is polled between subtrees (of every variant below
+    // too): once it asks, the run throws ComputeCancelled (cancel.hpp).
+    BSplitTriplet bsplit_chudnovsky(long a, long b, Progress* prog, bool need_p = true,
+                                    const CancelToken* cancel = nullptr);
+
+    // One inner node of the tree: L = [a, m) and R = [m, b) are combined
+    // into L as [a, b), consuming R (with need_p = false, L.P is dropped too)
+    void bsplit_merge(BSplitTriplet& L, BSplitTriplet& R, bool need_p = true, ThreadPool* pool = nullptr);
+
+    // Parallel binary-splitting with real thread pool (need_p as above).
+    // A nonzero `max_memory` (bytes) bounds the estimated peak of the
+    // subtrees and merges run at the same time; work that does not fit waits
+    // and runs on the current thread instead.
+    BSplitTriplet bsplit_chudnovsky_parallel(long a, long b, int num_threads, Progress* prog = nullptr,
+                                             bool need_p = true, std::size_t max_memory = 0,
+                                             const CancelToken* cancel = nullptr);
+
+    // Level-batched variant for an offload multiplier (gpu_backend.hpp):
+    // subtrees of a few thousand terms are built on the pool as above, then
+    // each tree level above them is merged in one step, all of its products
+    // (operands of nearly equal size) handed to mul.multiply_products together.
+    // Same result and progress as above; a level's inputs and outputs are
+    // alive together, so there is no memory budget.
+    BSplitTriplet bsplit_chudnovsky_batched(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                            GPUMultiplier& mul, const CancelToken* cancel = nullptr);
+
+    // NUMA-aware variant: [a, b) is cut into one contiguous part per node,
+    // each built by a pool pinned to that node's cores (threads in proportion
+    // to its CPUs) so its integers are node-local; the part results are then
+    // merged with interleaved pages. Same arguments and result as above; on
+    // one node it is bsplit_chudnovsky_parallel.
+    BSplitTriplet bsplit_chudnovsky_numa(long a, long b, int num_threads, Progress* prog = nullptr,
+                                         bool need_p = true, std::size_t max_memory = 0,
+                                         const CancelToken* cancel = nullptr);
+
+    // Shape of the split tree. Every shape yields the same P/Q/T, so these
+    // only trade speed; tuning.hpp measures them per host. Set them between
+    // runs: a run reads them as it goes.
+    struct BSplitTuning {
+        long leaf_terms = 16;          // ranges up to this size use the fused base case
+        long min_parallel_grain = 64;  // smallest subtree a parallel run gives a task of its own
+        long tasks_per_thread = 16;    // parallel runs cut about this many subtrees per thread
+    };
+    BSplitTuning bsplit_tuning();
+    // Values are clamped to sane ranges (leaf_terms to [1, 1024], ...)
+    void set_bsplit_tuning(const BSplitTuning& t);
+
+    // Size estimates for [a, b): the P/Q/T result, and the peak working set
+    // of computing it on one thread (what a memory budget reserves per subtree)
+    std::size_t bsplit_result_bytes(long a, long b);
+    std::size_t bsplit_peak_bytes(long a, long b);
+
+    // Progress units of [a, b) (the total every bsplit_chudnovsky* run
+    // reports against): each leaf range and merge is weighted by the
+    // estimated cost of its products, so the long top-level merges move the
+    // bar as much as they take. bsplit_merge_work is the share of the merge
+    // at the root of [a, b).
+    std::uint64_t bsplit_work(long a, long b);
+    std::uint64_t bsplit_merge_work(long a, long b);
+
+    struct CheckpointSegment;
+    class CheckpointWriter;
+
+    // Resumable binary-splitting. The top levels of the split tree are run
+    // one subtree at a time; every finished subtree (range plus P/Q/T) is
+    // posted to `writer` (may be null) together with the other finished
+    // ones. Subtrees found in `resume`, as saved by an earlier run over the
+    // same [a, b), are used instead of being recomputed; entries that match
+    // no subtree are ignored. `max_memory` as for bsplit_chudnovsky_parallel.
+    // A cancelled run flushes `writer` before it throws, so the next run
+    // resumes from every subtree finished by then.
+    BSplitTriplet bsplit_chudnovsky_resumable(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                              std::vector<CheckpointSegment> resume, CheckpointWriter* writer,
+                                              std::size_t max_memory = 0, const CancelToken* cancel = nullptr);
+
+    // The same engine for any series policy (series.hpp): one tree shape,
+    // parallel scheduler, memory budget, multiplication backend and
+    // checkpoint format for every series, the leaf polynomials inlined into
+    // each instantiation. The bsplit_chudnovsky* forms above are these with
+    // ChudnovskySeries (NUMA and out-of-core runs are Chudnovsky only).
+    // Instantiated in bsplit.cpp for the policies of series.hpp.
+    template <class Series>
+    BSplitTriplet bsplit_series(long a, long b, Progress* prog = nullptr, bool need_p = true,
+                                const CancelToken* cancel = nullptr);
+    template <class Series>
+    BSplitTriplet bsplit_series_parallel(long a, long b, int num_threads, Progress* prog = nullptr,
+                                         bool need_p = true, std::size_t max_memory = 0,
+                                         const CancelToken* cancel = nullptr);
+    template <class Series>
+    BSplitTriplet bsplit_series_batched(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                        GPUMultiplier& mul, const CancelToken* cancel = nullptr);
+    template <class Series>
+    BSplitTriplet bsplit_series_resumable(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                          std::vector<CheckpointSegment> resume, CheckpointWriter* writer,
+                                          std::size_t max_memory = 0, const CancelToken* cancel = nullptr);
+
+    // Out-of-core binary-splitting for results beyond RAM. Subtrees whose
+    // estimated peak (bsplit_peak_bytes) fits in `memory_limit` run in memory
+    // (on `num_threads`, under the same budget) and are spilled to files in
+    // `scratch_dir`; the nodes above them merge on disk with streamed block
+    // products (disk_mul/disk_add). Q and T of the root, and P if need_p,
+    // are returned in memory. Throws std::runtime_error on I/O errors.
+    BSplitTriplet bsplit_chudnovsky_out_of_core(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                                const std::string& scratch_dir, std::size_t memory_limit,
+                                                std::size_t* peak_disk_bytes = nullptr,
+                                                const CancelToken* cancel = nullptr);
+
     // Advanced parallel scheduler with thread pool
     struct ParallelScheduler {
         int num_threads;
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace piracer {
+
+    // Thrown out of a computation stopped through its CancelToken. Every
+    // intermediate is released on the way out (scratch files included); a
+    // checkpointed run has saved the subtrees it finished.
+    class ComputeCancelled : public std::runtime_error {
+    public:
+        explicit ComputeCancelled(bool deadline)
+            : std::runtime_error(deadline ? "computation passed its deadline" : "computation cancelled"),
+              deadline_(deadline) {}
+
+        // True if the deadline passed, false if cancel() was called
+        bool deadline() const { return deadline_; }
+
+    private:
+        bool deadline_;
+    };
+
+    // Cooperative stop request shared by a computation and whoever may stop
+    // it (ComputeOptions::cancel). The computation polls check() at subtree
+    // granularity in binary splitting and between pipeline stages, so it
+    // stops within one subtree or stage of the request.
+    class CancelToken {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        // One lock-free atomic store: safe from a signal handler
+        void cancel() noexcept { cancelled_.store(true, std::memory_order_relaxed); }
+
+        // The computation stops at the first check after `t`; the default
+        // time point clears the deadline
+        void set_deadline(clock::time_point t) noexcept {
+            deadline_.store(t.time_since_epoch().count(), std::memory_order_relaxed);
+        }
+        void set_timeout(clock::duration d) { set_deadline(clock::now() + d); }
+
+        bool cancel_requested() const noexcept { return cancelled_.load(std::memory_order_relaxed); }
+
+        bool deadline_passed() const {
+            const clock::rep d = deadline_.load(std::memory_order_relaxed);
+            return d != 0 && clock::now().time_since_epoch().count() >= d;
+        }
+
+        bool stopped() const { return cancel_requested() || deadline_passed(); }
+
+        // Throws ComputeCancelled once cancelled or past the deadline
+        void check() const {
+            if (cancel_requested()) throw ComputeCancelled(false);
+            if (deadline_passed()) throw ComputeCancelled(true);
+        }
+
+    private:
+        static_assert(std::atomic<bool>::is_always_lock_free, "cancel() must be async-signal-safe");
+
+        std::atomic<bool> cancelled_{false};
+        std::atomic<clock::rep> deadline_{0};  // 0: none
+    };
+
+} // namespace piracer
@@ -3,6 +3,13 @@
 #include <fstream>
 #include <chrono>
 #include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "piracer/bsplit.hpp"
 
 namespace piracer {
     
@@ -50,5 +57,109 @@ namespace piracer {
     
     // Generate checksum for data integrity
     std::string generate_checksum(const CheckpointData& data);
+
+    // ---- Binary checkpoints ---------------------------------------------------
+    // Layout: a fixed header, a segment table, then the raw limbs of every
+    // P/Q/T, each array 64-byte aligned. The header and the rest of the file
+    // carry separate CRC32C checksums. Files are native-endian and are
+    // rejected on a machine with a different byte order or limb size.
+    // Loading maps the file and copies limbs straight into the mpz values.
+
+    // Binary-splitting state for the term range [begin, end)
+    struct CheckpointSegment {
+        std::uint64_t begin = 0;
+        std::uint64_t end = 0;
+        BSplitTriplet state;
+    };
+
+    struct BinaryCheckpoint {
+        std::size_t digits = 0;
+        int base = 10;
+        int num_threads = 1;
+        std::size_t completed_terms = 0;
+        std::size_t total_terms = 0;
+        std::string algorithm_name = "chudnovsky";
+        std::chrono::system_clock::time_point timestamp = std::chrono::system_clock::now();
+        std::vector<CheckpointSegment> segments;
+    };
+
+    // Replaces `filename` atomically (write_file_atomically: "<filename>.tmp",
+    // flushed to the device, then renamed)
+    bool save_binary_checkpoint(const std::string& filename, const BinaryCheckpoint& data);
+
+    // Fails (returns false) on a bad header, a checksum mismatch or a truncated file
+    bool load_binary_checkpoint(const std::string& filename, BinaryCheckpoint& data);
+
+    // True if the file starts with the binary checkpoint magic
+    bool is_binary_checkpoint(const std::string& filename);
+
+    // The same encoding as a byte stream, for links that cannot seek (a
+    // socket between hosts). A writer takes the bytes in order; a reader
+    // fills exactly `n` bytes. Either returns false to give up.
+    using ByteWriter = std::function<bool(const void* data, std::size_t n)>;
+    using ByteReader = std::function<bool(void* data, std::size_t n)>;
+
+    // False as soon as `write` fails
+    bool send_binary_checkpoint(const BinaryCheckpoint& data, const ByteWriter& write);
+
+    // Reads one encoding, limbs straight into the mpz values; fails (false)
+    // like load_binary_checkpoint does, when `read` fails, or when the
+    // header claims more than `max_bytes` in all (0: no limit), before
+    // anything is allocated. Set a limit for data from an untrusted peer.
+    bool receive_binary_checkpoint(const ByteReader& read, BinaryCheckpoint& data, std::uint64_t max_bytes = 0);
+
+    // Saves checkpoints from a background thread so the computation never
+    // waits on disk. post() hands over the current set of finished subtrees;
+    // segments are shared, immutable snapshots, so posting copies no limbs.
+    // Only the newest snapshot is written, at most once per `interval`.
+    class CheckpointWriter {
+    public:
+        using Snapshot = std::vector<std::shared_ptr<const CheckpointSegment>>;
+
+        // `meta` provides the header fields of every file written
+        CheckpointWriter(std::string filename, BinaryCheckpoint meta, std::chrono::seconds interval);
+
+        // Stops the thread; a snapshot still waiting for its interval is dropped
+        ~CheckpointWriter();
+
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        void post(Snapshot segments, std::size_t completed_terms);
+
+        // Write the newest snapshot now and wait until it is on disk
+        void flush();
+
+        // False once any save has failed
+        bool ok() const;
+
+        // Number of checkpoints written so far
+        std::size_t saves() const;
+
+    private:
+        std::string filename_;
+        BinaryCheckpoint meta_;
+        std::chrono::seconds interval_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable idle_;
+        Snapshot pending_;
+        std::size_t pending_terms_ = 0;
+        bool has_pending_ = false;
+        bool writing_ = false;
+        bool flush_ = false;
+        bool stop_ = false;
+        bool failed_ = false;
+        std::size_t saves_ = 0;
+        std::chrono::steady_clock::time_point last_save_;
+        std::thread thread_;
+
+        void run();
+    };
+
+    // CRC32C (Castagnoli); uses the SSE4.2 / ARMv8 CRC instructions when present.
+    // Pass the previous result as `crc` to checksum data in pieces.
+    std::uint32_t crc32c(const void* data, std::size_t n, std::uint32_t crc = 0);
     
 } // namespace piracer 
\ No newline at end of file
@@ -1,24 +1,145 @@
 #pragma once
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
+#include "piracer/bsplit.hpp"
+#include "piracer/cancel.hpp"
 #include "piracer/progress.hpp"
 
 namespace piracer {
+    class DigitSink;
+
     // Compute π to `digits` decimals. No progress reporting.
     std::string compute_pi(std::size_t digits);
 
-    // Same as above but reports progress via `prog` (ticks per term).
+    // Same as above but reports progress via `prog` (sampled ticks, see ProgressReporter).
     std::string compute_pi_with_progress(std::size_t digits, Progress* prog);
     
     // Compute π to `digits` in specified base (10 or 16). No progress reporting.
     std::string compute_pi_base(std::size_t digits, int base);
 
-    // Same as above but reports progress via `prog` (ticks per term).
+    // Same as above but reports progress via `prog` (sampled ticks, see ProgressReporter).
     std::string compute_pi_base_with_progress(std::size_t digits, int base, Progress* prog);
     
     // Compute π to `digits` in specified base with thread count. No progress reporting.
     std::string compute_pi_base_threaded(std::size_t digits, int base, int num_threads);
 
-    // Same as above but reports progress via `prog` (ticks per term).
+    // Same as above but reports progress via `prog` (sampled ticks, see ProgressReporter).
     std::string compute_pi_base_threaded_with_progress(std::size_t digits, int base, int num_threads, Progress* prog);
+
+    // The series over [0, terms), P included, as kept for reuse
+    struct SeriesState {
+        long terms = 0;
+        BSplitTriplet S;
+    };
+
+    // `count` digits of π in `base` (10 or 16) starting `start` digits
+    // after the point, without the full expansion (PiPipeline::run_range)
+    std::string compute_pi_digit_range(std::size_t start, std::size_t count, int base, int num_threads = 1);
+
+    struct ComputeOptions {
+        std::size_t digits = 0;
+        int base = 10;              // 10 or 16
+        int threads = 1;            // bsplit and radix conversion
+        Progress* progress = nullptr;
+
+        // Bound (bytes) on the estimated working set of binary-splitting
+        // subtrees run concurrently; 0: no bound. See bsplit_peak_bytes().
+        std::size_t max_memory = 0;
+
+        // Split binary-splitting across NUMA nodes with node-pinned workers
+        // (bsplit_chudnovsky_numa); no effect on single-node machines
+        bool numa = false;
+
+        // Merge binary-splitting level by level through the best multiply
+        // backend (bsplit_chudnovsky_batched): the GPU where one is built in
+        // and present, the CPU otherwise. Ignores max_memory and numa.
+        bool gpu = false;
+
+        // Out-of-core mode (empty: off): binary-splitting intermediates that
+        // exceed max_memory (default: half the RAM) are kept in files here
+        std::string scratch;
+
+        // Binary-splitting state is saved here while computing (empty: off), and
+        // a matching checkpoint found here at start is resumed from. run()
+        // deletes the file once the digits are in the sink.
+        std::string checkpoint;
+        std::chrono::seconds checkpoint_interval{60};
+
+        // Distributed mode (empty: off): binary-splitting is spread over the
+        // bsplit workers at these "host:port" addresses (distributed.hpp),
+        // `threads` merging their ranges here. Ignores max_memory, numa,
+        // gpu, scratch and checkpoint.
+        std::vector<std::string> nodes;
+
+        // After the digits are out, spot-check hex digits of the computed
+        // value by BBP digit extraction (pi_hex_digits_bbp): the last 64 the
+        // run determines plus `verify_samples` random positions. Decimal runs
+        // are checked through the binary value their digits come from.
+        bool verify = false;
+        int verify_samples = 2;
+        std::uint64_t verify_seed = 0;  // 0: seeded from std::random_device
+
+        // Series reuse across runs (PiService). A `series_prefix` of at most
+        // the run's terms is extended by the terms after it instead of being
+        // recomputed; `keep_series` receives the run's full series (P too,
+        // which costs one more root product) before the finish consumes it.
+        std::shared_ptr<const SeriesState> series_prefix;
+        SeriesState* keep_series = nullptr;
+
+        // Stop request and deadline (cancel.hpp; null: run to the end),
+        // polled between binary-splitting subtrees and between stages. A
+        // stopped run throws ComputeCancelled after a final checkpoint save,
+        // with its scratch files deleted and its pool memory given back.
+        const CancelToken* cancel = nullptr;
+    };
+
+    // Stages of one computation, in order (see PiPipeline)
+    enum class PiStage { Series, Sqrt, Divide, Radix, Write, Verify };
+    constexpr int kPiStageCount = 6;
+
+    // "series", "sqrt", "divide", "radix", "write", "verify"
+    const char* stage_name(PiStage stage);
+
+    struct StageTiming {
+        bool ran = false;
+        double wall_seconds = 0.0;
+        double cpu_seconds = 0.0;   // all threads of the process
+        std::size_t peak_bytes = 0; // pool high-water mark (0 without the GMP pool)
+    };
+
+    // One BBP spot check (ComputeOptions::verify)
+    struct VerifyCheck {
+        std::size_t position = 0;  // hex digits after the point
+        std::string expected;      // from BBP
+        std::string computed;      // of the computed value
+        bool ok() const { return expected == computed; }
+    };
+
+    struct ComputeReport {
+        std::size_t resumed_terms = 0;       // series terms taken from the checkpoint or series_prefix
+        std::size_t checkpoints_written = 0;
+        bool checkpoint_failed = false;      // some save could not be written
+        std::size_t scratch_peak_bytes = 0;  // out-of-core mode: most bytes on disk at once
+        std::size_t terms = 0;               // series terms of the run
+        std::string gpu_backend;             // multiply backend of a gpu run ("cuda: <device>" or "cpu")
+        std::vector<VerifyCheck> checks;     // empty without verify
+
+        bool verify_failed() const {
+            for (const VerifyCheck& c : checks) if (!c.ok()) return true;
+            return false;
+        }
+
+        StageTiming stages[kPiStageCount];
+        StageTiming& stage(PiStage s) { return stages[static_cast<int>(s)]; }
+        const StageTiming& stage(PiStage s) const { return stages[static_cast<int>(s)]; }
+    };
+
+    // Compute π and stream "3." plus the digits into `sink` in order, so the
+    // formatted result never needs to fit in memory as one string. The sink
+    // is not finished. Same as PiPipeline(opts).run(sink).
+    ComputeReport compute_pi_to_sink(const ComputeOptions& opts, DigitSink& sink);
 } // namespace piracer
@@ -17,4 +17,43 @@ namespace piracer {
         }
         return static_cast<std::size_t>(std::stoull(s));
     }
+
+    // Parse byte counts: "1073741824", "512M", "4G", "1.5GiB", "64KB".
+    // Suffixes are binary (K = 1024); the B and iB spellings are accepted.
+    inline std::size_t parse_bytes(const std::string& s) {
+        std::size_t used = 0;
+        const long double v = std::stold(s, &used);
+        if (!(v > 0.0L)) throw std::invalid_argument("size must be > 0");
+
+        std::string unit = s.substr(used);
+        if (unit.size() >= 2 && (unit.compare(unit.size() - 2, 2, "iB") == 0)) {
+            unit.erase(unit.size() - 2);
+        } else if (!unit.empty() && (unit.back() == 'B' || unit.back() == 'b')) {
+            unit.pop_back();
+        }
+        long double scale = 1.0L;
+        if (unit.size() > 1) throw std::invalid_argument("unknown size suffix: " + s);
+        if (!unit.empty()) {
+            switch (unit[0]) {
+                case 'k': case 'K': scale = 1024.0L; break;
+                case 'm': case 'M': scale = 1024.0L * 1024.0L; break;
+                case 'g': case 'G': scale = 1024.0L * 1024.0L * 1024.0L; break;
+                case 't': case 'T': scale = 1024.0L * 1024.0L * 1024.0L * 1024.0L; break;
+                default: throw std::invalid_argument("unknown size suffix: " + s);
+            }
+        }
+        return static_cast<std::size_t>(std::llround(v * scale));
+    }
+
+    // Parse durations in seconds: "90", "1.5", "30s", "10m", "2h".
+    inline double parse_seconds(const std::string& s) {
+        std::size_t used = 0;
+        const double v = std::stod(s, &used);
+        if (!(v > 0.0)) throw std::invalid_argument("duration must be > 0");
+        const std::string unit = s.substr(used);
+        if (unit.empty() || unit == "s") return v;
+        if (unit == "m") return v * 60.0;
+        if (unit == "h") return v * 3600.0;
+        throw std::invalid_argument("unknown duration suffix: " + s);
+    }
 } // namespace piracer
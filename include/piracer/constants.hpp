@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "piracer/progress.hpp"
+
+namespace piracer {
+    class CancelToken;
+
+    // Constants other than the Chudnovsky π, each summed by the binary-
+    // splitting engine over its series.hpp policy (same scheduler, backend
+    // and tuning as π) and finished with a division, plus a square root for
+    // the Ramanujan π. Names: "e", "log2", "pi-ramanujan".
+    std::vector<std::string> series_constant_names();
+
+    // "X." and `digits` truncated digits in base 10 or 16, as compute_pi_base
+    // gives for π. Throws std::invalid_argument for an unknown name, a base
+    // other than 10 and 16, or 0 digits; ComputeCancelled once `cancel` asks.
+    std::string compute_series_constant(const std::string& name, std::size_t digits, int base = 10,
+                                        int num_threads = 1, Progress* prog = nullptr,
+                                        const CancelToken* cancel = nullptr);
+
+} // namespace piracer
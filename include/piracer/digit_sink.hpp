@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace piracer {
+
+    // Destination for formatted digits, fed in order and in large blocks so
+    // that no caller ever needs the whole result in memory. Errors throw
+    // std::runtime_error.
+    class DigitSink {
+    public:
+        virtual ~DigitSink() = default;
+
+        // Append digits
+        virtual void write(const char* data, std::size_t n) = 0;
+
+        // Append framing around the digits ("3.", the final newline). Sinks
+        // that split output by digit count do not count these bytes.
+        virtual void write_text(const char* data, std::size_t n) { write(data, n); }
+
+        // Flush everything written so far to its destination
+        virtual void finish() {}
+    };
+
+    // Collects the stream into a string (tests, library callers)
+    class StringSink : public DigitSink {
+    public:
+        void write(const char* data, std::size_t n) override { str.append(data, n); }
+        std::string str;
+    };
+
+    // Buffered writer on a file descriptor (file, pipe or terminal). Data is
+    // staged in a page-aligned buffer and written out in full-buffer syscalls.
+    class FdSink : public DigitSink {
+    public:
+        static constexpr std::size_t kDefaultBuffer = std::size_t(4) << 20;
+
+        // `owns` closes the descriptor on destruction
+        explicit FdSink(int fd, bool owns = false, std::size_t buffer_bytes = kDefaultBuffer);
+        ~FdSink() override;
+
+        FdSink(const FdSink&) = delete;
+        FdSink& operator=(const FdSink&) = delete;
+
+        // Create or truncate `path` for writing
+        static std::unique_ptr<FdSink> open_file(const std::string& path,
+                                                 std::size_t buffer_bytes = kDefaultBuffer);
+
+        void write(const char* data, std::size_t n) override;
+        void finish() override;
+
+        std::size_t bytes_written() const { return total_; }
+
+    private:
+        struct AlignedFree {
+            void operator()(char* p) const;
+        };
+
+        int fd_;
+        bool owns_;
+        std::unique_ptr<char, AlignedFree> buffer_;
+        std::size_t capacity_;
+        std::size_t used_ = 0;
+        std::size_t total_ = 0;
+
+        void drain();
+        void write_all(const char* data, std::size_t n);
+    };
+
+    // Splits the digit stream into files of `digits_per_file` digits each,
+    // named like y-cruncher's chunked output: "pi.txt" becomes "pi - 0.txt",
+    // "pi - 1.txt", ... Framing text goes into the current file, so the files
+    // concatenate to exactly the single-file output.
+    class ChunkedFileSink : public DigitSink {
+    public:
+        ChunkedFileSink(std::string path, std::size_t digits_per_file,
+                        std::size_t buffer_bytes = FdSink::kDefaultBuffer);
+
+        void write(const char* data, std::size_t n) override;
+        void write_text(const char* data, std::size_t n) override;
+        void finish() override;
+
+        std::size_t files_written() const { return index_; }
+
+        // Name of chunk `index` for `path`
+        static std::string chunk_name(const std::string& path, std::size_t index);
+
+    private:
+        std::string path_;
+        std::size_t per_file_;
+        std::size_t buffer_bytes_;
+        std::size_t index_ = 0;      // number of files opened so far
+        std::size_t in_file_ = 0;    // digits in the current file
+        std::unique_ptr<FdSink> current_;
+
+        void next_file();
+    };
+
+} // namespace piracer
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <gmpxx.h>
+#include <memory>
+#include <string>
+
+namespace piracer {
+    class ThreadPool;
+
+    // Directory holding the spill files of one out-of-core run. Files get
+    // unique names and are removed with their DiskInt; the directory itself
+    // is created if needed and removed on destruction if this created it.
+    // I/O errors throw std::runtime_error.
+    class ScratchSpace {
+    public:
+        explicit ScratchSpace(std::string dir);
+        ~ScratchSpace();
+
+        ScratchSpace(const ScratchSpace&) = delete;
+        ScratchSpace& operator=(const ScratchSpace&) = delete;
+
+        const std::string& dir() const { return dir_; }
+
+        // Path for a new spill file
+        std::string new_path();
+
+        // Limb bytes currently on disk, and the high-water mark
+        std::size_t bytes_on_disk() const { return bytes_; }
+        std::size_t peak_bytes_on_disk() const { return peak_bytes_; }
+
+    private:
+        friend class DiskInt;
+        friend class DiskIntWriter;
+
+        std::string dir_;
+        bool created_ = false;
+        std::uint64_t next_id_ = 0;
+        std::size_t bytes_ = 0;
+        std::size_t peak_bytes_ = 0;
+
+        void add_bytes(std::size_t n);
+        void sub_bytes(std::size_t n);
+    };
+
+    // Integer whose limbs live in a scratch file: native limbs, least
+    // significant first, unpadded (the layout of the binary checkpoint's
+    // integer records). Accessed in blocks with read-ahead and write-behind,
+    // so its size is bounded by the disk rather than by memory.
+    class DiskInt {
+    public:
+        DiskInt();
+        ~DiskInt();
+
+        DiskInt(DiskInt&& other) noexcept;
+        DiskInt& operator=(DiskInt&& other) noexcept;
+        DiskInt(const DiskInt&) = delete;
+        DiskInt& operator=(const DiskInt&) = delete;
+
+        // Write x out and release its memory (x becomes 0)
+        static DiskInt spill(ScratchSpace& space, mpz_class& x);
+
+        // Read the whole value back
+        void load(mpz_class& x) const;
+
+        std::size_t limbs() const { return limbs_; }
+        int sign() const { return limbs_ == 0 ? 0 : (negative_ ? -1 : 1); }
+        std::size_t bytes() const { return limbs_ * sizeof(mp_limb_t); }
+
+        // Delete the file now (the value becomes 0)
+        void reset();
+
+    private:
+        friend class DiskIntWriter;
+        friend class DiskIntReader;
+
+        struct File;
+        ScratchSpace* space_ = nullptr;
+        std::unique_ptr<File> file_;
+        std::size_t limbs_ = 0;
+        bool negative_ = false;
+    };
+
+    // Settings of the streamed arithmetic below. Memory use is a small
+    // multiple of `block_limbs` (about 56 limbs of working set per block
+    // limb, NTT scratch included); operands of any size are handled.
+    struct DiskMath {
+        ScratchSpace* space = nullptr;
+        std::size_t block_limbs = std::size_t(1) << 20;
+        ThreadPool* pool = nullptr;  // for the block products (may be null)
+    };
+
+    // Block size for a memory limit in bytes
+    std::size_t disk_block_limbs(std::size_t memory_bytes);
+
+    // Installed RAM in bytes, 0 if unknown
+    std::size_t physical_memory_bytes();
+
+    // a * b, one block product at a time: output block k collects
+    // sum_{i+j=k} a_i * b_j in memory and is written out as soon as no later
+    // product reaches it
+    DiskInt disk_mul(const DiskInt& a, const DiskInt& b, const DiskMath& m);
+
+    // a + b (signed), in one streaming pass (two if the signs differ and
+    // the magnitudes have to be compared first)
+    DiskInt disk_add(const DiskInt& a, const DiskInt& b, const DiskMath& m);
+} // namespace piracer
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "piracer/bsplit.hpp"
+
+namespace piracer {
+
+    // Binary splitting across hosts over plain TCP. Each worker host runs
+    // serve_bsplit_worker; the coordinator cuts [a, b) into equal
+    // contiguous ranges and hands them to the workers. A worker builds its
+    // range with the threaded engine and sends P/Q/T back in the binary
+    // checkpoint encoding (checkpoint.hpp). The coordinator merges the
+    // ranges in a balanced tree above them, on its own threads: there is no
+    // reduce across the nodes, so the largest merges all run on one host and
+    // bound the speedup (docs/architecture.md has measurements).
+    //
+    // Protocol, one request line per range:
+    //   "BSPLIT <a> <b> <need_p 0|1>\n"
+    // answered "OK\n" plus one encoded segment [a, b), or "ERR <message>\n".
+    // Requests on one connection are answered in order. The encoding checks
+    // byte order and limb size, so mixed hosts fail at the first range.
+    // There is no authentication: run workers on a trusted network only.
+
+    // Ranges per node: the second is sent while the first is being built,
+    // and results from earlier rounds are received and merged while later
+    // ranges are still being built
+    constexpr int kDistributedRangesPerNode = 2;
+
+    // [a, b) over the workers at `nodes` ("host:port", "[v6addr]:port").
+    // Each worker gets up to two requests at a time. If a node fails (no
+    // connection, an error reply, a broken link), its ranges go back to the
+    // queue for the others. That includes sending more data than
+    // bsplit_result_bytes allows for the range, which is refused before
+    // anything is allocated. `num_threads` is for the merges on this host.
+    // Progress, need_p and cancel work as for bsplit_chudnovsky_parallel; a
+    // cancelled run drops its connections, which stops the workers too.
+    // Throws std::runtime_error once no node is left with ranges to do.
+    BSplitTriplet bsplit_chudnovsky_distributed(long a, long b, const std::vector<std::string>& nodes,
+                                                int num_threads, Progress* prog = nullptr, bool need_p = true,
+                                                const CancelToken* cancel = nullptr);
+
+    // Serves ranges on TCP `address` until accept fails. The address is
+    // "[host:]port"; without a host it listens on 127.0.0.1 only, and
+    // "0.0.0.0:port" listens on every interface. There is one thread per
+    // connection, and each range is built on `num_threads` under
+    // `max_memory` (as for bsplit_chudnovsky_parallel).
+    //
+    // A range whose estimated peak (bsplit_peak_bytes) exceeds `max_memory`
+    // (0: half the RAM) is answered "ERR", so no request can run the worker
+    // out of memory. A range is sent back while the next one on the same
+    // connection is built, and the ranges of a coordinator that has hung up
+    // are abandoned. Throws std::runtime_error if the socket cannot be set up.
+    void serve_bsplit_worker(const std::string& address, int num_threads, std::size_t max_memory = 0,
+                             std::function<void(const std::string&)> log = {});
+
+} // namespace piracer
@@ -4,9 +4,31 @@
 #include <mpfr.h>
 
 namespace piracer {
+    class DigitSink;
+    class ThreadPool;
+
     // Convert an MPFR value to a fixed-point decimal string "X.Y..." with exactly `digits` decimals.
-    std::string mpfr_to_fixed_decimal(const mpfr_t v, std::size_t digits);
-    
+    // Digits are truncated (not rounded); with a pool the radix conversion runs in parallel.
+    std::string mpfr_to_fixed_decimal(const mpfr_t v, std::size_t digits, ThreadPool* pool = nullptr);
+
     // Convert an MPFR value to a fixed-point hexadecimal string "X.Y..." with exactly `digits` hex digits.
-    std::string mpfr_to_fixed_hex(const mpfr_t v, std::size_t digits);
-} // namespace piracer
\ No newline at end of file
+    // The digits are expanded straight from the mantissa limbs (no string conversion, no copy).
+    std::string mpfr_to_fixed_hex(const mpfr_t v, std::size_t digits, ThreadPool* pool = nullptr);
+
+    // `count` hex digits of the fraction of |v| starting `position` digits
+    // after the point (zeros past the mantissa), read in place: the digits
+    // mpfr_to_fixed_hex would put there, without the ones before them.
+    std::string mpfr_hex_digits_at(const mpfr_t v, std::size_t position, std::size_t count);
+
+    // Same window in decimal. Only that window is converted: with |v| =
+    // I + r / 2^s, digit `position` on is the start of the fraction
+    // (r * 10^position mod 2^s) / 2^s, one product away, so the cost is a
+    // multiplication at v's precision plus a conversion of `count` digits.
+    std::string mpfr_decimal_digits_at(const mpfr_t v, std::size_t position, std::size_t count,
+                                       ThreadPool* pool = nullptr);
+
+    // Streaming forms: "X." goes to the sink as framing text, then the digits
+    // in order, without materializing the whole string.
+    void write_fixed_decimal(DigitSink& sink, const mpfr_t v, std::size_t digits, ThreadPool* pool = nullptr);
+    void write_fixed_hex(DigitSink& sink, const mpfr_t v, std::size_t digits, ThreadPool* pool = nullptr);
+} // namespace piracer
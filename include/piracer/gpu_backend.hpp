@@ -1,16 +1,26 @@
 #pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <gmpxx.h>
 #include <string>
 #include <vector>
 #include <memory>
 #include <functional>
 
+// Big-integer multiplication offload. The CUDA backend (built with
+// -DPIRACER_ENABLE_CUDA=ON) runs the same three-prime NTT as mul_ntt on the
+// device and recombines on the host; without a device, or in builds without
+// it, the CPU backend (mul_big on a thread pool) takes its place.
 namespace piracer {
+    class ThreadPool;
 
     // GPU backend types
     enum class GPUBackend {
         CUDA,
-        OpenCL,
-        Auto  // Automatically select best available
+        OpenCL,  // not implemented: never available
+        CPU,     // host fallback, always available
+        Auto     // Automatically select best available
     };
 
     // GPU device information
@@ -56,30 +66,50 @@ namespace piracer {
     class GPUMultiplier {
     public:
         virtual ~GPUMultiplier() = default;
-        
-        // Multiply two large integers (represented as byte arrays)
-        virtual std::vector<uint8_t> multiply(const std::vector<uint8_t>& a, 
-                                            const std::vector<uint8_t>& b) = 0;
-        
+
+        // One product of a batch: *out = *a * *b. `out` must not alias any
+        // input of the batch (the products run concurrently).
+        struct BatchProduct {
+            const mpz_class* a;
+            const mpz_class* b;
+            mpz_class* out;
+        };
+
+        // All products of `jobs`, the form the bsplit engine uses. Products
+        // too small to pay for a transfer run on the CPU (on `pool`) while
+        // the device works. Throws std::runtime_error on device errors.
+        virtual void multiply_products(const std::vector<BatchProduct>& jobs, ThreadPool* pool = nullptr) = 0;
+
+        // "cuda: <device>" or "cpu"
+        virtual std::string backend_name() const = 0;
+
+        // Multiply two large integers (little-endian magnitude bytes)
+        virtual std::vector<uint8_t> multiply(const std::vector<uint8_t>& a,
+                                            const std::vector<uint8_t>& b);
+
         // Multiply multiple pairs at once (batch operation)
         virtual std::vector<std::vector<uint8_t>> multiply_batch(
-            const std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>>& pairs) = 0;
+            const std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>>& pairs);
         
         // Get performance metrics
         virtual double get_multiplication_time_ms() const = 0;
         virtual size_t get_memory_usage_mb() const = 0;
         
-        // Benchmark operations
+        // Benchmark operations: `iterations` products of two random
+        // `digit_count`-digit operands; the average lands in
+        // get_multiplication_time_ms
         virtual void benchmark(size_t digit_count, int iterations = 100) = 0;
     };
 
     // GPU backend factory
     class GPUBackendFactory {
     public:
-        // Create GPU context
+        // Create GPU context (null where the backend has no device, and for CPU)
         static std::unique_ptr<GPUContext> create_context(GPUBackend backend = GPUBackend::Auto);
-        
-        // Create GPU multiplier
+
+        // Create GPU multiplier. Auto picks CUDA when a device is present and
+        // the CPU backend otherwise; an explicit backend that is not
+        // available throws std::runtime_error.
         static std::unique_ptr<GPUMultiplier> create_multiplier(GPUBackend backend = GPUBackend::Auto);
         
         // Check if backend is available
@@ -92,6 +122,17 @@ namespace piracer {
         static std::string get_backend_info(GPUBackend backend);
     };
 
+    // Totals over all device work of the process (the CUDA backend adds to
+    // them; GPUProfiler reports their change over its window)
+    struct GPUStats {
+        double kernel_ms = 0.0;
+        double transfer_ms = 0.0;
+        std::size_t bytes_allocated = 0;
+        std::size_t operations = 0;  // butterflies and pointwise products
+    };
+    GPUStats gpu_stats();
+    void gpu_stats_add(const GPUStats& delta);
+
     // GPU performance profiler
     class GPUProfiler {
     public:
@@ -123,32 +164,42 @@ namespace piracer {
         bool export_to_csv(const std::string& filename) const;
         
     private:
-        ProfileResult current_result_;
+        ProfileResult current_result_{};
+        GPUStats start_stats_;
         bool is_profiling_ = false;
         std::chrono::high_resolution_clock::time_point start_time_;
     };
 
-    // GPU memory manager
+    // GPU memory manager: device allocations of the current CUDA device,
+    // tracked until freed (or clear_all / destruction). Every call throws
+    // std::runtime_error in builds without the CUDA backend or on failure.
     class GPUMemoryManager {
     public:
         GPUMemoryManager() = default;
-        ~GPUMemoryManager() = default;
-        
+        ~GPUMemoryManager() { clear_all(); }
+
+        GPUMemoryManager(const GPUMemoryManager&) = delete;
+        GPUMemoryManager& operator=(const GPUMemoryManager&) = delete;
+
         // Allocate GPU memory
         template<typename T>
-        T* allocate_gpu(size_t count);
-        
+        T* allocate_gpu(size_t count) { return static_cast<T*>(raw_allocate(count * sizeof(T))); }
+
         // Free GPU memory
         template<typename T>
-        void free_gpu(T* ptr);
-        
+        void free_gpu(T* ptr) { raw_free(ptr); }
+
         // Copy data to GPU
         template<typename T>
-        void copy_to_gpu(const std::vector<T>& host_data, T* gpu_ptr);
-        
-        // Copy data from GPU
+        void copy_to_gpu(const std::vector<T>& host_data, T* gpu_ptr) {
+            raw_copy(gpu_ptr, host_data.data(), host_data.size() * sizeof(T), true);
+        }
+
+        // Copy data from GPU: host_data.size() elements
         template<typename T>
-        void copy_from_gpu(T* gpu_ptr, std::vector<T>& host_data);
+        void copy_from_gpu(T* gpu_ptr, std::vector<T>& host_data) {
+            raw_copy(host_data.data(), gpu_ptr, host_data.size() * sizeof(T), false);
+        }
         
         // Get memory usage statistics
         size_t get_total_allocated_mb() const;
@@ -164,6 +215,10 @@ namespace piracer {
             size_t size;
             std::chrono::system_clock::time_point timestamp;
         };
+
+        void* raw_allocate(size_t bytes);
+        void raw_free(void* ptr);
+        void raw_copy(void* dst, const void* src, size_t bytes, bool to_device);
         
         std::vector<Allocation> allocations_;
         size_t total_allocated_ = 0;
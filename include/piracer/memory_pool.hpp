@@ -1,66 +1,172 @@
 #pragma once
-#include <vector>
-#include <memory>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
 
 namespace piracer {
-    
-    // Memory pool for efficient allocation of large numbers
-    // Reduces malloc overhead and improves cache locality
-    
+    struct ThreadCache;
+
+    // Allocator for limb buffers and other short-lived numeric storage.
+    // All memory comes from one large virtual reservation (the arena),
+    // advised for transparent huge pages and managed as a buddy system:
+    //  - Small blocks (up to kMaxSmallBytes) use size classes. Every thread
+    //    keeps its own free lists and carves new blocks from 2 MiB chunks, so
+    //    the hot path takes no lock; surplus blocks move to per-class central
+    //    lists in batches.
+    //  - Large blocks are power-of-two buddies. Freed neighbours coalesce and
+    //    keep their pages, so later (larger) requests reuse memory that is
+    //    already resident instead of faulting in fresh pages. The rounding
+    //    costs address space only: untouched tails are never backed.
+    // Frees must pass the size given at allocation (as GMP does). Pointers
+    // from outside the arena are handed to std::free. Where no arena can be
+    // reserved (Windows, strict overcommit) the pool passes through to malloc.
+
     class MemoryPool {
     public:
-        explicit MemoryPool(size_t initial_size = 1024 * 1024);  // 1MB default
-        ~MemoryPool() = default;
-        
+        static constexpr std::size_t kChunkBytes = std::size_t(2) << 20;
+        static constexpr std::size_t kMaxSmallBytes = std::size_t(256) << 10;
+        static constexpr int kClasses = 52;
+
+        constexpr MemoryPool() noexcept {}
+        explicit MemoryPool(size_t initial_size);
+        ~MemoryPool() = default;  // the arena stays reserved until exit
+
         // Disable copy
         MemoryPool(const MemoryPool&) = delete;
         MemoryPool& operator=(const MemoryPool&) = delete;
-        
-        // Allocate memory
+
+        // Allocate memory (throws std::bad_alloc). Small blocks are 16-byte
+        // aligned; large ones at least page aligned while the pool is active.
         void* allocate(size_t size);
-        
-        // Deallocate memory (no-op for pool)
+
+        // Return memory obtained from allocate(size)
         void deallocate(void* ptr, size_t size);
-        
+
+        // Resize, preserving min(old_size, new_size) bytes. Large blocks grow
+        // in place while their buddies are free.
+        void* reallocate(void* ptr, size_t old_size, size_t new_size);
+
+        // False if the arena could not be reserved (everything goes to malloc)
+        bool active();
+
         // Get pool statistics
-        size_t total_allocated() const { return total_allocated_; }
-        size_t total_used() const { return total_used_; }
-        size_t pool_count() const { return pools.size(); }
-        
-        // Clear all pools
+        // Arena bytes handed out: chunks plus large blocks at buddy size
+        size_t total_allocated() const { return allocated_.load(std::memory_order_relaxed); }
+        // High-water mark of total_allocated()
+        size_t peak_allocated() const { return peak_allocated_.load(std::memory_order_relaxed); }
+        // High-water mark of total_allocated() since the last reset_window_peak(),
+        // for the peak of one phase of a computation
+        size_t window_peak() const { return window_peak_.load(std::memory_order_relaxed); }
+        void reset_window_peak() { window_peak_.store(total_allocated(), std::memory_order_relaxed); }
+        // Bytes in live blocks (small ones at size-class size)
+        size_t total_used() const;
+        // Number of 2 MiB chunks backing the small size classes
+        size_t pool_count() const { return chunk_count_.load(std::memory_order_relaxed); }
+
+        // Give the pages of free large blocks and unused chunks back to the OS
         void clear();
-        
-        // Reserve additional memory
+
+        // Set chunks aside for at least `size` bytes of small blocks
         void reserve(size_t size);
-        
+
+        // Large blocks of at least `bytes` get their pages interleaved over
+        // the NUMA nodes (numa_interleave) until reset with 0. Only pages not
+        // yet faulted in are placed; single-node machines ignore this.
+        void set_interleave_threshold(size_t bytes) { interleave_bytes_.store(bytes, std::memory_order_relaxed); }
+
     private:
-        struct Pool {
-            std::vector<uint8_t> data;
-            size_t used = 0;
-            
-            Pool(size_t size) : data(size) {}
-            
-            bool can_allocate(size_t size) const {
-                return used + size <= data.size();
-            }
-            
-            void* allocate(size_t size) {
-                if (!can_allocate(size)) return nullptr;
-                void* ptr = data.data() + used;
-                used += size;
-                return ptr;
-            }
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        // Unused tail of a chunk left by an exited thread
+        struct Region {
+            Region* next;
+            char* end;
+        };
+        static constexpr std::size_t kMinRegionBytes = std::size_t(64) << 10;
+
+        struct alignas(64) Central {
+            std::mutex mutex;
+            FreeBlock* head = nullptr;
+            size_t count = 0;
         };
-        
-        std::vector<std::unique_ptr<Pool>> pools;
-        size_t total_allocated_ = 0;
-        size_t total_used_ = 0;
-        
-        // Find or create pool that can fit the request
-        Pool* find_or_create_pool(size_t size);
+
+        // Buddy orders: block sizes 2^kMinShift .. 2^kMaxShift
+        static constexpr unsigned kMinShift = 19;
+        static constexpr unsigned kMaxShift = 40;
+        static constexpr unsigned kOrders = kMaxShift - kMinShift + 1;
+
+        friend struct ThreadCache;
+
+        Central central_[kClasses];
+
+        // Arena and buddy state (guarded by arena_mutex_). Per minimum-size
+        // block: state_ (free / allocated head and its order) and slot_ (its
+        // index in the free list of its order).
+        std::once_flag arena_once_;
+        std::mutex arena_mutex_;
+        char* base_ = nullptr;
+        size_t arena_bytes_ = 0;
+        unsigned top_order_ = 0;
+        std::uint8_t* state_ = nullptr;
+        std::uint32_t* slot_ = nullptr;
+        std::uint32_t* free_list_[kOrders] = {};
+        size_t free_count_[kOrders] = {};
+
+        // Chunks set aside by reserve(), chunk tails of exited threads, and
+        // the bump region for threads without a cache (and pools other than
+        // g_memory_pool)
+        std::mutex chunk_mutex_;
+        FreeBlock* spare_chunks_ = nullptr;
+        Region* regions_ = nullptr;
+        char* bump_ = nullptr;
+        char* bump_end_ = nullptr;
+
+        std::atomic<size_t> allocated_{0};
+        std::atomic<size_t> peak_allocated_{0};
+        std::atomic<size_t> window_peak_{0};
+        std::atomic<size_t> chunk_count_{0};
+        std::atomic<size_t> interleave_bytes_{0};
+        std::atomic<std::int64_t> large_used_{0};
+        std::atomic<std::int64_t> small_used_{0};  // central path and exited threads
+
+        // Live thread caches, for total_used()
+        mutable std::mutex caches_mutex_;
+        ThreadCache* caches_ = nullptr;
+
+        void init_arena();
+        bool owns(const void* p) const {
+            return static_cast<const char*>(p) >= base_ && static_cast<const char*>(p) < base_ + arena_bytes_;
+        }
+
+        // Buddy system; callers hold arena_mutex_
+        std::size_t block_index(const void* p) const;
+        void push_free(unsigned k, std::size_t i);
+        void remove_free(unsigned k, std::size_t i);
+        void* alloc_block(unsigned k);
+        void free_block(std::size_t i);
+        bool grow_block(std::size_t i, unsigned k, unsigned target);
+
+        char* new_chunk();
+        void give_region(char* begin, char* end);
+        bool take_region(size_t bytes, char*& begin, char*& end);
+        void* carve(size_t bytes);
+        void* allocate_small(int c);
+        void deallocate_small(void* ptr, int c);
+        void* allocate_large(size_t size);
+        void deallocate_large(void* ptr);
+        void account(std::int64_t delta);
+
+        // Batch moves between a thread cache and the central lists
+        void push_central(int c, FreeBlock* head, FreeBlock* tail, size_t n);
+        size_t pop_central(int c, FreeBlock*& head, size_t max);
     };
-    
+
     // Custom allocator using memory pool
     template<typename T>
     class PoolAllocator {
@@ -68,48 +174,57 @@ namespace piracer {
         using value_type = T;
         using size_type = std::size_t;
         using difference_type = std::ptrdiff_t;
-        
+
         explicit PoolAllocator(MemoryPool* pool) : pool_(pool) {}
-        
+
         template<typename U>
-        PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool_) {}
-        
+        PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool()) {}
+
         T* allocate(size_type n) {
-            size_type bytes = n * sizeof(T);
-            return static_cast<T*>(pool_->allocate(bytes));
+            return static_cast<T*>(pool_->allocate(n * sizeof(T)));
         }
-        
+
         void deallocate(T* p, size_type n) {
-            // No-op for pool allocator
-            (void)p; (void)n;
+            pool_->deallocate(p, n * sizeof(T));
         }
-        
+
         template<typename U, typename... Args>
         void construct(U* p, Args&&... args) {
             ::new(p) U(std::forward<Args>(args)...);
         }
-        
+
         template<typename U>
         void destroy(U* p) {
             p->~U();
         }
-        
+
         MemoryPool* pool() const { return pool_; }
-        
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U>& other) const { return pool_ == other.pool(); }
+        template<typename U>
+        bool operator!=(const PoolAllocator<U>& other) const { return pool_ != other.pool(); }
+
     private:
         MemoryPool* pool_;
     };
-    
+
     // Global memory pool instance
     extern MemoryPool g_memory_pool;
-    
+
+    // Route all GMP (and therefore MPFR) allocations through g_memory_pool.
+    // Must run before the first GMP allocation, i.e. at the top of main().
+    // Does nothing if the pool is not active.
+    void install_gmp_allocator();
+    bool gmp_allocator_installed();
+
     // Convenience functions
     template<typename T>
     using pool_vector = std::vector<T, PoolAllocator<T>>;
-    
+
     template<typename T>
     pool_vector<T> make_pool_vector(size_t size = 0) {
         return pool_vector<T>(size, PoolAllocator<T>(&g_memory_pool));
     }
-    
-} // namespace piracer 
\ No newline at end of file
+
+} // namespace piracer
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+
+// Scalar word-sized modular arithmetic shared by the NTT backend and its
+// SIMD kernels. Only available with 128-bit integer support.
+#if defined(__SIZEOF_INT128__)
+#define PIRACER_HAVE_U128 1
+
+namespace piracer {
+    namespace mont {
+        __extension__ typedef unsigned __int128 u128;
+
+        inline std::uint64_t add(std::uint64_t a, std::uint64_t b, std::uint64_t p) {
+            std::uint64_t s = a + b;
+            return s >= p ? s - p : s;
+        }
+
+        inline std::uint64_t sub(std::uint64_t a, std::uint64_t b, std::uint64_t p) {
+            return a >= b ? a - b : a + p - b;
+        }
+
+        // Montgomery product a*b/2^64 mod p for a, b < p (REDC, high-half form)
+        inline std::uint64_t mul(std::uint64_t a, std::uint64_t b, std::uint64_t p, std::uint64_t inv) {
+            const u128 t = static_cast<u128>(a) * b;
+            const std::uint64_t m  = static_cast<std::uint64_t>(t) * inv;
+            const std::uint64_t mh = static_cast<std::uint64_t>((static_cast<u128>(m) * p) >> 64);
+            const std::uint64_t th = static_cast<std::uint64_t>(t >> 64);
+            return th >= mh ? th - mh : th - mh + p;
+        }
+
+        // p^-1 mod 2^64 by Newton iteration (p odd)
+        inline std::uint64_t inverse_2_64(std::uint64_t p) {
+            std::uint64_t x = p;  // correct to 3 bits
+            for (int i = 0; i < 5; ++i) x *= 2 - p * x;
+            return x;
+        }
+
+        inline std::uint64_t to_mont(std::uint64_t x, std::uint64_t p) {
+            return static_cast<std::uint64_t>((static_cast<u128>(x % p) << 64) % p);
+        }
+    } // namespace mont
+} // namespace piracer
+
+#else
+#define PIRACER_HAVE_U128 0
+#endif
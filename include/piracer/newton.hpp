@@ -0,0 +1,18 @@
+#pragma once
+#include <gmpxx.h>
+
+namespace piracer {
+    class ThreadPool;
+
+    // Fixed-point Newton iterations on integers. Each step doubles the
+    // precision of the previous one, so the full-size products (mul_big, on
+    // `pool` when given) of the last step dominate: roughly three full
+    // multiplications for a reciprocal or inverse square root, instead of a
+    // sequential division. Results are within a few units of the last place.
+
+    // y ~ 2^(bitlen(d) + bits) / d for d > 0, i.e. 2^bits times a value in (1, 2]
+    void reciprocal_fixed(mpz_class& y, const mpz_class& d, long bits, ThreadPool* pool = nullptr);
+
+    // r ~ 2^bits / sqrt(x) for x > 0
+    void inv_sqrt_fixed(mpz_class& r, unsigned long x, long bits, ThreadPool* pool = nullptr);
+} // namespace piracer
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "piracer/chudnovsky.hpp"
+
+namespace piracer {
+    struct AlgorithmConfig;
+    class DigitSink;
+
+    // The one π engine behind every compute_pi* entry point. A run goes
+    // through the PiStage stages in order:
+    //  - series: Chudnovsky binary splitting (in memory, resumable or out of
+    //    core, per the options)
+    //  - sqrt, divide: 426880 sqrt(10005) Q / T; at high precision sqrt runs
+    //    beside divide as Newton iterations, otherwise through MPFR
+    //  - radix, write: conversion to the output base, streamed block by
+    //    block into the sink
+    //  - verify (opt-in): BBP spot checks of the value's hex digits, into
+    //    ComputeReport::checks
+    // ComputeOptions::cancel is polled before every stage and within the
+    // series. Each stage's wall and CPU time and memory peak go to
+    // ComputeReport::stages. Stages that overlap (sqrt with divide, radix
+    // with write) share one memory peak; the CPU time of an overlapped
+    // stage is what its own thread used.
+    class PiPipeline {
+    public:
+        explicit PiPipeline(ComputeOptions opts);
+
+        // Options from an algorithm configuration: num_threads, and the base
+        // from output_format ("decimal" or "hex"). Throws
+        // std::invalid_argument for other formats.
+        PiPipeline(std::size_t digits, const AlgorithmConfig& config, Progress* prog = nullptr);
+
+        // Run every stage, streaming "3." plus the digits into `sink`
+        // (not finished). Throws std::invalid_argument unless base is 10 or 16.
+        ComputeReport run(DigitSink& sink);
+
+        // The whole result as one string
+        std::string run_to_string(ComputeReport* report = nullptr);
+
+        // Only the `count` digits from `start` digits after the point (the
+        // options' digits are ignored): the same characters the full result
+        // has there, without forming it. Small hex windows come from BBP
+        // digit extraction, in parallel and without a series; otherwise π is
+        // computed to start + count digits and just the window converted.
+        std::string run_range(std::size_t start, std::size_t count, ComputeReport* report = nullptr);
+
+        const ComputeOptions& options() const { return opts_; }
+
+        // Series terms for `digits` in `base`: each term adds about 14.18
+        // decimal digits (47.11 bits)
+        static long series_terms(std::size_t digits, int base);
+
+    private:
+        ComputeOptions opts_;
+    };
+} // namespace piracer
@@ -1,10 +1,20 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <utility>
+
+// Hot-path sections (PIRACER_PROFILE_SCOPE) are compiled in only with
+// -DPIRACER_ENABLE_PROFILING=ON, which defines PIRACER_PROFILING=1
+#ifndef PIRACER_PROFILING
+#define PIRACER_PROFILING 0
+#endif
 
 namespace piracer {
 
@@ -29,84 +39,164 @@ namespace piracer {
         std::string unit;
         std::chrono::system_clock::time_point timestamp;
         std::map<std::string, std::string> metadata;
-        
-        PerformanceEvent(const std::string& n, const std::string& cat, 
+
+        PerformanceEvent(const std::string& n, const std::string& cat,
                         ProfilerMetric m, double v, const std::string& u = "")
             : name(n), category(cat), metric(m), value(v), unit(u),
               timestamp(std::chrono::system_clock::now()) {}
     };
 
-    // Performance profiler
+    // Section recording behind PerformanceProfiler. Every thread aggregates
+    // its sections in a table of its own (no locks after the first use of a
+    // section), keyed by the current phase and the section name; the
+    // profiler merges the tables when asked. A section records calls, wall
+    // time and, where perf_event_open is available (Linux, permitted by
+    // perf_event_paranoid), cycles, instructions, cache and branch misses of
+    // its thread. Nested sections count inclusively.
+    namespace profiling {
+        enum Counter { kCycles, kInstructions, kCacheMisses, kBranchMisses, kCounters };
+
+        struct Sample {
+            std::uint64_t wall_ns = 0;
+            std::uint64_t counters[kCounters] = {};
+            bool counted = false;  // counters were read
+        };
+
+        extern std::atomic<bool> g_enabled;
+        inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+        // Phase new sections are filed under, for all threads (a pipeline
+        // stage name). `phase` must have static lifetime.
+        void set_phase(const char* phase);
+        const char* current_phase();
+
+        // Records [construction, destruction) as section `name` (static
+        // lifetime; null: records nothing) when profiling is enabled
+        class Scope {
+        public:
+            explicit Scope(const char* name) {
+                if (name && enabled()) begin(name);
+            }
+            ~Scope() {
+                if (name_) end();
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            void begin(const char* name);
+            void end();
+
+            const char* name_ = nullptr;
+            const char* phase_ = nullptr;
+            Sample start_;
+        };
+
+        // Sets the phase for its lifetime (restoring the previous one) and
+        // records itself as section "stage" on the calling thread
+        class PhaseScope {
+        public:
+            explicit PhaseScope(const char* phase);
+            ~PhaseScope();
+
+            PhaseScope(const PhaseScope&) = delete;
+            PhaseScope& operator=(const PhaseScope&) = delete;
+
+        private:
+            const char* previous_;
+            Scope scope_;
+        };
+    } // namespace profiling
+
+    // Performance profiler. Sections are process-wide (see profiling::Scope):
+    // every instance reports the same ones, next to its own custom metrics.
     class PerformanceProfiler {
     public:
-        PerformanceProfiler() = default;
+        PerformanceProfiler();
         ~PerformanceProfiler() = default;
-        
+
+        // Start / stop recording sections (off by default). Hardware counters
+        // are opened per thread on its first section, when available.
+        void enable(bool on = true, bool hardware_counters = true);
+        bool enabled() const { return profiling::enabled(); }
+
+        // Whether this thread could open its hardware counters
+        bool hardware_counters_available() const;
+
         // Start profiling a section
         void start_section(const std::string& name, const std::string& category = "default");
-        
+
         // End profiling a section
         void end_section(const std::string& name);
-        
+
         // Measure a function execution time
         template<typename F, typename... Args>
         auto measure_function(const std::string& name, F&& func, Args&&... args)
-            -> decltype(func(std::forward<Args>(args)...);
-        
+            -> decltype(func(std::forward<Args>(args)...));
+
         // Add custom metric
-        void add_metric(const std::string& name, ProfilerMetric metric, double value, 
+        void add_metric(const std::string& name, ProfilerMetric metric, double value,
                        const std::string& unit = "", const std::string& category = "default");
-        
+
         // Get profiling results
         struct ProfilingResult {
             std::vector<PerformanceEvent> events;
-            std::map<std::string, double> section_times;
+            std::map<std::string, double> section_times;  // "phase/name" -> wall ms
             std::map<std::string, std::vector<double>> metric_values;
             double total_time_ms;
             size_t total_events;
         };
-        
+
         ProfilingResult get_results() const;
-        
+
         // Export results to various formats
         bool export_to_csv(const std::string& filename) const;
         bool export_to_json(const std::string& filename) const;
         bool export_to_html(const std::string& filename) const;
-        
+
         // Generate performance report
         std::string generate_report() const;
-        
-        // Reset profiler
+
+        // Reset profiler (between runs: sections still open are lost)
         void reset();
-        
+
         // Get current memory usage
         size_t get_current_memory_usage_mb() const;
-        
+
         // Get peak memory usage
         size_t get_peak_memory_usage_mb() const;
-        
+
     private:
-        struct Section {
-            std::string name;
-            std::string category;
-            std::chrono::high_resolution_clock::time_point start_time;
-            bool is_active;
-        };
-        
-        std::map<std::string, Section> active_sections_;
+        mutable std::mutex mutex_;
         std::vector<PerformanceEvent> events_;
-        std::chrono::high_resolution_clock::time_point profiler_start_;
-        size_t peak_memory_usage_ = 0;
-        
-        void update_memory_usage();
+        std::map<std::string, std::string> categories_;  // section name -> category
+        std::chrono::steady_clock::time_point profiler_start_;
+        mutable size_t peak_memory_usage_ = 0;
+
+        void update_memory_usage() const;
     };
 
+    template<typename F, typename... Args>
+    auto PerformanceProfiler::measure_function(const std::string& name, F&& func, Args&&... args)
+        -> decltype(func(std::forward<Args>(args)...)) {
+        struct End {
+            PerformanceProfiler* self;
+            const std::string& name;
+            ~End() { self->end_section(name); }
+        };
+        start_section(name, "function");
+        End end{this, name};
+        return func(std::forward<Args>(args)...);
+    }
+
     // Cache performance analyzer
     class CacheProfiler {
     public:
-        CacheProfiler() = default;
+        // Cache geometry from the system where it reports it
+        CacheProfiler();
         ~CacheProfiler() = default;
-        
+
         // Analyze cache performance for a data structure
         struct CacheAnalysis {
             size_t total_accesses;
@@ -117,21 +207,25 @@ namespace piracer {
             size_t cache_line_size;
             size_t total_memory_footprint;
         };
-        
-        CacheAnalysis analyze_cache_performance(const void* data, size_t size, 
+
+        // One read pass over `data` with a stride of `access_pattern` bytes
+        // (0: one cache line), counted by the hardware cache-reference and
+        // cache-miss events; estimated from the cache sizes without them
+        CacheAnalysis analyze_cache_performance(const void* data, size_t size,
                                               size_t access_pattern = 0);
-        
-        // Simulate different cache configurations
+
+        // Model of repeated sequential sweeps under L1, L2 and L3 (LRU): a
+        // level misses every line once the footprint exceeds it
         std::vector<CacheAnalysis> simulate_cache_configs(const void* data, size_t size);
-        
+
         // Get cache line size
         size_t get_cache_line_size() const;
-        
+
         // Get L1, L2, L3 cache sizes
         size_t get_l1_cache_size() const;
         size_t get_l2_cache_size() const;
         size_t get_l3_cache_size() const;
-        
+
     private:
         size_t cache_line_size_ = 64;  // Default x86_64 cache line size
         size_t l1_cache_size_ = 32 * 1024;   // 32KB
@@ -144,25 +238,27 @@ namespace piracer {
     public:
         BranchProfiler() = default;
         ~BranchProfiler() = default;
-        
+
         // Analyze branch prediction performance
         struct BranchAnalysis {
             size_t total_branches;
-            size_t taken_branches;
-            size_t not_taken_branches;
+            size_t taken_branches;      // not told apart by the generic
+            size_t not_taken_branches;  // events: reported as 0
             size_t mispredicted_branches;
             double prediction_accuracy;
             double taken_rate;
         };
-        
+
+        // Branch and branch-miss events of this thread around `code` (all
+        // zero without hardware counters); kept as "run <n>"
         BranchAnalysis analyze_branch_performance(const std::function<void()>& code);
-        
+
         // Get branch prediction statistics
         std::map<std::string, BranchAnalysis> get_branch_statistics() const;
-        
+
         // Reset branch counters
         void reset_counters();
-        
+
     private:
         std::map<std::string, BranchAnalysis> branch_stats_;
     };
@@ -172,30 +268,30 @@ namespace piracer {
     public:
         PerformanceComparator() = default;
         ~PerformanceComparator() = default;
-        
+
         // Compare two implementations
         struct ComparisonResult {
             std::string implementation_a;
             std::string implementation_b;
-            double speedup_factor;
-            double memory_ratio;
+            double speedup_factor;  // time of a / time of b
+            double memory_ratio;    // peak bytes of a / of b
             std::vector<std::string> advantages_a;
             std::vector<std::string> advantages_b;
             std::string recommendation;
         };
-        
+
         ComparisonResult compare_implementations(
             const std::string& name_a, const std::function<void()>& impl_a,
             const std::string& name_b, const std::function<void()>& impl_b,
             int iterations = 1000);
-        
+
         // Generate comparison report
         std::string generate_comparison_report(const std::vector<ComparisonResult>& results);
-        
+
         // Export comparison to CSV
-        bool export_comparison_to_csv(const std::string& filename, 
+        bool export_comparison_to_csv(const std::string& filename,
                                     const std::vector<ComparisonResult>& results) const;
-        
+
     private:
         double measure_execution_time(const std::function<void()>& func, int iterations);
         size_t measure_memory_usage(const std::function<void()>& func);
@@ -203,14 +299,24 @@ namespace piracer {
 
     // Global performance profiler instance
     extern std::unique_ptr<PerformanceProfiler> g_profiler;
-    
-    // Convenience macros for profiling
-    #define PROFILE_SECTION(name) \
-        piracer::g_profiler->start_section(name); \
-        auto _profile_end_##name = [&]() { piracer::g_profiler->end_section(name); }; \
-        std::unique_ptr<void, decltype(_profile_end_##name)> _profile_guard_##name(nullptr, _profile_end_##name)
-    
-    #define PROFILE_FUNCTION() \
-        PROFILE_SECTION(__FUNCTION__)
-
-} // namespace piracer 
\ No newline at end of file
+
+    // Section scopes for hot paths: a profiling::Scope when built with
+    // PIRACER_PROFILING, nothing at all otherwise. The _IF form records only
+    // when `cond` holds (keeps small, frequent calls out of the numbers).
+#define PIRACER_PROFILE_CAT2(a, b) a##b
+#define PIRACER_PROFILE_CAT(a, b) PIRACER_PROFILE_CAT2(a, b)
+#if PIRACER_PROFILING
+#define PIRACER_PROFILE_SCOPE(name) \
+    ::piracer::profiling::Scope PIRACER_PROFILE_CAT(piracer_profile_scope_, __LINE__)(name)
+#define PIRACER_PROFILE_SCOPE_IF(cond, name) \
+    ::piracer::profiling::Scope PIRACER_PROFILE_CAT(piracer_profile_scope_, __LINE__)((cond) ? (name) : nullptr)
+#else
+#define PIRACER_PROFILE_SCOPE(name) static_cast<void>(0)
+#define PIRACER_PROFILE_SCOPE_IF(cond, name) static_cast<void>(0)
+#endif
+
+    // Older spellings
+#define PROFILE_SECTION(name) PIRACER_PROFILE_SCOPE(#name)
+#define PROFILE_FUNCTION() PIRACER_PROFILE_SCOPE(__func__)
+
+} // namespace piracer
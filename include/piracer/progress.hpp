@@ -1,8 +1,13 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <string>
 #include <chrono>
 #include <functional>
+#include <thread>
 #include <vector>
 #include <memory>
 
@@ -110,12 +115,47 @@ namespace piracer {
         void update_performance_metrics();
     };
     
-    // Legacy compatibility
+    // Work counted by the threads of a running computation. Every thread
+    // adds to its own cache line (threads beyond kSlots share one), so adding
+    // is an uncontended relaxed atomic add; sum() is exact once the writers
+    // are done and a close lower bound while they run. A copy is a snapshot
+    // of the counts.
+    class ProgressCounters {
+    public:
+        static constexpr std::size_t kSlots = 64;
+
+        ProgressCounters() = default;
+        ProgressCounters(const ProgressCounters& other);
+        ProgressCounters& operator=(const ProgressCounters& other);
+
+        void add(std::uint64_t work);
+        std::uint64_t sum() const;
+        void reset();
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> value{0};
+        };
+        Slot slots_[kSlots];
+    };
+
+    // Legacy compatibility. Workers only ever call add(); `done`, `total`,
+    // `tick` and `tracker` belong to the ProgressReporter of the run, which
+    // calls tick on its own thread. Copies snapshot the fields and counts
+    // and are not reporting, whatever the original is doing.
     struct Progress {
         std::size_t total = 0;
         std::size_t done  = 0;
         void (*tick)(std::size_t done, std::size_t total, void* user) = nullptr;
         void* user = nullptr;
+
+        // Also updated by the reporter when set
+        ProgressTracker* tracker = nullptr;
+
+        ProgressCounters counters;
+        std::atomic<bool> reporting{false};  // a reporter is running
+
+        void add(std::uint64_t work) { counters.add(work); }
         
         // Constructor for easy conversion
         Progress() = default;
@@ -124,6 +164,44 @@ namespace piracer {
         // Conversion from ProgressTracker
         Progress(const ProgressTracker& tracker) 
             : total(tracker.get_total()), done(tracker.get_current()) {}
+
+        Progress(const Progress& other)
+            : total(other.total), done(other.done), tick(other.tick), user(other.user),
+              tracker(other.tracker), counters(other.counters) {}
+        Progress& operator=(const Progress& other) {
+            total = other.total;
+            done = other.done;
+            tick = other.tick;
+            user = other.user;
+            tracker = other.tracker;
+            counters = other.counters;
+            return *this;
+        }
+    };
+
+    // Samples prog->counters at a fixed rate on a thread of its own and
+    // publishes the sum to prog->done, prog->tick and prog->tracker, against
+    // `total` work units; destruction publishes a final sample. Only the
+    // outermost reporter of a Progress runs: entry points that call each
+    // other can all open one. A null `prog` makes it a no-op.
+    class ProgressReporter {
+    public:
+        ProgressReporter(Progress* prog, std::uint64_t total,
+                         std::chrono::milliseconds period = std::chrono::milliseconds(50));
+        ~ProgressReporter();
+
+        ProgressReporter(const ProgressReporter&) = delete;
+        ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    private:
+        void publish();
+
+        Progress* prog_ = nullptr;  // null unless this reporter is active
+        std::chrono::milliseconds period_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stop_ = false;
+        std::thread thread_;
     };
     
 } // namespace piracer
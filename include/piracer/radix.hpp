@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <gmpxx.h>
+#include <string>
+
+namespace piracer {
+    class DigitSink;
+    class ThreadPool;
+
+    // Default block size for the streaming conversions
+    constexpr std::size_t kStreamBlockDigits = std::size_t(1) << 22;
+
+    // Divide-and-conquer radix conversion.
+    // Values are split by powers 10^(L*2^k), computed once per conversion by
+    // repeated squaring; each half is converted independently (in parallel
+    // with a pool) straight into its window of the output buffer.
+
+    // Write `n` (>= 0) as exactly `digits` decimal characters into `out`,
+    // zero-padded on the left. Throws std::invalid_argument if
+    // n >= 10^digits. `n` is consumed: pass with std::move to avoid a copy.
+    void mpz_to_decimal(char* out, std::size_t digits, mpz_class n, ThreadPool* pool = nullptr);
+
+    // First `digits` decimals of the binary fraction r / 2^s (0 <= r < 2^s),
+    // i.e. floor(r * 10^digits / 2^s), zero-padded. Runs as a scaled remainder
+    // tree: the fraction tree needs one multiplication per node and no
+    // divisions, and nodes whose truncation error could reach a digit
+    // boundary are detected and redone on the exact integer path.
+    void fraction_to_decimal(char* out, std::size_t digits, const mpz_class& r, std::size_t s,
+                             ThreadPool* pool = nullptr);
+
+    // Streaming form: the digits reach `sink` in order, in blocks of at most
+    // `block_digits` (beyond the tree itself, only one block is buffered)
+    void fraction_to_decimal(DigitSink& sink, std::size_t digits, const mpz_class& r, std::size_t s,
+                             ThreadPool* pool = nullptr, std::size_t block_digits = kStreamBlockDigits);
+
+    // First `digits` hex digits (lowercase) of r / 2^s, read straight from
+    // the bits of r
+    void fraction_to_hex(char* out, std::size_t digits, const mpz_class& r, std::size_t s,
+                         ThreadPool* pool = nullptr);
+    void fraction_to_hex(DigitSink& sink, std::size_t digits, const mpz_class& r, std::size_t s,
+                         ThreadPool* pool = nullptr, std::size_t block_digits = kStreamBlockDigits);
+
+    // Same for the fraction in the low `s` bits of a limb array (least
+    // significant limb first; bits from s up are ignored), such as an MPFR
+    // mantissa, read in place. Whole 64-bit windows are expanded by
+    // simd::hex_expand. The streaming form converts the next block while
+    // the sink writes the current one.
+    void fraction_to_hex(char* out, std::size_t digits, const mp_limb_t* limbs, std::size_t nlimbs, std::size_t s,
+                         ThreadPool* pool = nullptr);
+    void fraction_to_hex(DigitSink& sink, std::size_t digits, const mp_limb_t* limbs, std::size_t nlimbs,
+                         std::size_t s, ThreadPool* pool = nullptr, std::size_t block_digits = kStreamBlockDigits);
+
+    // `n` as exactly `digits` hex characters, zero-padded
+    void mpz_to_hex(char* out, std::size_t digits, const mpz_class& n, ThreadPool* pool = nullptr);
+
+    // Convenience: `n` in decimal with no padding ("0" for zero)
+    std::string mpz_to_decimal_string(const mpz_class& n, ThreadPool* pool = nullptr);
+} // namespace piracer
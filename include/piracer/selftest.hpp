@@ -1,10 +1,36 @@
 #pragma once
 #include <cstddef>
 #include <string>
+#include <vector>
 
 namespace piracer {
     // Runs a correctness self-test by comparing our Chudnovsky+BSplit output
     // against MPFR's builtin π (mpfr_const_pi) at `digits` decimals.
     // Returns true on match. If `message` is provided, it contains a short verdict.
     bool self_test(std::size_t digits, std::string* message = nullptr);
+
+    // Self-tests of single stages, each against a reference of its own:
+    //   "mul"        mul_ntt vs mpz_mul over sizes, for every available NTT kernel
+    //   "radix"      fraction_to_decimal next to digit boundaries vs mpz_get_str
+    //   "checkpoint" binary checkpoint round trips; a flipped byte must be refused
+    //   "bbp"        BBP digit extraction vs published hex digits of π
+    //   "range"      PiPipeline::run_range windows vs the full result
+    //   "constants"  e, log 2 and the Ramanujan π vs known digits
+    //   "pool"       ThreadPool: throwing tasks are retired and reported; idle waits sleep
+    //   "service"    PiService: coalesced requests, series reuse, ERR for bad requests
+    //   "distributed" a worker on 127.0.0.1 vs bsplit run locally
+    //   "memory"     MemoryPool: size classes, reuse, realloc, cross-thread frees
+    //   "newton"     reciprocal_fixed / inv_sqrt_fixed vs MPFR; a Newton-finished run
+    //   "disk"       disk_mul / disk_add vs GMP: signs, carries across blocks
+    //   "resume"     a run stopped after its first checkpoint, resumed vs a fresh run
+    //   "cancel"     a run past its deadline: ComputeCancelled, no digits, checkpoint kept
+    //   "sinks"      FdSink buffer edges and bypass, ChunkedFileSink names and splits
+    //   "progress"   ProgressCounters and Progress after multithreaded bsplit runs
+    //   "tuning"     save/load round trip; other hosts and damaged profiles refused
+    //   "batch"      GPUMultiplier batches (CPU backend, and the device if any) vs mpz_mul
+    std::vector<std::string> self_test_suites();
+
+    // Runs one of the above ("all": every one in turn). Same result and
+    // `message` as self_test; throws std::invalid_argument for other names.
+    bool run_self_test_suite(const std::string& name, std::string* message = nullptr);
 } // namespace piracer
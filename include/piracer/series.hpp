@@ -0,0 +1,240 @@
+#pragma once
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <gmpxx.h>
+
+// Word-sized leaf arithmetic needs 128-bit integers and 64-bit GMP limbs
+// passed as unsigned long (LP64); other targets use the generic mpz leaf.
+#if defined(__SIZEOF_INT128__) && ULONG_MAX >= 0xFFFFFFFFFFFFFFFFULL && GMP_NUMB_BITS == 64
+#define PIRACER_WORD_LEAF 1
+#else
+#define PIRACER_WORD_LEAF 0
+#endif
+
+namespace piracer {
+
+    // Series policies for the binary-splitting engine (bsplit.hpp). A policy
+    // describes a hypergeometric series
+    //
+    //   S = sum_{k >= 0} (-1)^[negative(k)] a(k) p(1)...p(k) / (q(1)...q(k))
+    //
+    // through static inline functions, so each instantiation of the engine
+    // gets its own fully inlined leaf. Term 0 has p = q = 1. Every policy has
+    //
+    //   name                        for reports and checkpoint headers
+    //   terms(decimals)             terms for that many correct decimals
+    //   result_bits_per_term(lg)    estimated |P| + |Q| + |T| per term when
+    //                               k ~ 2^lg (memory budgets)
+    //
+    // and, with PIRACER_WORD_LEAF, the word-sized term polynomials
+    //
+    //   p(k), a(k), negative(k)     exact as leaf::u128 for any k the engine meets
+    //   mul_q(r, k)                 r *= q(k)
+    //   p_bits, q_bits, pa_bits     bounds on p(k), q(k), p(k) a(k) for
+    //                               k < 2^lg, used to reserve leaf storage
+    //
+    // or otherwise term(k, p, q, t) with t = ±a(k) p(k) as mpz values
+    // (term 0 is 1, 1, a(0)).
+
+#if PIRACER_WORD_LEAF
+    // Word-by-bignum helpers for the policies' leaf arithmetic
+    namespace leaf {
+        __extension__ typedef unsigned __int128 u128;
+
+        // r = x * v without materialising v as an mpz (read-only limb view)
+        inline void mul_u128(mpz_ptr r, mpz_srcptr x, u128 v) {
+            const std::uint64_t hi = static_cast<std::uint64_t>(v >> 64);
+            if (hi == 0) {
+                mpz_mul_ui(r, x, static_cast<unsigned long>(v));
+                return;
+            }
+            const mp_limb_t limbs[2] = { static_cast<mp_limb_t>(v), static_cast<mp_limb_t>(hi) };
+            mpz_t w;
+            mpz_mul(r, x, mpz_roinit_n(w, limbs, 2));
+        }
+
+        // r += sign * x * v
+        inline void addmul_u128(mpz_ptr r, mpz_srcptr x, u128 v, bool negative) {
+            if ((v >> 64) == 0) {
+                const unsigned long w = static_cast<unsigned long>(v);
+                negative ? mpz_submul_ui(r, x, w) : mpz_addmul_ui(r, x, w);
+                return;
+            }
+            const mp_limb_t limbs[2] = { static_cast<mp_limb_t>(v),
+                                         static_cast<mp_limb_t>(v >> 64) };
+            mpz_t w;
+            negative ? mpz_submul(r, x, mpz_roinit_n(w, limbs, 2))
+                     : mpz_addmul(r, x, mpz_roinit_n(w, limbs, 2));
+        }
+
+        // r *= k^3 * c, in one pass while the product fits 128 bits
+        inline void mul_cube_u128(mpz_ptr r, long k, std::uint64_t c) {
+            const u128 kk = static_cast<u128>(k);
+            const u128 k3 = kk * kk * kk;
+            if (k3 <= ~u128(0) / c) {
+                mul_u128(r, r, k3 * c);
+            } else {
+                mul_u128(r, r, k3);
+                mpz_mul_ui(r, r, c);
+            }
+        }
+    } // namespace leaf
+#endif
+
+    // 1/π = 12/640320^(3/2) * S with p(k) = (6k-5)(2k-1)(6k-1),
+    // q(k) = k^3 640320^3/24, a(k) = 13591409 + 545140134 k, alternating
+    struct ChudnovskySeries {
+        static constexpr const char* name = "chudnovsky";
+        static constexpr std::uint64_t kA = 13591409;
+        static constexpr std::uint64_t kB = 545140134;
+        static constexpr std::uint64_t kC3Over24 = 10939058860032000ULL;  // 640320^3 / 24
+
+        static long terms(double decimals) {
+            return static_cast<long>(std::ceil(decimals / 14.181647462725477)) + 1;
+        }
+        // |P| ~ 3 lg + 6.2 and |Q|, |T| ~ 3 lg + 53.3 bits
+        static double result_bits_per_term(double lg) { return 9.0 * lg + 113.0; }
+
+#if PIRACER_WORD_LEAF
+        // Exact for k < ~1.6e12, far beyond any range whose result fits in memory
+        static leaf::u128 p(long k) {
+            const leaf::u128 kk = static_cast<leaf::u128>(k);
+            return (6 * kk - 5) * (2 * kk - 1) * (6 * kk - 1);
+        }
+        static leaf::u128 a(long k) { return kA + static_cast<leaf::u128>(kB) * static_cast<leaf::u128>(k); }
+        static bool negative(long k) { return (k & 1) != 0; }
+        static void mul_q(mpz_ptr r, long k) { leaf::mul_cube_u128(r, k, kC3Over24); }
+
+        static mp_bitcnt_t p_bits(mp_bitcnt_t lg) { return 3 * lg + 7; }
+        static mp_bitcnt_t q_bits(mp_bitcnt_t lg) { return 3 * lg + 54; }
+        static mp_bitcnt_t pa_bits(mp_bitcnt_t lg) { return 3 * lg + 37; }
+#else
+        static void term(long k, mpz_class& p, mpz_class& q, mpz_class& t) {
+            static const mpz_class c3_over_24 = mpz_class(640320) * 640320 * 640320 / 24;
+            if (k == 0) {
+                p = q = 1;
+                t = static_cast<unsigned long>(kA);
+                return;
+            }
+            mpz_class kz;
+            mpz_set_si(kz.get_mpz_t(), k);
+            p = (6 * kz - 5) * (2 * kz - 1) * (6 * kz - 1);
+            q = kz * kz * kz * c3_over_24;
+            t = p * (static_cast<unsigned long>(kA) + static_cast<unsigned long>(kB) * kz);
+            if (k & 1) t = -t;
+        }
+#endif
+    };
+
+    // Ramanujan (1914): 1/π = 2√2/9801 * S with p(k) = 4(4k-3)(4k-2)(4k-1),
+    // q(k) = k^3 396^4, a(k) = 1103 + 26390 k; about 8 digits per term
+    struct RamanujanSeries {
+        static constexpr const char* name = "ramanujan";
+        static constexpr std::uint64_t kA = 1103;
+        static constexpr std::uint64_t kB = 26390;
+        static constexpr std::uint64_t kC = 24591257856ULL;  // 396^4
+
+        static long terms(double decimals) {
+            return static_cast<long>(std::ceil(decimals / 7.9825407783902)) + 1;
+        }
+        static double result_bits_per_term(double lg) { return 9.0 * lg + 78.0; }
+
+#if PIRACER_WORD_LEAF
+        static leaf::u128 p(long k) {
+            const leaf::u128 kk = static_cast<leaf::u128>(k);
+            return 4 * (4 * kk - 3) * (4 * kk - 2) * (4 * kk - 1);
+        }
+        static leaf::u128 a(long k) { return kA + static_cast<leaf::u128>(kB) * static_cast<leaf::u128>(k); }
+        static bool negative(long) { return false; }
+        static void mul_q(mpz_ptr r, long k) { leaf::mul_cube_u128(r, k, kC); }
+
+        static mp_bitcnt_t p_bits(mp_bitcnt_t lg) { return 3 * lg + 8; }
+        static mp_bitcnt_t q_bits(mp_bitcnt_t lg) { return 3 * lg + 35; }
+        static mp_bitcnt_t pa_bits(mp_bitcnt_t lg) { return 4 * lg + 23; }
+#else
+        static void term(long k, mpz_class& p, mpz_class& q, mpz_class& t) {
+            if (k == 0) {
+                p = q = 1;
+                t = static_cast<unsigned long>(kA);
+                return;
+            }
+            mpz_class kz;
+            mpz_set_si(kz.get_mpz_t(), k);
+            p = 4 * (4 * kz - 3) * (4 * kz - 2) * (4 * kz - 1);
+            q = kz * kz * kz * 396 * 396 * 396 * 396;
+            t = p * (static_cast<unsigned long>(kA) + static_cast<unsigned long>(kB) * kz);
+        }
+#endif
+    };
+
+    // e = S with p(k) = 1, q(k) = k, a(k) = 1: the terms are 1/k!
+    struct ESeries {
+        static constexpr const char* name = "e";
+
+        // Smallest n with log10(n!) past the requested digits
+        static long terms(double decimals) {
+            long lo = 1, hi = 2;
+            while (std::lgamma(static_cast<double>(hi) + 1.0) / std::log(10.0) < decimals) hi *= 2;
+            while (lo < hi) {
+                const long mid = lo + (hi - lo) / 2;
+                if (std::lgamma(static_cast<double>(mid) + 1.0) / std::log(10.0) < decimals) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo + 2;
+        }
+        static double result_bits_per_term(double lg) { return 2.0 * lg + 1.0; }
+
+#if PIRACER_WORD_LEAF
+        static leaf::u128 p(long) { return 1; }
+        static leaf::u128 a(long) { return 1; }
+        static bool negative(long) { return false; }
+        static void mul_q(mpz_ptr r, long k) { mpz_mul_ui(r, r, static_cast<unsigned long>(k)); }
+
+        static mp_bitcnt_t p_bits(mp_bitcnt_t) { return 1; }
+        static mp_bitcnt_t q_bits(mp_bitcnt_t lg) { return lg; }
+        static mp_bitcnt_t pa_bits(mp_bitcnt_t) { return 1; }
+#else
+        static void term(long k, mpz_class& p, mpz_class& q, mpz_class& t) {
+            p = t = 1;
+            q = k == 0 ? 1 : k;
+        }
+#endif
+    };
+
+    // log 2 = 3/4 * S with p(k) = k, q(k) = 8k + 4, a(k) = 1, alternating:
+    // the terms are (-1)^k (k!)^2 / (2^k (2k+1)!), 3 bits each
+    struct Log2Series {
+        static constexpr const char* name = "log2";
+
+        static long terms(double decimals) {
+            return static_cast<long>(std::ceil(decimals / 0.9030899869919435)) + 1;
+        }
+        static double result_bits_per_term(double lg) { return 3.0 * lg + 8.0; }
+
+#if PIRACER_WORD_LEAF
+        static leaf::u128 p(long k) { return static_cast<leaf::u128>(k); }
+        static leaf::u128 a(long) { return 1; }
+        static bool negative(long k) { return (k & 1) != 0; }
+        static void mul_q(mpz_ptr r, long k) { mpz_mul_ui(r, r, 8 * static_cast<unsigned long>(k) + 4); }
+
+        static mp_bitcnt_t p_bits(mp_bitcnt_t lg) { return lg; }
+        static mp_bitcnt_t q_bits(mp_bitcnt_t lg) { return lg + 4; }
+        static mp_bitcnt_t pa_bits(mp_bitcnt_t lg) { return lg; }
+#else
+        static void term(long k, mpz_class& p, mpz_class& q, mpz_class& t) {
+            if (k == 0) {
+                p = q = t = 1;
+                return;
+            }
+            p = k;
+            q = 8 * mpz_class(k) + 4;
+            t = (k & 1) ? -p : p;
+        }
+#endif
+    };
+
+} // namespace piracer
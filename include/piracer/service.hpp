@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "piracer/chudnovsky.hpp"
+
+namespace piracer {
+
+    // "3." and the first `digits` digits of π in `base`: a view into a kept
+    // result at least that long, held alive by `owner`. The digits are
+    // truncated, so a prefix of a longer result is the shorter result.
+    struct PiDigits {
+        std::shared_ptr<const std::string> owner;
+        std::string_view text;
+        std::size_t digits = 0;
+        int base = 10;
+        bool cached = false;  // sliced from a finished result, nothing computed or awaited
+    };
+
+    struct ServiceOptions {
+        int threads = 1;        // per computation
+        std::string cache_dir;  // results and the series are kept here across restarts (empty: memory only)
+
+        // Largest request served (0: no limit). Past what the host can hold, a
+        // request would end the whole process in the allocator.
+        std::size_t max_digits = 100000000;
+    };
+
+    // Long-running π server for callers asking for many sizes. The longest
+    // result per base is kept, and a request no longer than it is a slice of
+    // it. A longer request extends the largest kept series (P/Q/T over
+    // [0, n)) by the terms it lacks instead of starting over. Requests that
+    // a computation already running will cover wait for it instead of
+    // starting their own.
+    class PiService {
+    public:
+        explicit PiService(ServiceOptions opts = {});
+
+        PiService(const PiService&) = delete;
+        PiService& operator=(const PiService&) = delete;
+
+        // Throws std::invalid_argument for 0 digits, more than max_digits or a
+        // base other than 10 and 16; a failed computation throws in every
+        // request waiting on it
+        PiDigits get(std::size_t digits, int base = 10);
+
+        struct Stats {
+            std::uint64_t requests = 0;
+            std::uint64_t hits = 0;          // slices of a finished result
+            std::uint64_t coalesced = 0;     // waited for a computation already running
+            std::uint64_t computed = 0;      // ran a computation
+            std::uint64_t extended = 0;      // ... of those, from a kept series
+            std::uint64_t reused_terms = 0;  // series terms those did not recompute
+        };
+        Stats stats() const;
+
+    private:
+        using Text = std::shared_ptr<const std::string>;
+
+        struct Kept {
+            Text text;
+            std::size_t digits = 0;
+        };
+
+        struct Pending {
+            std::size_t digits;
+            std::shared_future<Text> result;
+        };
+
+        void load_cache();
+        void save_result(int slot);
+        void save_series();
+
+        ServiceOptions opts_;
+        mutable std::mutex mutex_;
+        Kept results_[2];                  // base 10, base 16
+        std::vector<Pending> pending_[2];
+        std::shared_ptr<const SeriesState> series_;
+        Stats stats_;
+        std::mutex save_mutex_;            // one cache write at a time
+    };
+
+    // Serves `service` on a Unix domain socket at `path` (a stale socket file
+    // there is replaced), one thread per connection, until accept fails.
+    // Each request line "<digits> [dec|hex]" is answered "OK <bytes>\n" and
+    // that many bytes of text, "stats" with one line of counters, and errors
+    // with "ERR <message>\n". <digits> is plain decimal (no sign, no
+    // exponent). Throws std::runtime_error if the socket cannot be set up (or
+    // on platforms without Unix sockets).
+    void serve_unix_socket(PiService& service, const std::string& path,
+                           std::function<void(const std::string&)> log = {});
+
+} // namespace piracer
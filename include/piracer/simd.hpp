@@ -1,114 +1,94 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
-#include <immintrin.h>  // Intel intrinsics
 
 namespace piracer {
-    
-    // SIMD optimizations for different architectures
+
+    // SIMD optimizations for different architectures.
+    // Kernels for every instruction set the compiler can target are built
+    // into the same binary; get_cpu_features() decides at runtime which one
+    // runs, so no -march flag is needed for full speed.
     namespace simd {
-        
+
         // Detect CPU features
         struct CPUFeatures {
             bool sse2 = false;
             bool sse3 = false;
+            bool ssse3 = false;       // pshufb
             bool sse4_1 = false;
+            bool sse4_2 = false;      // includes the CRC32C instruction
             bool avx = false;
             bool avx2 = false;
-            bool avx512 = false;
+            bool avx512 = false;      // AVX-512 F
+            bool avx512ifma = false;
             bool neon = false;  // ARM
+            bool sve = false;
         };
-        
-                     // Get CPU features
-             CPUFeatures get_cpu_features();
-             
-             // Detect and log SIMD capabilities
-             void log_simd_capabilities();
-             
-             // Check if specific features are available
-             bool has_avx512() const;
-             bool has_neon() const;
-             bool has_sve() const;  // ARM Scalable Vector Extension
-        
-        // Vectorized operations for different data types
-        
-        // 32-bit integer operations
-        namespace i32 {
-            // Add 8 integers at once
-            __m256i add_8(__m256i a, __m256i b);
-            
-            // Multiply 8 integers at once
-            __m256i mul_8(__m256i a, __m256i b);
-            
-            // Load from array
-            __m256i load_8(const int32_t* ptr);
-            
-            // Store to array
-            void store_8(int32_t* ptr, __m256i val);
-        }
-        
-        // 64-bit integer operations
-        namespace i64 {
-            // Add 4 integers at once
-            __m256i add_4(__m256i a, __m256i b);
-            
-            // Multiply 4 integers at once
-            __m256i mul_4(__m256i a, __m256i b);
-            
-            // Load from array
-            __m256i load_4(const int64_t* ptr);
-            
-            // Store to array
-            void store_4(int64_t* ptr, __m256i val);
-        }
-        
-        // Floating point operations
-        namespace f64 {
-            // Add 4 doubles at once
-            __m256d add_4(__m256d a, __m256d b);
-            
-            // Multiply 4 doubles at once
-            __m256d mul_4(__m256d a, __m256d b);
-            
-            // Load from array
-            __m256d load_4(const double* ptr);
-            
-            // Store to array
-            void store_4(double* ptr, __m256d val);
+
+        // Get CPU features (detected once, then cached)
+        CPUFeatures get_cpu_features();
+
+        // Print the detected features and the selected NTT kernel to stderr
+        void log_simd_capabilities();
+
+        // Check if specific features are available
+        bool has_avx512();
+        bool has_neon();
+        bool has_sve();  // ARM Scalable Vector Extension
+
+        // NTT butterfly kernels.
+        // All functions work on residues in [0, p) for a prime p < 2^63 and
+        // use Montgomery multiplication with R = 2^64 (`inv` = p^-1 mod 2^64);
+        // twiddles and scale factors are in Montgomery form, data is not.
+        namespace ntt {
+            enum class Kernel {
+                Scalar,
+                AVX2,
+                AVX512,
+                NEON
+            };
+
+            struct Kernels {
+                Kernel kind;
+                const char* name;
+
+                // One decimation-in-frequency level of half-length h over x[0, n):
+                // (u, v) -> (u + v, (u - v) * w[j])
+                void (*dif_level)(std::uint64_t* x, std::size_t n, std::size_t h, const std::uint64_t* w,
+                                  std::uint64_t p, std::uint64_t inv);
+
+                // One decimation-in-time level: (u, v) -> (u + v * w[j], u - v * w[j])
+                void (*dit_level)(std::uint64_t* x, std::size_t n, std::size_t h, const std::uint64_t* w,
+                                  std::uint64_t p, std::uint64_t inv);
+
+                // a[i] = a[i] * b[i] / R
+                void (*pointwise)(std::uint64_t* a, const std::uint64_t* b, std::size_t n,
+                                  std::uint64_t p, std::uint64_t inv);
+
+                // x[i] = x[i] * s / R
+                void (*scale)(std::uint64_t* x, std::size_t n, std::uint64_t s,
+                              std::uint64_t p, std::uint64_t inv);
+            };
+
+            // Kernel set in use (best supported one unless overridden)
+            const Kernels& kernels();
+
+            // Whether this binary and CPU can run a given kernel
+            bool kernel_available(Kernel k);
+
+            // Override the runtime choice (benchmarks, cross-checking).
+            // Throws std::invalid_argument if the kernel is not available.
+            void force_kernel(Kernel k);
+
+            const char* kernel_name(Kernel k);
         }
-        
-                     // NTT-specific optimizations
-             namespace ntt {
-                 // Vectorized butterfly operation
-                 void butterfly_4(__m256d& a, __m256d& b, __m256d w);
-
-                 // Vectorized twiddle factor multiplication
-                 __m256d twiddle_mul_4(__m256d data, __m256d twiddle);
-                 
-                 // Advanced AVX-512 operations
-                 void butterfly_8(__m512d& a, __m512d& b, __m512d w);
-                 __m512d twiddle_mul_8(__m512d data, __m512d twiddle);
-             }
-             
-             // ARM NEON optimizations
-             namespace neon {
-                 // 64-bit integer operations (4 at once)
-                 void add_4_int64(int64_t* a, int64_t* b, int64_t* result);
-                 void mul_4_int64(int64_t* a, int64_t* b, int64_t* result);
-                 
-                 // Floating point operations
-                 void add_4_double(double* a, double* b, double* result);
-                 void mul_4_double(double* a, double* b, double* result);
-             }
-             
-             // Performance monitoring
-             namespace perf {
-                 // Measure SIMD operation performance
-                 double benchmark_simd_operation(const std::function<void()>& op, int iterations = 1000);
-                 
-                 // Compare SIMD vs scalar performance
-                 void compare_simd_scalar(const std::string& operation_name);
-             }
-        
+
+        // Hex digits of whole words: out[16 i .. 16 i + 16) = words[i] as
+        // 16 lowercase hex digits, most significant first (no terminator).
+        // Nibbles go through a 16-entry table lookup, 16 digits per
+        // instruction where SSSE3 or NEON is available.
+        void hex_expand(char* out, const std::uint64_t* words, std::size_t n);
+
     } // namespace simd
-    
-} // namespace piracer 
\ No newline at end of file
+
+} // namespace piracer
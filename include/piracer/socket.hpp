@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace piracer {
+
+    // Stream-socket plumbing shared by the front ends (service.hpp,
+    // distributed.hpp). POSIX only; the callers provide the fallbacks.
+
+    // Writes all `n` bytes (retrying on EINTR, no SIGPIPE); false once the peer is gone
+    bool send_all(int fd, const void* data, std::size_t n);
+
+    // `line` plus "\n"
+    bool send_line(int fd, const std::string& line);
+
+    // Buffered reads of request/reply lines, and of the raw bytes after
+    // them straight into the caller's memory
+    class SocketReader {
+    public:
+        explicit SocketReader(int fd) : fd_(fd) {}
+
+        // One line without its "\n" (or "\r\n"); false at end of stream, on
+        // errors and on lines longer than 4 KiB
+        bool line(std::string& out);
+
+        // Exactly `n` bytes; false at end of stream or on errors
+        bool exact(void* data, std::size_t n);
+
+    private:
+        bool fill();
+
+        int fd_;
+        std::string buf_;
+        std::size_t pos_ = 0;
+    };
+
+    // Accepts connections on `listener` until accept fails, each handled by
+    // `handle(fd)` on a thread of its own (which owns and closes fd). The
+    // threads are detached, so a long-lived server does not pile up finished
+    // ones, and counted: returning waits for the last. `listener` stays open.
+    void serve_connections(int listener, const std::function<void(int fd)>& handle,
+                           const std::function<void(const std::string&)>& log = {});
+
+} // namespace piracer
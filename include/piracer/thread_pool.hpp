@@ -1,77 +1,210 @@
 #pragma once
-#include <vector>
-#include <queue>
-#include <thread>
-#include <mutex>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 namespace piracer {
-    
-    // Efficient thread pool for parallel binary-splitting
+
+    // Work-stealing thread pool for parallel binary-splitting.
+    // Every worker owns a deque: it pushes and pops its own tasks at the back
+    // (LIFO, cache-hot) while idle workers steal from the front (FIFO, the
+    // oldest and therefore largest subtrees). Tasks submitted from threads
+    // outside the pool go to a shared injection queue.
     class ThreadPool {
     public:
+        using Task = std::function<void()>;
+
         explicit ThreadPool(size_t num_threads);
+
+        // Worker i is pinned to cpus[i % cpus.size()] before it runs any task
+        // (no pinning if `cpus` is empty), so its first-touch allocations land
+        // on that CPU's NUMA node
+        ThreadPool(size_t num_threads, std::vector<int> cpus);
         ~ThreadPool();
-        
+
         // Disable copy
         ThreadPool(const ThreadPool&) = delete;
         ThreadPool& operator=(const ThreadPool&) = delete;
-        
-        // Submit a task and return a future
+
+        // Submit a task and return a future.
+        // Blocking on the future from inside a task is not helping: use
+        // TaskGroup for nested fork/join work.
         template<class F, class... Args>
-        auto submit(F&& f, Args&&... args) 
+        auto submit(F&& f, Args&&... args)
             -> std::future<typename std::result_of<F(Args...)>::type>;
-        
+
+        // Schedule a fire-and-forget task (local deque when called from a worker).
+        // An exception escaping `task` is dropped; submit() and TaskGroup
+        // hand theirs back.
+        void spawn(Task task);
+
+        // Run one pending task on the calling thread. Returns false if none was found.
+        bool try_run_one();
+
         // Get number of threads
         size_t size() const { return workers.size(); }
-        
-        // Wait for all tasks to complete
+
+        // Index of the calling thread in this pool, or -1 for outside threads
+        int current_worker() const;
+
+        // Block until every submitted task (including tasks spawned by tasks)
+        // has finished running. Must be called from outside the pool.
         void wait_all();
-        
+
+        // Number of tasks submitted but not yet finished
+        size_t in_flight() const { return pending.load(); }
+
+        // Sleep until a task is queued (or the pool stops) or done() holds;
+        // done() is checked under the lock notify_waiters() takes, so a
+        // waiter whose condition a notifier just made true cannot miss it.
+        // For helpers that found nothing to run (TaskGroup).
+        void wait_for_work(const std::function<bool()>& done);
+        void notify_waiters();
+
+        // Scheduler counters, to tell task bodies apart from scheduling cost.
+        // busy = time inside task bodies, idle = time asleep waiting for work;
+        // the rest of the workers' wall time is scheduler overhead.
+        struct Stats {
+            std::uint64_t tasks_executed = 0;
+            std::uint64_t tasks_stolen   = 0;
+            double        busy_seconds   = 0.0;
+            double        idle_seconds   = 0.0;
+            double        wall_seconds   = 0.0;  // pool lifetime
+        };
+        Stats stats() const;
+
     private:
-        // Worker threads
+        struct alignas(64) WorkQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+
+            // Counters of the threads running tasks from this slot (relaxed)
+            std::atomic<std::uint64_t> executed{0};
+            std::atomic<std::uint64_t> stolen{0};
+            std::atomic<std::uint64_t> busy_ns{0};
+            std::atomic<std::uint64_t> idle_ns{0};
+        };
+
+        // Worker threads and their deques (same index)
         std::vector<std::thread> workers;
-        
-        // Task queue
-        std::queue<std::function<void()>> tasks;
-        
-        // Synchronization
-        mutable std::mutex queue_mutex;
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+
+        // Tasks submitted from outside the pool (counters: helping outside threads)
+        WorkQueue injection;
+
+        // Number of tasks sitting in any queue (not yet picked up)
+        std::atomic<size_t> queued{0};
+
+        // Number of tasks submitted and not yet finished, with its quiescence signal
+        std::atomic<size_t>     pending{0};
+        std::mutex              done_mutex;
+        std::condition_variable done_condition;
+
+        std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+
+        // Sleep/wake-up of idle workers, and of helpers in wait_for_work
+        std::atomic<int>        sleeping{0};
+        std::atomic<int>        helping{0};
+        std::mutex              sleep_mutex;
         std::condition_variable condition;
-        
+        std::condition_variable help_condition;
+
         // Stop flag
-        bool stop;
-        
+        std::atomic<bool> stop{false};
+
+        // CPUs the workers are pinned to (empty: not pinned)
+        std::vector<int> cpus_;
+
         // Worker function
-        void worker_function();
+        void worker_function(size_t index);
+
+        // Task lookup: own deque (back), injection queue, then steal (front)
+        bool find_task(int self, Task& out);
+        bool steal(int thief, Task& out);
+
+        // Execute a task on the calling thread and retire it
+        void run(Task& task, int self);
+
+        void wake_one();
+    };
+
+    // Fork/join scope on a ThreadPool: spawn() children, then sync() waits
+    // for exactly those children. A waiting thread keeps executing other tasks
+    // while there are any, so nested groups (recursive bsplit) cannot deadlock
+    // the pool; when nothing is runnable it sleeps until new work is spawned
+    // or its last child ends.
+    // With a null pool every child runs inline.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool* pool) : pool_(pool) {}
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        template<class F>
+        void spawn(F&& f);
+
+        // Wait for every spawned child; rethrows the first child exception
+        void sync();
+
+    private:
+        ThreadPool*             pool_;
+        std::atomic<size_t>     pending_{0};
+        std::mutex              mutex_;      // guards error_ and the last decrement
+        std::exception_ptr      error_;
+
+        void wait();
+        void finish_one();
+        void record_error(std::exception_ptr e);
     };
-    
+
     // Implementation
     template<class F, class... Args>
-    auto ThreadPool::submit(F&& f, Args&&... args) 
+    auto ThreadPool::submit(F&& f, Args&&... args)
         -> std::future<typename std::result_of<F(Args...)>::type> {
-        
+
         using return_type = typename std::result_of<F(Args...)>::type;
-        
+
         auto task = std::make_shared<std::packaged_task<return_type()>>(
             std::bind(std::forward<F>(f), std::forward<Args>(args)...)
         );
-        
+
         std::future<return_type> res = task->get_future();
-        
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex);
-            if (stop) {
-                throw std::runtime_error("submit on stopped ThreadPool");
+        spawn([task](){ (*task)(); });
+        return res;
+    }
+
+    template<class F>
+    void TaskGroup::spawn(F&& f) {
+        if (!pool_) {
+            try {
+                f();
+            } catch (...) {
+                record_error(std::current_exception());
             }
-            tasks.emplace([task](){ (*task)(); });
+            return;
         }
-        
-        condition.notify_one();
-        return res;
+
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        pool_->spawn([this, fn = std::forward<F>(f)]() mutable {
+            try {
+                fn();
+            } catch (...) {
+                record_error(std::current_exception());
+            }
+            finish_one();
+        });
     }
-    
-} // namespace piracer 
\ No newline at end of file
+
+} // namespace piracer
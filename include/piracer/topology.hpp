@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace piracer {
+
+    // One logical CPU the process may run on
+    struct CpuInfo {
+        int cpu = 0;     // OS index
+        int core = 0;    // physical core (unique across sockets)
+        int socket = 0;
+        int node = 0;    // NUMA node
+        int l3 = 0;      // last-level cache domain (unique across sockets)
+    };
+
+    // Machine layout as far as memory placement is concerned, discovered
+    // once from sysfs (Linux) and restricted to the process affinity mask.
+    // Elsewhere every CPU is reported on a single node.
+    class Topology {
+    public:
+        static const Topology& get();
+
+        const std::vector<CpuInfo>& cpus() const { return cpus_; }
+        int sockets() const { return sockets_; }
+        int l3_domains() const { return l3_domains_; }
+
+        // NUMA nodes with at least one usable CPU, ascending
+        const std::vector<int>& nodes() const { return nodes_; }
+
+        // CPUs of `node`: one per physical core first, then SMT siblings
+        std::vector<int> cpus_of_node(int node) const;
+
+        // "2 sockets, 2 NUMA nodes, 4 L3 domains, 64 CPUs"
+        std::string describe() const;
+
+        // Build from an explicit CPU list (tests, other discovery sources)
+        explicit Topology(std::vector<CpuInfo> cpus);
+
+    private:
+        std::vector<CpuInfo> cpus_;
+        std::vector<int> nodes_;
+        int sockets_ = 1;
+        int l3_domains_ = 1;
+    };
+
+    // Restrict the calling thread to `cpu` / to `cpus`. False if the OS
+    // refused or has no affinity API.
+    bool pin_thread_to_cpu(int cpu);
+    bool pin_thread_to_cpus(const std::vector<int>& cpus);
+
+    // Pins the calling thread for the lifetime of the object, then restores
+    // its previous affinity
+    class ScopedAffinity {
+    public:
+        explicit ScopedAffinity(const std::vector<int>& cpus);
+        ~ScopedAffinity();
+
+        ScopedAffinity(const ScopedAffinity&) = delete;
+        ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+    private:
+        std::vector<int> saved_;
+        bool pinned_ = false;
+    };
+
+    // Spread the pages of [p, p + bytes) round-robin over all nodes of the
+    // topology (mbind MPOL_INTERLEAVE). Affects pages not yet touched.
+    // False on single-node machines and where the OS has no such policy.
+    bool numa_interleave(void* p, std::size_t bytes);
+
+} // namespace piracer
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include "piracer/bsplit.hpp"
+
+namespace piracer {
+
+    // Per-host performance parameters: the GMP / NTT crossover of mul_big
+    // and the shape of the binary-splitting tree. Defaults are fine on a
+    // typical desktop; run_tuning measures them on the current machine, and
+    // a profile file keeps the result for later runs on the same host.
+    struct TuningProfile {
+        std::size_t ntt_threshold_limbs = 0;  // 0: the built-in per-kernel default
+        BSplitTuning bsplit;
+        int threads = 1;                      // thread count the bsplit values were measured at
+    };
+
+    // What the next computation will use
+    TuningProfile current_tuning();
+    void apply_tuning(const TuningProfile& t);
+
+    // Identifies the machine a profile was measured on: host name, CPU
+    // model, hardware threads, NTT kernel and piracer version. A profile is
+    // only loaded where it matches, so one file (or directory) can be shared
+    // across a fleet of different machines.
+    std::string host_fingerprint();
+
+    // $PIRACER_TUNING_FILE, else tuning-<host>.conf under $XDG_CACHE_HOME/piracer
+    // or ~/.cache/piracer; empty if neither variable is set
+    std::string default_tuning_file();
+
+    // Reads `file` into `out`. False (with the reason in `why`) if it is
+    // missing, unreadable, or made for another host; `out` is then untouched.
+    bool load_tuning(const std::string& file, TuningProfile& out, std::string* why = nullptr);
+
+    // Writes `t` with this host's fingerprint, creating the directory; the
+    // file is replaced atomically. False on I/O errors.
+    bool save_tuning(const std::string& file, const TuningProfile& t);
+
+    struct TuneOptions {
+        int threads = 1;  // thread count to tune the parallel tree for
+        std::function<void(const std::string&)> log;  // one line per measurement (optional)
+    };
+
+    // Calibration sweeps on this host (a few seconds to a minute): mpz_mul
+    // against mul_ntt on doubling operand sizes, leaf sizes of a serial
+    // tree, then grain and tasks per thread of a parallel one (with
+    // opts.threads > 1). Returns the best values found; the tuning in
+    // effect is restored afterwards.
+    TuningProfile run_tuning(const TuneOptions& opts);
+
+} // namespace piracer
@@ -1,71 +1,279 @@
 #include "piracer/bsplit.hpp"
+#include "piracer/bigmul.hpp"
+#include "piracer/cancel.hpp"
+#include "piracer/checkpoint.hpp"
+#include "piracer/gpu_backend.hpp"
+#include "piracer/memory_pool.hpp"
+#include "piracer/profiler.hpp"
+#include "piracer/series.hpp"
 #include "piracer/thread_pool.hpp"
+#include "piracer/topology.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
 
 namespace piracer {
     namespace {
-        const mpz_class A = 13591409;
-        const mpz_class B = 545140134;
-        const mpz_class C3_OVER_24 = mpz_class(640320) * 640320 * 640320 / 24;
+        // Tree shape (BSplitTuning), read as a run goes
+        std::atomic<long> g_leaf_terms{BSplitTuning{}.leaf_terms};
+        std::atomic<long> g_min_parallel_grain{BSplitTuning{}.min_parallel_grain};
+        std::atomic<long> g_tasks_per_thread{BSplitTuning{}.tasks_per_thread};
+
+        // Ranges up to this many terms are evaluated by the fused base case
+        inline long leaf_terms() {
+            return g_leaf_terms.load(std::memory_order_relaxed);
+        }
 
-        // Leaf computation shared by both entry points
-        inline BSplitTriplet leaf(long a) {
-            if (a == 0) return BSplitTriplet{ mpz_class{1}, mpz_class{1}, A };
+        // Merges below this many limbs of Q stay out of the profile: there
+        // are millions of them and the timer would dominate
+        constexpr std::size_t kProfileMergeLimbs = 64;
 
-            mpz_class az; mpz_set_si(az.get_mpz_t(), a);
-            mpz_class P = (6 * az - 5) * (2 * az - 1) * (6 * az - 1);
-            mpz_class Q = az * az * az; Q *= C3_OVER_24;
-            mpz_class T = P * (A + B * az);
-            if (a & 1) T = -T;
-            return BSplitTriplet{P, Q, T};
+        // Serial subtrees poll the cancel token from this size on: a check
+        // reads the clock, a subtree this large takes far longer
+        constexpr long kCancelCheckTerms = 1024;
+
+        inline void check(const CancelToken* cancel) {
+            if (cancel) cancel->check();
         }
+
+#if PIRACER_WORD_LEAF
+        using leaf::addmul_u128;
+        using leaf::mul_u128;
+
+        // Fused base case for [a, b): accumulate terms left to right with
+        // word-by-bignum products (linear, no temporaries) instead of a
+        // tree of tiny mpz products:
+        //   T' = T*q(k) + (P*p(k))*a(k)*(-1)^k,  P' = P*p(k),  Q' = Q*q(k)
+        template <class Series>
+        inline BSplitTriplet leaf_range(long a, long b) {
+            BSplitTriplet x;
+            mpz_ptr P = x.P.get_mpz_t();
+            mpz_ptr Q = x.Q.get_mpz_t();
+            mpz_ptr T = x.T.get_mpz_t();
+
+            // Reserve the final sizes up front
+            const mp_bitcnt_t lg =
+                static_cast<mp_bitcnt_t>(64 - __builtin_clzl(static_cast<unsigned long>(b)));
+            const mp_bitcnt_t terms = static_cast<mp_bitcnt_t>(b - a);
+            mpz_realloc2(P, terms * Series::p_bits(lg));
+            mpz_realloc2(Q, terms * Series::q_bits(lg));
+            mpz_realloc2(T, terms * Series::q_bits(lg) + Series::pa_bits(lg));
+
+            long k = a;
+            mpz_set_ui(P, 1);
+            mpz_set_ui(Q, 1);
+            mpz_set_ui(T, 0);
+            if (k == 0) {
+                addmul_u128(T, P, Series::a(0), Series::negative(0));
+            } else {
+                mul_u128(P, P, Series::p(k));
+                addmul_u128(T, P, Series::a(k), Series::negative(k));
+                Series::mul_q(Q, k);
+            }
+
+            for (++k; k < b; ++k) {
+                Series::mul_q(T, k);
+                mul_u128(P, P, Series::p(k));
+                addmul_u128(T, P, Series::a(k), Series::negative(k));
+                Series::mul_q(Q, k);
+            }
+            return x;
+        }
+#else
+        // Base case for [a, b): fold single-term leaves left to right
+        template <class Series>
+        inline BSplitTriplet leaf_range(long a, long b) {
+            BSplitTriplet x, y;
+            Series::term(a, x.P, x.Q, x.T);
+            for (long k = a + 1; k < b; ++k) {
+                Series::term(k, y.P, y.Q, y.T);
+                x.T = x.T * y.Q + x.P * y.T;
+                x.P *= y.P;
+                x.Q *= y.Q;
+            }
+            return x;
+        }
+#endif
     } // namespace
 
-    // Non-reporting version
-    static BSplitTriplet bsplit_impl(long a, long b) {
-        if (b - a == 1) return leaf(a);
-        long m = (a + b) / 2;
-        BSplitTriplet L = bsplit_impl(a, m);
-        BSplitTriplet R = bsplit_impl(m, b);
-        return BSplitTriplet{
-            L.P * R.P,
-            L.Q * R.Q,
-            L.T * R.Q + L.P * R.T
-        };
+    namespace {
+        // Give an operand's limbs back as soon as its last product is done
+        inline void release(mpz_class& x) {
+            mpz_class empty;
+            x.swap(empty);
+        }
+    } // namespace
+
+    // L <- merge of two adjacent ranges L, R, consuming both. P is only formed
+    // when the caller reads it: at the root and along the right spine of the
+    // tree it is never used, and at the root it is one of the three largest
+    // products of the whole run. Products land in L's own storage (mul_big
+    // allows aliasing) and every input is released right after its last use,
+    // so besides L and R only the P*T product is alive at any point. Products
+    // go through mul_big, which hands the top levels to the NTT.
+    static void merge_into(BSplitTriplet& L, BSplitTriplet& R, bool need_p, ThreadPool* pool = nullptr) {
+        PIRACER_PROFILE_SCOPE_IF(mpz_size(L.Q.get_mpz_t()) >= kProfileMergeLimbs, "bsplit.merge");
+        mpz_class PT;
+        mul_big(PT, L.P, R.T, pool);
+        release(R.T);
+        if (!need_p) release(L.P);
+        mul_big(L.T, L.T, R.Q, pool);
+        L.T += PT;
+        release(PT);
+        mul_big(L.Q, L.Q, R.Q, pool);
+        release(R.Q);
+        if (need_p) mul_big(L.P, L.P, R.P, pool);
+        release(R.P);
     }
 
-    // Reporting version (ticks at each leaf)
-    static BSplitTriplet bsplit_impl(long a, long b, Progress* prog) {
-        if (b - a == 1) {
-            BSplitTriplet x = leaf(a);
-            if (prog) {
-                ++prog->done;
-                if (prog->tick) prog->tick(prog->done, prog->total, prog->user);
+    // Merge leaving both inputs intact, for children that are shared
+    static BSplitTriplet merge(const BSplitTriplet& L, const BSplitTriplet& R, bool need_p,
+                               ThreadPool* pool = nullptr) {
+        BSplitTriplet x;
+        mpz_class PT;
+        if (need_p) mul_big(x.P, L.P, R.P, pool);
+        mul_big(x.Q, L.Q, R.Q, pool);
+        mul_big(x.T, L.T, R.Q, pool);
+        mul_big(PT, L.P, R.T, pool);
+        x.T += PT;
+        return x;
+    }
+
+    namespace {
+        // Progress units of one step: a merge of s terms is charged s lg^2 s
+        // (products O(s) digits long, O(n log n) each, and the top levels
+        // also lose cache locality: lg s alone underweights them); a leaf
+        // range is charged like a merge of its size
+        inline std::uint64_t step_work(long s) {
+            const std::uint64_t n = static_cast<std::uint64_t>(s);
+            const std::uint64_t lg = static_cast<std::uint64_t>(64 - __builtin_clzll(n | 1));
+            return n * lg * lg;
+        }
+
+        // All steps of a subtree of s terms; it only depends on s, and each
+        // level of the tree has at most two sizes
+        std::uint64_t subtree_work(long s, std::map<long, std::uint64_t>& memo) {
+            if (s <= leaf_terms()) return step_work(s);
+            auto it = memo.find(s);
+            if (it != memo.end()) return it->second;
+            const long h = s / 2;
+            const std::uint64_t w = subtree_work(h, memo) + subtree_work(s - h, memo) + step_work(s);
+            memo.emplace(s, w);
+            return w;
+        }
+    } // namespace
+
+    std::uint64_t bsplit_work(long a, long b) {
+        if (b <= a) return 0;
+        std::map<long, std::uint64_t> memo;
+        return subtree_work(b - a, memo);
+    }
+
+    std::uint64_t bsplit_merge_work(long a, long b) {
+        return b - a > leaf_terms() ? step_work(b - a) : 0;
+    }
+
+    namespace {
+        // Non-reporting version
+        template <class Series>
+        BSplitTriplet bsplit_impl(long a, long b, bool need_p = true) {
+            if (b - a <= leaf_terms()) return leaf_range<Series>(a, b);
+            long m = (a + b) / 2;
+            BSplitTriplet L = bsplit_impl<Series>(a, m);
+            BSplitTriplet R = bsplit_impl<Series>(m, b, need_p);
+            merge_into(L, R, need_p);
+            return L;
+        }
+
+        // Reporting version: counts the work of every leaf range and merge,
+        // and stops between subtrees once `cancel` asks
+        template <class Series>
+        BSplitTriplet bsplit_impl(long a, long b, Progress* prog, bool need_p, const CancelToken* cancel) {
+            if (b - a <= leaf_terms()) {
+                BSplitTriplet x = leaf_range<Series>(a, b);
+                if (prog) prog->add(step_work(b - a));
+                return x;
             }
-            return x;
+            if (b - a >= kCancelCheckTerms) check(cancel);
+            long m = (a + b) / 2;
+            BSplitTriplet L = bsplit_impl<Series>(a, m, prog, true, cancel);
+            BSplitTriplet R = bsplit_impl<Series>(m, b, prog, need_p, cancel);
+            if (b - a >= kCancelCheckTerms) check(cancel);
+            merge_into(L, R, need_p);
+            if (prog) prog->add(step_work(b - a));
+            return L;
         }
-        long m = (a + b) / 2;
-        BSplitTriplet L = bsplit_impl(a, m, prog);
-        BSplitTriplet R = bsplit_impl(m, b, prog);
-        return BSplitTriplet{
-            L.P * R.P,
-            L.Q * R.Q,
-            L.T * R.Q + L.P * R.T
-        };
+
+        template <class Series>
+        std::size_t result_bytes(long a, long b) {
+            const double lg = std::log2(static_cast<double>(std::max(b, 2L)));
+            return static_cast<std::size_t>(static_cast<double>(b - a) * Series::result_bits_per_term(lg) / 8.0);
+        }
+
+        // The final merge holds L, R and P*T (about 1.8x the result) while a
+        // product of up to 0.4x runs through the NTT: three primes, two
+        // operands and twiddle tables, each up to twice its length. Measured
+        // peaks are 8-10x the result.
+        template <class Series>
+        std::size_t peak_bytes(long a, long b) {
+            return 10 * result_bytes<Series>(a, b);
+        }
+    } // namespace
+
+    std::size_t bsplit_result_bytes(long a, long b) {
+        return result_bytes<ChudnovskySeries>(a, b);
+    }
+
+    std::size_t bsplit_peak_bytes(long a, long b) {
+        return peak_bytes<ChudnovskySeries>(a, b);
+    }
+
+    template <class Series>
+    BSplitTriplet bsplit_series(long a, long b, Progress* prog, bool need_p, const CancelToken* cancel) {
+        ProgressReporter reporter(prog, bsplit_work(a, b));
+        return bsplit_impl<Series>(a, b, prog, need_p, cancel);
     }
 
     BSplitTriplet bsplit_chudnovsky(long a, long b) {
-        return bsplit_impl(a, b);
+        return bsplit_impl<ChudnovskySeries>(a, b);
     }
 
-    BSplitTriplet bsplit_chudnovsky(long a, long b, Progress* prog) {
-        return bsplit_impl(a, b, prog);
+    void bsplit_merge(BSplitTriplet& L, BSplitTriplet& R, bool need_p, ThreadPool* pool) {
+        merge_into(L, R, need_p, pool);
+    }
+
+    BSplitTriplet bsplit_chudnovsky(long a, long b, Progress* prog, bool need_p, const CancelToken* cancel) {
+        return bsplit_series<ChudnovskySeries>(a, b, prog, need_p, cancel);
     }
     
+    BSplitTuning bsplit_tuning() {
+        BSplitTuning t;
+        t.leaf_terms = g_leaf_terms.load(std::memory_order_relaxed);
+        t.min_parallel_grain = g_min_parallel_grain.load(std::memory_order_relaxed);
+        t.tasks_per_thread = g_tasks_per_thread.load(std::memory_order_relaxed);
+        return t;
+    }
+
+    void set_bsplit_tuning(const BSplitTuning& t) {
+        g_leaf_terms.store(std::clamp(t.leaf_terms, 1L, 1024L), std::memory_order_relaxed);
+        g_min_parallel_grain.store(std::clamp(t.min_parallel_grain, 2L, 1L << 20), std::memory_order_relaxed);
+        g_tasks_per_thread.store(std::clamp(t.tasks_per_thread, 1L, 1024L), std::memory_order_relaxed);
+    }
+
     // Parallel scheduler implementation
     ParallelScheduler::ParallelScheduler(int threads, long chunk)
         : num_threads(threads), chunk_size(chunk), current_pos(0), end_pos(0) {
+        // The calling thread joins in while it waits, so it counts as one worker
         if (threads > 1) {
-            thread_pool = std::make_unique<ThreadPool>(threads);
+            thread_pool = std::make_unique<ThreadPool>(threads - 1);
         }
     }
     
@@ -91,32 +299,504 @@ namespace piracer {
         return thread_pool.get();
     }
     
+    namespace {
+        // Subtree size below which a parallel run stops forking: about
+        // tasks_per_thread subtrees per thread keeps thieves fed near the
+        // end, but none smaller than min_parallel_grain terms
+        long parallel_grain(long terms, int threads) {
+            const long tasks = g_tasks_per_thread.load(std::memory_order_relaxed) * std::max(threads, 1);
+            return std::max(g_min_parallel_grain.load(std::memory_order_relaxed), terms / tasks);
+        }
+
+        // Merge operands below this many limbs are multiplied inline:
+        // spawning costs more than the product itself
+        constexpr std::size_t kParallelMergeLimbs = 256;
+
+        // Reservations against ComputeOptions::max_memory. A subtree or a
+        // parallel merge runs concurrently only if its estimated peak fits;
+        // otherwise the work stays on the current thread. The root is always
+        // allowed, so a budget below its own peak only serialises the run.
+        struct MemoryBudget {
+            std::size_t limit = 0;  // bytes, 0: unlimited
+            std::atomic<std::size_t> reserved{0};
+
+            bool try_reserve(std::size_t bytes) {
+                if (limit == 0) return true;
+                std::size_t cur = reserved.load(std::memory_order_relaxed);
+                do {
+                    if (cur + bytes > limit) return false;
+                } while (!reserved.compare_exchange_weak(cur, cur + bytes, std::memory_order_relaxed));
+                return true;
+            }
+
+            void force_reserve(std::size_t bytes) {
+                if (limit) reserved.fetch_add(bytes, std::memory_order_relaxed);
+            }
+
+            void release(std::size_t bytes) {
+                if (limit) reserved.fetch_sub(bytes, std::memory_order_relaxed);
+            }
+        };
+
+        // merge_into with the independent products in parallel. T and Q are
+        // formed in place (no other product reads them); P needs a fresh
+        // output since P*T reads L.P concurrently.
+        void merge_parallel(ThreadPool& pool, BSplitTriplet& L, BSplitTriplet& R, bool need_p,
+                            MemoryBudget& budget, std::size_t extra_bytes) {
+            if (mpz_size(L.Q.get_mpz_t()) < kParallelMergeLimbs || !budget.try_reserve(extra_bytes)) {
+                merge_into(L, R, need_p, &pool);
+                return;
+            }
+
+            // Up to four independent products; this thread takes one of them
+            PIRACER_PROFILE_SCOPE("bsplit.merge_parallel");
+            mpz_class P, PT;
+            {
+                TaskGroup g(&pool);
+                if (need_p) g.spawn([&] { mul_big(P, L.P, R.P, &pool); });
+                g.spawn([&] { mul_big(L.Q, L.Q, R.Q, &pool); });
+                g.spawn([&] { mul_big(PT, L.P, R.T, &pool); });
+                mul_big(L.T, L.T, R.Q, &pool);
+                g.sync();
+            }
+            R = BSplitTriplet{};
+            L.P.swap(P);
+            release(P);
+            L.T += PT;
+            budget.release(extra_bytes);
+        }
+
+        // Fork/join recursion: the left half is offered to thieves while this
+        // thread descends into the right half, then both are merged. Under a
+        // memory budget the left half is only offered if its peak fits. Every
+        // subtree polls `cancel` before it starts, so once it asks, queued
+        // work drains without computing and the first throw reaches the root.
+        template <class Series>
+        BSplitTriplet bsplit_parallel_impl(ThreadPool& pool, long a, long b, long grain, bool need_p,
+                                           Progress* prog, MemoryBudget& budget, const CancelToken* cancel) {
+            check(cancel);
+            if (b - a <= grain) {
+                PIRACER_PROFILE_SCOPE("bsplit.subtree");
+                return bsplit_impl<Series>(a, b, prog, need_p, cancel);
+            }
+
+            long m = (a + b) / 2;
+            BSplitTriplet L, R;
+            const std::size_t left_bytes = peak_bytes<Series>(a, m);
+            if (budget.try_reserve(left_bytes)) {
+                {
+                    TaskGroup g(&pool);
+                    g.spawn([&] { L = bsplit_parallel_impl<Series>(pool, a, m, grain, true, prog, budget, cancel); });
+                    R = bsplit_parallel_impl<Series>(pool, m, b, grain, need_p, prog, budget, cancel);
+                    g.sync();
+                }
+                budget.release(left_bytes);
+            } else {
+                L = bsplit_parallel_impl<Series>(pool, a, m, grain, true, prog, budget, cancel);
+                R = bsplit_parallel_impl<Series>(pool, m, b, grain, need_p, prog, budget, cancel);
+            }
+            // Running the products side by side keeps a fresh P and P*T alive together
+            check(cancel);
+            merge_parallel(pool, L, R, need_p, budget, result_bytes<Series>(a, b));
+            if (prog) prog->add(step_work(b - a));
+            return L;
+        }
+    } // namespace
+
     // Parallel binary-splitting implementation
-    BSplitTriplet bsplit_chudnovsky_parallel(long a, long b, int num_threads, Progress* prog) {
-        // For now, this is a stub that falls back to sequential
-        // TODO: Implement actual parallel processing with thread pool
-        
-        if (num_threads <= 1) {
-            return bsplit_chudnovsky(a, b, prog);
+    template <class Series>
+    BSplitTriplet bsplit_series_parallel(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                         std::size_t max_memory, const CancelToken* cancel) {
+        if (num_threads <= 1 || b - a < 2) {
+            return bsplit_series<Series>(a, b, prog, need_p, cancel);
         }
-        
-        // Simple chunk-based approach (not yet parallel)
-        const long chunk_size = std::max(1L, (b - a) / num_threads);
-        ParallelScheduler scheduler(num_threads, chunk_size);
-        
-        // For now, just process sequentially but with chunking
-        BSplitTriplet result{mpz_class{1}, mpz_class{1}, mpz_class{0}};
-        
-        for (long chunk_start = a; chunk_start < b; chunk_start += chunk_size) {
-            long chunk_end = std::min(chunk_start + chunk_size, b);
-            BSplitTriplet chunk = bsplit_chudnovsky(chunk_start, chunk_end, prog);
-            
-            // Combine results
-            result.P *= chunk.P;
-            result.Q *= chunk.Q;
-            result.T = result.T * chunk.Q + result.P * chunk.T;
+
+        ProgressReporter reporter(prog, bsplit_work(a, b));
+        ParallelScheduler scheduler(num_threads);
+
+        const long grain = parallel_grain(b - a, num_threads);
+
+        MemoryBudget budget;
+        budget.limit = max_memory;
+        budget.force_reserve(peak_bytes<Series>(a, b));
+        return bsplit_parallel_impl<Series>(*scheduler.get_thread_pool(), a, b, grain, need_p, prog, budget, cancel);
+    }
+
+    BSplitTriplet bsplit_chudnovsky_parallel(long a, long b, int num_threads, Progress* prog,
+                                             bool need_p, std::size_t max_memory, const CancelToken* cancel) {
+        return bsplit_series_parallel<ChudnovskySeries>(a, b, num_threads, prog, need_p, max_memory, cancel);
+    }
+
+    namespace {
+        // Products at least this large are interleaved while merging the
+        // per-node results: every node reads them, none should own them
+        constexpr std::size_t kInterleaveBytes = std::size_t(32) << 20;
+
+        // One contiguous part of the series per NUMA node
+        struct NodePart {
+            long a = 0, b = 0;
+            std::vector<int> cpus;
+            int threads = 1;
+            BSplitTriplet result;
+        };
+
+        void run_part(NodePart& part, bool need_p, Progress* prog, MemoryBudget& budget, const CancelToken* cancel) {
+            ThreadPool pool(static_cast<std::size_t>(part.threads - 1), part.cpus);
+            const long grain = parallel_grain(part.b - part.a, part.threads);
+            part.result = bsplit_parallel_impl<ChudnovskySeries>(pool, part.a, part.b, grain, need_p, prog, budget,
+                                                                 cancel);
         }
-        
-        return result;
+
+        struct InterleaveScope {
+            InterleaveScope() { g_memory_pool.set_interleave_threshold(kInterleaveBytes); }
+            ~InterleaveScope() { g_memory_pool.set_interleave_threshold(0); }
+        };
+    } // namespace
+
+    BSplitTriplet bsplit_chudnovsky_numa(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                         std::size_t max_memory, const CancelToken* cancel) {
+        const Topology& topo = Topology::get();
+        const std::size_t nodes = std::min(topo.nodes().size(), static_cast<std::size_t>(std::max(num_threads, 1)));
+        if (nodes < 2 || b - a < static_cast<long>(nodes) * g_min_parallel_grain.load(std::memory_order_relaxed)) {
+            return bsplit_chudnovsky_parallel(a, b, num_threads, prog, need_p, max_memory, cancel);
+        }
+
+        ProgressReporter reporter(prog, bsplit_work(a, b));
+
+        // Threads in proportion to each node's CPUs, at least one per node
+        std::vector<NodePart> parts(nodes);
+        std::size_t total_cpus = 0;
+        for (std::size_t i = 0; i < nodes; ++i) {
+            parts[i].cpus = topo.cpus_of_node(topo.nodes()[i]);
+            total_cpus += parts[i].cpus.size();
+        }
+        int assigned = 0;
+        for (std::size_t i = 0; i < nodes; ++i) {
+            const int share = static_cast<int>(static_cast<std::size_t>(num_threads) * parts[i].cpus.size() / total_cpus);
+            parts[i].threads = std::max(1, share);
+            assigned += parts[i].threads;
+        }
+        for (std::size_t i = 0; assigned < num_threads; i = (i + 1) % nodes, ++assigned) ++parts[i].threads;
+        while (assigned > num_threads) {
+            auto most = std::max_element(parts.begin(), parts.end(),
+                                         [](const NodePart& x, const NodePart& y) { return x.threads < y.threads; });
+            --most->threads;
+            --assigned;
+        }
+
+        // Terms in proportion to threads
+        long start = a;
+        int threads_before = 0;
+        for (std::size_t i = 0; i < nodes; ++i) {
+            threads_before += parts[i].threads;
+            parts[i].a = start;
+            parts[i].b = i + 1 == nodes ? b : a + static_cast<long>((b - a) * static_cast<double>(threads_before) / num_threads);
+            start = parts[i].b;
+        }
+
+        MemoryBudget budget;
+        budget.limit = max_memory;
+        budget.force_reserve(bsplit_peak_bytes(a, b));
+
+        // Every part's tree is built by threads of its node, so its limbs are
+        // first touched there. This thread takes node 0; a pinned driver
+        // thread leads each of the others.
+        std::vector<std::exception_ptr> errors(nodes);
+        {
+            std::vector<std::thread> drivers;
+            for (std::size_t i = 1; i < nodes; ++i) {
+                drivers.emplace_back([&, i] {
+                    pin_thread_to_cpus(parts[i].cpus);
+                    try {
+                        run_part(parts[i], i + 1 < nodes || need_p, prog, budget, cancel);
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                });
+            }
+            try {
+                ScopedAffinity pin(parts[0].cpus);
+                run_part(parts[0], true, prog, budget, cancel);
+            } catch (...) {
+                errors[0] = std::current_exception();
+            }
+            for (std::thread& t : drivers) t.join();
+        }
+        for (const std::exception_ptr& e : errors) {
+            if (e) std::rethrow_exception(e);
+        }
+
+        // Merge neighbours pairwise on all threads, unpinned, with the large
+        // products spread over the nodes
+        InterleaveScope interleave;
+        ThreadPool pool(static_cast<std::size_t>(num_threads - 1));
+
+        // The parts are not cut where bsplit_work splits: the merges take
+        // whatever work is left, in equal shares
+        std::uint64_t merge_work = bsplit_work(a, b);
+        for (const NodePart& p : parts) merge_work -= std::min(merge_work, bsplit_work(p.a, p.b));
+        std::size_t merges_left = nodes - 1;
+        while (parts.size() > 1) {
+            std::vector<NodePart> next;
+            for (std::size_t i = 0; i + 1 < parts.size(); i += 2) {
+                NodePart& L = parts[i];
+                NodePart& R = parts[i + 1];
+                const bool last = R.b == b;
+                check(cancel);
+                merge_parallel(pool, L.result, R.result, !last || need_p, budget, bsplit_result_bytes(L.a, R.b));
+                const std::uint64_t w = merge_work / merges_left--;
+                merge_work -= w;
+                if (prog) prog->add(w);
+                L.b = R.b;
+                next.push_back(std::move(L));
+            }
+            if (parts.size() % 2) next.push_back(std::move(parts.back()));
+            parts = std::move(next);
+        }
+        return std::move(parts[0].result);
     }
-} // namespace piracer
\ No newline at end of file
+
+    namespace {
+        // Batched runs build subtrees of at least this many terms before
+        // merging level by level: below that the products are too small to
+        // be worth a batch
+        constexpr long kBatchBaseTerms = long(1) << 13;
+
+        // One node of a tree level: its range and P/Q/T
+        struct LevelNode {
+            long a, b;
+            BSplitTriplet t;
+        };
+    } // namespace
+
+    template <class Series>
+    BSplitTriplet bsplit_series_batched(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                        GPUMultiplier& mul, const CancelToken* cancel) {
+        if (b - a < 2 * kBatchBaseTerms) {
+            return bsplit_series_parallel<Series>(a, b, num_threads, prog, need_p, 0, cancel);
+        }
+
+        ProgressReporter reporter(prog, bsplit_work(a, b));
+        std::unique_ptr<ThreadPool> pool;
+        if (num_threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(num_threads - 1));
+
+        // The nodes `depth` levels below the root, cut at the same midpoints
+        // as every other variant, so the merges reproduce its tree exactly
+        int depth = 0;
+        while (depth < 20 && ((b - a) >> (depth + 1)) >= kBatchBaseTerms) ++depth;
+        std::vector<LevelNode> level{{a, b, {}}};
+        for (int d = 0; d < depth; ++d) {
+            std::vector<LevelNode> next;
+            next.reserve(2 * level.size());
+            for (const LevelNode& n : level) {
+                const long m = (n.a + n.b) / 2;
+                next.push_back({n.a, m, {}});
+                next.push_back({m, n.b, {}});
+            }
+            level = std::move(next);
+        }
+
+        // Only the rightmost node of a level lies on the right spine
+        {
+            TaskGroup g(pool.get());
+            for (std::size_t i = 0; i < level.size(); ++i) {
+                LevelNode& n = level[i];
+                const bool p = i + 1 < level.size() || need_p;
+                g.spawn([&n, p, prog, cancel] {
+                    PIRACER_PROFILE_SCOPE("bsplit.subtree");
+                    check(cancel);
+                    n.t = bsplit_impl<Series>(n.a, n.b, prog, p, cancel);
+                });
+            }
+            g.sync();
+        }
+
+        while (level.size() > 1) {
+            check(cancel);
+            PIRACER_PROFILE_SCOPE("bsplit.merge_level");
+            const std::size_t pairs = level.size() / 2;
+            std::vector<BSplitTriplet> out(pairs);
+            std::vector<mpz_class> pt(pairs);
+            std::vector<GPUMultiplier::BatchProduct> jobs;
+            jobs.reserve(4 * pairs);
+            for (std::size_t i = 0; i < pairs; ++i) {
+                const BSplitTriplet& L = level[2 * i].t;
+                const BSplitTriplet& R = level[2 * i + 1].t;
+                jobs.push_back({&L.P, &R.T, &pt[i]});
+                jobs.push_back({&L.T, &R.Q, &out[i].T});
+                jobs.push_back({&L.Q, &R.Q, &out[i].Q});
+                if (i + 1 < pairs || need_p) jobs.push_back({&L.P, &R.P, &out[i].P});
+            }
+            mul.multiply_products(jobs, pool.get());
+
+            std::vector<LevelNode> next;
+            next.reserve(pairs);
+            for (std::size_t i = 0; i < pairs; ++i) {
+                const long lo = level[2 * i].a, hi = level[2 * i + 1].b;
+                level[2 * i].t = BSplitTriplet{};
+                level[2 * i + 1].t = BSplitTriplet{};
+                out[i].T += pt[i];
+                release(pt[i]);
+                next.push_back({lo, hi, std::move(out[i])});
+                if (prog) prog->add(step_work(hi - lo));
+            }
+            level = std::move(next);
+        }
+        return std::move(level[0].t);
+    }
+
+    BSplitTriplet bsplit_chudnovsky_batched(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                            GPUMultiplier& mul, const CancelToken* cancel) {
+        return bsplit_series_batched<ChudnovskySeries>(a, b, num_threads, prog, need_p, mul, cancel);
+    }
+
+    namespace {
+        // Finished subtrees of the top of the tree are the checkpoint units;
+        // below this many terms a subtree is not split further
+        constexpr long kMinCheckpointTerms = 4096;
+        constexpr int kMaxCheckpointDepth = 6;
+
+        using SegmentPtr = std::shared_ptr<CheckpointSegment>;
+        using SegmentMap = std::map<std::pair<long, long>, SegmentPtr>;
+
+        struct ResumableRun {
+            ThreadPool* pool = nullptr;
+            int num_threads = 1;
+            Progress* prog = nullptr;
+            const CancelToken* cancel = nullptr;
+            MemoryBudget budget;
+            SegmentMap resume;    // loaded, not yet reached
+            SegmentMap done;      // maximal finished subtrees
+            CheckpointWriter* writer = nullptr;
+
+            // A step (or a resumed subtree) is done
+            void advance(std::uint64_t work) {
+                if (prog) prog->add(work);
+            }
+
+            void post() {
+                if (!writer) return;
+                CheckpointWriter::Snapshot snapshot;
+                std::size_t terms = 0;
+                for (const auto& entry : done) {
+                    snapshot.push_back(entry.second);
+                    terms += static_cast<std::size_t>(entry.second->end - entry.second->begin);
+                }
+                writer->post(std::move(snapshot), terms);
+            }
+        };
+
+        // Segments are never modified once posted; the root is not posted
+        // (the run is over) so the caller can take its state
+        template <class Series>
+        SegmentPtr resumable_node(ResumableRun& run, long a, long b, int depth, bool need_p, bool is_root) {
+            const auto key = std::make_pair(a, b);
+            auto it = run.resume.find(key);
+            if (it != run.resume.end()) {
+                SegmentPtr seg = it->second;
+                run.resume.erase(it);
+                run.done[key] = seg;
+                run.advance(bsplit_work(a, b));
+                return seg;
+            }
+
+            auto seg = std::make_shared<CheckpointSegment>();
+            seg->begin = static_cast<std::uint64_t>(a);
+            seg->end = static_cast<std::uint64_t>(b);
+            if (depth == 0 || b - a <= leaf_terms()) {
+                if (run.pool) {
+                    const long grain = parallel_grain(b - a, run.num_threads);
+                    seg->state = bsplit_parallel_impl<Series>(*run.pool, a, b, grain, need_p, run.prog, run.budget,
+                                                              run.cancel);
+                } else {
+                    seg->state = bsplit_impl<Series>(a, b, run.prog, need_p, run.cancel);
+                }
+            } else {
+                const long m = (a + b) / 2;
+                SegmentPtr L = resumable_node<Series>(run, a, m, depth - 1, true, false);
+                SegmentPtr R = resumable_node<Series>(run, m, b, depth - 1, need_p, false);
+                check(run.cancel);
+                run.done.erase({a, m});
+                run.done.erase({m, b});
+                if (L.use_count() == 1 && R.use_count() == 1) {
+                    // Nobody else can reach the children any more: consume them
+                    seg->state = std::move(L->state);
+                    if (run.pool) {
+                        merge_parallel(*run.pool, seg->state, R->state, need_p, run.budget,
+                                       result_bytes<Series>(a, b));
+                    } else {
+                        merge_into(seg->state, R->state, need_p);
+                    }
+                } else {
+                    // A pending checkpoint save still reads them
+                    seg->state = merge(L->state, R->state, need_p, run.pool);
+                }
+                run.advance(step_work(b - a));
+            }
+            if (is_root) return seg;
+            run.done[key] = seg;
+            run.post();
+            return seg;
+        }
+    } // namespace
+
+    template <class Series>
+    BSplitTriplet bsplit_series_resumable(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                          std::vector<CheckpointSegment> resume, CheckpointWriter* writer,
+                                          std::size_t max_memory, const CancelToken* cancel) {
+        int depth = 0;
+        while (depth < kMaxCheckpointDepth && ((b - a) >> (depth + 1)) >= kMinCheckpointTerms) ++depth;
+
+        ProgressReporter reporter(prog, bsplit_work(a, b));
+        std::unique_ptr<ThreadPool> pool;
+        if (num_threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(num_threads - 1));
+
+        ResumableRun run;
+        run.pool = pool.get();
+        run.num_threads = num_threads;
+        run.prog = prog;
+        run.cancel = cancel;
+        run.budget.limit = max_memory;
+        run.budget.force_reserve(peak_bytes<Series>(a, b));
+        run.writer = writer;
+        for (CheckpointSegment& seg : resume) {
+            const auto key = std::make_pair(static_cast<long>(seg.begin), static_cast<long>(seg.end));
+            run.resume[key] = std::make_shared<CheckpointSegment>(std::move(seg));
+        }
+        resume.clear();
+
+        SegmentPtr root;
+        try {
+            root = resumable_node<Series>(run, a, b, depth, need_p, true);
+        } catch (const ComputeCancelled&) {
+            // Whatever finished so far is on disk before the stop goes on
+            if (writer) writer->flush();
+            throw;
+        }
+        run.done.clear();
+        return std::move(root->state);
+    }
+
+    BSplitTriplet bsplit_chudnovsky_resumable(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                              std::vector<CheckpointSegment> resume, CheckpointWriter* writer,
+                                              std::size_t max_memory, const CancelToken* cancel) {
+        return bsplit_series_resumable<ChudnovskySeries>(a, b, num_threads, prog, need_p, std::move(resume), writer,
+                                                         max_memory, cancel);
+    }
+
+    // The shipped policies; a new series.hpp policy adds its line here
+#define PIRACER_INSTANTIATE_SERIES(S)                                                                        \
+    template BSplitTriplet bsplit_series<S>(long, long, Progress*, bool, const CancelToken*);               \
+    template BSplitTriplet bsplit_series_parallel<S>(long, long, int, Progress*, bool, std::size_t,         \
+                                                     const CancelToken*);                                   \
+    template BSplitTriplet bsplit_series_batched<S>(long, long, int, Progress*, bool, GPUMultiplier&,       \
+                                                    const CancelToken*);                                    \
+    template BSplitTriplet bsplit_series_resumable<S>(long, long, int, Progress*, bool,                    \
+                                                      std::vector<CheckpointSegment>, CheckpointWriter*,   \
+                                                      std::size_t, const CancelToken*);
+    PIRACER_INSTANTIATE_SERIES(ChudnovskySeries)
+    PIRACER_INSTANTIATE_SERIES(RamanujanSeries)
+    PIRACER_INSTANTIATE_SERIES(ESeries)
+    PIRACER_INSTANTIATE_SERIES(Log2Series)
+#undef PIRACER_INSTANTIATE_SERIES
+} // namespace piracer
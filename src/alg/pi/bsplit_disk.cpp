@@ -0,0 +1,116 @@
+#include "piracer/bsplit.hpp"
+#include "piracer/cancel.hpp"
+#include "piracer/disk_int.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace piracer {
+    namespace {
+        // Subtrees this small are never spilled, whatever the limit
+        constexpr long kMinDiskTerms = 1024;
+
+        struct DiskTriplet {
+            DiskInt P, Q, T;
+        };
+
+        struct OutOfCoreRun {
+            ScratchSpace* space = nullptr;
+            DiskMath math;
+            std::size_t memory_limit = 0;
+            int num_threads = 1;
+            Progress* prog = nullptr;
+            const CancelToken* cancel = nullptr;
+        };
+
+        BSplitTriplet in_memory(const OutOfCoreRun& run, long a, long b, bool need_p) {
+            return run.num_threads > 1
+                       ? bsplit_chudnovsky_parallel(a, b, run.num_threads, run.prog, need_p, run.memory_limit,
+                                                    run.cancel)
+                       : bsplit_chudnovsky(a, b, run.prog, need_p, run.cancel);
+        }
+
+        bool fits(const OutOfCoreRun& run, long a, long b) {
+            return b - a <= kMinDiskTerms || bsplit_peak_bytes(a, b) <= run.memory_limit;
+        }
+
+        // Same products as the in-memory merge, each streamed from and to the
+        // scratch space; inputs are deleted after their last use
+        DiskTriplet merge_disk(const OutOfCoreRun& run, DiskTriplet& L, DiskTriplet& R, bool need_p) {
+            DiskTriplet x;
+            DiskInt PT = disk_mul(L.P, R.T, run.math);
+            R.T.reset();
+            if (!need_p) L.P.reset();
+            DiskInt TQ = disk_mul(L.T, R.Q, run.math);
+            L.T.reset();
+            x.T = disk_add(TQ, PT, run.math);
+            TQ.reset();
+            PT.reset();
+            x.Q = disk_mul(L.Q, R.Q, run.math);
+            L.Q.reset();
+            R.Q.reset();
+            if (need_p) x.P = disk_mul(L.P, R.P, run.math);
+            L.P.reset();
+            R.P.reset();
+            return x;
+        }
+
+        DiskTriplet disk_node(const OutOfCoreRun& run, long a, long b, bool need_p) {
+            if (fits(run, a, b)) {
+                BSplitTriplet x = in_memory(run, a, b, need_p);
+                DiskTriplet d;
+                d.P = DiskInt::spill(*run.space, x.P);
+                d.Q = DiskInt::spill(*run.space, x.Q);
+                d.T = DiskInt::spill(*run.space, x.T);
+                return d;
+            }
+            const long m = (a + b) / 2;
+            DiskTriplet L = disk_node(run, a, m, true);
+            DiskTriplet R = disk_node(run, m, b, need_p);
+            if (run.cancel) run.cancel->check();
+            DiskTriplet x = merge_disk(run, L, R, need_p);
+            if (run.prog) run.prog->add(bsplit_merge_work(a, b));
+            return x;
+        }
+    } // namespace
+
+    BSplitTriplet bsplit_chudnovsky_out_of_core(long a, long b, int num_threads, Progress* prog, bool need_p,
+                                                const std::string& scratch_dir, std::size_t memory_limit,
+                                                std::size_t* peak_disk_bytes, const CancelToken* cancel) {
+        ProgressReporter reporter(prog, bsplit_work(a, b));
+        OutOfCoreRun run;
+        run.memory_limit = memory_limit;
+        run.num_threads = num_threads;
+        run.prog = prog;
+        run.cancel = cancel;
+        if (peak_disk_bytes) *peak_disk_bytes = 0;
+        if (fits(run, a, b)) return in_memory(run, a, b, need_p);
+
+        ScratchSpace space(scratch_dir);
+        std::unique_ptr<ThreadPool> pool;
+        if (num_threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(num_threads - 1));
+        run.space = &space;
+        run.math.space = &space;
+        run.math.block_limbs = disk_block_limbs(memory_limit);
+        run.math.pool = pool.get();
+
+        const long m = (a + b) / 2;
+        DiskTriplet L = disk_node(run, a, m, true);
+        DiskTriplet R = disk_node(run, m, b, need_p);
+        if (cancel) cancel->check();
+        DiskTriplet root = merge_disk(run, L, R, need_p);
+        if (prog) prog->add(bsplit_merge_work(a, b));
+
+        // The caller divides Q by T next, which needs both in memory
+        BSplitTriplet S;
+        root.Q.load(S.Q);
+        root.Q.reset();
+        root.T.load(S.T);
+        root.T.reset();
+        if (need_p) root.P.load(S.P);
+        if (peak_disk_bytes) *peak_disk_bytes = space.peak_bytes_on_disk();
+        return S;
+    }
+} // namespace piracer
@@ -0,0 +1,502 @@
+#include "piracer/distributed.hpp"
+#include "piracer/cancel.hpp"
+#include "piracer/checkpoint.hpp"
+#include "piracer/disk_int.hpp"
+#include "piracer/socket.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+#ifndef _WIN32
+    namespace {
+        constexpr const char* kAlgorithm = "chudnovsky";
+
+        // Ranges smaller than this are not worth a round trip
+        constexpr long kMinRangeTerms = 1024;
+
+        // No request may end past this term (~1.4e13 digits), which keeps
+        // the size estimates of a range far from overflowing
+        constexpr long kMaxTerm = 1L << 40;
+
+        // A received range may be this much larger than bsplit_result_bytes
+        // estimates before it is taken for garbage
+        std::uint64_t max_range_bytes(long a, long b) {
+            return 2 * static_cast<std::uint64_t>(bsplit_result_bytes(a, b)) + (std::uint64_t(1) << 20);
+        }
+
+        // "[host:]port" or "[v6addr]:port"; host is empty when not given
+        void split_address(const std::string& address, std::string& host, std::string& port) {
+            if (!address.empty() && address[0] == '[') {
+                const auto close = address.find(']');
+                if (close == std::string::npos || close + 1 >= address.size() || address[close + 1] != ':') {
+                    throw std::runtime_error("bad address '" + address + "'");
+                }
+                host = address.substr(1, close - 1);
+                port = address.substr(close + 2);
+            } else {
+                const auto colon = address.rfind(':');
+                host = colon == std::string::npos ? std::string() : address.substr(0, colon);
+                port = colon == std::string::npos ? address : address.substr(colon + 1);
+            }
+            if (port.empty()) throw std::runtime_error("no port in '" + address + "'");
+        }
+
+        // A connected or listening socket for `address`; throws
+        // std::runtime_error("<address>: <why>")
+        int open_tcp(const std::string& address, bool listen) {
+            std::string host, port;
+            split_address(address, host, port);
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* found = nullptr;
+            // No host: IPv4 loopback, where "localhost" reaches it too
+            if (host.empty()) host = "127.0.0.1";
+            const int rc = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &found);
+            if (rc != 0) throw std::runtime_error(address + ": " + ::gai_strerror(rc));
+
+            std::string why = "no usable address";
+            int fd = -1;
+            for (addrinfo* ai = found; ai && fd < 0; ai = ai->ai_next) {
+                fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+                if (fd < 0) {
+                    why = std::strerror(errno);
+                    continue;
+                }
+                const int one = 1;
+                bool ok;
+                if (listen) {
+                    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                    ok = ::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, 64) == 0;
+                } else {
+                    ok = ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+                }
+                if (!ok) {
+                    why = std::strerror(errno);
+                    ::close(fd);
+                    fd = -1;
+                    continue;
+                }
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            ::freeaddrinfo(found);
+            if (fd < 0) throw std::runtime_error(address + ": " + why);
+            return fd;
+        }
+
+        bool send_range(int fd, long a, long b, BSplitTriplet&& state) {
+            BinaryCheckpoint enc;
+            enc.algorithm_name = kAlgorithm;
+            enc.completed_terms = static_cast<std::size_t>(b - a);
+            enc.total_terms = static_cast<std::size_t>(b);
+            enc.segments.push_back({static_cast<std::uint64_t>(a), static_cast<std::uint64_t>(b), std::move(state)});
+            return send_line(fd, "OK") && send_binary_checkpoint(enc, [fd](const void* p, std::size_t n) {
+                       return send_all(fd, p, n);
+                   });
+        }
+
+        // Closable FIFO between the threads of one worker connection
+        template <class T>
+        class Channel {
+        public:
+            void push(T x) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    items_.push_back(std::move(x));
+                }
+                ready_.notify_one();
+            }
+
+            // False once closed and drained
+            bool pop(T& x) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return closed_ || !items_.empty(); });
+                if (items_.empty()) return false;
+                x = std::move(items_.front());
+                items_.pop_front();
+                return true;
+            }
+
+            void close() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    closed_ = true;
+                }
+                ready_.notify_all();
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable ready_;
+            std::deque<T> items_;
+            bool closed_ = false;
+        };
+
+        struct WorkItem {
+            long a = 0, b = 0;
+            bool need_p = true;
+            std::string error;  // set on a bad request, then on a failed build
+            BSplitTriplet state;
+        };
+
+        // Three threads, so a range is built while the one before it is
+        // sent and the one after it is already read: this one reads
+        // requests, a builder runs them, a sender answers them in order
+        void serve_connection(int fd, int num_threads, std::size_t max_memory, std::size_t range_limit,
+                              const std::function<void(const std::string&)>& log) {
+            CancelToken hangup;
+            Channel<WorkItem> requests, replies;
+
+            std::thread sender([&] {
+                WorkItem w;
+                bool open = true;
+                while (replies.pop(w)) {
+                    if (!open) continue;
+                    open = w.error.empty() ? send_range(fd, w.a, w.b, std::move(w.state)) : send_line(fd, "ERR " + w.error);
+                    if (!open) hangup.cancel();
+                }
+            });
+            std::thread builder([&] {
+                WorkItem w;
+                while (requests.pop(w)) {
+                    if (hangup.stopped()) continue;
+                    if (w.error.empty()) {
+                        const auto t0 = std::chrono::steady_clock::now();
+                        try {
+                            w.state = num_threads > 1
+                                ? bsplit_chudnovsky_parallel(w.a, w.b, num_threads, nullptr, w.need_p, max_memory, &hangup)
+                                : bsplit_chudnovsky(w.a, w.b, nullptr, w.need_p, &hangup);
+                        } catch (const ComputeCancelled&) {
+                            continue;
+                        } catch (const std::exception& e) {
+                            w.error = e.what();
+                        }
+                        if (log && w.error.empty()) {
+                            std::ostringstream line;
+                            line << "range [" << w.a << ", " << w.b << ") in "
+                                 << std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() << " s";
+                            log(line.str());
+                        }
+                    }
+                    replies.push(std::move(w));
+                }
+                replies.close();
+            });
+
+            SocketReader in(fd);
+            std::string line;
+            while (in.line(line)) {
+                if (line.empty()) continue;
+                std::istringstream words(line);
+                std::string verb;
+                WorkItem w;
+                int need_p = 1;
+                if (!(words >> verb >> w.a >> w.b >> need_p) || verb != "BSPLIT" || w.a < 0 || w.b <= w.a ||
+                    w.b > kMaxTerm || (need_p != 0 && need_p != 1)) {
+                    w.error = "bad request '" + line + "'";
+                } else if (bsplit_peak_bytes(w.a, w.b) > range_limit) {
+                    w.error = "range [" + std::to_string(w.a) + ", " + std::to_string(w.b) + ") needs about " +
+                              std::to_string(bsplit_peak_bytes(w.a, w.b) >> 20) + " MiB, more than the " +
+                              std::to_string(range_limit >> 20) + " MiB this worker allows";
+                }
+                w.need_p = need_p != 0;
+                requests.push(std::move(w));
+            }
+            // The coordinator is gone (or done): nothing left is wanted
+            hangup.cancel();
+            requests.close();
+            builder.join();
+            sender.join();
+            ::close(fd);
+        }
+
+        struct Range {
+            long a, b;
+        };
+
+        // State the node threads and the merging thread share
+        struct DistributedRun {
+            std::vector<std::string> nodes;
+            std::vector<Range> ranges;
+            long b = 0;
+            bool need_p = true;
+
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::deque<std::size_t> todo;          // ranges no node holds
+            std::vector<BSplitTriplet> results;    // by range
+            std::deque<std::size_t> arrived;       // received, not yet taken by the merger
+            std::size_t outstanding = 0;           // ranges not received yet
+            std::size_t alive = 0;                 // node threads still able to take ranges
+            std::string last_error;
+            std::vector<int> fds;                  // per node, -1 when not connected
+            bool stop = false;
+
+            // Runs one node: keeps up to kDistributedRangesPerNode requests
+            // in flight and receives the replies in order
+            void drive(std::size_t node) {
+                std::deque<std::size_t> inflight;
+                // `why` names the node
+                auto fail = [&](const std::string& why) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (auto it = inflight.rbegin(); it != inflight.rend(); ++it) todo.push_front(*it);
+                    --alive;
+                    if (!stop) last_error = why;
+                    changed.notify_all();
+                };
+
+                int fd;
+                try {
+                    fd = open_tcp(nodes[node], false);
+                } catch (const std::exception& e) {
+                    fail(e.what());
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    fds[node] = fd;
+                }
+                auto disconnect = [&] {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    fds[node] = -1;
+                    ::close(fd);
+                };
+
+                SocketReader in(fd);
+                for (;;) {
+                    std::vector<std::size_t> to_send;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        if (inflight.empty()) {
+                            changed.wait(lock, [&] { return stop || !todo.empty() || outstanding == 0; });
+                        }
+                        if (stop || (inflight.empty() && todo.empty())) break;
+                        while (inflight.size() < static_cast<std::size_t>(kDistributedRangesPerNode) && !todo.empty()) {
+                            inflight.push_back(todo.front());
+                            to_send.push_back(todo.front());
+                            todo.pop_front();
+                        }
+                    }
+                    for (std::size_t i : to_send) {
+                        const Range& r = ranges[i];
+                        if (!send_line(fd, "BSPLIT " + std::to_string(r.a) + " " + std::to_string(r.b) + " " +
+                                               (need_p || r.b < b ? "1" : "0"))) {
+                            disconnect();
+                            fail(nodes[node] + ": connection lost");
+                            return;
+                        }
+                    }
+
+                    const std::size_t i = inflight.front();
+                    const Range& r = ranges[i];
+                    std::string line;
+                    BinaryCheckpoint enc;
+                    std::string why;
+                    if (!in.line(line)) {
+                        why = "connection lost";
+                    } else if (line != "OK") {
+                        why = line.compare(0, 4, "ERR ") == 0 ? line.substr(4) : "bad reply '" + line + "'";
+                    } else if (!receive_binary_checkpoint([&in](void* p, std::size_t n) { return in.exact(p, n); },
+                                                          enc, max_range_bytes(r.a, r.b))) {
+                        why = "range data bad, truncated or larger than its size estimate";
+                    } else if (enc.segments.size() != 1 || enc.segments[0].begin != static_cast<std::uint64_t>(r.a) ||
+                               enc.segments[0].end != static_cast<std::uint64_t>(r.b)) {
+                        why = "sent a range that was not asked for";
+                    }
+                    if (!why.empty()) {
+                        disconnect();
+                        fail(nodes[node] + ": " + why);
+                        return;
+                    }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results[i] = std::move(enc.segments[0].state);
+                    arrived.push_back(i);
+                    --outstanding;
+                    inflight.pop_front();
+                    changed.notify_all();
+                }
+                disconnect();
+                std::lock_guard<std::mutex> lock(mutex);
+                --alive;
+                changed.notify_all();
+            }
+        };
+
+        // Stops and joins the node threads however the merging ends
+        class NodeThreads {
+        public:
+            explicit NodeThreads(DistributedRun& run) : run_(run) {
+                for (std::size_t i = 0; i < run.nodes.size(); ++i) threads_.emplace_back([&run, i] { run.drive(i); });
+            }
+
+            ~NodeThreads() {
+                {
+                    std::lock_guard<std::mutex> lock(run_.mutex);
+                    run_.stop = true;
+                    for (int fd : run_.fds) {
+                        if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+                    }
+                }
+                run_.changed.notify_all();
+                for (std::thread& t : threads_) t.join();
+            }
+
+            NodeThreads(const NodeThreads&) = delete;
+            NodeThreads& operator=(const NodeThreads&) = delete;
+
+        private:
+            DistributedRun& run_;
+            std::vector<std::thread> threads_;
+        };
+    } // namespace
+
+    BSplitTriplet bsplit_chudnovsky_distributed(long a, long b, const std::vector<std::string>& nodes,
+                                                int num_threads, Progress* prog, bool need_p,
+                                                const CancelToken* cancel) {
+        if (nodes.empty()) throw std::invalid_argument("distributed: no nodes");
+        ProgressReporter reporter(prog, bsplit_work(a, b));
+
+        DistributedRun run;
+        run.nodes = nodes;
+        run.b = b;
+        run.need_p = need_p;
+        const long count = std::max(1L, std::min(static_cast<long>(nodes.size()) * kDistributedRangesPerNode,
+                                                 (b - a) / kMinRangeTerms));
+        for (long i = 0; i < count; ++i) {
+            run.ranges.push_back({a + (b - a) * i / count, i + 1 == count ? b : a + (b - a) * (i + 1) / count});
+            run.todo.push_back(static_cast<std::size_t>(i));
+        }
+        run.results.resize(run.ranges.size());
+        run.outstanding = run.ranges.size();
+        run.alive = nodes.size();
+        run.fds.assign(nodes.size(), -1);
+
+        // The tree above the ranges: level l has slot j over ranges
+        // [j 2^l, (j + 1) 2^l), the last slot of a level possibly without a
+        // right child. A slot is merged as soon as both children are in.
+        enum : int { Empty, Ready, Used };
+        struct Slot {
+            int state = Empty;
+            BSplitTriplet s;
+        };
+        std::vector<std::vector<Slot>> levels(1, std::vector<Slot>(run.ranges.size()));
+        std::size_t merges_left = 0;
+        while (levels.back().size() > 1) {
+            const std::size_t n = levels.back().size();
+            merges_left += n / 2;
+            levels.emplace_back((n + 1) / 2);
+        }
+        auto slot_end = [&](std::size_t l, std::size_t j) {
+            return run.ranges[std::min(((j + 1) << l), run.ranges.size()) - 1].b;
+        };
+
+        // Range work as it arrives; the merges share what is left, as with NUMA parts
+        std::uint64_t merge_work = bsplit_work(a, b);
+        for (const Range& r : run.ranges) merge_work -= std::min(merge_work, bsplit_work(r.a, r.b));
+
+        std::unique_ptr<ThreadPool> pool;
+        if (num_threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(num_threads - 1));
+
+        NodeThreads threads(run);
+        while (levels.back()[0].state != Ready) {
+            std::deque<std::size_t> fresh;
+            {
+                std::unique_lock<std::mutex> lock(run.mutex);
+                while (run.arrived.empty() && !(run.alive == 0 && run.outstanding > 0)) {
+                    run.changed.wait_for(lock, std::chrono::milliseconds(100));
+                    if (cancel) cancel->check();
+                }
+                if (run.arrived.empty()) {
+                    throw std::runtime_error("distributed: no node left for " + std::to_string(run.outstanding) +
+                                             " of " + std::to_string(run.ranges.size()) +
+                                             " ranges (last error: " + run.last_error + ")");
+                }
+                fresh.swap(run.arrived);
+                for (std::size_t i : fresh) {
+                    levels[0][i].s = std::move(run.results[i]);
+                    levels[0][i].state = Ready;
+                }
+            }
+            for (std::size_t i : fresh) {
+                if (prog) prog->add(bsplit_work(run.ranges[i].a, run.ranges[i].b));
+            }
+
+            // Everything that became possible, bottom up
+            for (std::size_t l = 0; l + 1 < levels.size(); ++l) {
+                for (std::size_t j = 0; j < levels[l + 1].size(); ++j) {
+                    Slot& up = levels[l + 1][j];
+                    Slot& L = levels[l][2 * j];
+                    Slot* R = 2 * j + 1 < levels[l].size() ? &levels[l][2 * j + 1] : nullptr;
+                    if (up.state != Empty || L.state != Ready || (R && R->state != Ready)) continue;
+                    if (R) {
+                        if (cancel) cancel->check();
+                        bsplit_merge(L.s, R->s, need_p || slot_end(l + 1, j) < b, pool.get());
+                        R->state = Used;
+                        const std::uint64_t w = merge_work / merges_left--;
+                        merge_work -= w;
+                        if (prog) prog->add(w);
+                    }
+                    up.s = std::move(L.s);
+                    up.state = Ready;
+                    L.state = Used;
+                }
+            }
+        }
+        return std::move(levels.back()[0].s);
+    }
+
+    void serve_bsplit_worker(const std::string& address, int num_threads, std::size_t max_memory,
+                             std::function<void(const std::string&)> log) {
+        int listener;
+        try {
+            listener = open_tcp(address, true);
+        } catch (const std::exception& e) {
+            throw std::runtime_error(std::string("worker: cannot listen on ") + e.what());
+        }
+        std::size_t range_limit = max_memory ? max_memory : physical_memory_bytes() / 2;
+        if (range_limit == 0) range_limit = std::size_t(1) << 30;
+        if (log) {
+            log("listening on " + address + ", " + std::to_string(num_threads) + " thread(s) per range, ranges up to " +
+                std::to_string(range_limit >> 20) + " MiB");
+        }
+
+        serve_connections(listener, [&](int fd) {
+            const int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            serve_connection(fd, std::max(1, num_threads), max_memory, range_limit, log);
+        }, log);
+        ::close(listener);
+    }
+#else
+    BSplitTriplet bsplit_chudnovsky_distributed(long, long, const std::vector<std::string>&, int, Progress*, bool,
+                                                const CancelToken*) {
+        throw std::runtime_error("distributed: TCP sockets are not supported on this platform yet");
+    }
+
+    void serve_bsplit_worker(const std::string&, int, std::size_t, std::function<void(const std::string&)>) {
+        throw std::runtime_error("distributed: TCP sockets are not supported on this platform yet");
+    }
+#endif
+
+} // namespace piracer
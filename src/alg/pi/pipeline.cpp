@@ -0,0 +1,514 @@
+// src/alg/pi/pipeline.cpp
+#include "piracer/pipeline.hpp"
+#include "piracer/algorithm_factory.hpp"
+#include "piracer/bbp.hpp"
+#include "piracer/bigmul.hpp"
+#include "piracer/bsplit.hpp"
+#include "piracer/checkpoint.hpp"
+#include "piracer/digit_sink.hpp"
+#include "piracer/distributed.hpp"
+#include "piracer/disk_int.hpp"
+#include "piracer/format.hpp"
+#include "piracer/gpu_backend.hpp"
+#include "piracer/memory_pool.hpp"
+#include "piracer/newton.hpp"
+#include "piracer/profiler.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <filesystem>
+#include <gmpxx.h>
+#include <memory>
+#include <mpfr.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace piracer {
+
+    const char* stage_name(PiStage stage) {
+        switch (stage) {
+            case PiStage::Series: return "series";
+            case PiStage::Sqrt:   return "sqrt";
+            case PiStage::Divide: return "divide";
+            case PiStage::Radix:  return "radix";
+            case PiStage::Write:  return "write";
+            case PiStage::Verify: return "verify";
+        }
+        return "?";
+    }
+
+    namespace {
+        // From this precision on, sqrt and divide run as Newton iterations
+        // on the parallel multiplier instead of MPFR's sequential sqrt and div
+        constexpr long kNewtonFinishBits = long(1) << 20;
+
+        double cpu_seconds() {
+            return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+        }
+
+        // CPU time of the calling thread, where the platform has a clock for it
+        double thread_cpu_seconds() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+            timespec ts;
+            if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+            return 0.0;
+        }
+
+        // Times one stage into its StageTiming from construction to stop()
+        class StageClock {
+        public:
+            explicit StageClock(StageTiming& t)
+                : t_(t), wall0_(std::chrono::steady_clock::now()), cpu0_(cpu_seconds()) {
+                g_memory_pool.reset_window_peak();
+            }
+            ~StageClock() { stop(); }
+
+            void stop() {
+                if (stopped_) return;
+                stopped_ = true;
+                t_.ran = true;
+                t_.wall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0_).count();
+                t_.cpu_seconds += cpu_seconds() - cpu0_;
+                t_.peak_bytes = std::max(t_.peak_bytes, g_memory_pool.window_peak());
+            }
+
+        private:
+            StageTiming& t_;
+            std::chrono::steady_clock::time_point wall0_;
+            double cpu0_;
+            bool stopped_ = false;
+        };
+
+        // Passes everything on, adding the time spent in the wrapped sink
+        // to the write stage
+        class TimedSink : public DigitSink {
+        public:
+            TimedSink(DigitSink& inner, StageTiming& t) : inner_(inner), t_(t) {}
+
+            void write(const char* data, std::size_t n) override {
+                Span span(t_);
+                inner_.write(data, n);
+            }
+            void write_text(const char* data, std::size_t n) override {
+                Span span(t_);
+                inner_.write_text(data, n);
+            }
+            void finish() override {
+                Span span(t_);
+                inner_.finish();
+            }
+
+        private:
+            struct Span {
+                StageTiming& t;
+                std::chrono::steady_clock::time_point wall0 = std::chrono::steady_clock::now();
+                double cpu0 = thread_cpu_seconds();
+
+                explicit Span(StageTiming& s) : t(s) {}
+                ~Span() {
+                    t.ran = true;
+                    t.wall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+                    t.cpu_seconds += thread_cpu_seconds() - cpu0;
+                }
+            };
+
+            DigitSink& inner_;
+            StageTiming& t_;
+        };
+
+        void check_cancel(const ComputeOptions& opts) {
+            if (opts.cancel) opts.cancel->check();
+        }
+
+        // A run that leaves by an exception (a cancelled one above all) hands
+        // the memory pool's free pages back once everything it held is
+        // released. Declared first in a run, so it is destroyed last.
+        class ReleaseOnUnwind {
+        public:
+            ~ReleaseOnUnwind() {
+                if (std::uncaught_exceptions() > exceptions_) g_memory_pool.clear();
+            }
+
+        private:
+            int exceptions_ = std::uncaught_exceptions();
+        };
+
+        // Checkpoint-aware binary splitting over [0, n): picks up a checkpoint
+        // saved for the same run and keeps it current while computing
+        BSplitTriplet bsplit_with_checkpoint(const ComputeOptions& opts, long n, bool need_p, ComputeReport& report) {
+            std::vector<CheckpointSegment> resume;
+            BinaryCheckpoint saved;
+            if (is_binary_checkpoint(opts.checkpoint) && load_binary_checkpoint(opts.checkpoint, saved) &&
+                saved.digits == opts.digits && saved.base == opts.base &&
+                saved.total_terms == static_cast<std::size_t>(n) && saved.algorithm_name == "chudnovsky") {
+                report.resumed_terms = saved.completed_terms;
+                resume = std::move(saved.segments);
+            }
+
+            BinaryCheckpoint meta;
+            meta.digits = opts.digits;
+            meta.base = opts.base;
+            meta.num_threads = opts.threads;
+            meta.total_terms = static_cast<std::size_t>(n);
+            CheckpointWriter writer(opts.checkpoint, meta, opts.checkpoint_interval);
+
+            BSplitTriplet S = bsplit_chudnovsky_resumable(0, n, opts.threads, opts.progress, need_p,
+                                                          std::move(resume), &writer, opts.max_memory, opts.cancel);
+            report.checkpoints_written = writer.saves();
+            report.checkpoint_failed = !writer.ok();
+            return S;
+        }
+
+        // P/Q/T over [a, b) by the variant the options ask for
+        BSplitTriplet series_range(const ComputeOptions& opts, long a, long b, bool need_p, ComputeReport& report) {
+            Progress* prog = opts.progress;
+            if (!opts.nodes.empty()) {
+                return bsplit_chudnovsky_distributed(a, b, opts.nodes, opts.threads, prog, need_p, opts.cancel);
+            }
+            if (!opts.scratch.empty()) {
+                std::size_t limit = opts.max_memory;
+                if (limit == 0) limit = physical_memory_bytes() / 2;
+                if (limit == 0) limit = std::size_t(1) << 30;
+                std::size_t peak = 0;
+                BSplitTriplet S = bsplit_chudnovsky_out_of_core(a, b, opts.threads, prog, need_p, opts.scratch, limit,
+                                                                &peak, opts.cancel);
+                report.scratch_peak_bytes = peak;
+                return S;
+            }
+            if (!opts.checkpoint.empty() && a == 0) return bsplit_with_checkpoint(opts, b, need_p, report);
+            if (opts.gpu) {
+                std::unique_ptr<GPUMultiplier> mul = GPUBackendFactory::create_multiplier(GPUBackend::Auto);
+                report.gpu_backend = mul->backend_name();
+                return bsplit_chudnovsky_batched(a, b, opts.threads, prog, need_p, *mul, opts.cancel);
+            }
+            if (opts.threads > 1 && opts.numa) {
+                return bsplit_chudnovsky_numa(a, b, opts.threads, prog, need_p, opts.max_memory, opts.cancel);
+            }
+            if (opts.threads > 1) {
+                return bsplit_chudnovsky_parallel(a, b, opts.threads, prog, need_p, opts.max_memory, opts.cancel);
+            }
+            return bsplit_chudnovsky(a, b, prog, need_p, opts.cancel);
+        }
+
+        // Series stage: P/Q/T over [0, n); only Q and T are read unless the
+        // series is kept. A prefix from an earlier run is extended by the
+        // terms after it: a merge of [0, m) and [m, n) is the same P/Q/T as
+        // the split the run would have made.
+        BSplitTriplet run_series(const ComputeOptions& opts, long n, ComputeReport& report) {
+            Progress* prog = opts.progress;
+            const bool need_p = opts.keep_series != nullptr;
+            const SeriesState* prefix = opts.series_prefix.get();
+            if (prefix && (prefix->terms <= 0 || prefix->terms > n)) prefix = nullptr;
+
+            BSplitTriplet S;
+            if (!prefix) {
+                ProgressReporter reporter(prog, bsplit_work(0, n));
+                S = series_range(opts, 0, n, need_p, report);
+            } else {
+                const long m = prefix->terms;
+                report.resumed_terms = static_cast<std::size_t>(m);
+                const std::uint64_t merge_work = m < n ? bsplit_merge_work(0, n) : 0;
+                ProgressReporter reporter(prog, bsplit_work(m, n) + merge_work);
+                S = prefix->S;
+                if (m < n) {
+                    BSplitTriplet R = series_range(opts, m, n, need_p, report);
+                    check_cancel(opts);
+                    std::unique_ptr<ThreadPool> pool;
+                    if (opts.threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(opts.threads - 1));
+                    bsplit_merge(S, R, need_p, pool.get());
+                    if (prog) prog->add(merge_work);
+                }
+            }
+            if (opts.keep_series) {
+                opts.keep_series->terms = n;
+                opts.keep_series->S = S;
+            }
+            return S;
+        }
+
+        // sqrt + divide as Newton iterations: pi = 426880 * 10005 *
+        // (1/sqrt(10005)) * Q * (1/T) in fixed point. The inverse square root
+        // does not depend on the series, so it runs alongside the reciprocal
+        // of T. Consumes S.Q and S.T; `pi` is initialized here.
+        void finish_newton(mpfr_t pi, BSplitTriplet& S, long prec_bits, ThreadPool* pool, ComputeReport& report) {
+            StageTiming& sqrt_t = report.stage(PiStage::Sqrt);
+            StageClock divide(report.stage(PiStage::Divide));
+            profiling::PhaseScope phase(stage_name(PiStage::Divide));  // the inverse sqrt included
+
+            const long bits = prec_bits + 32;
+            mpz_abs(S.T.get_mpz_t(), S.T.get_mpz_t());
+            const long t_bits = static_cast<long>(mpz_sizeinbase(S.T.get_mpz_t(), 2));
+
+            mpz_class r, y;  // 2^bits / sqrt(10005), 2^(t_bits + bits) / T
+            {
+                TaskGroup g(pool);
+                g.spawn([&] {
+                    const auto wall0 = std::chrono::steady_clock::now();
+                    const double cpu0 = thread_cpu_seconds();
+                    inv_sqrt_fixed(r, 10005u, bits, pool);
+                    sqrt_t.ran = true;
+                    sqrt_t.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+                    sqrt_t.cpu_seconds = thread_cpu_seconds() - cpu0;
+                });
+                reciprocal_fixed(y, S.T, bits, pool);
+                mpz_class().swap(S.T);
+                g.sync();
+            }
+
+            // Only the leading bits of Q and of the products matter
+            long shift = 0;
+            auto truncate = [&](mpz_class& x) {
+                const long drop = static_cast<long>(mpz_sizeinbase(x.get_mpz_t(), 2)) - bits;
+                if (drop <= 0) return;
+                mpz_fdiv_q_2exp(x.get_mpz_t(), x.get_mpz_t(), static_cast<mp_bitcnt_t>(drop));
+                shift += drop;
+            };
+            truncate(S.Q);
+            mul_big(y, y, S.Q, pool);
+            mpz_class().swap(S.Q);
+            truncate(y);
+            mul_big(y, y, r, pool);
+            mpz_mul_ui(y.get_mpz_t(), y.get_mpz_t(), 426880u);
+            mpz_mul_ui(y.get_mpz_t(), y.get_mpz_t(), 10005u);
+
+            mpfr_init2(pi, prec_bits);
+            mpfr_set_z(pi, y.get_mpz_t(), MPFR_RNDN);
+            mpfr_mul_2si(pi, pi, shift - t_bits - 2 * bits, MPFR_RNDN);
+
+            divide.stop();
+            StageTiming& d = report.stage(PiStage::Divide);
+            d.cpu_seconds = std::max(0.0, d.cpu_seconds - sqrt_t.cpu_seconds);
+            sqrt_t.peak_bytes = d.peak_bytes;
+        }
+
+        // sqrt + divide through MPFR, for precisions where Newton does not pay
+        void finish_mpfr(mpfr_t pi, BSplitTriplet& S, long prec_bits, ComputeReport& report) {
+            mpfr_t sqrt10005, tmp, qf, tf;
+            mpfr_init2(pi, prec_bits);
+            mpfr_init2(sqrt10005, prec_bits);
+            mpfr_init2(tmp, prec_bits);
+            mpfr_init2(qf, prec_bits);
+            mpfr_init2(tf, prec_bits);
+            {
+                StageClock sqrt(report.stage(PiStage::Sqrt));
+                profiling::PhaseScope phase(stage_name(PiStage::Sqrt));
+                mpfr_set_ui(sqrt10005, 10005u, MPFR_RNDN);
+                mpfr_sqrt(sqrt10005, sqrt10005, MPFR_RNDN);
+            }
+            {
+                StageClock divide(report.stage(PiStage::Divide));
+                profiling::PhaseScope phase(stage_name(PiStage::Divide));
+
+                // Each integer is dropped as soon as MPFR holds its value
+                mpfr_set_z(qf, S.Q.get_mpz_t(), MPFR_RNDN);
+                mpz_class().swap(S.Q);
+
+                mpz_abs(S.T.get_mpz_t(), S.T.get_mpz_t());
+                mpfr_set_z(tf, S.T.get_mpz_t(), MPFR_RNDN);
+                mpz_class().swap(S.T);
+
+                mpfr_mul_ui(tmp, sqrt10005, 426880u, MPFR_RNDN);
+                mpfr_mul(tmp, tmp, qf, MPFR_RNDN);
+                mpfr_div(pi, tmp, tf, MPFR_RNDN);
+            }
+            mpfr_clears(sqrt10005, tmp, qf, tf, (mpfr_ptr)0);
+        }
+
+        // BBP spot checks of the hex digits of `pi`. Hex runs cover their
+        // output digits; decimal runs the hex digits their precision
+        // determines, digits * log2(10) / 4 of them.
+        void verify_digits(const mpfr_t pi, const ComputeOptions& opts, ThreadPool* pool, ComputeReport& report) {
+            const std::size_t hex_digits = opts.base == 16
+                ? opts.digits
+                : static_cast<std::size_t>(static_cast<double>(opts.digits) * 3.3219280948873626 / 4);
+            if (hex_digits == 0) return;
+            const std::size_t count = std::min(hex_digits, kBBPMaxDigits);
+            const std::size_t last = hex_digits - count;
+
+            std::vector<std::size_t> positions{last};
+            std::mt19937_64 rng(opts.verify_seed ? opts.verify_seed : std::random_device{}());
+            std::uniform_int_distribution<std::size_t> pick(0, last);
+            for (int i = 0; i < opts.verify_samples && last > 0; ++i) positions.push_back(pick(rng));
+
+            for (std::size_t p : positions) {
+                VerifyCheck c;
+                c.position = p;
+                c.expected = pi_hex_digits_bbp(p, count, pool);
+                c.computed = mpfr_hex_digits_at(pi, p, count);
+                report.checks.push_back(std::move(c));
+            }
+        }
+        // Series, sqrt and divide for opts.digits: π into `pi` (initialized
+        // here). `pool` is created for the stages after the series, which
+        // share it (the caller helps).
+        void compute_value(mpfr_t pi, const ComputeOptions& opts, std::unique_ptr<ThreadPool>& pool,
+                           ComputeReport& report) {
+            const long prec_bits = static_cast<long>(opts.digits * (opts.base == 16 ? 4.0 : 3.3219280948873626) + 64);
+            const long n = PiPipeline::series_terms(opts.digits, opts.base);
+            report.terms = static_cast<std::size_t>(n);
+
+            check_cancel(opts);
+            BSplitTriplet S;
+            {
+                StageClock series(report.stage(PiStage::Series));
+                profiling::PhaseScope phase(stage_name(PiStage::Series));
+                S = run_series(opts, n, report);
+            }
+            check_cancel(opts);
+
+            if (opts.threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(opts.threads - 1));
+            if (prec_bits >= kNewtonFinishBits) {
+                finish_newton(pi, S, prec_bits, pool.get(), report);
+            } else {
+                finish_mpfr(pi, S, prec_bits, report);
+            }
+        }
+
+        // Hex windows of up to this many BBP evaluations per thread are
+        // extracted directly. One evaluation (64 digits) at position k costs
+        // about as much as computing all k digits at k ~ 10^6, and less
+        // further out, so wider windows are read from the computed value.
+        constexpr std::size_t kBBPRangeChunksPerThread = 2;
+
+        // `count` hex digits from `start` by BBP, the 64-digit chunks in parallel
+        std::string hex_range_bbp(std::size_t start, std::size_t count, ThreadPool* pool) {
+            std::string out(count, '0');
+            TaskGroup g(pool);
+            for (std::size_t at = 0; at < count; at += kBBPMaxDigits) {
+                const std::size_t len = std::min(kBBPMaxDigits, count - at);
+                g.spawn([&out, start, at, len, pool] {
+                    pi_hex_digits_bbp(start + at, len, pool).copy(&out[at], len);
+                });
+            }
+            g.sync();
+            return out;
+        }
+    } // namespace
+
+    PiPipeline::PiPipeline(ComputeOptions opts) : opts_(std::move(opts)) {}
+
+    PiPipeline::PiPipeline(std::size_t digits, const AlgorithmConfig& config, Progress* prog) {
+        opts_.digits = digits;
+        opts_.threads = std::max(1, config.num_threads);
+        opts_.progress = prog;
+        if (config.output_format == "decimal" || config.output_format == "dec") {
+            opts_.base = 10;
+        } else if (config.output_format == "hex" || config.output_format == "hexadecimal") {
+            opts_.base = 16;
+        } else {
+            throw std::invalid_argument("PiPipeline: unknown output format '" + config.output_format + "'");
+        }
+    }
+
+    long PiPipeline::series_terms(std::size_t digits, int base) {
+        // Hex digits carry log10(16) decimals each
+        const double decimals = static_cast<double>(digits) * (base == 16 ? 1.2041199826559248 : 1.0);
+        return static_cast<long>(std::ceil(decimals / 14.181647462725477)) + 1;
+    }
+
+    ComputeReport PiPipeline::run(DigitSink& sink) {
+        if (opts_.base != 10 && opts_.base != 16) throw std::invalid_argument("PiPipeline: base must be 10 or 16");
+
+        ReleaseOnUnwind release;
+        ComputeReport report;
+        std::unique_ptr<ThreadPool> pool;
+        mpfr_t pi;
+        compute_value(pi, opts_, pool, report);
+
+        try {
+            check_cancel(opts_);
+            StageTiming& write = report.stage(PiStage::Write);
+            TimedSink timed(sink, write);
+            StageClock radix(report.stage(PiStage::Radix));
+            {
+                profiling::PhaseScope phase(stage_name(PiStage::Radix));  // the sink included
+                if (opts_.base == 16) {
+                    write_fixed_hex(timed, pi, opts_.digits, pool.get());
+                } else {
+                    write_fixed_decimal(timed, pi, opts_.digits, pool.get());
+                }
+            }
+            radix.stop();
+
+            // The conversion ran around the sink: keep only its own share
+            StageTiming& r = report.stage(PiStage::Radix);
+            r.wall_seconds = std::max(0.0, r.wall_seconds - write.wall_seconds);
+            r.cpu_seconds = std::max(0.0, r.cpu_seconds - write.cpu_seconds);
+            write.peak_bytes = r.peak_bytes;
+
+            // The digits are out: the checkpoint has served its purpose
+            if (!opts_.checkpoint.empty()) {
+                std::error_code ec;
+                std::filesystem::remove(opts_.checkpoint, ec);
+            }
+
+            if (opts_.verify) {
+                check_cancel(opts_);
+                StageClock verify(report.stage(PiStage::Verify));
+                profiling::PhaseScope phase(stage_name(PiStage::Verify));
+                verify_digits(pi, opts_, pool.get(), report);
+            }
+        } catch (...) {
+            mpfr_clear(pi);
+            throw;
+        }
+        mpfr_clear(pi);
+        return report;
+    }
+
+    std::string PiPipeline::run_range(std::size_t start, std::size_t count, ComputeReport* report_out) {
+        if (opts_.base != 10 && opts_.base != 16) throw std::invalid_argument("PiPipeline: base must be 10 or 16");
+
+        ReleaseOnUnwind release;
+        ComputeReport report;
+        std::string out;
+        if (count == 0) {
+            if (report_out) *report_out = report;
+            return out;
+        }
+
+        std::unique_ptr<ThreadPool> pool;
+        const std::size_t chunks = (count + kBBPMaxDigits - 1) / kBBPMaxDigits;
+        if (opts_.base == 16 && chunks <= kBBPRangeChunksPerThread * static_cast<std::size_t>(std::max(1, opts_.threads))) {
+            if (opts_.threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(opts_.threads - 1));
+            check_cancel(opts_);
+            StageClock radix(report.stage(PiStage::Radix));
+            profiling::PhaseScope phase(stage_name(PiStage::Radix));
+            out = hex_range_bbp(start, count, pool.get());
+        } else {
+            ComputeOptions opts = opts_;
+            opts.digits = start + count;
+            mpfr_t pi;
+            compute_value(pi, opts, pool, report);
+            try {
+                check_cancel(opts);
+                StageClock radix(report.stage(PiStage::Radix));
+                profiling::PhaseScope phase(stage_name(PiStage::Radix));
+                out = opts.base == 16 ? mpfr_hex_digits_at(pi, start, count)
+                                      : mpfr_decimal_digits_at(pi, start, count, pool.get());
+            } catch (...) {
+                mpfr_clear(pi);
+                throw;
+            }
+            mpfr_clear(pi);
+        }
+        if (report_out) *report_out = report;
+        return out;
+    }
+
+    std::string PiPipeline::run_to_string(ComputeReport* report) {
+        StringSink sink;
+        ComputeReport r = run(sink);
+        if (report) *report = r;
+        return std::move(sink.str);
+    }
+
+} // namespace piracer
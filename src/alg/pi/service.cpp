@@ -0,0 +1,284 @@
+#include "piracer/service.hpp"
+#include "piracer/atomic_file.hpp"
+#include "piracer/checkpoint.hpp"
+#include "piracer/cli_utils.hpp"
+#include "piracer/pipeline.hpp"
+#include "piracer/socket.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+    namespace {
+        const char* const kResultFiles[2] = {"pi-dec.txt", "pi-hex.txt"};
+        constexpr const char* kSeriesFile = "series.bin";
+        constexpr const char* kSeriesAlgorithm = "chudnovsky-series";
+
+    } // namespace
+
+    PiService::PiService(ServiceOptions opts) : opts_(std::move(opts)) {
+        opts_.threads = std::max(1, opts_.threads);
+        if (!opts_.cache_dir.empty()) load_cache();
+    }
+
+    // Whatever the directory holds from an earlier service; files that do
+    // not look like ours are ignored (and overwritten by the next save)
+    void PiService::load_cache() {
+        const std::filesystem::path dir(opts_.cache_dir);
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+
+        for (int slot = 0; slot < 2; ++slot) {
+            std::ifstream f(dir / kResultFiles[slot], std::ios::binary);
+            if (!f) continue;
+            std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+            if (text.size() < 3 || text.compare(0, 2, "3.") != 0) continue;
+            results_[slot].digits = text.size() - 2;
+            results_[slot].text = std::make_shared<const std::string>(std::move(text));
+        }
+
+        const std::string series = (dir / kSeriesFile).string();
+        BinaryCheckpoint saved;
+        if (is_binary_checkpoint(series) && load_binary_checkpoint(series, saved) &&
+            saved.algorithm_name == kSeriesAlgorithm && saved.segments.size() == 1 &&
+            saved.segments[0].begin == 0 && saved.segments[0].end == saved.total_terms && saved.total_terms > 0) {
+            auto s = std::make_shared<SeriesState>();
+            s->terms = static_cast<long>(saved.total_terms);
+            s->S = std::move(saved.segments[0].state);
+            series_ = std::move(s);
+        }
+    }
+
+    // Saves run outside mutex_ and write whatever is newest by then, so a
+    // slower save of an older result never lands last. The cache is best
+    // effort: a failed write only costs recomputation after a restart.
+    void PiService::save_result(int slot) {
+        std::lock_guard<std::mutex> io(save_mutex_);
+        Kept k;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            k = results_[slot];
+        }
+        if (!k.text) return;
+        write_file_atomically((std::filesystem::path(opts_.cache_dir) / kResultFiles[slot]).string(),
+                              [&k](std::ostream& f) {
+                                  f.write(k.text->data(), static_cast<std::streamsize>(k.text->size()));
+                                  return f.good();
+                              });
+    }
+
+    void PiService::save_series() {
+        std::lock_guard<std::mutex> io(save_mutex_);
+        std::shared_ptr<const SeriesState> s;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            s = series_;
+        }
+        if (!s) return;
+        BinaryCheckpoint meta;
+        meta.algorithm_name = kSeriesAlgorithm;
+        meta.num_threads = opts_.threads;
+        meta.completed_terms = meta.total_terms = static_cast<std::size_t>(s->terms);
+        meta.segments.push_back({0, static_cast<std::uint64_t>(s->terms), s->S});
+        save_binary_checkpoint((std::filesystem::path(opts_.cache_dir) / kSeriesFile).string(), meta);
+    }
+
+    PiDigits PiService::get(std::size_t digits, int base) {
+        if (digits == 0) throw std::invalid_argument("PiService: digits must be > 0");
+        if (opts_.max_digits > 0 && digits > opts_.max_digits) {
+            throw std::invalid_argument("PiService: " + std::to_string(digits) + " digits is more than the limit of " +
+                                        std::to_string(opts_.max_digits));
+        }
+        if (base != 10 && base != 16) throw std::invalid_argument("PiService: base must be 10 or 16");
+        const int slot = base == 16 ? 1 : 0;
+
+        PiDigits out;
+        out.digits = digits;
+        out.base = base;
+        auto slice = [&](Text text) {
+            out.owner = std::move(text);
+            out.text = std::string_view(*out.owner).substr(0, 2 + digits);
+            return out;
+        };
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++stats_.requests;
+        if (results_[slot].digits >= digits) {
+            ++stats_.hits;
+            out.cached = true;
+            return slice(results_[slot].text);
+        }
+        for (const Pending& p : pending_[slot]) {
+            if (p.digits < digits) continue;
+            ++stats_.coalesced;
+            std::shared_future<Text> result = p.result;
+            lock.unlock();
+            return slice(result.get());
+        }
+
+        // This request computes; later ones up to its size wait for it
+        std::promise<Text> promise;
+        pending_[slot].push_back({digits, promise.get_future().share()});
+        auto unlist = [&] {
+            auto& list = pending_[slot];
+            list.erase(std::remove_if(list.begin(), list.end(), [&](const Pending& p) { return p.digits == digits; }),
+                       list.end());
+        };
+
+        const long n = PiPipeline::series_terms(digits, base);
+        ComputeOptions opts;
+        opts.digits = digits;
+        opts.base = base;
+        opts.threads = opts_.threads;
+        if (series_ && series_->terms <= n) {
+            opts.series_prefix = series_;
+            ++stats_.extended;
+            stats_.reused_terms += static_cast<std::uint64_t>(series_->terms);
+        }
+        // Only a series longer than the kept one is worth its P
+        SeriesState kept;
+        if (!series_ || series_->terms < n) opts.keep_series = &kept;
+        ++stats_.computed;
+        lock.unlock();
+
+        Text text;
+        try {
+            text = std::make_shared<const std::string>(PiPipeline(std::move(opts)).run_to_string());
+        } catch (...) {
+            lock.lock();
+            unlist();
+            lock.unlock();
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        bool new_result = false, new_series = false;
+        lock.lock();
+        unlist();
+        if (digits > results_[slot].digits) {
+            results_[slot] = {text, digits};
+            new_result = true;
+        }
+        if (kept.terms > 0 && (!series_ || kept.terms > series_->terms)) {
+            series_ = std::make_shared<const SeriesState>(std::move(kept));
+            new_series = true;
+        }
+        lock.unlock();
+        promise.set_value(text);
+
+        if (!opts_.cache_dir.empty()) {
+            if (new_result) save_result(slot);
+            if (new_series) save_series();
+        }
+        return slice(std::move(text));
+    }
+
+    PiService::Stats PiService::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    // ---- Unix socket front end ------------------------------------------------------
+
+#ifndef _WIN32
+    namespace {
+        // Decimal digits only: no sign, exponent or trailing text, and no more
+        // than fit in size_t
+        bool parse_count(const std::string& s, std::size_t& out) {
+            if (s.empty() || s.size() > 20) return false;
+            std::size_t v = 0;
+            for (char c : s) {
+                if (c < '0' || c > '9') return false;
+                const std::size_t d = static_cast<std::size_t>(c - '0');
+                if (v > (static_cast<std::size_t>(-1) - d) / 10) return false;
+                v = v * 10 + d;
+            }
+            out = v;
+            return true;
+        }
+
+        // One request line; false once the client is gone
+        bool answer(PiService& service, int fd, const std::string& line) {
+            std::istringstream in(line);
+            std::string what, base_name, extra;
+            in >> what >> base_name >> extra;
+            if (what.empty()) return true;
+            if (what == "stats") {
+                const PiService::Stats s = service.stats();
+                return send_line(fd, "OK requests " + std::to_string(s.requests) + " hits " + std::to_string(s.hits) +
+                                     " coalesced " + std::to_string(s.coalesced) + " computed " +
+                                     std::to_string(s.computed) + " extended " + std::to_string(s.extended) +
+                                     " reused_terms " + std::to_string(s.reused_terms));
+            }
+            try {
+                std::size_t digits = 0;
+                if (!extra.empty()) throw std::invalid_argument("expected \"<digits> [dec|hex]\"");
+                if (!parse_count(what, digits)) throw std::invalid_argument("bad digit count '" + what + "'");
+                int base = 10;
+                if (base_name == "hex") {
+                    base = 16;
+                } else if (!base_name.empty() && base_name != "dec") {
+                    throw std::invalid_argument("unknown base '" + base_name + "' (dec or hex)");
+                }
+                const PiDigits d = service.get(digits, base);
+                return send_line(fd, "OK " + std::to_string(d.text.size())) &&
+                       send_all(fd, d.text.data(), d.text.size());
+            } catch (const std::exception& e) {
+                return send_line(fd, std::string("ERR ") + e.what());
+            }
+        }
+
+        void serve_connection(PiService& service, int fd) {
+            SocketReader in(fd);
+            std::string line;
+            while (in.line(line)) {
+                if (!answer(service, fd, line)) break;
+            }
+            ::close(fd);
+        }
+    } // namespace
+
+    void serve_unix_socket(PiService& service, const std::string& path, std::function<void(const std::string&)> log) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("serve: bad socket path '" + path + "'");
+        }
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) throw std::runtime_error(std::string("serve: socket: ") + std::strerror(errno));
+        ::unlink(path.c_str());
+        if (::bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listener, 64) != 0) {
+            const std::string why = std::strerror(errno);
+            ::close(listener);
+            throw std::runtime_error("serve: cannot listen on '" + path + "': " + why);
+        }
+        if (log) log("listening on " + path);
+
+        serve_connections(listener, [&service](int fd) { serve_connection(service, fd); }, log);
+        ::close(listener);
+        ::unlink(path.c_str());
+    }
+#else
+    void serve_unix_socket(PiService&, const std::string&, std::function<void(const std::string&)>) {
+        throw std::runtime_error("serve: Unix domain sockets are not available on this platform");
+    }
+#endif
+
+} // namespace piracer
@@ -0,0 +1,100 @@
+#include "piracer/constants.hpp"
+#include "piracer/bsplit.hpp"
+#include "piracer/cancel.hpp"
+#include "piracer/format.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <cmath>
+#include <memory>
+#include <mpfr.h>
+#include <stdexcept>
+
+namespace piracer {
+    namespace {
+        // v <- the constant from the series sums Q and T (at v's precision)
+        using Finish = void (*)(mpfr_t v, const mpfr_t q, const mpfr_t t);
+
+        void finish_e(mpfr_t v, const mpfr_t q, const mpfr_t t) {
+            mpfr_div(v, t, q, MPFR_RNDN);
+        }
+
+        void finish_log2(mpfr_t v, const mpfr_t q, const mpfr_t t) {
+            mpfr_mul_ui(v, t, 3u, MPFR_RNDN);
+            mpfr_div(v, v, q, MPFR_RNDN);
+            mpfr_mul_2si(v, v, -2, MPFR_RNDN);
+        }
+
+        // π = 9801 Q / (√8 T)
+        void finish_ramanujan(mpfr_t v, const mpfr_t q, const mpfr_t t) {
+            mpfr_t s;
+            mpfr_init2(s, mpfr_get_prec(v));
+            mpfr_set_ui(s, 8u, MPFR_RNDN);
+            mpfr_sqrt(s, s, MPFR_RNDN);
+            mpfr_mul(s, s, t, MPFR_RNDN);
+            mpfr_mul_ui(v, q, 9801u, MPFR_RNDN);
+            mpfr_div(v, v, s, MPFR_RNDN);
+            mpfr_clear(s);
+        }
+
+        // P is never read: the sum skips it along the right spine
+        template <class Series>
+        BSplitTriplet sum(double decimals, int num_threads, Progress* prog, const CancelToken* cancel) {
+            return bsplit_series_parallel<Series>(0, Series::terms(decimals), num_threads, prog, false, 0, cancel);
+        }
+
+        struct Constant {
+            const char* name;
+            BSplitTriplet (*sum)(double decimals, int num_threads, Progress* prog, const CancelToken* cancel);
+            Finish finish;
+        };
+
+        const Constant kConstants[] = {
+            {ESeries::name, sum<ESeries>, finish_e},
+            {Log2Series::name, sum<Log2Series>, finish_log2},
+            {"pi-ramanujan", sum<RamanujanSeries>, finish_ramanujan},
+        };
+    } // namespace
+
+    std::vector<std::string> series_constant_names() {
+        std::vector<std::string> names;
+        for (const Constant& c : kConstants) names.emplace_back(c.name);
+        return names;
+    }
+
+    std::string compute_series_constant(const std::string& name, std::size_t digits, int base, int num_threads,
+                                        Progress* prog, const CancelToken* cancel) {
+        const Constant* c = nullptr;
+        for (const Constant& k : kConstants) {
+            if (name == k.name) c = &k;
+        }
+        if (!c) throw std::invalid_argument("unknown constant '" + name + "'");
+        if (digits == 0) throw std::invalid_argument("compute_series_constant: digits must be > 0");
+        if (base != 10 && base != 16) throw std::invalid_argument("compute_series_constant: base must be 10 or 16");
+
+        // A few guard digits against the truncated tail and rounding
+        const double decimals = static_cast<double>(digits) * std::log10(static_cast<double>(base)) + 4.0;
+        const long prec_bits = static_cast<long>(decimals * 3.3219280948873626) + 64;
+        BSplitTriplet S = c->sum(decimals, num_threads, prog, cancel);
+        if (cancel) cancel->check();
+
+        mpfr_t v, q, t;
+        mpfr_inits2(prec_bits, v, q, t, (mpfr_ptr)0);
+        mpfr_set_z(q, S.Q.get_mpz_t(), MPFR_RNDN);
+        mpfr_set_z(t, S.T.get_mpz_t(), MPFR_RNDN);
+        S = BSplitTriplet{};
+        c->finish(v, q, t);
+        mpfr_clears(q, t, (mpfr_ptr)0);
+
+        std::unique_ptr<ThreadPool> pool;
+        if (num_threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(num_threads - 1));
+        std::string out;
+        try {
+            out = base == 16 ? mpfr_to_fixed_hex(v, digits, pool.get()) : mpfr_to_fixed_decimal(v, digits, pool.get());
+        } catch (...) {
+            mpfr_clear(v);
+            throw;
+        }
+        mpfr_clear(v);
+        return out;
+    }
+} // namespace piracer
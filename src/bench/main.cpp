@@ -0,0 +1,303 @@
+#include "piracer/bigmul.hpp"
+#include "piracer/bsplit.hpp"
+#include "piracer/format.hpp"
+#include "piracer/memory_pool.hpp"
+#include "piracer/simd.hpp"
+#include "piracer/thread_pool.hpp"
+#include "piracer/version.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <gmpxx.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mpfr.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// piracer-bench — in-process micro and stage benchmarks
+// Times the building blocks of a run one by one (no process startup, no
+// output I/O) and prints the results as JSON with per-repeat statistics.
+// ============================================================================
+
+namespace {
+using bench_clock = std::chrono::steady_clock;
+
+struct Options {
+    int repeats = 5;
+    double min_sample_seconds = 0.05;  // each sample runs the operation at least this long
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    bool quick = false;                // smaller sizes only (CI smoke runs)
+    std::string filter;                // run benchmarks whose name contains this
+    std::string out;                   // JSON file (default: stdout)
+};
+
+// One benchmark: `samples` are nanoseconds per item, one per repeat
+struct Result {
+    std::string name;
+    std::vector<std::pair<std::string, long long>> params;
+    std::size_t ops_per_sample = 0;
+    std::size_t items_per_op = 1;
+    std::vector<double> samples;
+
+    double median() const {
+        std::vector<double> s = samples;
+        std::sort(s.begin(), s.end());
+        const std::size_t n = s.size();
+        return n == 0 ? 0.0 : n % 2 ? s[n / 2] : 0.5 * (s[n / 2 - 1] + s[n / 2]);
+    }
+    double mean() const {
+        double sum = 0.0;
+        for (double x : samples) sum += x;
+        return samples.empty() ? 0.0 : sum / static_cast<double>(samples.size());
+    }
+    double stddev() const {
+        if (samples.size() < 2) return 0.0;
+        const double m = mean();
+        double sq = 0.0;
+        for (double x : samples) sq += (x - m) * (x - m);
+        return std::sqrt(sq / static_cast<double>(samples.size() - 1));
+    }
+};
+
+// Each operation is timed on its own, so `setup` (run before every one of
+// them) stays out of the numbers; one warm-up operation precedes the samples
+Result measure(const Options& opts, std::string name, std::vector<std::pair<std::string, long long>> params,
+               const std::function<void()>& setup, const std::function<void()>& op, std::size_t items_per_op = 1) {
+    Result r;
+    r.name = std::move(name);
+    r.params = std::move(params);
+    r.items_per_op = items_per_op;
+
+    setup();
+    op();
+    for (int rep = 0; rep < opts.repeats; ++rep) {
+        std::chrono::duration<double> spent{0};
+        std::size_t ops = 0;
+        do {
+            setup();
+            const auto t0 = bench_clock::now();
+            op();
+            spent += bench_clock::now() - t0;
+            ++ops;
+        } while (spent.count() < opts.min_sample_seconds);
+        r.ops_per_sample = std::max(r.ops_per_sample, ops);
+        r.samples.push_back(spent.count() * 1e9 / static_cast<double>(ops * items_per_op));
+    }
+
+    std::cerr << "  " << r.name;
+    for (const auto& p : r.params) std::cerr << " " << p.first << "=" << p.second;
+    const double ns = r.median();
+    const char* unit = ns >= 1e6 ? "ms" : ns >= 1e3 ? "us" : "ns";
+    const double scaled = ns >= 1e6 ? ns / 1e6 : ns >= 1e3 ? ns / 1e3 : ns;
+    std::cerr << ": " << std::fixed << std::setprecision(2) << scaled << " " << unit;
+    if (items_per_op > 1) std::cerr << "/item";
+    std::cerr << " (cv " << std::setprecision(1) << (r.mean() > 0 ? 100.0 * r.stddev() / r.mean() : 0.0) << "%)\n";
+    std::cerr.unsetf(std::ios::fixed);
+    std::cerr << std::setprecision(6);
+    return r;
+}
+
+bool selected(const Options& opts, const std::string& name) {
+    return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+}
+
+mpz_class random_limbs(gmp_randclass& rng, std::size_t limbs) {
+    mpz_class x = rng.get_z_bits(static_cast<mp_bitcnt_t>(limbs * GMP_NUMB_BITS));
+    mpz_setbit(x.get_mpz_t(), static_cast<mp_bitcnt_t>(limbs * GMP_NUMB_BITS - 1));
+    return x;
+}
+
+// ---- Benchmarks -------------------------------------------------------------
+
+// The fused base case: a range of at most 16 terms is one leaf
+void bench_leaf(const Options& opts, std::vector<Result>& out) {
+    for (long a : {1000L, 1000000L}) {
+        piracer::BSplitTriplet x;
+        out.push_back(measure(opts, "leaf", {{"first_term", a}, {"terms", 16}}, [] {},
+                              [&] { x = piracer::bsplit_chudnovsky(a, a + 16); }));
+    }
+}
+
+// One inner node of the tree, single-threaded, at several subtree sizes
+void bench_merge(const Options& opts, std::vector<Result>& out) {
+    std::vector<long> sizes{1L << 10, 1L << 14};
+    if (!opts.quick) sizes.push_back(1L << 18);
+    for (long s : sizes) {
+        const long a = 1000000;
+        const piracer::BSplitTriplet left = piracer::bsplit_chudnovsky(a, a + s / 2);
+        const piracer::BSplitTriplet right = piracer::bsplit_chudnovsky(a + s / 2, a + s);
+        piracer::BSplitTriplet L, R;
+        out.push_back(measure(opts, "bsplit_merge",
+                              {{"terms", s}, {"limbs", static_cast<long long>(mpz_size(left.Q.get_mpz_t()))}},
+                              [&] { L = left; R = right; },
+                              [&] { piracer::bsplit_merge(L, R); }));
+    }
+}
+
+// mpz_mul against mul_ntt on equal-sized operands; reports where the NTT
+// starts to win (0: not within the sizes run) next to the threshold mul_big uses
+void bench_mul(const Options& opts, std::vector<Result>& out, std::size_t& crossover) {
+    gmp_randclass rng(gmp_randinit_default);
+    rng.seed(12345);
+    const std::size_t top = opts.quick ? (std::size_t(1) << 14) : (std::size_t(1) << 18);
+    crossover = 0;
+    for (std::size_t limbs = 256; limbs <= top; limbs *= 2) {
+        const mpz_class x = random_limbs(rng, limbs), y = random_limbs(rng, limbs);
+        mpz_class z;
+        const long long n = static_cast<long long>(limbs);
+        out.push_back(measure(opts, "mpz_mul", {{"limbs", n}}, [] {},
+                              [&] { mpz_mul(z.get_mpz_t(), x.get_mpz_t(), y.get_mpz_t()); }));
+        const double gmp = out.back().median();
+        out.push_back(measure(opts, "mul_ntt", {{"limbs", n}}, [] {},
+                              [&] { piracer::mul_ntt(x, y, z); }));
+        if (crossover == 0 && out.back().median() < gmp) crossover = limbs;
+    }
+}
+
+void bench_decimal(const Options& opts, std::vector<Result>& out, piracer::ThreadPool* pool) {
+    std::vector<std::size_t> sizes{10000, 100000};
+    if (!opts.quick) sizes.push_back(1000000);
+    for (std::size_t digits : sizes) {
+        mpfr_t pi;
+        mpfr_init2(pi, static_cast<mpfr_prec_t>(digits * 3.3219280948873626 + 64));
+        mpfr_const_pi(pi, MPFR_RNDN);
+        std::string s;
+        const long long d = static_cast<long long>(digits);
+        out.push_back(measure(opts, "mpfr_to_fixed_decimal", {{"digits", d}, {"threads", 1}}, [] {},
+                              [&] { s = piracer::mpfr_to_fixed_decimal(pi, digits); }));
+        if (pool) {
+            out.push_back(measure(opts, "mpfr_to_fixed_decimal",
+                                  {{"digits", d}, {"threads", static_cast<long long>(opts.threads)}}, [] {},
+                                  [&] { s = piracer::mpfr_to_fixed_decimal(pi, digits, pool); }));
+        }
+        mpfr_clear(pi);
+    }
+}
+
+// Spawn-to-completion cost of an empty task through a TaskGroup
+void bench_pool(const Options& opts, std::vector<Result>& out, piracer::ThreadPool* pool) {
+    constexpr std::size_t kTasks = 1000;
+    std::atomic<std::size_t> sink{0};
+    auto run = [&](piracer::ThreadPool* p) {
+        piracer::TaskGroup g(p);
+        for (std::size_t i = 0; i < kTasks; ++i) g.spawn([&sink] { sink.fetch_add(1, std::memory_order_relaxed); });
+        g.sync();
+    };
+    out.push_back(measure(opts, "task_overhead", {{"threads", 1}}, [] {}, [&] { run(nullptr); }, kTasks));
+    if (pool) {
+        out.push_back(measure(opts, "task_overhead", {{"threads", static_cast<long long>(opts.threads)}}, [] {},
+                              [&] { run(pool); }, kTasks));
+    }
+}
+
+// ---- Output -----------------------------------------------------------------
+
+void write_json(std::ostream& os, const Options& opts, const std::vector<Result>& results, std::size_t crossover) {
+    os << std::setprecision(6);
+    os << "{\n"
+       << "  \"piracer_version\": \"" << piracer::version << "\",\n"
+       << "  \"ntt_kernel\": \"" << piracer::simd::ntt::kernels().name << "\",\n"
+       << "  \"threads\": " << opts.threads << ",\n"
+       << "  \"repeats\": " << opts.repeats << ",\n"
+       << "  \"ntt_threshold_limbs\": " << piracer::ntt_threshold_limbs() << ",\n"
+       << "  \"ntt_crossover_limbs\": " << (crossover ? std::to_string(crossover) : "null") << ",\n"
+       << "  \"unit\": \"ns\",\n"
+       << "  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        os << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"params\": {";
+        for (std::size_t j = 0; j < r.params.size(); ++j) {
+            os << (j ? ", " : "") << "\"" << r.params[j].first << "\": " << r.params[j].second;
+        }
+        os << "}, \"items_per_op\": " << r.items_per_op << ", \"ops_per_sample\": " << r.ops_per_sample
+           << ", \"median\": " << r.median() << ", \"mean\": " << r.mean() << ", \"stddev\": " << r.stddev()
+           << ", \"min\": " << *std::min_element(r.samples.begin(), r.samples.end())
+           << ", \"max\": " << *std::max_element(r.samples.begin(), r.samples.end()) << ", \"samples\": [";
+        for (std::size_t j = 0; j < r.samples.size(); ++j) os << (j ? ", " : "") << r.samples[j];
+        os << "]}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void print_help() {
+    std::cerr
+        << "piracer-bench " << piracer::version << " — in-process benchmarks, JSON on stdout\n"
+        << "\nUSAGE\n"
+        << "  piracer-bench [--repeat N] [--min-time S] [--threads N] [--filter NAME] [--quick] [--out FILE]\n"
+        << "\nOPTIONS\n"
+        << "  -r, --repeat N    Samples per benchmark (statistics over these). Default: 5\n"
+        << "      --min-time S  Seconds each sample runs at least. Default: 0.05\n"
+        << "  -t, --threads N   Threads for the pooled variants. Default: all CPUs\n"
+        << "  -f, --filter NAME Only benchmarks whose name contains NAME\n"
+        << "                    (leaf, bsplit_merge, mpz_mul, mul_ntt, mpfr_to_fixed_decimal,\n"
+        << "                    task_overhead).\n"
+        << "      --quick       Skip the largest sizes.\n"
+        << "  -o, --out FILE    Write the JSON to FILE instead of stdout.\n"
+        << "  -h, --help        Show this help and exit.\n";
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    piracer::install_gmp_allocator();
+
+    Options opts;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string a = argv[i];
+            if ((a == "--repeat" || a == "-r") && i + 1 < argc) {
+                opts.repeats = std::max(1, std::stoi(argv[++i]));
+            } else if (a == "--min-time" && i + 1 < argc) {
+                opts.min_sample_seconds = std::stod(argv[++i]);
+            } else if ((a == "--threads" || a == "-t") && i + 1 < argc) {
+                opts.threads = std::max(1, std::stoi(argv[++i]));
+            } else if ((a == "--filter" || a == "-f") && i + 1 < argc) {
+                opts.filter = argv[++i];
+            } else if (a == "--quick") {
+                opts.quick = true;
+            } else if ((a == "--out" || a == "-o") && i + 1 < argc) {
+                opts.out = argv[++i];
+            } else if (a == "--help" || a == "-h") {
+                print_help();
+                return 0;
+            } else {
+                std::cerr << "Unknown option: " << a << "\nTry '--help' for usage.\n";
+                return 1;
+            }
+        }
+
+        // The calling thread helps, as in a run
+        std::unique_ptr<piracer::ThreadPool> pool;
+        if (opts.threads > 1) pool = std::make_unique<piracer::ThreadPool>(static_cast<std::size_t>(opts.threads - 1));
+
+        std::vector<Result> results;
+        std::size_t crossover = 0;
+        if (selected(opts, "leaf")) bench_leaf(opts, results);
+        if (selected(opts, "bsplit_merge")) bench_merge(opts, results);
+        if (selected(opts, "mpz_mul") || selected(opts, "mul_ntt")) bench_mul(opts, results, crossover);
+        if (selected(opts, "mpfr_to_fixed_decimal")) bench_decimal(opts, results, pool.get());
+        if (selected(opts, "task_overhead")) bench_pool(opts, results, pool.get());
+
+        if (opts.out.empty()) {
+            write_json(std::cout, opts, results, crossover);
+        } else {
+            std::ofstream f(opts.out);
+            if (!f) throw std::runtime_error("cannot open '" + opts.out + "' for writing");
+            write_json(f, opts, results, crossover);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+}
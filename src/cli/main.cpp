@@ -1,15 +1,31 @@
 #include "piracer/chudnovsky.hpp"
+#include "piracer/checkpoint.hpp"
+#include "piracer/constants.hpp"
 #include "piracer/cli_utils.hpp"
+#include "piracer/digit_sink.hpp"
+#include "piracer/distributed.hpp"
+#include "piracer/gpu_backend.hpp"
+#include "piracer/memory_pool.hpp"
+#include "piracer/pipeline.hpp"
 #include "piracer/version.hpp"
 #include "piracer/selftest.hpp"
+#include "piracer/service.hpp"
+#include "piracer/topology.hpp"
 #include "piracer/progress.hpp"
+#include "piracer/profiler.hpp"
+#include "piracer/tuning.hpp"
 
 #include <iomanip> // setw, setprecision
+#include <algorithm>
 #include <chrono>
-#include <fstream>
+#include <csignal>
+#include <filesystem>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 // ============================================================================
 // PiRacer — Thin CLI (baseline)
@@ -17,6 +33,28 @@
 // ============================================================================
 
 namespace {
+// Stops the computation of this process (SIGINT, SIGTERM, --timeout)
+piracer::CancelToken g_cancel;
+
+// The first signal asks the run to stop at its next check; a second one
+// finds the default action back and ends the process at once
+extern "C" void on_stop_signal(int sig) {
+    g_cancel.cancel();
+    std::signal(sig, SIG_DFL);
+}
+
+bool has_suffix(const std::string& s, const char* suffix) {
+    const std::string x(suffix);
+    return s.size() >= x.size() && s.compare(s.size() - x.size(), x.size(), x) == 0;
+}
+
+// Writes the profile as CSV or HTML by extension, JSON otherwise
+bool export_profile(const std::string& file) {
+    if (has_suffix(file, ".csv")) return piracer::g_profiler->export_to_csv(file);
+    if (has_suffix(file, ".html") || has_suffix(file, ".htm")) return piracer::g_profiler->export_to_html(file);
+    return piracer::g_profiler->export_to_json(file);
+}
+
 std::string basename_of(const char* argv0) {
     std::string s = argv0 ? argv0 : "piracer";
     auto pos = s.find_last_of("/\\");
@@ -37,29 +75,100 @@ void print_help(const char* argv0) {
     print_banner();
     std::cerr
         << "\nUSAGE\n"
-        << "  " << me << " --digits N [--out FILE] [--base {dec,hex}] [--threads N] [--quiet]\n"
+        << "  " << me << " --digits N [--out FILE [--chunk-digits N]] [--base {dec,hex}] [--threads N] [--quiet]\n"
         << "  " << me << " -n N        [-o FILE] [-b {dec,hex}] [-t N] [-q]\n"
         << "  " << me << " --self-test [--digits N]\n"
         << "  " << me << " -T          [-n N]\n"
+        << "  " << me << " --self-test-suite NAME|all\n"
         << "\nOPTIONS\n"
         << "  -n, --digits N    Number of decimal digits to compute.\n"
         << "                    Accepts forms like 1000000 or 1e6.\n"
         << "  -o, --out FILE    Write to FILE instead of stdout.\n"
+        << "      --chunk-digits N  Split --out into files of N digits each\n"
+        << "                    (\"pi.txt\" -> \"pi - 0.txt\", \"pi - 1.txt\", ...).\n"
         << "  -b, --base BASE   Output base: dec (decimal) or hex (hexadecimal).\n"
         << "                    Default: dec\n"
-        << "  -t, --threads N   Number of threads (no-op for now, future NTT support).\n"
+        << "  -t, --threads N   Number of worker threads for the binary-splitting tree.\n"
         << "                    Default: 1\n"
-        << "  -c, --checkpoint FILE  Checkpoint file for resuming computation.\n"
-        << "                    Default: none\n"
+        << "  -c, --checkpoint FILE  Save binary-splitting progress to FILE; an interrupted\n"
+        << "                    run restarted with the same FILE and digits resumes from it.\n"
+        << "                    The file is removed after a successful run. Default: none\n"
+        << "      --checkpoint-interval S  Seconds between checkpoint saves. Default: 60\n"
+        << "      --max-memory SIZE  Run no more binary-splitting subtrees at once than\n"
+        << "                    fit in SIZE (e.g. 512M, 8G); below the need of a single\n"
+        << "                    thread the run is just serialised. Default: no limit\n"
+        << "      --scratch DIR  Out-of-core mode: keep binary-splitting intermediates\n"
+        << "                    larger than --max-memory (default: half the RAM) in DIR.\n"
+        << "                    Cannot be combined with --checkpoint.\n"
+        << "      --numa        Give every NUMA node its own part of the binary-splitting\n"
+        << "                    tree, built by workers pinned to that node's cores; the\n"
+        << "                    final merges interleave memory across nodes. Needs\n"
+        << "                    --threads > 1; no effect on single-node machines.\n"
+        << "      --gpu         Merge binary-splitting level by level, each level's\n"
+        << "                    products as one batch on the GPU (builds with\n"
+        << "                    PIRACER_ENABLE_CUDA and a CUDA device), else on the CPU.\n"
+        << "                    Ignores --max-memory and --numa.\n"
+        << "      --verify      After the run, recompute the last 64 hex digits and two\n"
+        << "                    random positions by BBP digit extraction and compare\n"
+        << "                    (decimal runs: against the binary value behind them).\n"
+        << "                    Exits with status 4 on a mismatch.\n"
+        << "      --profile FILE  Record time per stage (and, in builds with\n"
+        << "                    PIRACER_ENABLE_PROFILING, per hot section) with hardware\n"
+        << "                    counters where perf events are permitted; written as\n"
+        << "                    JSON, or CSV / HTML for a .csv / .html FILE.\n"
+        << "      --tune        Measure the multiply crossover and tree shape for this\n"
+        << "                    host (at --threads) and save them to the tuning profile;\n"
+        << "                    without --digits, exit after tuning.\n"
+        << "      --tuning-file FILE  Tuning profile to load at startup and --tune into.\n"
+        << "                    Default: $PIRACER_TUNING_FILE, else\n"
+        << "                    ~/.cache/piracer/tuning-<host>.conf. A profile made on\n"
+        << "                    another host (or build) is ignored.\n"
+        << "      --no-tuning   Ignore the tuning profile; use the built-in defaults.\n"
+        << "      --range START:COUNT  Print only COUNT digits, starting START digits\n"
+        << "                    after the point (0: the first), without the full expansion.\n"
+        << "                    Small hex windows come from BBP digit extraction.\n"
+        << "      --constant NAME  Compute another constant on the same engine instead\n"
+        << "                    of pi: e, log2 or pi-ramanujan (a cross-check of pi).\n"
+        << "                    Honours --digits, --base, --threads and --out.\n"
+        << "      --serve SOCKET  Run as a service on a Unix socket instead of computing\n"
+        << "                    once: each request line \"N [dec|hex]\" is answered\n"
+        << "                    \"OK <bytes>\" and the digits. Results are kept, shorter\n"
+        << "                    requests are served from them and longer ones extend the\n"
+        << "                    kept series; \"stats\" reports the cache counters.\n"
+        << "      --cache-dir DIR  Keep the --serve results and series in DIR across\n"
+        << "                    restarts. Default: memory only\n"
+        << "      --max-digits N  Largest --serve request; longer ones are answered\n"
+        << "                    \"ERR\" (0: no limit). Default: 1e8\n"
+        << "      --nodes LIST  Spread binary-splitting over the --worker hosts in LIST\n"
+        << "                    (host:port,host:port,...): each builds whole ranges of\n"
+        << "                    terms, this host merges them on --threads. Cannot be\n"
+        << "                    combined with --checkpoint or --scratch.\n"
+        << "      --worker [HOST:]PORT  Run as a --nodes worker on a TCP port instead of\n"
+        << "                    computing once; ranges are built on --threads, and ones\n"
+        << "                    needing more than --max-memory (default: half the RAM)\n"
+        << "                    are refused. PORT alone listens on 127.0.0.1 only; use\n"
+        << "                    0.0.0.0:PORT for other hosts. No authentication: trusted\n"
+        << "                    networks only.\n"
+        << "      --timeout T   Stop the run after T (seconds, or with an s/m/h suffix).\n"
+        << "                    SIGINT and SIGTERM stop it the same way: the current\n"
+        << "                    binary-splitting subtree or stage ends, a --checkpoint\n"
+        << "                    is saved for resuming, scratch files are deleted, and\n"
+        << "                    the exit status is 5. A second signal kills at once.\n"
         << "  -q, --quiet       Suppress non-result logs (stderr).\n"
         << "  -p, --progress    Show a live progress bar with ETA during computation.\n"
         << "  -T, --self-test   Run a correctness self-test (defaults to 1000 digits;\n"
         << "                    respects --digits if provided) and exit.\n"
+        << "      --self-test-suite NAME\n"
+        << "                    Run one stage self-test and exit: mul (NTT vs GMP on every\n"
+        << "                    kernel), radix, checkpoint, bbp, range, constants, pool,\n"
+        << "                    service, distributed, memory, newton, disk, resume, cancel,\n"
+        << "                    sinks, progress, tuning, batch, or all.\n"
         << "  -V, --version     Show version and exit.\n"
         << "  -h, --help        Show this help and exit.\n"
         << "\nEXAMPLES\n"
         << "  " << me << " --digits 100000 > pi.txt\n"
         << "  " << me << " -n 1e6 -o pi_1M.txt\n"
+        << "  " << me << " -n 1e9 -o pi.txt --chunk-digits 1e8\n"
         << "  " << me << " --base hex -n 1000    # output in hexadecimal\n"
         << "  " << me << " --self-test          # defaults to 1000 digits\n"
         << "  " << me << " --self-test -n 2500  # test at 2500 digits\n";
@@ -67,14 +176,40 @@ void print_help(const char* argv0) {
 } // namespace
 
 int main(int argc, char** argv) {
+    // Before anything touches GMP: every limb buffer comes from the pool
+    piracer::install_gmp_allocator();
+
+    // Outside the try: a stopped run cleans up after itself below
+    std::string out;
+    std::size_t chunk_digits = 0;
+    std::string checkpoint_file;
     try {
         std::size_t digits = 0;
-        std::string out;
-        std::string checkpoint_file;
+        long checkpoint_interval = 60;
+        std::size_t max_memory = 0;
+        std::string scratch_dir;
+        bool numa = false;
+        bool gpu = false;
+        bool range = false;
+        std::size_t range_start = 0, range_count = 0;
+        std::string constant;
+        double timeout_seconds = 0;
+        std::string serve_socket;
+        std::string cache_dir;
+        std::size_t serve_max_digits = piracer::ServiceOptions().max_digits;
+        std::vector<std::string> nodes;
+        std::string worker_address;
+        bool verify = false;
+        std::string profile_file;
+        bool tune = false;
+        bool use_tuning = true;
+        std::string tuning_file;
+        bool tuning_loaded = false;
         int base = 10;  // default to decimal
         int threads = 1;  // default to single thread
         bool quiet = false;
         bool do_selftest = false;
+        std::string selftest_suite;
         bool show_progress = false;
         
         // Simple manual parsing (robust enough for baseline)
@@ -84,6 +219,8 @@ int main(int argc, char** argv) {
                 digits = piracer::parse_digits(argv[++i]);
             } else if ((a == "--out" || a == "-o") && i + 1 < argc) {
                 out = argv[++i];
+            } else if (a == "--chunk-digits" && i + 1 < argc) {
+                chunk_digits = piracer::parse_digits(argv[++i]);
             } else if ((a == "--base" || a == "-b") && i + 1 < argc) {
                 std::string b = argv[++i];
                 if (b == "dec" || b == "decimal") {
@@ -102,10 +239,70 @@ int main(int argc, char** argv) {
                 }
             } else if ((a == "--checkpoint" || a == "-c") && i + 1 < argc) {
                 checkpoint_file = argv[++i];
+            } else if (a == "--checkpoint-interval" && i + 1 < argc) {
+                checkpoint_interval = std::stol(argv[++i]);
+                if (checkpoint_interval < 0) {
+                    std::cerr << "Invalid checkpoint interval: " << checkpoint_interval << " (must be >= 0)\n";
+                    return 1;
+                }
+            } else if (a == "--max-memory" && i + 1 < argc) {
+                max_memory = piracer::parse_bytes(argv[++i]);
+            } else if (a == "--scratch" && i + 1 < argc) {
+                scratch_dir = argv[++i];
+            } else if (a == "--numa") {
+                numa = true;
+            } else if (a == "--gpu") {
+                gpu = true;
+            } else if (a == "--range" && i + 1 < argc) {
+                const std::string r = argv[++i];
+                const auto colon = r.find(':');
+                if (colon == std::string::npos) {
+                    std::cerr << "--range expects START:COUNT, got '" << r << "'\n";
+                    return 1;
+                }
+                range_start = colon == 0 ? 0 : piracer::parse_digits(r.substr(0, colon));
+                range_count = piracer::parse_digits(r.substr(colon + 1));
+                range = true;
+            } else if (a == "--timeout" && i + 1 < argc) {
+                timeout_seconds = piracer::parse_seconds(argv[++i]);
+            } else if (a == "--constant" && i + 1 < argc) {
+                constant = argv[++i];
+            } else if (a == "--serve" && i + 1 < argc) {
+                serve_socket = argv[++i];
+            } else if (a == "--max-digits" && i + 1 < argc) {
+                const std::string v = argv[++i];
+                serve_max_digits = v == "0" ? 0 : piracer::parse_digits(v);
+            } else if (a == "--cache-dir" && i + 1 < argc) {
+                cache_dir = argv[++i];
+            } else if (a == "--nodes" && i + 1 < argc) {
+                std::string list = argv[++i];
+                for (std::size_t at = 0; at <= list.size();) {
+                    const std::size_t comma = std::min(list.find(',', at), list.size());
+                    if (comma > at) nodes.push_back(list.substr(at, comma - at));
+                    at = comma + 1;
+                }
+                if (nodes.empty()) {
+                    std::cerr << "--nodes expects host:port[,host:port...]\n";
+                    return 1;
+                }
+            } else if (a == "--worker" && i + 1 < argc) {
+                worker_address = argv[++i];
+            } else if (a == "--verify") {
+                verify = true;
+            } else if (a == "--profile" && i + 1 < argc) {
+                profile_file = argv[++i];
+            } else if (a == "--tune") {
+                tune = true;
+            } else if (a == "--tuning-file" && i + 1 < argc) {
+                tuning_file = argv[++i];
+            } else if (a == "--no-tuning") {
+                use_tuning = false;
             } else if (a == "--quiet" || a == "-q") {
                 quiet = true;
             } else if (a == "--self-test" || a == "-T") {
                 do_selftest = true;
+            } else if (a == "--self-test-suite" && i + 1 < argc) {
+                selftest_suite = argv[++i];
             } else if (a == "--progress" || a == "-p") {
                 show_progress = true;
             } else if (a == "--version" || a == "-V") {
@@ -122,6 +319,17 @@ int main(int argc, char** argv) {
         }
 
         // Handle self-test BEFORE enforcing --digits.
+        if (!selftest_suite.empty()) {
+            if (!quiet) {
+                print_banner();
+                std::cerr << "Running self-test suite " << selftest_suite << "...\n";
+            }
+            std::string verdict;
+            bool ok = piracer::run_self_test_suite(selftest_suite, &verdict);
+            std::cerr << "Self-test " << selftest_suite << ": " << (ok ? "OK ✅" : "FAIL ❌")
+                      << (verdict.empty() ? "" : " — " + verdict) << "\n";
+            return ok ? 0 : 3;
+        }
         if (do_selftest) {
             const std::size_t k = digits ? digits : 1000;
             if (!quiet) {
@@ -135,12 +343,153 @@ int main(int argc, char** argv) {
             return ok ? 0 : 3;
         }
 
+        // Per-host parameters: measured now, or from an earlier --tune
+        if (tuning_file.empty()) tuning_file = piracer::default_tuning_file();
+        if (tune) {
+            if (!quiet) std::cerr << "Tuning for " << piracer::host_fingerprint() << " at " << threads << " thread(s)...\n";
+            piracer::TuneOptions topts;
+            topts.threads = threads;
+            if (!quiet) topts.log = [](const std::string& line) { std::cerr << "  " << line << "\n"; };
+            const piracer::TuningProfile t = piracer::run_tuning(topts);
+            piracer::apply_tuning(t);
+            if (!quiet) {
+                std::cerr << "Tuned: ntt_threshold_limbs " << t.ntt_threshold_limbs << ", leaf_terms "
+                          << t.bsplit.leaf_terms << ", min_parallel_grain " << t.bsplit.min_parallel_grain
+                          << ", tasks_per_thread " << t.bsplit.tasks_per_thread << "\n";
+            }
+            if (tuning_file.empty()) {
+                std::cerr << "Warning: no place for the tuning profile (set HOME or use --tuning-file)\n";
+            } else if (!piracer::save_tuning(tuning_file, t)) {
+                std::cerr << "Warning: could not write the tuning profile to '" << tuning_file << "'\n";
+            } else if (!quiet) {
+                std::cerr << "Tuning profile saved to '" << tuning_file << "'\n";
+            }
+            if (digits == 0) return 0;
+        } else if (use_tuning && !tuning_file.empty()) {
+            piracer::TuningProfile t;
+            std::string why;
+            if (piracer::load_tuning(tuning_file, t, &why)) {
+                piracer::apply_tuning(t);
+                tuning_loaded = true;
+            } else if (!quiet && std::filesystem::exists(tuning_file)) {
+                std::cerr << "Note: " << why << "; using defaults\n";
+            }
+        }
+
+        if (!serve_socket.empty()) {
+            if (!quiet) {
+                print_banner();
+                std::cerr << "Service: " << serve_socket << ", " << threads << " thread(s) per computation";
+                std::cerr << (cache_dir.empty() ? std::string(", memory cache") : ", cache " + cache_dir) << "\n";
+            }
+            piracer::ServiceOptions sopts;
+            sopts.threads = threads;
+            sopts.cache_dir = cache_dir;
+            sopts.max_digits = serve_max_digits;
+            piracer::PiService service(sopts);
+            std::function<void(const std::string&)> log;
+            if (!quiet) log = [](const std::string& line) { std::cerr << "serve: " << line << "\n"; };
+            piracer::serve_unix_socket(service, serve_socket, log);
+            return 0;
+        }
+
+        if (!worker_address.empty()) {
+            if (!quiet) {
+                print_banner();
+                std::cerr << "Worker: " << worker_address << ", " << threads << " thread(s) per range\n";
+            }
+            std::function<void(const std::string&)> log;
+            if (!quiet) log = [](const std::string& line) { std::cerr << "worker: " << line << "\n"; };
+            piracer::serve_bsplit_worker(worker_address, threads, max_memory, log);
+            return 0;
+        }
+
+        // From here on the run is one computation, which these stop cleanly
+        std::signal(SIGINT, on_stop_signal);
+        std::signal(SIGTERM, on_stop_signal);
+        if (timeout_seconds > 0) {
+            g_cancel.set_timeout(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(timeout_seconds)));
+        }
+
+        if (range) {
+            if (!quiet) {
+                print_banner();
+                std::cerr << "Range: " << range_count << " " << (base == 16 ? "hexadecimal" : "decimal")
+                          << " digits from position " << range_start << "\n";
+            }
+            const auto r0 = std::chrono::steady_clock::now();
+            piracer::ComputeOptions ropts;
+            ropts.base = base;
+            ropts.threads = threads;
+            ropts.nodes = nodes;
+            ropts.cancel = &g_cancel;
+            const std::string window = piracer::PiPipeline(ropts).run_range(range_start, range_count);
+            std::unique_ptr<piracer::DigitSink> sink =
+                out.empty() ? std::make_unique<piracer::FdSink>(1) : piracer::FdSink::open_file(out);
+            sink->write(window.data(), window.size());
+            sink->write_text("\n", 1);
+            sink->finish();
+            if (!quiet) {
+                std::cerr << "Elapsed: " << std::chrono::duration<double>(std::chrono::steady_clock::now() - r0).count()
+                          << " s\n";
+            }
+            return 0;
+        }
+
         // Regular compute mode requires --digits.
         if (digits == 0) {
             std::cerr << "Missing required option: --digits N\n";
             std::cerr << "Tip: you can also run '--self-test' (defaults to 1000 digits).\n";
             return 1;
         }
+        if (!constant.empty() && constant != "pi") {
+            const std::vector<std::string> names = piracer::series_constant_names();
+            if (std::find(names.begin(), names.end(), constant) == names.end()) {
+                std::cerr << "Unknown constant '" << constant << "' (pi";
+                for (const std::string& c : names) std::cerr << ", " << c;
+                std::cerr << ")\n";
+                return 1;
+            }
+            if (!quiet) {
+                print_banner();
+                std::cerr << "Constant: " << constant << ", " << digits << " "
+                          << (base == 16 ? "hexadecimal" : "decimal") << " digits\n";
+            }
+            const auto c0 = std::chrono::steady_clock::now();
+            const std::string text =
+                piracer::compute_series_constant(constant, digits, base, threads, nullptr, &g_cancel);
+            std::unique_ptr<piracer::DigitSink> sink =
+                out.empty() ? std::make_unique<piracer::FdSink>(1) : piracer::FdSink::open_file(out);
+            sink->write(text.data(), text.size());
+            sink->write_text("\n", 1);
+            sink->finish();
+            if (!quiet) {
+                std::cerr << "Elapsed: " << std::chrono::duration<double>(std::chrono::steady_clock::now() - c0).count()
+                          << " s\n";
+            }
+            return 0;
+        }
+        if (chunk_digits > 0 && out.empty()) {
+            std::cerr << "--chunk-digits requires --out FILE\n";
+            return 1;
+        }
+        if (!scratch_dir.empty() && !checkpoint_file.empty()) {
+            std::cerr << "--scratch cannot be combined with --checkpoint\n";
+            return 1;
+        }
+
+        if (!nodes.empty() && (!scratch_dir.empty() || !checkpoint_file.empty())) {
+            std::cerr << "--nodes cannot be combined with --checkpoint or --scratch\n";
+            return 1;
+        }
+
+        // Never overwrite something that is not one of our checkpoints
+        const bool checkpoint_exists = !checkpoint_file.empty() && std::filesystem::exists(checkpoint_file);
+        if (checkpoint_exists && !piracer::is_binary_checkpoint(checkpoint_file)) {
+            std::cerr << "Refusing to use '" << checkpoint_file << "' as checkpoint: not a PiRacer checkpoint\n";
+            return 1;
+        }
 
         using clock = std::chrono::high_resolution_clock;
         auto t0 = clock::now();
@@ -149,15 +498,63 @@ int main(int argc, char** argv) {
             print_banner();
             std::cerr << "Request: " << digits << " " << (base == 16 ? "hexadecimal" : "decimal") << " digits\n";
             if (threads > 1) {
-                std::cerr << "Threads: " << threads << " (no-op for now, future NTT support)\n";
+                std::cerr << "Threads: " << threads << "\n";
+            }
+            if (max_memory > 0) {
+                std::cerr << "Memory budget: " << max_memory / 1048576 << " MiB\n";
+            }
+            if (tuning_loaded) {
+                std::cerr << "Tuning: " << tuning_file << "\n";
+            }
+            if (numa) {
+                std::cerr << "Topology: " << piracer::Topology::get().describe() << "\n";
+            }
+            if (gpu) {
+                std::cerr << "GPU: " << piracer::GPUBackendFactory::get_backend_info(piracer::GPUBackend::Auto) << "\n";
+            }
+            if (!nodes.empty()) {
+                std::cerr << "Nodes: " << nodes.size() << " (";
+                for (std::size_t i = 0; i < nodes.size(); ++i) std::cerr << (i ? ", " : "") << nodes[i];
+                std::cerr << ")\n";
             }
-            if (!checkpoint_file.empty()) {
-                std::cerr << "Checkpoint: " << checkpoint_file << " (not yet wired)\n";
+            if (!scratch_dir.empty()) {
+                std::cerr << "Scratch: " << scratch_dir << " (out-of-core)\n";
             }
+            if (checkpoint_exists) {
+                std::cerr << "Checkpoint: " << checkpoint_file << " (exists, resuming if it matches this run)\n";
+            } else if (!checkpoint_file.empty()) {
+                std::cerr << "Checkpoint: " << checkpoint_file << " (every " << checkpoint_interval << " s)\n";
+            }
+        }
+
+        // Digits stream straight to the destination; open it before computing
+        // so a bad path fails fast
+        std::unique_ptr<piracer::DigitSink> sink;
+        if (out.empty()) {
+            sink = std::make_unique<piracer::FdSink>(1);
+        } else if (chunk_digits > 0) {
+            sink = std::make_unique<piracer::ChunkedFileSink>(out, chunk_digits);
+        } else {
+            sink = piracer::FdSink::open_file(out);
         }
 
-        // Optional progress bar: tick per series term
-        std::string pi;
+        piracer::ComputeOptions opts;
+        opts.digits = digits;
+        opts.base = base;
+        opts.threads = threads;
+        opts.checkpoint = checkpoint_file;
+        opts.checkpoint_interval = std::chrono::seconds(checkpoint_interval);
+        opts.max_memory = max_memory;
+        opts.scratch = scratch_dir;
+        opts.numa = numa;
+        opts.gpu = gpu;
+        opts.nodes = nodes;
+        opts.verify = verify;
+        opts.cancel = &g_cancel;
+        piracer::ComputeReport report;
+        if (!profile_file.empty()) piracer::g_profiler->enable();
+
+        // Optional progress bar: ticks come from the reporter thread at ~20 Hz
         if (show_progress && !quiet) {
             struct Bar {
                 std::chrono::steady_clock::time_point start, last;
@@ -185,46 +582,82 @@ int main(int argc, char** argv) {
             piracer::Progress prog;
             prog.tick = tick;
             prog.user = &bar;
-            
-            // Use threaded version when multiple threads requested
-            if (threads > 1) {
-                pi = piracer::compute_pi_base_threaded_with_progress(digits, base, threads, &prog);
-            } else {
-                pi = piracer::compute_pi_base_with_progress(digits, base, &prog);
-            }
+            opts.progress = &prog;
+            report = piracer::compute_pi_to_sink(opts, *sink);
         } else {
-            // Use threaded version when multiple threads requested
-            if (threads > 1) {
-                pi = piracer::compute_pi_base_threaded(digits, base, threads);
-            } else {
-                pi = piracer::compute_pi_base(digits, base);
-            }
+            report = piracer::compute_pi_to_sink(opts, *sink);
         }
 
         // Output π either to stdout or file, keep logs on stderr.
-        if (out.empty()) {
-            std::cout << pi << std::endl;
-        } else {
-            std::ofstream f(out);
-            if (!f) throw std::runtime_error("cannot open output file: " + out);
-            f << pi << "\n";
-            f.close();
-        }
+        sink->write_text("\n", 1);
+        sink->finish();
 
         auto t1 = clock::now();
         std::chrono::duration<double> dt = t1 - t0;
 
+        if (!profile_file.empty()) {
+            piracer::g_profiler->enable(false);
+            piracer::g_profiler->add_metric("elapsed", piracer::ProfilerMetric::WALL_TIME, dt.count() * 1e3, "ms", "run");
+            piracer::g_profiler->add_metric("digits", piracer::ProfilerMetric::CUSTOM, static_cast<double>(digits), "", "run");
+            if (!export_profile(profile_file)) {
+                std::cerr << "Warning: could not write the profile to '" << profile_file << "'\n";
+            } else if (!quiet) {
+                std::cerr << "Profile: written to '" << profile_file << "'\n";
+            }
+        }
+
         if (!quiet) {
             if (!out.empty())
                 std::cerr << "Wrote " << digits << " " << (base == 16 ? "hex" : "decimal") << " digits to '" << out << "'\n";
+            if (report.resumed_terms > 0)
+                std::cerr << "Resumed " << report.resumed_terms << " series terms from checkpoint\n";
+            if (report.checkpoint_failed)
+                std::cerr << "Warning: a checkpoint save to '" << checkpoint_file << "' failed\n";
+            if (report.scratch_peak_bytes > 0)
+                std::cerr << "Scratch: " << report.scratch_peak_bytes / 1048576 << " MiB peak on disk\n";
             std::cerr << "Elapsed: " << dt.count() << " s\n";
+            std::cerr << "Stages:  " << std::setw(9) << "wall s" << std::setw(9) << "cpu s"
+                      << std::setw(10) << "peak MiB" << "\n";
+            for (int s = 0; s < piracer::kPiStageCount; ++s) {
+                const auto stage = static_cast<piracer::PiStage>(s);
+                const piracer::StageTiming& t = report.stage(stage);
+                if (!t.ran) continue;
+                std::cerr << "  " << std::left << std::setw(7) << piracer::stage_name(stage) << std::right
+                          << std::fixed << std::setprecision(3) << std::setw(9) << t.wall_seconds
+                          << std::setw(9) << t.cpu_seconds << std::setprecision(1)
+                          << std::setw(10) << t.peak_bytes / 1048576.0 << "\n";
+            }
+            std::cerr.unsetf(std::ios::fixed);
+            std::cerr << std::setprecision(6);
             
             // Calculate and log ns/digit metric
             double ns_per_digit = (dt.count() * 1e9) / digits;
             std::cerr << "Performance: " << std::fixed << std::setprecision(3) << ns_per_digit << " ns/digit\n";
+            if (piracer::gmp_allocator_installed())
+                std::cerr << "Memory: " << std::setprecision(1)
+                          << piracer::g_memory_pool.peak_allocated() / 1048576.0 << " MiB pool peak\n";
         }
 
-        return 0;
+        // Mismatches are reported even with --quiet
+        for (const piracer::VerifyCheck& c : report.checks) {
+            if (quiet && c.ok()) continue;
+            std::cerr << "Verify: hex digits at " << c.position << ": "
+                      << (c.ok() ? "OK" : "MISMATCH") << " (" << c.computed.size() << " digits)\n";
+            if (!c.ok()) std::cerr << "  computed " << c.computed << "\n  BBP      " << c.expected << "\n";
+        }
+        return report.verify_failed() ? 4 : 0;
+    } catch (const piracer::ComputeCancelled& e) {
+        // Nothing was written yet (digits only go out after the last check)
+        if (!out.empty() && chunk_digits == 0) {
+            std::error_code ec;
+            std::filesystem::remove(out, ec);
+        }
+        std::cerr << "Stopped: " << (e.deadline() ? "--timeout passed" : "interrupted") << "\n";
+        if (!checkpoint_file.empty() && std::filesystem::exists(checkpoint_file)) {
+            std::cerr << "Checkpoint: '" << checkpoint_file << "' holds the finished subtrees; rerun the same "
+                      << "command to resume\n";
+        }
+        return 5;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n"
                   << "Tip: run with '--help' for usage.\n";
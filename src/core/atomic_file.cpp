@@ -0,0 +1,74 @@
+#include "piracer/atomic_file.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+    namespace {
+        // Waits until the file's data is on the device; a flushed stream only
+        // hands it to the OS
+        bool sync_file(const std::string& path) {
+#ifdef _WIN32
+            const int fd = ::_open(path.c_str(), _O_WRONLY | _O_BINARY);
+            if (fd < 0) return false;
+            const bool ok = ::_commit(fd) == 0;
+            ::_close(fd);
+#else
+            const int fd = ::open(path.c_str(), O_WRONLY);
+            if (fd < 0) return false;
+            const bool ok = ::fsync(fd) == 0;
+            ::close(fd);
+#endif
+            return ok;
+        }
+
+        // The rename is a change of the directory: make it durable too
+        // (best effort; not available on Windows)
+        void sync_directory_of(const std::string& path) {
+#ifndef _WIN32
+            std::filesystem::path dir = std::filesystem::path(path).parent_path();
+            if (dir.empty()) dir = ".";
+            const int fd = ::open(dir.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            ::fsync(fd);
+            ::close(fd);
+#else
+            (void)path;
+#endif
+        }
+    } // namespace
+
+    bool write_file_atomically(const std::string& path, const std::function<bool(std::ostream&)>& fill) {
+        const std::string tmp = path + ".tmp";
+        std::error_code ec;
+        bool ok = false;
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            if (f && fill(f)) {
+                f.close();
+                ok = !f.fail();
+            }
+        }
+        if (ok) ok = sync_file(tmp);
+        if (ok) {
+            std::filesystem::rename(tmp, path, ec);
+            ok = !ec;
+        }
+        if (!ok) {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        sync_directory_of(path);
+        return true;
+    }
+
+} // namespace piracer
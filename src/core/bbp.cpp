@@ -0,0 +1,193 @@
+#include "piracer/bbp.hpp"
+#include "piracer/montgomery.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace piracer {
+
+#if PIRACER_HAVE_U128
+    namespace {
+        // pi = sum_k 16^-k (4/(8k+1) - 2/(8k+4) - 1/(8k+5) - 1/(8k+6)). The
+        // digits after position d are the fractional part of 16^d pi: for
+        // k < d each series contributes frac(16^(d-k) / (8k+j)), which is
+        // rewritten as frac(2^t / o) with o odd so Montgomery arithmetic
+        // applies (8k+4 = 4 (2k+1), 8k+6 = 2 (4k+3)); the k >= d tail is a
+        // handful of plain fractions.
+
+        // Fixed-point fraction modulo 1 in kLimbs words, most significant first
+        constexpr int kLimbs = 5;
+        struct Fraction {
+            std::uint64_t w[kLimbs] = {};
+
+            void add(const Fraction& x) {
+                unsigned carry = 0;
+                for (int i = kLimbs - 1; i >= 0; --i) {
+                    const std::uint64_t s = w[i] + x.w[i];
+                    const unsigned c1 = s < w[i];
+                    w[i] = s + carry;
+                    carry = c1 | (w[i] < s);
+                }
+            }
+
+            void negate() {
+                unsigned carry = 1;
+                for (int i = kLimbs - 1; i >= 0; --i) {
+                    w[i] = ~w[i] + carry;
+                    carry = carry && w[i] == 0;
+                }
+            }
+
+            void mul_small(std::uint64_t m) {
+                mont::u128 carry = 0;
+                for (int i = kLimbs - 1; i >= 0; --i) {
+                    const mont::u128 p = static_cast<mont::u128>(w[i]) * m + carry;
+                    w[i] = static_cast<std::uint64_t>(p);
+                    carry = p >> 64;
+                }
+            }
+
+            // Add 1 / (m * 2^shift) (long division, truncated)
+            void add_inverse(std::uint64_t m, unsigned shift) {
+                Fraction q;
+                mont::u128 rem = 1;
+                for (int i = 0; i < kLimbs; ++i) {
+                    rem <<= 64;
+                    q.w[i] = static_cast<std::uint64_t>(rem / m);
+                    rem %= m;
+                }
+                const unsigned limbs = shift / 64, bits = shift % 64;
+                Fraction s;
+                for (int i = kLimbs - 1; i >= static_cast<int>(limbs); --i) {
+                    const int from = i - static_cast<int>(limbs);
+                    s.w[i] = q.w[from] >> bits;
+                    if (bits && from > 0) s.w[i] |= q.w[from - 1] << (64 - bits);
+                }
+                add(s);
+            }
+        };
+
+        // The four series, with their coefficients in the formula
+        constexpr int kSeries = 4;
+        constexpr std::uint64_t kDenOffset[kSeries] = {1, 4, 5, 6};
+
+        struct Sums {
+            Fraction s[kSeries];
+        };
+
+        // Odd modulus and power of two of term k of series j, for k < d
+        inline void reduce_term(int j, std::uint64_t k, std::uint64_t d, std::uint64_t& o, std::uint64_t& t) {
+            const std::uint64_t e = 4 * (d - k);
+            switch (j) {
+                case 0: o = 8 * k + 1; t = e; break;
+                case 1: o = 2 * k + 1; t = e - 2; break;
+                case 2: o = 8 * k + 5; t = e; break;
+                default: o = 4 * k + 3; t = e - 1; break;
+            }
+        }
+
+        // frac(2^t / o) for o odd > 1, to kLimbs words. With y = 2^(t+64) mod o,
+        // floor(2^64 (2^t mod o) / o) = -y / o mod 2^64 exactly (the division
+        // is exact), and each further word takes one more factor 2^64.
+        inline void add_term(Fraction& acc, std::uint64_t y, std::uint64_t o, std::uint64_t inv,
+                             std::uint64_t r2) {
+            Fraction f;
+            for (int i = 0; i < kLimbs; ++i) {
+                f.w[i] = 0 - y * inv;
+                if (i + 1 < kLimbs) y = mont::mul(y, r2, o, inv);
+            }
+            acc.add(f);
+        }
+
+        // Head terms k in [k0, k1) of all four series. The four modular
+        // exponentiations of one k run in lockstep, so their multiplication
+        // chains overlap.
+        void head_range(Sums& sums, std::uint64_t k0, std::uint64_t k1, std::uint64_t d) {
+            for (std::uint64_t k = k0; k < k1; ++k) {
+                std::uint64_t o[kSeries], t[kSeries], inv[kSeries], x[kSeries];
+                std::uint64_t top = 0;
+                for (int j = 0; j < kSeries; ++j) {
+                    reduce_term(j, k, d, o[j], t[j]);
+                    inv[j] = mont::inverse_2_64(o[j]);
+                    x[j] = o[j] > 1 ? (0 - o[j]) % o[j] : 0;  // 2^64 mod o: Montgomery 1
+                    top |= t[j];
+                }
+
+                // Left-to-right binary powering of 2 in Montgomery form
+                for (int b = 63 - __builtin_clzll(top | 1); b >= 0; --b) {
+                    for (int j = 0; j < kSeries; ++j) {
+                        x[j] = mont::mul(x[j], x[j], o[j], inv[j]);
+                        if ((t[j] >> b) & 1) x[j] = mont::add(x[j], x[j], o[j]);
+                    }
+                }
+
+                for (int j = 0; j < kSeries; ++j) {
+                    if (o[j] == 1) continue;  // an integer: no fractional part
+                    // Montgomery form of 2^64 = 2^128 mod o, by six squarings of 2
+                    const std::uint64_t one = (0 - o[j]) % o[j];
+                    std::uint64_t r2 = mont::add(one, one, o[j]);
+                    for (int i = 0; i < 6; ++i) r2 = mont::mul(r2, r2, o[j], inv[j]);
+                    add_term(sums.s[j], x[j], o[j], inv[j], r2);
+                }
+            }
+        }
+
+        // k >= d: 16^(d-k) / (8k+j) until it drops below the last word
+        void tail(Sums& sums, std::uint64_t d) {
+            for (unsigned i = 0; 4 * i < 64 * kLimbs; ++i) {
+                const std::uint64_t k = d + i;
+                for (int j = 0; j < kSeries; ++j) sums.s[j].add_inverse(8 * k + kDenOffset[j], 4 * i);
+            }
+        }
+
+        constexpr std::uint64_t kTermsPerTask = std::uint64_t(1) << 16;
+    } // namespace
+
+    std::string pi_hex_digits_bbp(std::uint64_t position, std::size_t count, ThreadPool* pool) {
+        if (count > kBBPMaxDigits) throw std::invalid_argument("pi_hex_digits_bbp: at most 64 digits per call");
+        const std::uint64_t d = position;
+
+        // Blocks of head terms, each summed separately and combined under a lock
+        Sums total;
+        std::mutex mutex;
+        {
+            TaskGroup g(d >= 2 * kTermsPerTask ? pool : nullptr);
+            for (std::uint64_t k0 = 0; k0 < d; k0 += kTermsPerTask) {
+                const std::uint64_t k1 = std::min(d, k0 + kTermsPerTask);
+                g.spawn([&, k0, k1] {
+                    Sums part;
+                    head_range(part, k0, k1, d);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (int j = 0; j < kSeries; ++j) total.s[j].add(part.s[j]);
+                });
+            }
+            g.sync();
+        }
+        tail(total, d);
+
+        // 4 S1 - 2 S4 - S5 - S6 (mod 1)
+        Fraction x = total.s[0];
+        x.mul_small(4);
+        Fraction y = total.s[1];
+        y.mul_small(2);
+        y.add(total.s[2]);
+        y.add(total.s[3]);
+        y.negate();
+        x.add(y);
+
+        static const char kHex[] = "0123456789abcdef";
+        std::string out(count, '0');
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i] = kHex[(x.w[i / 16] >> (60 - 4 * (i % 16))) & 15];
+        }
+        return out;
+    }
+#else
+    std::string pi_hex_digits_bbp(std::uint64_t, std::size_t, ThreadPool*) {
+        throw std::invalid_argument("pi_hex_digits_bbp: needs 128-bit integer support");
+    }
+#endif
+
+} // namespace piracer
@@ -1,186 +1,485 @@
 #include "piracer/bigmul.hpp"
-#include <stdexcept>
+#include "piracer/montgomery.hpp"
+#include "piracer/profiler.hpp"
+#include "piracer/simd.hpp"
+#include "piracer/thread_pool.hpp"
+
 #include <algorithm>
-#include <cmath>
+#include <atomic>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+// The word-sized backend needs 128-bit products and 64-bit GMP limbs
+#if PIRACER_HAVE_U128 && GMP_NUMB_BITS == 64
+#define PIRACER_HAVE_NTT 1
+#else
+#define PIRACER_HAVE_NTT 0
+#endif
 
 namespace piracer {
-    
-    // Simple NTT implementation for power-of-2 sizes
-    // This is a basic implementation that can be optimized further
-    
-    NTTContext::NTTContext(mpz_class mod, std::size_t sz) 
-        : modulus(mod), size(sz) {
-        // Find primitive root of unity for the modulus
-        // For now, use a simple approach with common moduli
-        
-        // Calculate roots of unity
-        mpz_class g = 2;  // Try 2 as generator
-        mpz_class phi = modulus - 1;
-        
-        // Find primitive root
-        for (mpz_class test = 2; test < 100; ++test) {
-            mpz_class result = 1;
-            bool is_primitive = true;
-            
-            for (mpz_class i = 1; i < phi; ++i) {
-                mpz_powm(result.get_mpz_t(), test.get_mpz_t(), i.get_mpz_t(), modulus.get_mpz_t());
-                if (result == 1) {
-                    is_primitive = false;
-                    break;
+
+    namespace {
+        // p = k * 2^s + 1, all in (2^62, 2^63) so that a limb is < 4p and
+        // sums of two residues never overflow 64 bits.
+        const std::vector<std::uint64_t> kModuli = {
+            0x5700000000000001ULL,  //  87 * 2^56 + 1
+            0x4180000000000001ULL,  // 131 * 2^55 + 1
+            0x6280000000000001ULL,  // 197 * 2^55 + 1
+        };
+
+        // Largest transform supported by every prime of the set
+        constexpr std::size_t kMaxTransform = std::size_t(1) << 55;
+
+        // 0 = pick from the active butterfly kernel (see ntt_threshold_limbs)
+        std::atomic<std::size_t> g_ntt_threshold{0};
+
+#if PIRACER_HAVE_NTT
+        using mont::u128;
+        using mont::inverse_2_64;
+        using mont::to_mont;
+
+        // Reduce x < 2^64 (at most 4p) into [0, p)
+        inline std::uint64_t reduce(std::uint64_t x, std::uint64_t p) {
+            while (x >= p) x -= p;
+            return x;
+        }
+
+        std::uint64_t mul_mod(std::uint64_t a, std::uint64_t b, std::uint64_t p) {
+            return static_cast<std::uint64_t>(static_cast<u128>(a) * b % p);
+        }
+
+        std::uint64_t pow_mod(std::uint64_t b, std::uint64_t e, std::uint64_t p) {
+            std::uint64_t r = 1 % p;
+            b %= p;
+            for (; e; e >>= 1) {
+                if (e & 1) r = mul_mod(r, b, p);
+                b = mul_mod(b, b, p);
+            }
+            return r;
+        }
+
+        // Generator of (Z/p)^*: p - 1 = k * 2^s with a small odd k, so the
+        // factorisation is found by trial division and every candidate costs
+        // one pow_mod per prime factor.
+        std::uint64_t primitive_root(std::uint64_t p) {
+            std::vector<std::uint64_t> factors = {2};
+            std::uint64_t k = p - 1;
+            while ((k & 1) == 0) k >>= 1;
+            if (k >> 32) throw std::invalid_argument("NTT modulus is not of the form k*2^s+1 with small k");
+            for (std::uint64_t d = 3; d * d <= k; d += 2) {
+                if (k % d == 0) {
+                    factors.push_back(d);
+                    while (k % d == 0) k /= d;
                 }
             }
-            
-            if (is_primitive) {
-                g = test;
-                break;
+            if (k > 1) factors.push_back(k);
+
+            for (std::uint64_t g = 2; g < p; ++g) {
+                bool primitive = true;
+                for (std::uint64_t q : factors) {
+                    if (pow_mod(g, (p - 1) / q, p) == 1) {
+                        primitive = false;
+                        break;
+                    }
+                }
+                if (primitive) return g;
             }
+            throw std::invalid_argument("NTT modulus has no primitive root (not prime?)");
         }
-        
-        // Calculate roots of unity
-        mpz_class w;
-        mpz_class exp = phi / size;
-        mpz_powm(w.get_mpz_t(), g.get_mpz_t(), exp.get_mpz_t(), modulus.get_mpz_t());
-        
-        roots_of_unity.resize(size);
-        inv_roots_of_unity.resize(size);
-        
-        mpz_class current = 1;
-        for (std::size_t i = 0; i < size; ++i) {
-            roots_of_unity[i] = current;
-            mpz_invert(inv_roots_of_unity[i].get_mpz_t(), current.get_mpz_t(), modulus.get_mpz_t());
-            mpz_mul(current.get_mpz_t(), current.get_mpz_t(), w.get_mpz_t());
-            mpz_mod(current.get_mpz_t(), current.get_mpz_t(), modulus.get_mpz_t());
-        }
-    }
-    
-    CRTContext::CRTContext(const std::vector<mpz_class>& mods) 
-        : moduli(mods) {
-        // Calculate CRT coefficients
-        mpz_class M = 1;
-        for (const auto& m : moduli) {
-            M *= m;
-        }
-        
-        crt_coeffs.resize(moduli.size());
-        for (std::size_t i = 0; i < moduli.size(); ++i) {
-            mpz_class Mi = M / moduli[i];
-            mpz_invert(crt_coeffs[i].get_mpz_t(), Mi.get_mpz_t(), moduli[i].get_mpz_t());
-            crt_coeffs[i] = (crt_coeffs[i] * Mi) % M;
-        }
-    }
-    
-    void mul_ntt(const mpz_class& a, const mpz_class& b, mpz_class& out) {
-        // For now, use GMP but prepare for NTT
-        // TODO: Implement full NTT multiplication
-        out = a * b;
-    }
-    
-    void mul_ntt_with_context(const mpz_class& a, const mpz_class& b, mpz_class& out,
-                             const NTTContext& /* ntt_ctx */, const CRTContext& crt_ctx) {
-        // Convert to residues for each modulus
-        std::vector<mpz_class> a_residues, b_residues;
-        
-        for (const auto& m : crt_ctx.moduli) {
-            a_residues.push_back(a % m);
-            b_residues.push_back(b % m);
-        }
-        
-        // Multiply in each residue field using NTT
-        std::vector<mpz_class> result_residues;
-        for (std::size_t i = 0; i < crt_ctx.moduli.size(); ++i) {
-            mpz_class result;
-            // Simple multiplication for now, replace with NTT
-            result = (a_residues[i] * b_residues[i]) % crt_ctx.moduli[i];
-            result_residues.push_back(result);
-        }
-        
-        // Reconstruct using CRT
-        out = crt_reconstruct(result_residues, crt_ctx);
-    }
-    
-    void ntt_forward(std::vector<mpz_class>& data, const NTTContext& ctx) {
-        // Basic NTT implementation (bit-reversal + butterfly)
-        std::size_t n = data.size();
-        
-        // Bit-reversal permutation
-        for (std::size_t i = 1, j = 0; i < n; ++i) {
-            std::size_t bit = n >> 1;
-            for (; j & bit; bit >>= 1) {
-                j ^= bit;
+
+        // Decimation-in-frequency butterflies: natural order in, bit-reversed out
+        void forward_dif(std::uint64_t* x, std::size_t n, const std::uint64_t* tw,
+                         std::uint64_t p, std::uint64_t inv) {
+            const simd::ntt::Kernels& k = simd::ntt::kernels();
+            for (std::size_t h = n >> 1; h > 0; h >>= 1) k.dif_level(x, n, h, tw + h, p, inv);
+        }
+
+        // Decimation-in-time butterflies: bit-reversed in, natural order out,
+        // then every coefficient is multiplied by the Montgomery constant `scale`
+        void inverse_dit(std::uint64_t* x, std::size_t n, const std::uint64_t* itw,
+                         std::uint64_t p, std::uint64_t inv, std::uint64_t scale) {
+            const simd::ntt::Kernels& k = simd::ntt::kernels();
+            for (std::size_t h = 1; h < n; h <<= 1) k.dit_level(x, n, h, itw + h, p, inv);
+            k.scale(x, n, scale, p, inv);
+        }
+
+        // Per-level twiddle table for a primitive n-th root w: entry h + j = w_{2h}^j
+        AlignedWords level_twiddles(std::uint64_t w, std::size_t n, std::uint64_t p, std::uint64_t inv) {
+            AlignedWords tw(std::max<std::size_t>(n, 2), 0);
+            if (n < 2) return tw;
+
+            const std::size_t top = n >> 1;
+            const std::uint64_t wm = to_mont(w, p);
+            std::uint64_t cur = to_mont(1, p);
+            for (std::size_t j = 0; j < top; ++j) {
+                tw[top + j] = cur;
+                cur = mont::mul(cur, wm, p, inv);
             }
-            j ^= bit;
-            if (i < j) {
-                std::swap(data[i], data[j]);
+            // w_{2h} = w_{4h}^2: lower levels are every other entry of the level above
+            for (std::size_t h = top >> 1; h > 0; h >>= 1) {
+                for (std::size_t j = 0; j < h; ++j) tw[h + j] = tw[2 * h + 2 * j];
             }
+            return tw;
+        }
+
+        // Residues of the limbs of |z| mod p, zero-padded to n coefficients
+        void load_residues(AlignedWords& dst, const mpz_class& z, std::size_t n,
+                           std::uint64_t p) {
+            const std::size_t len = mpz_size(z.get_mpz_t());
+            const mp_limb_t* limbs = mpz_limbs_read(z.get_mpz_t());
+            dst.assign(n, 0);
+            for (std::size_t i = 0; i < len; ++i) dst[i] = reduce(limbs[i], p);
         }
-        
-        // NTT butterfly operations
-        for (std::size_t len = 2; len <= n; len <<= 1) {
-            std::size_t half = len >> 1;
-            for (std::size_t i = 0; i < n; i += len) {
-                for (std::size_t j = 0; j < half; ++j) {
-                    mpz_class u = data[i + j];
-                    mpz_class v = (data[i + j + half] * ctx.roots_of_unity[j * (n / len)]) % ctx.modulus;
-                    
-                    data[i + j] = (u + v) % ctx.modulus;
-                    data[i + j + half] = (u - v + ctx.modulus) % ctx.modulus;
+
+        // Full cyclic product of |a| and |b| mod one prime, left in `fa`
+        void convolve_one_prime(AlignedWords& fa, const mpz_class& a, const mpz_class& b,
+                                const NTTContext& ctx) {
+            PIRACER_PROFILE_SCOPE("ntt.convolve");
+            const std::uint64_t p = ctx.modulus, inv = ctx.mont_inv;
+            const std::size_t n = ctx.size;
+
+            load_residues(fa, a, n, p);
+            forward_dif(fa.data(), n, ctx.roots_of_unity.data(), p, inv);
+
+            if (&a == &b) {
+                simd::ntt::kernels().pointwise(fa.data(), fa.data(), n, p, inv);
+            } else {
+                AlignedWords fb;
+                load_residues(fb, b, n, p);
+                forward_dif(fb.data(), n, ctx.roots_of_unity.data(), p, inv);
+                simd::ntt::kernels().pointwise(fa.data(), fb.data(), n, p, inv);
+            }
+
+            inverse_dit(fa.data(), n, ctx.inv_roots_of_unity.data(), p, inv, ctx.product_scale);
+        }
+
+        // Garner recombination of the three residue vectors into `len` limbs
+        void crt_to_limbs(mp_limb_t* out, std::size_t len, const std::uint64_t* const* r,
+                          const CRTContext& crt) {
+            PIRACER_PROFILE_SCOPE("ntt.crt");
+            const std::uint64_t p0 = crt.moduli[0], p1 = crt.moduli[1], p2 = crt.moduli[2];
+            const std::uint64_t inv1 = inverse_2_64(p1), inv2 = inverse_2_64(p2);
+            const std::uint64_t c01 = crt.crt_coeffs[0];   // p0^-1 mod p1
+            const std::uint64_t c012 = crt.crt_coeffs[1];  // (p0*p1)^-1 mod p2
+            const std::uint64_t c0 = crt.crt_coeffs[2];    // p0 mod p2
+            const u128 p01 = static_cast<u128>(p0) * p1;
+            const std::uint64_t p01_lo = static_cast<std::uint64_t>(p01);
+            const std::uint64_t p01_hi = static_cast<std::uint64_t>(p01 >> 64);
+
+            u128 carry = 0;
+            for (std::size_t k = 0; k < len; ++k) {
+                const std::uint64_t x0 = r[0][k];
+                const std::uint64_t x1 = mont::mul(mont::sub(r[1][k], reduce(x0, p1), p1), c01, p1, inv1);
+                const std::uint64_t t  = mont::add(reduce(x0, p2),
+                                                 mont::mul(reduce(x1, p2), c0, p2, inv2), p2);
+                const std::uint64_t x2 = mont::mul(mont::sub(r[2][k], t, p2), c012, p2, inv2);
+
+                // value = x0 + p0*x1 + p0*p1*x2 (< 2^189), added to the running carry
+                const u128 v  = static_cast<u128>(p0) * x1 + x0;
+                const u128 m0 = static_cast<u128>(p01_lo) * x2;
+                const u128 m1 = static_cast<u128>(p01_hi) * x2;
+
+                const u128 w0 = static_cast<u128>(static_cast<std::uint64_t>(m0)) +
+                                static_cast<std::uint64_t>(v) + static_cast<std::uint64_t>(carry);
+                const u128 w1 = (w0 >> 64) + (m0 >> 64) + static_cast<std::uint64_t>(m1) +
+                                (v >> 64) + (carry >> 64);
+                const u128 w2 = (w1 >> 64) + (m1 >> 64);
+
+                out[k] = static_cast<mp_limb_t>(w0);
+                carry = (w2 << 64) | static_cast<std::uint64_t>(w1);
+            }
+        }
+
+        void multiply(const mpz_class& a, const mpz_class& b, mpz_class& out, const NTTContext* ctx,
+                      const CRTContext& crt, ThreadPool* pool) {
+            PIRACER_PROFILE_SCOPE("ntt.mul");
+            const std::size_t len = mpz_size(a.get_mpz_t()) + mpz_size(b.get_mpz_t());
+            const bool negative = (mpz_sgn(a.get_mpz_t()) < 0) != (mpz_sgn(b.get_mpz_t()) < 0);
+
+            // One independent transform pipeline per prime, its buffers
+            // pooled like the twiddles
+            AlignedWords residues[kNTTPrimes];
+            {
+                TaskGroup g(pool);
+                for (int i = 1; i < kNTTPrimes; ++i) {
+                    g.spawn([&, i] { convolve_one_prime(residues[i], a, b, ctx[i]); });
                 }
+                convolve_one_prime(residues[0], a, b, ctx[0]);
+                g.sync();
             }
+
+            // Inputs are fully consumed: `out` may alias `a` or `b`
+            const std::uint64_t* r[kNTTPrimes];
+            for (int i = 0; i < kNTTPrimes; ++i) r[i] = residues[i].data();
+            mp_limb_t* limbs = mpz_limbs_write(out.get_mpz_t(), static_cast<mp_size_t>(len));
+            crt_to_limbs(limbs, len, r, crt);
+            const mp_size_t size = static_cast<mp_size_t>(len);
+            mpz_limbs_finish(out.get_mpz_t(), negative ? -size : size);
         }
+#endif
+
+        using PlanKey = std::pair<std::size_t, std::vector<std::uint64_t>>;
+        using PlanFuture = std::shared_future<std::shared_ptr<const NTTPlan>>;
+
+        struct PlanCache {
+            std::mutex mutex;
+            std::map<PlanKey, PlanFuture> plans;
+        };
+
+        PlanCache& plan_cache() {
+            static PlanCache cache;
+            return cache;
+        }
+    } // namespace
+
+    const std::vector<std::uint64_t>& ntt_default_moduli() {
+        return kModuli;
+    }
+
+#if PIRACER_HAVE_NTT
+    NTTContext::NTTContext(std::uint64_t mod, std::size_t sz)
+        : modulus(mod), size(sz) {
+        if (sz == 0 || (sz & (sz - 1)) != 0 || (mod - 1) % sz != 0 || (mod >> 63) != 0) {
+            throw std::invalid_argument("NTT size must be a power of two dividing modulus - 1");
+        }
+        mont_inv = inverse_2_64(mod);
+
+        const std::uint64_t g = primitive_root(mod);
+        const std::uint64_t w = pow_mod(g, (mod - 1) / sz, mod);
+        const std::uint64_t iw = pow_mod(w, mod - 2, mod);
+        roots_of_unity = level_twiddles(w, sz, mod, mont_inv);
+        inv_roots_of_unity = level_twiddles(iw, sz, mod, mont_inv);
+
+        const std::uint64_t inv_n = pow_mod(sz % mod, mod - 2, mod);
+        const std::uint64_t r_mod = static_cast<std::uint64_t>((static_cast<u128>(1) << 64) % mod);
+        inv_size = to_mont(inv_n, mod);
+        product_scale = to_mont(mul_mod(r_mod, inv_n, mod), mod);
     }
-    
-    void ntt_inverse(std::vector<mpz_class>& data, const NTTContext& ctx) {
-        // Inverse NTT
-        std::size_t n = data.size();
-        
-        // Bit-reversal permutation
-        for (std::size_t i = 1, j = 0; i < n; ++i) {
-            std::size_t bit = n >> 1;
-            for (; j & bit; bit >>= 1) {
-                j ^= bit;
+
+    CRTContext::CRTContext(const std::vector<std::uint64_t>& mods)
+        : moduli(mods) {
+        if (moduli.size() != static_cast<std::size_t>(kNTTPrimes)) {
+            throw std::invalid_argument("CRT context expects exactly three moduli");
+        }
+        const std::uint64_t p0 = moduli[0], p1 = moduli[1], p2 = moduli[2];
+
+        // Garner constants, Montgomery form for the modulus they are used with
+        crt_coeffs = {
+            to_mont(pow_mod(p0 % p1, p1 - 2, p1), p1),
+            to_mont(pow_mod(mul_mod(p0 % p2, p1 % p2, p2), p2 - 2, p2), p2),
+            to_mont(p0 % p2, p2),
+        };
+    }
+
+    void mul_ntt_with_context(const mpz_class& a, const mpz_class& b, mpz_class& out,
+                              const std::vector<NTTContext>& ntt_ctx, const CRTContext& crt_ctx,
+                              ThreadPool* pool) {
+        const std::size_t na = mpz_size(a.get_mpz_t());
+        const std::size_t nb = mpz_size(b.get_mpz_t());
+        if (na == 0 || nb == 0) {
+            out = 0;
+            return;
+        }
+
+        const std::size_t len = na + nb;
+        if (ntt_ctx.size() != crt_ctx.moduli.size()) {
+            throw std::invalid_argument("mul_ntt_with_context: one NTT context per CRT modulus");
+        }
+        for (std::size_t i = 0; i < ntt_ctx.size(); ++i) {
+            if (ntt_ctx[i].size < len || ntt_ctx[i].modulus != crt_ctx.moduli[i]) {
+                throw std::invalid_argument("mul_ntt_with_context: context does not fit operands");
             }
-            j ^= bit;
-            if (i < j) {
-                std::swap(data[i], data[j]);
+        }
+        multiply(a, b, out, ntt_ctx.data(), crt_ctx, pool);
+    }
+
+    void mul_ntt_with_plan(const mpz_class& a, const mpz_class& b, mpz_class& out,
+                           const NTTPlan& plan, ThreadPool* pool) {
+        if (mpz_sgn(a.get_mpz_t()) == 0 || mpz_sgn(b.get_mpz_t()) == 0) {
+            out = 0;
+            return;
+        }
+        if (plan.size < mpz_size(a.get_mpz_t()) + mpz_size(b.get_mpz_t())) {
+            throw std::invalid_argument("mul_ntt_with_plan: plan too short for operands");
+        }
+        multiply(a, b, out, plan.primes.data(), plan.crt, pool);
+    }
+
+    void mul_ntt(const mpz_class& a, const mpz_class& b, mpz_class& out, ThreadPool* pool) {
+        const std::size_t len = mpz_size(a.get_mpz_t()) + mpz_size(b.get_mpz_t());
+        if (mpz_sgn(a.get_mpz_t()) == 0 || mpz_sgn(b.get_mpz_t()) == 0) {
+            out = 0;
+            return;
+        }
+
+        std::size_t n = 1;
+        while (n < len) n <<= 1;
+        if (n > kMaxTransform) throw std::length_error("mul_ntt: operands exceed the NTT length limit");
+
+        mul_ntt_with_plan(a, b, out, *get_ntt_plan(n), pool);
+    }
+
+    void ntt_forward(std::vector<std::uint64_t>& data, const NTTContext& ctx) {
+        if (data.size() != ctx.size) throw std::invalid_argument("ntt_forward: size mismatch");
+        forward_dif(data.data(), ctx.size, ctx.roots_of_unity.data(), ctx.modulus, ctx.mont_inv);
+    }
+
+    void ntt_inverse(std::vector<std::uint64_t>& data, const NTTContext& ctx) {
+        if (data.size() != ctx.size) throw std::invalid_argument("ntt_inverse: size mismatch");
+        inverse_dit(data.data(), ctx.size, ctx.inv_roots_of_unity.data(), ctx.modulus, ctx.mont_inv,
+                    ctx.inv_size);
+    }
+
+    mpz_class crt_reconstruct(const std::vector<std::uint64_t>& residues, const CRTContext& ctx) {
+        std::uint64_t words[kNTTPrimes][3] = {};
+        const std::uint64_t* r[kNTTPrimes];
+        for (int i = 0; i < kNTTPrimes; ++i) {
+            words[i][0] = residues.at(i);
+            r[i] = words[i];
+        }
+
+        mpz_class out;
+        mp_limb_t* limbs = mpz_limbs_write(out.get_mpz_t(), 3);
+        crt_to_limbs(limbs, 3, r, ctx);
+        mpz_limbs_finish(out.get_mpz_t(), 3);
+        return out;
+    }
+
+    void crt_to_product(mpz_class& out, std::size_t len, const std::uint64_t* const* residues,
+                        const CRTContext& crt, bool negative) {
+        mp_limb_t* limbs = mpz_limbs_write(out.get_mpz_t(), static_cast<mp_size_t>(len));
+        crt_to_limbs(limbs, len, residues, crt);
+        const mp_size_t size = static_cast<mp_size_t>(len);
+        mpz_limbs_finish(out.get_mpz_t(), negative ? -size : size);
+    }
+#else
+    NTTContext::NTTContext(std::uint64_t mod, std::size_t sz)
+        : modulus(mod), size(sz), mont_inv(0), inv_size(0), product_scale(0) {
+        throw std::runtime_error("NTT backend requires 128-bit integers and 64-bit GMP limbs");
+    }
+
+    CRTContext::CRTContext(const std::vector<std::uint64_t>& mods) : moduli(mods) {
+        throw std::runtime_error("NTT backend requires 128-bit integers and 64-bit GMP limbs");
+    }
+
+    void mul_ntt_with_context(const mpz_class& a, const mpz_class& b, mpz_class& out,
+                              const std::vector<NTTContext>&, const CRTContext&, ThreadPool*) {
+        mpz_mul(out.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+    }
+
+    void mul_ntt_with_plan(const mpz_class& a, const mpz_class& b, mpz_class& out,
+                           const NTTPlan&, ThreadPool*) {
+        mpz_mul(out.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+    }
+
+    // Without the word-sized backend GMP does all the work
+    void mul_ntt(const mpz_class& a, const mpz_class& b, mpz_class& out, ThreadPool*) {
+        mpz_mul(out.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+    }
+
+    void ntt_forward(std::vector<std::uint64_t>&, const NTTContext&) {
+        throw std::runtime_error("NTT backend not available on this target");
+    }
+
+    void ntt_inverse(std::vector<std::uint64_t>&, const NTTContext&) {
+        throw std::runtime_error("NTT backend not available on this target");
+    }
+
+    mpz_class crt_reconstruct(const std::vector<std::uint64_t>&, const CRTContext&) {
+        throw std::runtime_error("NTT backend not available on this target");
+    }
+
+    void crt_to_product(mpz_class&, std::size_t, const std::uint64_t* const*, const CRTContext&, bool) {
+        throw std::runtime_error("NTT backend not available on this target");
+    }
+#endif
+
+    NTTPlan::NTTPlan(std::size_t sz, const std::vector<std::uint64_t>& moduli)
+        : size(sz), crt(moduli) {
+        primes.reserve(moduli.size());
+        for (std::uint64_t p : moduli) primes.emplace_back(p, sz);
+    }
+
+    std::shared_ptr<const NTTPlan> get_ntt_plan(std::size_t size) {
+        return get_ntt_plan(size, kModuli);
+    }
+
+    std::shared_ptr<const NTTPlan> get_ntt_plan(std::size_t size, const std::vector<std::uint64_t>& moduli) {
+        PlanCache& cache = plan_cache();
+        PlanKey key(size, moduli);
+
+        std::promise<std::shared_ptr<const NTTPlan>> promise;
+        PlanFuture plan;
+        bool build = false;
+        {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            auto it = cache.plans.find(key);
+            if (it != cache.plans.end()) {
+                plan = it->second;
+            } else {
+                plan = promise.get_future().share();
+                cache.plans.emplace(key, plan);
+                build = true;
             }
         }
-        
-        // Inverse NTT butterfly operations
-        for (std::size_t len = 2; len <= n; len <<= 1) {
-            std::size_t half = len >> 1;
-            for (std::size_t i = 0; i < n; i += len) {
-                for (std::size_t j = 0; j < half; ++j) {
-                    mpz_class u = data[i + j];
-                    mpz_class v = (data[i + j + half] * ctx.inv_roots_of_unity[j * (n / len)]) % ctx.modulus;
-                    
-                    data[i + j] = (u + v) % ctx.modulus;
-                    data[i + j + half] = (u - v + ctx.modulus) % ctx.modulus;
+
+        // Tables are built outside the lock so other sizes stay available
+        if (build) {
+            try {
+                promise.set_value(std::make_shared<const NTTPlan>(size, moduli));
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(cache.mutex);
+                    cache.plans.erase(key);
                 }
+                promise.set_exception(std::current_exception());
             }
         }
-        
-        // Scale by inverse of n
-        mpz_class inv_n;
-        mpz_invert(inv_n.get_mpz_t(), mpz_class(n).get_mpz_t(), ctx.modulus.get_mpz_t());
-        for (auto& x : data) {
-            x = (x * inv_n) % ctx.modulus;
-        }
+        return plan.get();
     }
-    
-    mpz_class crt_reconstruct(const std::vector<mpz_class>& residues, const CRTContext& ctx) {
-        mpz_class result = 0;
-        for (std::size_t i = 0; i < residues.size(); ++i) {
-            result = (result + residues[i] * ctx.crt_coeffs[i]) % ctx.moduli[i];
-        }
-        return result;
+
+    void clear_ntt_plan_cache() {
+        PlanCache& cache = plan_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.plans.clear();
     }
-    
-    NTTContext create_ntt_context(std::size_t size, const mpz_class& modulus) {
+
+    NTTContext create_ntt_context(std::size_t size, std::uint64_t modulus) {
         return NTTContext(modulus, size);
     }
-    
-    CRTContext create_crt_context(const std::vector<mpz_class>& moduli) {
+
+    CRTContext create_crt_context(const std::vector<std::uint64_t>& moduli) {
         return CRTContext(moduli);
     }
-    
-} // namespace piracer 
\ No newline at end of file
+
+    std::size_t ntt_threshold_limbs() {
+        const std::size_t t = g_ntt_threshold.load(std::memory_order_relaxed);
+        if (t) return t;
+
+        // Crossovers against mpz_mul measured on one core: 8-lane kernels win
+        // from 2^17 limbs, scalar and 4-lane ones only from 2^19
+#if PIRACER_HAVE_NTT
+        if (simd::ntt::kernels().kind == simd::ntt::Kernel::AVX512) return std::size_t(1) << 17;
+#endif
+        return std::size_t(1) << 19;
+    }
+
+    void set_ntt_threshold_limbs(std::size_t limbs) {
+        g_ntt_threshold.store(limbs, std::memory_order_relaxed);
+    }
+
+    void mul_big(mpz_class& out, const mpz_class& a, const mpz_class& b, ThreadPool* pool) {
+        const std::size_t m = std::min(mpz_size(a.get_mpz_t()), mpz_size(b.get_mpz_t()));
+        if (!PIRACER_HAVE_NTT || m < ntt_threshold_limbs()) {
+            // GMP's own multiplications, from where they start to matter
+            PIRACER_PROFILE_SCOPE_IF(m >= 1024, "gmp.mul");
+            mpz_mul(out.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+            return;
+        }
+        mul_ntt(a, b, out, pool);
+    }
+
+} // namespace piracer
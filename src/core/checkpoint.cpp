@@ -1,10 +1,36 @@
 #include "piracer/checkpoint.hpp"
+#include "piracer/atomic_file.hpp"
+#include "piracer/simd.hpp"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
+#include <type_traits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PIRACER_CRC_X86 1
+#include <nmmintrin.h>
+#else
+#define PIRACER_CRC_X86 0
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define PIRACER_CRC_ARM 1
+#include <arm_acle.h>
+#else
+#define PIRACER_CRC_ARM 0
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace piracer {
     
@@ -52,6 +78,509 @@ namespace piracer {
         }
     }
     
+    // ---- CRC32C -----------------------------------------------------------------
+    namespace {
+        // Slicing-by-8 tables for the reflected Castagnoli polynomial
+        struct Crc32cTables {
+            std::uint32_t t[8][256];
+            Crc32cTables() {
+                for (std::uint32_t i = 0; i < 256; ++i) {
+                    std::uint32_t c = i;
+                    for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1u)));
+                    t[0][i] = c;
+                }
+                for (int j = 1; j < 8; ++j) {
+                    for (int i = 0; i < 256; ++i) t[j][i] = (t[j - 1][i] >> 8) ^ t[0][t[j - 1][i] & 0xFF];
+                }
+            }
+        };
+
+        std::uint32_t crc32c_soft(const unsigned char* p, std::size_t n, std::uint32_t c) {
+            static const Crc32cTables tab;
+            const auto& t = tab.t;
+            for (; n >= 8; n -= 8, p += 8) {
+                std::uint64_t w;
+                std::memcpy(&w, p, 8);
+                w ^= c;  // little-endian: the low word absorbs the running CRC
+                c = t[7][w & 0xFF] ^ t[6][(w >> 8) & 0xFF] ^ t[5][(w >> 16) & 0xFF] ^ t[4][(w >> 24) & 0xFF] ^
+                    t[3][(w >> 32) & 0xFF] ^ t[2][(w >> 40) & 0xFF] ^ t[1][(w >> 48) & 0xFF] ^ t[0][w >> 56];
+            }
+            for (; n > 0; --n, ++p) c = (c >> 8) ^ t[0][(c ^ *p) & 0xFF];
+            return c;
+        }
+
+#if PIRACER_CRC_X86 && defined(__x86_64__)
+        __attribute__((target("sse4.2")))
+        std::uint32_t crc32c_hw(const unsigned char* p, std::size_t n, std::uint32_t c) {
+            std::uint64_t c64 = c;
+            for (; n >= 8; n -= 8, p += 8) {
+                std::uint64_t w;
+                std::memcpy(&w, p, 8);
+                c64 = _mm_crc32_u64(c64, w);
+            }
+            c = static_cast<std::uint32_t>(c64);
+            for (; n > 0; --n, ++p) c = _mm_crc32_u8(c, *p);
+            return c;
+        }
+#elif PIRACER_CRC_ARM
+        std::uint32_t crc32c_hw(const unsigned char* p, std::size_t n, std::uint32_t c) {
+            for (; n >= 8; n -= 8, p += 8) {
+                std::uint64_t w;
+                std::memcpy(&w, p, 8);
+                c = __crc32cd(c, w);
+            }
+            for (; n > 0; --n, ++p) c = __crc32cb(c, *p);
+            return c;
+        }
+#endif
+    } // namespace
+
+    std::uint32_t crc32c(const void* data, std::size_t n, std::uint32_t crc) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+#if PIRACER_CRC_X86 && defined(__x86_64__)
+        static const bool hw = simd::get_cpu_features().sse4_2;
+        crc = hw ? crc32c_hw(p, n, crc) : crc32c_soft(p, n, crc);
+#elif PIRACER_CRC_ARM
+        crc = crc32c_hw(p, n, crc);
+#else
+        crc = crc32c_soft(p, n, crc);
+#endif
+        return ~crc;
+    }
+
+    // ---- Binary checkpoint format ---------------------------------------------
+    namespace {
+        constexpr char kMagic[8] = {'P', 'I', 'R', 'A', 'C', 'K', 'P', 'T'};
+        constexpr std::uint32_t kFormatVersion = 1;
+        constexpr std::uint32_t kByteOrderMark = 0x01020304u;
+        constexpr std::size_t kAlign = 64;
+
+        struct FileHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t header_bytes;
+            std::uint32_t byte_order;
+            std::uint32_t limb_bits;
+            std::uint64_t digits;
+            std::int32_t base;
+            std::int32_t threads;
+            std::uint64_t completed_terms;
+            std::uint64_t total_terms;
+            std::int64_t timestamp;        // seconds since the epoch
+            std::uint64_t segment_count;
+            std::uint64_t file_bytes;
+            char algorithm[32];
+            std::uint64_t reserved;
+            std::uint32_t payload_crc;     // everything after the header
+            std::uint32_t header_crc;      // the header up to this field
+        };
+        static_assert(sizeof(FileHeader) == 128 && std::is_trivially_copyable<FileHeader>::value,
+                      "checkpoint header layout");
+
+        struct IntRecord {
+            std::uint64_t offset;   // from the start of the file
+            std::uint64_t limbs;
+            std::uint32_t negative;
+            std::uint32_t reserved;
+        };
+
+        struct SegmentRecord {
+            std::uint64_t begin;
+            std::uint64_t end;
+            IntRecord p, q, t;
+        };
+        static_assert(sizeof(SegmentRecord) == 88, "checkpoint segment layout");
+
+        std::uint64_t align_up(std::uint64_t x) { return (x + kAlign - 1) / kAlign * kAlign; }
+
+        std::uint32_t header_checksum(const FileHeader& h) {
+            return crc32c(&h, offsetof(FileHeader, header_crc));
+        }
+
+        bool header_ok(const FileHeader& h) {
+            return std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0 && h.version == kFormatVersion &&
+                   h.header_bytes == sizeof(FileHeader) && h.byte_order == kByteOrderMark &&
+                   h.limb_bits == GMP_LIMB_BITS && h.header_crc == header_checksum(h);
+        }
+
+        bool read_header(const std::string& filename, FileHeader& h) {
+            std::ifstream file(filename, std::ios::binary);
+            if (!file.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+            return header_ok(h);
+        }
+
+        // Read-only view of a whole file: mmap where available, a plain read elsewhere
+        class MappedFile {
+        public:
+            explicit MappedFile(const std::string& filename) {
+#ifndef _WIN32
+                fd_ = ::open(filename.c_str(), O_RDONLY);
+                if (fd_ < 0) return;
+                struct stat st;
+                if (::fstat(fd_, &st) != 0 || st.st_size <= 0) return;
+                size_ = static_cast<std::size_t>(st.st_size);
+                void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+                if (p == MAP_FAILED) {
+                    size_ = 0;
+                    return;
+                }
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const unsigned char*>(p);
+#else
+                std::ifstream file(filename, std::ios::binary | std::ios::ate);
+                if (!file) return;
+                buffer_.resize(static_cast<std::size_t>(file.tellg()));
+                file.seekg(0);
+                if (!file.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size())) return;
+                data_ = buffer_.data();
+                size_ = buffer_.size();
+#endif
+            }
+
+            ~MappedFile() {
+#ifndef _WIN32
+                if (data_) ::munmap(const_cast<unsigned char*>(data_), size_);
+                if (fd_ >= 0) ::close(fd_);
+#endif
+            }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const unsigned char* data() const { return data_; }
+            std::size_t size() const { return data_ ? size_ : 0; }
+
+        private:
+            const unsigned char* data_ = nullptr;
+            std::size_t size_ = 0;
+#ifndef _WIN32
+            int fd_ = -1;
+#else
+            std::vector<unsigned char> buffer_;
+#endif
+        };
+
+        // Header and checksums of a mapped file; `table` points at the segment records
+        bool verify_mapped(const MappedFile& m, FileHeader& h, const SegmentRecord*& table) {
+            if (m.size() < sizeof(FileHeader)) return false;
+            std::memcpy(&h, m.data(), sizeof(h));
+            if (!header_ok(h) || h.file_bytes != m.size()) return false;
+            if (h.segment_count > (m.size() - sizeof(FileHeader)) / sizeof(SegmentRecord)) return false;
+            if (crc32c(m.data() + sizeof(FileHeader), m.size() - sizeof(FileHeader)) != h.payload_crc) return false;
+            table = reinterpret_cast<const SegmentRecord*>(m.data() + sizeof(FileHeader));
+            return true;
+        }
+
+        bool load_int(const MappedFile& m, const IntRecord& rec, mpz_class& z) {
+            if (rec.offset > m.size() || rec.limbs > (m.size() - rec.offset) / sizeof(mp_limb_t)) return false;
+            const auto n = static_cast<mp_size_t>(rec.limbs);
+            if (n == 0) {
+                z = 0;
+                return true;
+            }
+            mp_limb_t* dst = mpz_limbs_write(z.get_mpz_t(), n);
+            std::memcpy(dst, m.data() + rec.offset, static_cast<std::size_t>(n) * sizeof(mp_limb_t));
+            mpz_limbs_finish(z.get_mpz_t(), rec.negative ? -n : n);
+            return true;
+        }
+    } // namespace
+
+    namespace {
+        // Header fields and layout for `segments` (data.segments is ignored);
+        // the checksums are left for the caller
+        void lay_out(const BinaryCheckpoint& data, const std::vector<const CheckpointSegment*>& segments,
+                     FileHeader& h, std::vector<SegmentRecord>& table) {
+            h = FileHeader{};
+            std::memcpy(h.magic, kMagic, sizeof(kMagic));
+            h.version = kFormatVersion;
+            h.header_bytes = sizeof(FileHeader);
+            h.byte_order = kByteOrderMark;
+            h.limb_bits = GMP_LIMB_BITS;
+            h.digits = data.digits;
+            h.base = data.base;
+            h.threads = data.num_threads;
+            h.completed_terms = data.completed_terms;
+            h.total_terms = data.total_terms;
+            h.timestamp = std::chrono::duration_cast<std::chrono::seconds>(data.timestamp.time_since_epoch()).count();
+            h.segment_count = segments.size();
+            std::strncpy(h.algorithm, data.algorithm_name.c_str(), sizeof(h.algorithm) - 1);
+
+            // The limb arrays follow the table
+            table.assign(segments.size(), SegmentRecord{});
+            std::uint64_t pos = align_up(sizeof(FileHeader) + table.size() * sizeof(SegmentRecord));
+            auto place = [&pos](const mpz_class& z, IntRecord& rec) {
+                rec = IntRecord{pos, mpz_size(z.get_mpz_t()), z < 0 ? 1u : 0u, 0u};
+                pos = align_up(pos + rec.limbs * sizeof(mp_limb_t));
+            };
+            for (std::size_t i = 0; i < table.size(); ++i) {
+                const CheckpointSegment& seg = *segments[i];
+                table[i].begin = seg.begin;
+                table[i].end = seg.end;
+                place(seg.state.P, table[i].p);
+                place(seg.state.Q, table[i].q);
+                place(seg.state.T, table[i].t);
+            }
+            h.file_bytes = pos;
+        }
+
+        // Everything after the header, in order, as put(data, bytes) calls
+        template <class Put>
+        void emit_payload(const FileHeader& h, const std::vector<SegmentRecord>& table,
+                          const std::vector<const CheckpointSegment*>& segments, Put&& put) {
+            std::uint64_t at = sizeof(FileHeader);
+            auto put_at = [&](const void* p, std::size_t n) {
+                put(p, n);
+                at += n;
+            };
+            auto pad_to = [&](std::uint64_t target) {
+                static const char zeros[kAlign] = {};
+                put_at(zeros, static_cast<std::size_t>(target - at));
+            };
+            auto put_int = [&](const mpz_class& z, const IntRecord& rec) {
+                pad_to(rec.offset);
+                put_at(mpz_limbs_read(z.get_mpz_t()), static_cast<std::size_t>(rec.limbs) * sizeof(mp_limb_t));
+            };
+
+            put_at(table.data(), table.size() * sizeof(SegmentRecord));
+            for (std::size_t i = 0; i < table.size(); ++i) {
+                put_int(segments[i]->state.P, table[i].p);
+                put_int(segments[i]->state.Q, table[i].q);
+                put_int(segments[i]->state.T, table[i].t);
+            }
+            pad_to(h.file_bytes);
+        }
+
+        bool write_binary_checkpoint(const std::string& filename, const BinaryCheckpoint& data,
+                                         const std::vector<const CheckpointSegment*>& segments) {
+            FileHeader h;
+            std::vector<SegmentRecord> table;
+            lay_out(data, segments, h, table);
+
+            // A crash mid-write leaves the previous checkpoint intact
+            return write_file_atomically(filename, [&](std::ostream& file) {
+                // The payload is checksummed as it is written; the header goes last
+                file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+                std::uint32_t crc = 0;
+                emit_payload(h, table, segments, [&](const void* p, std::size_t n) {
+                    file.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+                    crc = crc32c(p, n, crc);
+                });
+
+                h.payload_crc = crc;
+                h.header_crc = header_checksum(h);
+                file.seekp(0);
+                file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+                return file.good();
+            });
+        }
+
+        // The header fields of `h`, no segments
+        BinaryCheckpoint meta_of(const FileHeader& h) {
+            BinaryCheckpoint out;
+            out.digits = h.digits;
+            out.base = h.base;
+            out.num_threads = h.threads;
+            out.completed_terms = h.completed_terms;
+            out.total_terms = h.total_terms;
+            out.algorithm_name.assign(h.algorithm, strnlen(h.algorithm, sizeof(h.algorithm)));
+            out.timestamp = std::chrono::system_clock::time_point(std::chrono::seconds(h.timestamp));
+            return out;
+        }
+    } // namespace
+
+    bool save_binary_checkpoint(const std::string& filename, const BinaryCheckpoint& data) {
+        std::vector<const CheckpointSegment*> segments;
+        for (const CheckpointSegment& seg : data.segments) segments.push_back(&seg);
+        return write_binary_checkpoint(filename, data, segments);
+    }
+
+    // ---- Background writer ------------------------------------------------------
+    CheckpointWriter::CheckpointWriter(std::string filename, BinaryCheckpoint meta, std::chrono::seconds interval)
+        : filename_(std::move(filename)), meta_(std::move(meta)), interval_(interval),
+          last_save_(std::chrono::steady_clock::now()) {
+        meta_.segments.clear();
+        thread_ = std::thread([this] { run(); });
+    }
+
+    CheckpointWriter::~CheckpointWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    void CheckpointWriter::post(Snapshot segments, std::size_t completed_terms) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = std::move(segments);
+            pending_terms_ = completed_terms;
+            has_pending_ = true;
+        }
+        wake_.notify_all();
+    }
+
+    void CheckpointWriter::flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        flush_ = true;
+        wake_.notify_all();
+        idle_.wait(lock, [this] { return !has_pending_ && !writing_; });
+        flush_ = false;
+    }
+
+    bool CheckpointWriter::ok() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !failed_;
+    }
+
+    std::size_t CheckpointWriter::saves() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return saves_;
+    }
+
+    void CheckpointWriter::run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [this] { return stop_ || has_pending_; });
+            if (stop_) break;
+            // Only the newest snapshot is written, at most once per interval
+            // unless a flush asks for it now
+            wake_.wait_until(lock, last_save_ + interval_, [this] { return stop_ || flush_; });
+            if (stop_) break;
+
+            Snapshot snapshot = std::move(pending_);
+            BinaryCheckpoint meta = meta_;
+            meta.completed_terms = pending_terms_;
+            meta.timestamp = std::chrono::system_clock::now();
+            has_pending_ = false;
+            writing_ = true;
+            lock.unlock();
+
+            std::vector<const CheckpointSegment*> segments;
+            for (const auto& seg : snapshot) segments.push_back(seg.get());
+            const bool saved = write_binary_checkpoint(filename_, meta, segments);
+            snapshot.clear();
+
+            lock.lock();
+            writing_ = false;
+            last_save_ = std::chrono::steady_clock::now();
+            if (saved) ++saves_; else failed_ = true;
+            idle_.notify_all();
+        }
+        idle_.notify_all();
+    }
+
+
+    bool load_binary_checkpoint(const std::string& filename, BinaryCheckpoint& data) {
+        const MappedFile m(filename);
+        FileHeader h;
+        const SegmentRecord* table = nullptr;
+        if (!verify_mapped(m, h, table)) return false;
+
+        BinaryCheckpoint out = meta_of(h);
+        out.segments.resize(h.segment_count);
+        for (std::size_t i = 0; i < out.segments.size(); ++i) {
+            SegmentRecord rec;
+            std::memcpy(&rec, &table[i], sizeof(rec));
+            CheckpointSegment& seg = out.segments[i];
+            seg.begin = rec.begin;
+            seg.end = rec.end;
+            if (!load_int(m, rec.p, seg.state.P) || !load_int(m, rec.q, seg.state.Q) ||
+                !load_int(m, rec.t, seg.state.T)) {
+                return false;
+            }
+        }
+        data = std::move(out);
+        return true;
+    }
+
+    // ---- Streamed encoding -------------------------------------------------------
+    // No seeking back for the header: the payload checksum is a pass of its own
+    // ahead of the write (a fraction of the cost of sending it anywhere)
+    bool send_binary_checkpoint(const BinaryCheckpoint& data, const ByteWriter& write) {
+        std::vector<const CheckpointSegment*> segments;
+        for (const CheckpointSegment& seg : data.segments) segments.push_back(&seg);
+        FileHeader h;
+        std::vector<SegmentRecord> table;
+        lay_out(data, segments, h, table);
+
+        std::uint32_t crc = 0;
+        emit_payload(h, table, segments, [&](const void* p, std::size_t n) { crc = crc32c(p, n, crc); });
+        h.payload_crc = crc;
+        h.header_crc = header_checksum(h);
+
+        bool ok = write(&h, sizeof(h));
+        emit_payload(h, table, segments, [&](const void* p, std::size_t n) {
+            if (ok && n > 0) ok = write(p, n);
+        });
+        return ok;
+    }
+
+    bool receive_binary_checkpoint(const ByteReader& read, BinaryCheckpoint& data, std::uint64_t max_bytes) {
+        FileHeader h;
+        if (!read(&h, sizeof(h)) || !header_ok(h) || h.file_bytes < sizeof(FileHeader)) return false;
+        // Every limb count is checked against file_bytes below
+        if (max_bytes > 0 && h.file_bytes > max_bytes) return false;
+        if (h.segment_count > (h.file_bytes - sizeof(FileHeader)) / sizeof(SegmentRecord)) return false;
+
+        std::uint64_t at = sizeof(FileHeader);
+        std::uint32_t crc = 0;
+        auto get = [&](void* p, std::size_t n) {
+            if (n > 0 && !read(p, n)) return false;
+            crc = crc32c(p, n, crc);
+            at += n;
+            return true;
+        };
+        auto skip_to = [&](std::uint64_t target) {
+            char pad[kAlign];
+            while (at < target) {
+                if (!get(pad, static_cast<std::size_t>(std::min<std::uint64_t>(kAlign, target - at)))) return false;
+            }
+            return true;
+        };
+        // Limbs go straight into the mpz values; records must come in file order
+        auto get_int = [&](const IntRecord& rec, mpz_class& z) {
+            if (rec.offset < at || rec.offset > h.file_bytes ||
+                rec.limbs > (h.file_bytes - rec.offset) / sizeof(mp_limb_t) || !skip_to(rec.offset)) {
+                return false;
+            }
+            const auto n = static_cast<mp_size_t>(rec.limbs);
+            if (n == 0) {
+                z = 0;
+                return true;
+            }
+            mp_limb_t* dst = mpz_limbs_write(z.get_mpz_t(), n);
+            if (!get(dst, static_cast<std::size_t>(n) * sizeof(mp_limb_t))) return false;
+            mpz_limbs_finish(z.get_mpz_t(), rec.negative ? -n : n);
+            return true;
+        };
+
+        std::vector<SegmentRecord> table(h.segment_count);
+        if (!get(table.data(), table.size() * sizeof(SegmentRecord))) return false;
+        BinaryCheckpoint out = meta_of(h);
+        out.segments.resize(table.size());
+        for (std::size_t i = 0; i < table.size(); ++i) {
+            CheckpointSegment& seg = out.segments[i];
+            seg.begin = table[i].begin;
+            seg.end = table[i].end;
+            if (!get_int(table[i].p, seg.state.P) || !get_int(table[i].q, seg.state.Q) ||
+                !get_int(table[i].t, seg.state.T)) {
+                return false;
+            }
+        }
+        if (!skip_to(h.file_bytes) || crc != h.payload_crc) return false;
+        data = std::move(out);
+        return true;
+    }
+
+    bool is_binary_checkpoint(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        char magic[sizeof(kMagic)];
+        return file.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+    }
+
     std::string generate_checksum(const CheckpointData& data) {
         std::stringstream ss;
         ss << data.digits << "|" << data.base << "|" << data.num_threads 
@@ -92,11 +621,9 @@ namespace piracer {
             return false;
         }
         
-        std::string line;
-        std::string content;
-        while (std::getline(file, line)) {
-            content += line + "\n";
-        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        const std::string content = buffer.str();
         
         // Simple JSON parsing (for now)
         // In production, use a proper JSON library
@@ -145,6 +672,13 @@ namespace piracer {
         if (!std::filesystem::exists(filename)) {
             return false;
         }
+        if (is_binary_checkpoint(filename)) {
+            const MappedFile m(filename);
+            FileHeader h;
+            const SegmentRecord* table = nullptr;
+            return verify_mapped(m, h, table);
+        }
+
         
         CheckpointData data;
         if (!load_checkpoint(filename, data)) {
@@ -161,6 +695,12 @@ namespace piracer {
     }
     
     std::chrono::hours get_checkpoint_age(const std::string& filename) {
+        FileHeader h;
+        if (read_header(filename, h)) {
+            const auto written = std::chrono::system_clock::time_point(std::chrono::seconds(h.timestamp));
+            return std::chrono::duration_cast<std::chrono::hours>(std::chrono::system_clock::now() - written);
+        }
+
         CheckpointData data;
         if (!load_checkpoint(filename, data)) {
             return std::chrono::hours::max();
@@ -196,6 +736,14 @@ namespace piracer {
     }
     
     bool get_checkpoint_info(const std::string& filename, std::size_t& digits, int& base, int& threads) {
+        FileHeader h;
+        if (read_header(filename, h)) {
+            digits = h.digits;
+            base = h.base;
+            threads = h.threads;
+            return true;
+        }
+
         CheckpointData data;
         if (!load_checkpoint(filename, data)) {
             return false;
@@ -0,0 +1,444 @@
+// CUDA backend of GPUMultiplier: the three-prime NTT of mul_ntt run on the
+// device, level by level with the same twiddle tables and Montgomery
+// arithmetic (so residues match the CPU bit for bit), and recombined by CRT
+// on the host. Built only with -DPIRACER_ENABLE_CUDA=ON.
+#include "piracer/gpu_backend.hpp"
+#include "piracer/bigmul.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace piracer {
+    namespace cuda_backend {
+        namespace {
+            using u64 = std::uint64_t;
+
+            // Products whose smaller operand is below this stay on the CPU:
+            // the transfers cost more than the transform saves
+            constexpr std::size_t kMinDeviceLimbs = std::size_t(1) << 14;
+
+            constexpr int kBlock = 256;
+            constexpr int kMaxBlocks = 4096;
+
+            void check(cudaError_t e, const char* what) {
+                if (e != cudaSuccess) throw std::runtime_error(std::string("CUDA ") + what + ": " + cudaGetErrorString(e));
+            }
+
+            int blocks_for(std::size_t work) {
+                return static_cast<int>(std::min<std::size_t>((work + kBlock - 1) / kBlock, kMaxBlocks));
+            }
+
+            // ---- Device arithmetic (mont:: on the host) -------------------------------
+
+            __device__ __forceinline__ u64 d_add(u64 a, u64 b, u64 p) {
+                const u64 s = a + b;
+                return s >= p ? s - p : s;
+            }
+
+            __device__ __forceinline__ u64 d_sub(u64 a, u64 b, u64 p) {
+                return a >= b ? a - b : a + p - b;
+            }
+
+            __device__ __forceinline__ u64 d_mul(u64 a, u64 b, u64 p, u64 inv) {
+                const u64 th = __umul64hi(a, b);
+                const u64 m = (a * b) * inv;
+                const u64 mh = __umul64hi(m, p);
+                return th >= mh ? th - mh : th - mh + p;
+            }
+
+            // ---- Kernels (grid-stride) --------------------------------------------------
+
+            // dst[0, n) = limbs[0, len) mod p, zero-padded
+            __global__ void load_kernel(u64* dst, const u64* limbs, std::size_t len, std::size_t n, u64 p) {
+                for (std::size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += gridDim.x * blockDim.x) {
+                    u64 x = i < len ? limbs[i] : 0;
+                    while (x >= p) x -= p;
+                    dst[i] = x;
+                }
+            }
+
+            // One DIF level of half-length h: (u, v) -> (u + v, (u - v) w[j])
+            __global__ void dif_kernel(u64* x, std::size_t n, std::size_t h, const u64* w, u64 p, u64 inv) {
+                for (std::size_t t = blockIdx.x * blockDim.x + threadIdx.x; t < n / 2; t += gridDim.x * blockDim.x) {
+                    const std::size_t j = t & (h - 1), i = 2 * (t - j) + j;
+                    const u64 u = x[i], v = x[i + h];
+                    x[i] = d_add(u, v, p);
+                    x[i + h] = d_mul(d_sub(u, v, p), w[j], p, inv);
+                }
+            }
+
+            // One DIT level: (u, v) -> (u + v w[j], u - v w[j])
+            __global__ void dit_kernel(u64* x, std::size_t n, std::size_t h, const u64* w, u64 p, u64 inv) {
+                for (std::size_t t = blockIdx.x * blockDim.x + threadIdx.x; t < n / 2; t += gridDim.x * blockDim.x) {
+                    const std::size_t j = t & (h - 1), i = 2 * (t - j) + j;
+                    const u64 u = x[i], v = d_mul(x[i + h], w[j], p, inv);
+                    x[i] = d_add(u, v, p);
+                    x[i + h] = d_sub(u, v, p);
+                }
+            }
+
+            __global__ void pointwise_kernel(u64* a, const u64* b, std::size_t n, u64 p, u64 inv) {
+                for (std::size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += gridDim.x * blockDim.x) {
+                    a[i] = d_mul(a[i], b[i], p, inv);
+                }
+            }
+
+            __global__ void scale_kernel(u64* x, std::size_t n, u64 s, u64 p, u64 inv) {
+                for (std::size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += gridDim.x * blockDim.x) {
+                    x[i] = d_mul(x[i], s, p, inv);
+                }
+            }
+
+            // ---- Device context -----------------------------------------------------------
+
+            GPUDevice device_info(int id) {
+                cudaDeviceProp prop;
+                check(cudaGetDeviceProperties(&prop, id), "cudaGetDeviceProperties");
+                return GPUDevice(prop.name, "NVIDIA", prop.totalGlobalMem / (1024 * 1024), prop.major, prop.minor,
+                                 true, static_cast<std::size_t>(prop.maxThreadsPerBlock));
+            }
+
+            class CUDAContext : public GPUContext {
+            public:
+                bool initialize() override {
+                    valid_ = device_count() > 0 && cudaGetDevice(&device_) == cudaSuccess;
+                    return valid_;
+                }
+
+                std::vector<GPUDevice> get_devices() const override {
+                    std::vector<GPUDevice> out;
+                    for (int i = 0; i < device_count(); ++i) out.push_back(device_info(i));
+                    return out;
+                }
+
+                bool select_device(int device_id) override {
+                    if (device_id < 0 || device_id >= device_count()) return false;
+                    if (cudaSetDevice(device_id) != cudaSuccess) return false;
+                    device_ = device_id;
+                    valid_ = true;
+                    return true;
+                }
+
+                GPUDevice get_selected_device() const override { return device_info(device_); }
+                bool is_valid() const override { return valid_; }
+
+            private:
+                int device_ = 0;
+                bool valid_ = false;
+            };
+
+            // ---- Multiplier -----------------------------------------------------------------
+
+            // Twiddle tables of one transform length on the device
+            struct DevicePlan {
+                u64* tw[kNTTPrimes] = {};
+                u64* itw[kNTTPrimes] = {};
+            };
+
+            // One product in flight. Two slots alternate: while the device
+            // works on one, the host stages the next job into the other and
+            // recombines the one before.
+            struct Slot {
+                cudaStream_t stream = nullptr;
+                cudaEvent_t start = nullptr, copied = nullptr, computed = nullptr, done = nullptr;
+                std::size_t cap = 0;   // transform length the buffers hold
+                u64* h_in = nullptr;   // pinned: limbs of a, then of b
+                u64* h_out = nullptr;  // pinned: the product mod each prime, cap apart
+                u64* d_in = nullptr;
+                u64* d_fa = nullptr;   // kNTTPrimes transforms, cap apart
+                u64* d_fb = nullptr;
+
+                const GPUMultiplier::BatchProduct* job = nullptr;
+                std::shared_ptr<const NTTPlan> plan;
+                std::size_t len = 0, n = 0;
+                bool negative = false, square = false;
+            };
+
+            class CUDAMultiplier : public GPUMultiplier {
+            public:
+                CUDAMultiplier() {
+                    check(cudaGetDevice(&device_), "cudaGetDevice");
+                    name_ = "cuda: " + device_info(device_).name;
+                    for (Slot& s : slots_) {
+                        check(cudaStreamCreateWithFlags(&s.stream, cudaStreamNonBlocking), "cudaStreamCreate");
+                        for (cudaEvent_t* e : {&s.start, &s.copied, &s.computed, &s.done}) {
+                            check(cudaEventCreate(e), "cudaEventCreate");
+                        }
+                    }
+                }
+
+                ~CUDAMultiplier() override {
+                    for (Slot& s : slots_) {
+                        if (s.stream) cudaStreamSynchronize(s.stream);
+                        release_buffers(s);
+                        for (cudaEvent_t e : {s.start, s.copied, s.computed, s.done}) {
+                            if (e) cudaEventDestroy(e);
+                        }
+                        if (s.stream) cudaStreamDestroy(s.stream);
+                    }
+                    for (auto& entry : plans_) {
+                        for (int i = 0; i < kNTTPrimes; ++i) {
+                            cudaFree(entry.second.tw[i]);
+                            cudaFree(entry.second.itw[i]);
+                        }
+                    }
+                }
+
+                void multiply_products(const std::vector<BatchProduct>& jobs, ThreadPool* pool) override {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    const auto t0 = std::chrono::steady_clock::now();
+
+                    std::vector<const BatchProduct*> device, host;
+                    for (const BatchProduct& j : jobs) {
+                        const std::size_t m = std::min(mpz_size(j.a->get_mpz_t()), mpz_size(j.b->get_mpz_t()));
+                        (m >= kMinDeviceLimbs ? device : host).push_back(&j);
+                    }
+
+                    // Host products go to the pool first so they overlap the device;
+                    // without a pool they fill the gaps between submissions
+                    TaskGroup g(pool);
+                    std::size_t next_host = 0;
+                    if (pool) {
+                        for (; next_host < host.size(); ++next_host) {
+                            const BatchProduct* j = host[next_host];
+                            g.spawn([j, pool] { mul_big(*j->out, *j->a, *j->b, pool); });
+                        }
+                    }
+
+                    for (std::size_t i = 0; i < device.size(); ++i) {
+                        Slot& s = slots_[i % 2];
+                        if (s.job) finish(s);
+                        if (!submit(s, *device[i])) mul_big(*device[i]->out, *device[i]->a, *device[i]->b, pool);
+                        if (next_host < host.size()) {
+                            const BatchProduct* j = host[next_host++];
+                            mul_big(*j->out, *j->a, *j->b);
+                        }
+                    }
+                    for (Slot& s : slots_) {
+                        if (s.job) finish(s);
+                    }
+                    for (; next_host < host.size(); ++next_host) {
+                        const BatchProduct* j = host[next_host];
+                        mul_big(*j->out, *j->a, *j->b);
+                    }
+                    g.sync();
+
+                    last_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() /
+                               static_cast<double>(std::max<std::size_t>(jobs.size(), 1));
+                }
+
+                std::string backend_name() const override { return name_; }
+                double get_multiplication_time_ms() const override { return last_ms_; }
+                std::size_t get_memory_usage_mb() const override { return device_bytes_ / (1024 * 1024); }
+
+                void benchmark(std::size_t digit_count, int iterations) override {
+                    gmp_randclass rng(gmp_randinit_default);
+                    rng.seed(12345);
+                    const mp_bitcnt_t bits = static_cast<mp_bitcnt_t>(digit_count * 3.3219280948873626) + 1;
+                    const mpz_class a = rng.get_z_bits(bits), b = rng.get_z_bits(bits);
+                    std::vector<mpz_class> out(static_cast<std::size_t>(std::max(iterations, 1)));
+                    std::vector<BatchProduct> jobs;
+                    for (mpz_class& c : out) jobs.push_back({&a, &b, &c});
+                    multiply_products(jobs, nullptr);
+                }
+
+            private:
+                void release_buffers(Slot& s) {
+                    cudaFreeHost(s.h_in);
+                    cudaFreeHost(s.h_out);
+                    cudaFree(s.d_in);
+                    cudaFree(s.d_fa);
+                    cudaFree(s.d_fb);
+                    s.h_in = s.h_out = s.d_in = s.d_fa = s.d_fb = nullptr;
+                    device_bytes_ -= 8 * s.cap * sizeof(u64);
+                    s.cap = 0;
+                }
+
+                // Buffers for transforms of length n; false if the device is out of memory
+                bool reserve(Slot& s, std::size_t n) {
+                    if (s.cap >= n) return true;
+                    release_buffers(s);
+                    const std::size_t words = n * sizeof(u64);
+                    if (cudaMallocHost(&s.h_in, 2 * words) != cudaSuccess ||
+                        cudaMallocHost(&s.h_out, kNTTPrimes * words) != cudaSuccess ||
+                        cudaMalloc(&s.d_in, 2 * words) != cudaSuccess ||
+                        cudaMalloc(&s.d_fa, kNTTPrimes * words) != cudaSuccess ||
+                        cudaMalloc(&s.d_fb, kNTTPrimes * words) != cudaSuccess) {
+                        cudaGetLastError();  // clear the allocation error
+                        release_buffers(s);  // cap is 0: frees without accounting
+                        return false;
+                    }
+                    s.cap = n;
+                    device_bytes_ += 8 * words;
+                    gpu_stats_add({0.0, 0.0, 8 * words, 0});
+                    return true;
+                }
+
+                const DevicePlan* device_plan(const NTTPlan& plan) {
+                    auto it = plans_.find(plan.size);
+                    if (it != plans_.end()) return &it->second;
+                    DevicePlan d;
+                    const std::size_t bytes = std::max<std::size_t>(plan.size, 2) * sizeof(u64);
+                    for (int i = 0; i < kNTTPrimes; ++i) {
+                        if (cudaMalloc(&d.tw[i], bytes) != cudaSuccess || cudaMalloc(&d.itw[i], bytes) != cudaSuccess) {
+                            cudaGetLastError();
+                            for (int k = 0; k <= i; ++k) {
+                                cudaFree(d.tw[k]);
+                                cudaFree(d.itw[k]);
+                            }
+                            return nullptr;
+                        }
+                        check(cudaMemcpy(d.tw[i], plan.primes[i].roots_of_unity.data(), bytes, cudaMemcpyHostToDevice),
+                              "cudaMemcpy");
+                        check(cudaMemcpy(d.itw[i], plan.primes[i].inv_roots_of_unity.data(), bytes,
+                                         cudaMemcpyHostToDevice), "cudaMemcpy");
+                    }
+                    device_bytes_ += 2 * kNTTPrimes * bytes;
+                    return &plans_.emplace(plan.size, d).first->second;
+                }
+
+                // Stages `job` into `s` and queues its transfers and transforms;
+                // false if it does not fit on the device
+                bool submit(Slot& s, const BatchProduct& job) {
+                    mpz_srcptr a = job.a->get_mpz_t();
+                    mpz_srcptr b = job.b->get_mpz_t();
+                    const std::size_t la = mpz_size(a), lb = mpz_size(b);
+                    std::size_t n = 1;
+                    while (n < la + lb) n <<= 1;
+
+                    std::shared_ptr<const NTTPlan> plan = get_ntt_plan(n);
+                    const DevicePlan* dp = device_plan(*plan);
+                    if (!dp || !reserve(s, n)) return false;
+
+                    s.square = a == b;
+                    std::memcpy(s.h_in, mpz_limbs_read(a), la * sizeof(u64));
+                    if (!s.square) std::memcpy(s.h_in + la, mpz_limbs_read(b), lb * sizeof(u64));
+
+                    check(cudaEventRecord(s.start, s.stream), "cudaEventRecord");
+                    check(cudaMemcpyAsync(s.d_in, s.h_in, (s.square ? la : la + lb) * sizeof(u64),
+                                          cudaMemcpyHostToDevice, s.stream), "cudaMemcpyAsync");
+                    check(cudaEventRecord(s.copied, s.stream), "cudaEventRecord");
+
+                    const int nb = blocks_for(n), hb = blocks_for(n / 2);
+                    for (int i = 0; i < kNTTPrimes; ++i) {
+                        const NTTContext& ctx = plan->primes[i];
+                        const u64 p = ctx.modulus, inv = ctx.mont_inv;
+                        u64* fa = s.d_fa + i * s.cap;
+                        u64* fb = s.d_fb + i * s.cap;
+                        load_kernel<<<nb, kBlock, 0, s.stream>>>(fa, s.d_in, la, n, p);
+                        for (std::size_t h = n >> 1; h > 0; h >>= 1) {
+                            dif_kernel<<<hb, kBlock, 0, s.stream>>>(fa, n, h, dp->tw[i] + h, p, inv);
+                        }
+                        if (s.square) {
+                            pointwise_kernel<<<nb, kBlock, 0, s.stream>>>(fa, fa, n, p, inv);
+                        } else {
+                            load_kernel<<<nb, kBlock, 0, s.stream>>>(fb, s.d_in + la, lb, n, p);
+                            for (std::size_t h = n >> 1; h > 0; h >>= 1) {
+                                dif_kernel<<<hb, kBlock, 0, s.stream>>>(fb, n, h, dp->tw[i] + h, p, inv);
+                            }
+                            pointwise_kernel<<<nb, kBlock, 0, s.stream>>>(fa, fb, n, p, inv);
+                        }
+                        for (std::size_t h = 1; h < n; h <<= 1) {
+                            dit_kernel<<<hb, kBlock, 0, s.stream>>>(fa, n, h, dp->itw[i] + h, p, inv);
+                        }
+                        scale_kernel<<<nb, kBlock, 0, s.stream>>>(fa, n, ctx.product_scale, p, inv);
+                    }
+                    check(cudaGetLastError(), "kernel launch");
+                    check(cudaEventRecord(s.computed, s.stream), "cudaEventRecord");
+                    for (int i = 0; i < kNTTPrimes; ++i) {
+                        check(cudaMemcpyAsync(s.h_out + i * s.cap, s.d_fa + i * s.cap, (la + lb) * sizeof(u64),
+                                              cudaMemcpyDeviceToHost, s.stream), "cudaMemcpyAsync");
+                    }
+                    check(cudaEventRecord(s.done, s.stream), "cudaEventRecord");
+
+                    s.job = &job;
+                    s.plan = std::move(plan);
+                    s.len = la + lb;
+                    s.n = n;
+                    s.negative = (mpz_sgn(a) < 0) != (mpz_sgn(b) < 0);
+                    return true;
+                }
+
+                // Waits for the slot's product and recombines it on the host
+                void finish(Slot& s) {
+                    check(cudaEventSynchronize(s.done), "cudaEventSynchronize");
+                    const u64* r[kNTTPrimes];
+                    for (int i = 0; i < kNTTPrimes; ++i) r[i] = s.h_out + i * s.cap;
+                    crt_to_product(*s.job->out, s.len, r, s.plan->crt, s.negative);
+
+                    float up = 0, kernels = 0, down = 0;
+                    cudaEventElapsedTime(&up, s.start, s.copied);
+                    cudaEventElapsedTime(&kernels, s.copied, s.computed);
+                    cudaEventElapsedTime(&down, s.computed, s.done);
+                    std::size_t lg = 0;
+                    while ((std::size_t(1) << lg) < s.n) ++lg;
+                    const std::size_t transforms = s.square ? 2 : 3;
+                    gpu_stats_add({kernels, static_cast<double>(up) + down, 0,
+                                   kNTTPrimes * (transforms * (s.n / 2) * lg + s.n)});
+
+                    s.job = nullptr;
+                    s.plan.reset();
+                }
+
+                std::mutex mutex_;  // one batch at a time: the slots are shared
+                int device_ = 0;
+                std::string name_;
+                Slot slots_[2];
+                std::map<std::size_t, DevicePlan> plans_;
+                std::size_t device_bytes_ = 0;
+                double last_ms_ = 0.0;
+            };
+        } // namespace
+
+        int device_count() {
+            int n = 0;
+            if (cudaGetDeviceCount(&n) != cudaSuccess) {
+                cudaGetLastError();
+                return 0;
+            }
+            return n;
+        }
+
+        std::string describe() {
+            if (device_count() == 0) return "CUDA: no device";
+            int id = 0;
+            cudaGetDevice(&id);
+            const GPUDevice d = device_info(id);
+            return "CUDA: " + d.name + " (" + std::to_string(d.memory_mb) + " MiB, sm_" +
+                   std::to_string(d.compute_capability_major) + std::to_string(d.compute_capability_minor) + ")";
+        }
+
+        std::unique_ptr<GPUContext> make_context() {
+            auto ctx = std::make_unique<CUDAContext>();
+            if (!ctx->initialize()) return nullptr;
+            return ctx;
+        }
+
+        std::unique_ptr<GPUMultiplier> make_multiplier() {
+            return std::make_unique<CUDAMultiplier>();
+        }
+
+        void* device_alloc(std::size_t bytes) {
+            void* p = nullptr;
+            check(cudaMalloc(&p, bytes), "cudaMalloc");
+            gpu_stats_add({0.0, 0.0, bytes, 0});
+            return p;
+        }
+
+        void device_free(void* ptr) {
+            cudaFree(ptr);
+        }
+
+        void device_copy(void* dst, const void* src, std::size_t bytes, bool to_device) {
+            check(cudaMemcpy(dst, src, bytes, to_device ? cudaMemcpyHostToDevice : cudaMemcpyDeviceToHost), "cudaMemcpy");
+        }
+    } // namespace cuda_backend
+} // namespace piracer
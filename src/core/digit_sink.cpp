@@ -0,0 +1,151 @@
+#include "piracer/digit_sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+    namespace {
+        constexpr std::size_t kBufferAlign = 4096;
+
+#ifdef _WIN32
+        long sys_write(int fd, const char* data, std::size_t n) {
+            return _write(fd, data, static_cast<unsigned>(std::min<std::size_t>(n, 1u << 30)));
+        }
+        int sys_open(const std::string& path) {
+            return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+        }
+        int sys_close(int fd) { return _close(fd); }
+#else
+        long sys_write(int fd, const char* data, std::size_t n) {
+            return static_cast<long>(::write(fd, data, n));
+        }
+        int sys_open(const std::string& path) {
+            return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        int sys_close(int fd) { return ::close(fd); }
+#endif
+    } // namespace
+
+    void FdSink::AlignedFree::operator()(char* p) const {
+        ::operator delete(p, std::align_val_t(kBufferAlign));
+    }
+
+    FdSink::FdSink(int fd, bool owns, std::size_t buffer_bytes)
+        : fd_(fd), owns_(owns),
+          capacity_(std::max<std::size_t>(kBufferAlign, buffer_bytes / kBufferAlign * kBufferAlign)) {
+        buffer_.reset(static_cast<char*>(::operator new(capacity_, std::align_val_t(kBufferAlign))));
+    }
+
+    FdSink::~FdSink() {
+        // Errors can only be reported through finish(); this is best effort
+        try {
+            drain();
+        } catch (...) {
+        }
+        if (owns_) sys_close(fd_);
+    }
+
+    std::unique_ptr<FdSink> FdSink::open_file(const std::string& path, std::size_t buffer_bytes) {
+        const int fd = sys_open(path);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open output file: " + path + ": " + std::strerror(errno));
+        }
+        return std::make_unique<FdSink>(fd, true, buffer_bytes);
+    }
+
+    void FdSink::write(const char* data, std::size_t n) {
+        // Large blocks bypass the buffer once it is empty: no extra copy
+        while (n > 0) {
+            if (used_ == 0 && n >= capacity_) {
+                const std::size_t whole = n / capacity_ * capacity_;
+                write_all(data, whole);
+                data += whole;
+                n -= whole;
+                continue;
+            }
+            const std::size_t take = std::min(n, capacity_ - used_);
+            std::memcpy(buffer_.get() + used_, data, take);
+            used_ += take;
+            data += take;
+            n -= take;
+            if (used_ == capacity_) drain();
+        }
+    }
+
+    void FdSink::finish() {
+        drain();
+    }
+
+    void FdSink::drain() {
+        if (used_ == 0) return;
+        const std::size_t n = used_;
+        used_ = 0;
+        write_all(buffer_.get(), n);
+    }
+
+    void FdSink::write_all(const char* data, std::size_t n) {
+        while (n > 0) {
+            const long w = sys_write(fd_, data, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+            }
+            data += w;
+            n -= static_cast<std::size_t>(w);
+            total_ += static_cast<std::size_t>(w);
+        }
+    }
+
+    ChunkedFileSink::ChunkedFileSink(std::string path, std::size_t digits_per_file, std::size_t buffer_bytes)
+        : path_(std::move(path)), per_file_(digits_per_file), buffer_bytes_(buffer_bytes) {
+        if (per_file_ == 0) throw std::invalid_argument("ChunkedFileSink: digits per file must be > 0");
+    }
+
+    std::string ChunkedFileSink::chunk_name(const std::string& path, std::size_t index) {
+        const std::size_t slash = path.find_last_of("/\\");
+        const std::size_t dot = path.find_last_of('.');
+        const bool has_ext = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+        const std::string stem = has_ext ? path.substr(0, dot) : path;
+        const std::string ext = has_ext ? path.substr(dot) : std::string(".txt");
+        return stem + " - " + std::to_string(index) + ext;
+    }
+
+    void ChunkedFileSink::next_file() {
+        if (current_) current_->finish();
+        current_ = FdSink::open_file(chunk_name(path_, index_++), buffer_bytes_);
+        in_file_ = 0;
+    }
+
+    void ChunkedFileSink::write(const char* data, std::size_t n) {
+        while (n > 0) {
+            if (!current_ || in_file_ == per_file_) next_file();
+            const std::size_t take = std::min(n, per_file_ - in_file_);
+            current_->write(data, take);
+            in_file_ += take;
+            data += take;
+            n -= take;
+        }
+    }
+
+    void ChunkedFileSink::write_text(const char* data, std::size_t n) {
+        if (!current_) next_file();
+        current_->write(data, n);
+    }
+
+    void ChunkedFileSink::finish() {
+        if (current_) current_->finish();
+    }
+
+} // namespace piracer
@@ -0,0 +1,443 @@
+#include "piracer/disk_int.hpp"
+#include "piracer/bigmul.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+    namespace {
+        [[noreturn]] void io_error(const std::string& what, const std::string& path) {
+            throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+        }
+    } // namespace
+
+    // ---- Scratch files ----------------------------------------------------------
+
+    struct DiskInt::File {
+        std::string path;
+        int fd = -1;
+#ifdef _WIN32
+        std::mutex mutex;  // seek + read/write pairs
+#endif
+
+        explicit File(std::string p) : path(std::move(p)) {
+#ifdef _WIN32
+            fd = ::_open(path.c_str(), _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY, 0600);
+#else
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+#endif
+            if (fd < 0) io_error("cannot create scratch file", path);
+        }
+
+        ~File() {
+#ifdef _WIN32
+            ::_close(fd);
+#else
+            ::close(fd);
+#endif
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+
+        void read(void* data, std::size_t bytes, std::uint64_t offset) {
+            auto* p = static_cast<char*>(data);
+#ifdef _WIN32
+            std::lock_guard<std::mutex> lock(mutex);
+            if (::_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) io_error("cannot seek", path);
+#endif
+            while (bytes > 0) {
+                const std::size_t step = std::min<std::size_t>(bytes, std::size_t(1) << 30);
+#ifdef _WIN32
+                const long r = ::_read(fd, p, static_cast<unsigned>(step));
+#else
+                const long r = static_cast<long>(::pread(fd, p, step, static_cast<off_t>(offset)));
+#endif
+                if (r < 0 && errno == EINTR) continue;
+                if (r <= 0) io_error("cannot read scratch file", path);
+                p += r;
+                offset += static_cast<std::uint64_t>(r);
+                bytes -= static_cast<std::size_t>(r);
+            }
+        }
+
+        void write(const void* data, std::size_t bytes, std::uint64_t offset) {
+            const auto* p = static_cast<const char*>(data);
+#ifdef _WIN32
+            std::lock_guard<std::mutex> lock(mutex);
+            if (::_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) io_error("cannot seek", path);
+#endif
+            while (bytes > 0) {
+                const std::size_t step = std::min<std::size_t>(bytes, std::size_t(1) << 30);
+#ifdef _WIN32
+                const long w = ::_write(fd, p, static_cast<unsigned>(step));
+#else
+                const long w = static_cast<long>(::pwrite(fd, p, step, static_cast<off_t>(offset)));
+#endif
+                if (w < 0 && errno == EINTR) continue;
+                if (w <= 0) io_error("cannot write scratch file", path);
+                p += w;
+                offset += static_cast<std::uint64_t>(w);
+                bytes -= static_cast<std::size_t>(w);
+            }
+        }
+
+        void truncate(std::uint64_t bytes) {
+#ifdef _WIN32
+            const int rc = ::_chsize_s(fd, static_cast<__int64>(bytes));
+#else
+            const int rc = ::ftruncate(fd, static_cast<off_t>(bytes));
+#endif
+            if (rc != 0) io_error("cannot truncate scratch file", path);
+        }
+    };
+
+    ScratchSpace::ScratchSpace(std::string dir) : dir_(std::move(dir)) {
+        std::error_code ec;
+        if (!std::filesystem::exists(dir_, ec)) {
+            created_ = std::filesystem::create_directories(dir_, ec);
+            if (ec) throw std::runtime_error("cannot create scratch directory " + dir_ + ": " + ec.message());
+        } else if (!std::filesystem::is_directory(dir_, ec)) {
+            throw std::runtime_error("scratch path is not a directory: " + dir_);
+        }
+    }
+
+    ScratchSpace::~ScratchSpace() {
+        if (!created_) return;
+        std::error_code ec;
+        std::filesystem::remove(dir_, ec);  // only succeeds once empty
+    }
+
+    std::string ScratchSpace::new_path() {
+        const auto stem = "piracer-" + std::to_string(static_cast<unsigned long long>(
+#ifdef _WIN32
+            ::GetCurrentProcessId()
+#else
+            ::getpid()
+#endif
+            ));
+        return (std::filesystem::path(dir_) / (stem + "-" + std::to_string(next_id_++) + ".limbs")).string();
+    }
+
+    void ScratchSpace::add_bytes(std::size_t n) {
+        bytes_ += n;
+        peak_bytes_ = std::max(peak_bytes_, bytes_);
+    }
+
+    void ScratchSpace::sub_bytes(std::size_t n) {
+        bytes_ -= std::min(bytes_, n);
+    }
+
+    // ---- DiskInt ----------------------------------------------------------------
+
+    DiskInt::DiskInt() = default;
+
+    DiskInt::~DiskInt() {
+        reset();
+    }
+
+    DiskInt::DiskInt(DiskInt&& other) noexcept
+        : space_(other.space_), file_(std::move(other.file_)), limbs_(other.limbs_), negative_(other.negative_) {
+        other.limbs_ = 0;
+        other.negative_ = false;
+    }
+
+    DiskInt& DiskInt::operator=(DiskInt&& other) noexcept {
+        if (this != &other) {
+            reset();
+            space_ = other.space_;
+            file_ = std::move(other.file_);
+            limbs_ = other.limbs_;
+            negative_ = other.negative_;
+            other.limbs_ = 0;
+            other.negative_ = false;
+        }
+        return *this;
+    }
+
+    void DiskInt::reset() {
+        if (file_ && space_) space_->sub_bytes(bytes());
+        file_.reset();
+        limbs_ = 0;
+        negative_ = false;
+    }
+
+    DiskInt DiskInt::spill(ScratchSpace& space, mpz_class& x) {
+        // One large write: the page cache already defers it, and x can go
+        // as soon as the data is copied
+        DiskInt d;
+        const std::size_t n = mpz_size(x.get_mpz_t());
+        if (n > 0) {
+            d.space_ = &space;
+            d.file_ = std::make_unique<File>(space.new_path());
+            d.file_->write(mpz_limbs_read(x.get_mpz_t()), n * sizeof(mp_limb_t), 0);
+            d.limbs_ = n;
+            d.negative_ = mpz_sgn(x.get_mpz_t()) < 0;
+            space.add_bytes(d.bytes());
+        }
+        mpz_class().swap(x);
+        return d;
+    }
+
+    void DiskInt::load(mpz_class& x) const {
+        if (limbs_ == 0) {
+            x = 0;
+            return;
+        }
+        mp_limb_t* p = mpz_limbs_write(x.get_mpz_t(), static_cast<mp_size_t>(limbs_));
+        file_->read(p, bytes(), 0);
+        const auto n = static_cast<mp_size_t>(limbs_);
+        mpz_limbs_finish(x.get_mpz_t(), negative_ ? -n : n);
+    }
+
+    // ---- Block streams ----------------------------------------------------------
+
+    // Magnitude blocks of `block` limbs. get(i) returns block i (the last
+    // may be shorter), valid until the next get(); prefetch(i) starts
+    // reading block i in the background.
+    class DiskIntReader {
+    public:
+        DiskIntReader(const DiskInt& x, std::size_t block) : x_(x), block_(block) {}
+
+        ~DiskIntReader() {
+            if (pending_.valid()) pending_.wait();
+        }
+
+        std::size_t blocks() const { return (x_.limbs_ + block_ - 1) / block_; }
+
+        const mpz_class& get(std::size_t i) {
+            if (pending_.valid() && next_index_ == i) {
+                pending_.get();
+                std::swap(cur_, next_);
+                cur_index_ = i;
+                next_index_ = kNone;
+            } else if (cur_index_ != i) {
+                read(cur_, i);
+                cur_index_ = i;
+            }
+            return cur_;
+        }
+
+        void prefetch(std::size_t i) {
+            if (i >= blocks() || i == cur_index_ || i == next_index_) return;
+            if (pending_.valid()) pending_.get();  // the spare buffer is in use
+            next_index_ = i;
+            pending_ = std::async(std::launch::async, [this, i] { read(next_, i); });
+        }
+
+    private:
+        static constexpr std::size_t kNone = ~std::size_t(0);
+
+        const DiskInt& x_;
+        std::size_t block_;
+        mpz_class cur_, next_;
+        std::size_t cur_index_ = kNone, next_index_ = kNone;
+        std::future<void> pending_;
+
+        void read(mpz_class& out, std::size_t i) const {
+            if (i >= blocks()) {
+                out = 0;
+                return;
+            }
+            const std::size_t begin = i * block_;
+            const auto n = static_cast<mp_size_t>(std::min(block_, x_.limbs_ - begin));
+            mp_limb_t* p = mpz_limbs_write(out.get_mpz_t(), n);
+            x_.file_->read(p, static_cast<std::size_t>(n) * sizeof(mp_limb_t),
+                           static_cast<std::uint64_t>(begin) * sizeof(mp_limb_t));
+            mpz_limbs_finish(out.get_mpz_t(), n);  // normalizes high zero limbs
+        }
+    };
+
+    // Sequential writer with one block in flight: append() copies the block
+    // into the free buffer and queues it, so the caller keeps computing
+    // while the previous block reaches the disk
+    class DiskIntWriter {
+    public:
+        explicit DiskIntWriter(ScratchSpace& space) : space_(space) {
+            out_.space_ = &space;
+            out_.file_ = std::make_unique<DiskInt::File>(space.new_path());
+        }
+
+        ~DiskIntWriter() {
+            if (pending_.valid()) pending_.wait();
+        }
+
+        // Low n limbs of |v|, zero padded
+        void append(const mpz_class& v, std::size_t n) {
+            if (n == 0) return;
+            AlignedWords& buf = buffers_[cur_];
+            buf.assign(n, 0);
+            const std::size_t have = std::min(n, mpz_size(v.get_mpz_t()));
+            if (have > 0) {
+                std::memcpy(buf.data(), mpz_limbs_read(v.get_mpz_t()), have * sizeof(mp_limb_t));
+                for (std::size_t k = have; k-- > 0;) {
+                    if (buf[k] != 0) {
+                        top_ = pos_ + k + 1;
+                        break;
+                    }
+                }
+            }
+
+            if (pending_.valid()) pending_.get();
+            const std::uint64_t offset = static_cast<std::uint64_t>(pos_) * sizeof(mp_limb_t);
+            DiskInt::File* file = out_.file_.get();
+            pending_ = std::async(std::launch::async, [file, &buf, offset] {
+                file->write(buf.data(), buf.size() * sizeof(mp_limb_t), offset);
+            });
+            cur_ ^= 1;
+            pos_ += n;
+        }
+
+        DiskInt finish(bool negative) {
+            if (pending_.valid()) pending_.get();
+            if (top_ < pos_) out_.file_->truncate(static_cast<std::uint64_t>(top_) * sizeof(mp_limb_t));
+            out_.limbs_ = top_;
+            out_.negative_ = negative && top_ > 0;
+            if (top_ == 0) out_.file_.reset();
+            space_.add_bytes(out_.bytes());
+            return std::move(out_);
+        }
+
+    private:
+        ScratchSpace& space_;
+        DiskInt out_;
+        AlignedWords buffers_[2];
+        int cur_ = 0;
+        std::size_t pos_ = 0;  // limbs queued
+        std::size_t top_ = 0;  // limbs up to the highest nonzero one
+        std::future<void> pending_;
+    };
+
+    // ---- Streamed arithmetic ----------------------------------------------------
+
+    std::size_t disk_block_limbs(std::size_t memory_bytes) {
+        return std::max<std::size_t>(std::size_t(1) << 12, memory_bytes / (56 * sizeof(mp_limb_t)));
+    }
+
+    DiskInt disk_mul(const DiskInt& a, const DiskInt& b, const DiskMath& m) {
+        if (a.limbs() == 0 || b.limbs() == 0) return DiskInt();
+
+        const std::size_t s = m.block_limbs;
+        DiskIntReader ra(a, s), rb(b, s);
+        const std::size_t ba = ra.blocks(), bb = rb.blocks();
+        DiskIntWriter w(*m.space);
+
+        mpz_class acc, prod;
+        for (std::size_t k = 0; k + 1 < ba + bb; ++k) {
+            const std::size_t lo = k >= bb ? k - bb + 1 : 0;
+            const std::size_t hi = std::min(k, ba - 1);
+            for (std::size_t i = lo; i <= hi; ++i) {
+                const mpz_class& x = ra.get(i);
+                const mpz_class& y = rb.get(k - i);
+
+                // Read the next pair while this one is multiplied
+                if (i < hi) {
+                    ra.prefetch(i + 1);
+                    rb.prefetch(k - i - 1);
+                } else if (k + 2 < ba + bb) {
+                    const std::size_t nlo = k + 1 >= bb ? k + 2 - bb : 0;
+                    ra.prefetch(nlo);
+                    rb.prefetch(k + 1 - nlo);
+                }
+
+                mul_big(prod, x, y, m.pool);
+                acc += prod;
+            }
+            // No later product reaches below block k + 1
+            w.append(acc, s);
+            mpz_tdiv_q_2exp(acc.get_mpz_t(), acc.get_mpz_t(), static_cast<mp_bitcnt_t>(s) * GMP_NUMB_BITS);
+        }
+        w.append(acc, mpz_size(acc.get_mpz_t()));
+        return w.finish((a.sign() < 0) != (b.sign() < 0));
+    }
+
+    namespace {
+        // Sign of |a| - |b|, reading both from the top block down
+        int compare_magnitude(const DiskInt& a, const DiskInt& b, std::size_t s) {
+            if (a.limbs() != b.limbs()) return a.limbs() < b.limbs() ? -1 : 1;
+            DiskIntReader ra(a, s), rb(b, s);
+            for (std::size_t i = ra.blocks(); i-- > 0;) {
+                if (i > 0) {
+                    ra.prefetch(i - 1);
+                    rb.prefetch(i - 1);
+                }
+                const int c = mpz_cmp(ra.get(i).get_mpz_t(), rb.get(i).get_mpz_t());
+                if (c != 0) return c < 0 ? -1 : 1;
+            }
+            return 0;
+        }
+    } // namespace
+
+    DiskInt disk_add(const DiskInt& a, const DiskInt& b, const DiskMath& m) {
+        const std::size_t s = m.block_limbs;
+        const bool subtract = a.sign() * b.sign() < 0;
+
+        // For a difference, stream the larger magnitude minus the smaller
+        const DiskInt* x = &a;
+        const DiskInt* y = &b;
+        if (subtract) {
+            const int c = compare_magnitude(a, b, s);
+            if (c == 0) return DiskInt();
+            if (c < 0) std::swap(x, y);
+        } else if (x->sign() == 0) {
+            std::swap(x, y);  // the result takes the sign of the nonzero one
+        }
+
+        DiskIntReader rx(*x, s), ry(*y, s);
+        const std::size_t blocks = std::max(rx.blocks(), ry.blocks());
+        DiskIntWriter w(*m.space);
+        mpz_class acc, wrap;  // wrap = 2^(bits per block)
+        mpz_setbit(wrap.get_mpz_t(), static_cast<mp_bitcnt_t>(s) * GMP_NUMB_BITS);
+
+        int carry = 0;  // carry of a sum, borrow of a difference
+        for (std::size_t i = 0; i < blocks; ++i) {
+            rx.prefetch(i + 1);
+            ry.prefetch(i + 1);
+            if (subtract) {
+                mpz_sub(acc.get_mpz_t(), rx.get(i).get_mpz_t(), ry.get(i).get_mpz_t());
+                if (carry) mpz_sub_ui(acc.get_mpz_t(), acc.get_mpz_t(), 1);
+                carry = mpz_sgn(acc.get_mpz_t()) < 0;
+                if (carry) acc += wrap;
+            } else {
+                mpz_add(acc.get_mpz_t(), rx.get(i).get_mpz_t(), ry.get(i).get_mpz_t());
+                if (carry) mpz_add_ui(acc.get_mpz_t(), acc.get_mpz_t(), 1);
+                carry = mpz_cmp(acc.get_mpz_t(), wrap.get_mpz_t()) >= 0;
+                if (carry) acc -= wrap;
+            }
+            w.append(acc, s);
+        }
+        if (carry && !subtract) w.append(mpz_class(1), 1);
+        return w.finish(x->sign() < 0);
+    }
+
+    std::size_t physical_memory_bytes() {
+#ifdef _WIN32
+        MEMORYSTATUSEX status;
+        status.dwLength = sizeof(status);
+        return GlobalMemoryStatusEx(&status) ? static_cast<std::size_t>(status.ullTotalPhys) : 0;
+#elif defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+        const long pages = ::sysconf(_SC_PHYS_PAGES), page = ::sysconf(_SC_PAGESIZE);
+        return pages > 0 && page > 0 ? static_cast<std::size_t>(pages) * static_cast<std::size_t>(page) : 0;
+#else
+        return 0;
+#endif
+    }
+} // namespace piracer
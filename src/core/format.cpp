@@ -1,92 +1,148 @@
 #include "piracer/format.hpp"
-#include <algorithm>
-#include <cstring>
+#include "piracer/bigmul.hpp"
+#include "piracer/digit_sink.hpp"
+#include "piracer/profiler.hpp"
+#include "piracer/radix.hpp"
+
+#include <gmpxx.h>
 #include <stdexcept>
 
 namespace piracer {
-    std::string mpfr_to_fixed_decimal(const mpfr_t v, std::size_t digits) {
-        mp_exp_t expo;
-        // Request a couple guard digits; MPFR will round correctly at given precision.
-        char* buf = mpfr_get_str(nullptr, &expo, 10, digits + 2, v, MPFR_RNDN);
-        if (!buf) throw std::runtime_error("mpfr_get_str failed");
-
-        std::string out;
-        const bool neg = (buf[0] == '-');
-        char* mant = buf + (neg ? 1 : 0);
-
-        if (neg) out.push_back('-');
-
-        if (expo <= 0) {
-            out += "0.";
-            out.append(static_cast<std::size_t>(-expo), '0');
-            out += mant;
-        } else {
-            std::size_t len = std::strlen(mant);
-            if ((mp_exp_t)len <= expo) {
-                out.append(mant, mant + len);
-                out.append(static_cast<std::size_t>(expo - len), '0');
-                out += ".";
-            } else {
-                out.append(mant, mant + expo);
-                out += ".";
-                out.append(mant + expo, mant + std::min(len, (std::size_t)(expo + (mp_exp_t)digits)));
+    namespace {
+        // |v| = integer + fraction / 2^shift, split exactly from v = m * 2^e
+        struct FixedParts {
+            bool negative = false;
+            mpz_class integer;
+            mpz_class fraction;
+            std::size_t shift = 0;
+        };
+
+        FixedParts split_fixed(const mpfr_t v) {
+            if (!mpfr_number_p(v)) throw std::invalid_argument("cannot format NaN or infinity");
+
+            FixedParts parts;
+            if (mpfr_zero_p(v)) return parts;
+
+            mpz_class m;
+            const mpfr_exp_t e = mpfr_get_z_2exp(m.get_mpz_t(), v);
+            parts.negative = m < 0;
+            if (parts.negative) m = -m;
+
+            if (e >= 0) {
+                mpz_mul_2exp(parts.integer.get_mpz_t(), m.get_mpz_t(), static_cast<mp_bitcnt_t>(e));
+                return parts;
             }
+            parts.shift = static_cast<std::size_t>(-e);
+            mpz_fdiv_q_2exp(parts.integer.get_mpz_t(), m.get_mpz_t(), parts.shift);
+            mpz_fdiv_r_2exp(parts.fraction.get_mpz_t(), m.get_mpz_t(), parts.shift);
+            return parts;
         }
 
-        // Enforce exactly `digits` decimals
-        auto pos = out.find('.');
-        if (pos == std::string::npos) {
-            out += ".";
-            pos = out.size() - 1;
-        }
-        std::size_t have = out.size() - pos - 1;
-        if (have < digits) out.append(digits - have, '0');
-        if (have > digits) out.erase(pos + 1 + digits);
+        // |v| as its integer part plus the fraction in the low `shift` bits of
+        // the mantissa limbs, which are read in place rather than copied
+        struct HexParts {
+            FixedParts head;  // sign and integer part only
+            const mp_limb_t* limbs = nullptr;
+            std::size_t nlimbs = 0;
+        };
 
-        mpfr_free_str(buf);
-        return out;
-    }
+        HexParts split_hex(const mpfr_t v) {
+            if (!mpfr_number_p(v)) throw std::invalid_argument("cannot format NaN or infinity");
 
-    std::string mpfr_to_fixed_hex(const mpfr_t v, std::size_t digits) {
-        mp_exp_t expo;
-        // Request a couple guard digits; MPFR will round correctly at given precision.
-        char* buf = mpfr_get_str(nullptr, &expo, 16, digits + 2, v, MPFR_RNDN);
-        if (!buf) throw std::runtime_error("mpfr_get_str failed");
-
-        std::string out;
-        const bool neg = (buf[0] == '-');
-        char* mant = buf + (neg ? 1 : 0);
-
-        if (neg) out.push_back('-');
-
-        if (expo <= 0) {
-            out += "0x0.";
-            out.append(static_cast<std::size_t>(-expo), '0');
-            out += mant;
-        } else {
-            std::size_t len = std::strlen(mant);
-            if ((mp_exp_t)len <= expo) {
-                out.append(mant, mant + len);
-                out.append(static_cast<std::size_t>(expo - len), '0');
-                out += ".";
+            HexParts parts;
+            if (mpfr_zero_p(v)) return parts;
+            parts.head.negative = mpfr_sgn(v) < 0;
+            mpfr_get_z(parts.head.integer.get_mpz_t(), v, MPFR_RNDZ);
+            mpz_abs(parts.head.integer.get_mpz_t(), parts.head.integer.get_mpz_t());
+
+            // |v| = M * 2^(e - nlimbs * GMP_NUMB_BITS) for the mantissa M
+            const std::size_t nlimbs =
+                (static_cast<std::size_t>(mpfr_get_prec(v)) + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+            const long shift = static_cast<long>(nlimbs * GMP_NUMB_BITS) - static_cast<long>(mpfr_get_exp(v));
+            if (shift <= 0) return parts;  // an integer: every fraction digit is 0
+            parts.limbs = static_cast<const mp_limb_t*>(mpfr_custom_get_significand(v));
+            parts.nlimbs = nlimbs;
+            parts.head.shift = static_cast<std::size_t>(shift);
+            return parts;
+        }
+
+        // Sign, integer part and point: "-3." / "0x0."
+        std::string fixed_prefix(const FixedParts& parts, int base) {
+            std::string out = parts.negative ? "-" : "";
+            if (base == 10) {
+                out += mpz_to_decimal_string(parts.integer);
+            } else if (parts.integer == 0) {
+                out += "0x0";  // values below one carry the prefix, as mpfr_get_str-based output did
             } else {
-                out.append(mant, mant + expo);
-                out += ".";
-                out.append(mant + expo, mant + std::min(len, (std::size_t)(expo + (mp_exp_t)digits)));
+                const std::size_t pos = out.size();
+                out.resize(pos + mpz_sizeinbase(parts.integer.get_mpz_t(), 16));
+                mpz_to_hex(&out[pos], out.size() - pos, parts.integer);
             }
+            out.push_back('.');
+            return out;
         }
+    } // namespace
 
-        // Enforce exactly `digits` hex digits after decimal point
-        auto pos = out.find('.');
-        if (pos == std::string::npos) {
-            out += ".";
-            pos = out.size() - 1;
-        }
-        std::size_t have = out.size() - pos - 1;
-        if (have < digits) out.append(digits - have, '0');
-        if (have > digits) out.erase(pos + 1 + digits);
+    std::string mpfr_to_fixed_decimal(const mpfr_t v, std::size_t digits, ThreadPool* pool) {
+        PIRACER_PROFILE_SCOPE("radix.decimal");
+        const FixedParts parts = split_fixed(v);
+
+        // The fraction digits are written straight into the rest of the buffer
+        std::string out = fixed_prefix(parts, 10);
+        const std::size_t pos = out.size();
+        out.resize(pos + digits);
+        fraction_to_decimal(&out[pos], digits, parts.fraction, parts.shift, pool);
+        return out;
+    }
+
+    std::string mpfr_to_fixed_hex(const mpfr_t v, std::size_t digits, ThreadPool* pool) {
+        PIRACER_PROFILE_SCOPE("radix.hex");
+        const HexParts parts = split_hex(v);
+
+        std::string out = fixed_prefix(parts.head, 16);
+        const std::size_t pos = out.size();
+        out.resize(pos + digits);
+        fraction_to_hex(&out[pos], digits, parts.limbs, parts.nlimbs, parts.head.shift, pool);
+        return out;
+    }
+
+    std::string mpfr_hex_digits_at(const mpfr_t v, std::size_t position, std::size_t count) {
+        const HexParts parts = split_hex(v);
+        std::string out(count, '0');
+        if (parts.limbs == nullptr || 4 * position >= parts.head.shift) return out;
+        // Digit `position` of r / 2^s is digit 0 of the low s - 4 position bits
+        fraction_to_hex(&out[0], count, parts.limbs, parts.nlimbs, parts.head.shift - 4 * position);
+        return out;
+    }
 
-        mpfr_free_str(buf);
+    std::string mpfr_decimal_digits_at(const mpfr_t v, std::size_t position, std::size_t count, ThreadPool* pool) {
+        PIRACER_PROFILE_SCOPE("radix.decimal");
+        FixedParts parts = split_fixed(v);
+        std::string out(count, '0');
+        if (parts.shift == 0 || count == 0) return out;
+        if (position > 0) {
+            mpz_class scale;
+            mpz_ui_pow_ui(scale.get_mpz_t(), 10, position);
+            mul_big(parts.fraction, parts.fraction, scale, pool);
+            mpz_fdiv_r_2exp(parts.fraction.get_mpz_t(), parts.fraction.get_mpz_t(), parts.shift);
+        }
+        fraction_to_decimal(&out[0], count, parts.fraction, parts.shift, pool);
         return out;
     }
+
+    void write_fixed_decimal(DigitSink& sink, const mpfr_t v, std::size_t digits, ThreadPool* pool) {
+        PIRACER_PROFILE_SCOPE("radix.decimal");
+        const FixedParts parts = split_fixed(v);
+        const std::string prefix = fixed_prefix(parts, 10);
+        sink.write_text(prefix.data(), prefix.size());
+        fraction_to_decimal(sink, digits, parts.fraction, parts.shift, pool);
+    }
+
+    void write_fixed_hex(DigitSink& sink, const mpfr_t v, std::size_t digits, ThreadPool* pool) {
+        PIRACER_PROFILE_SCOPE("radix.hex");
+        const HexParts parts = split_hex(v);
+        const std::string prefix = fixed_prefix(parts.head, 16);
+        sink.write_text(prefix.data(), prefix.size());
+        fraction_to_hex(sink, digits, parts.limbs, parts.nlimbs, parts.head.shift, pool);
+    }
 } // namespace piracer
@@ -0,0 +1,276 @@
+#include "piracer/gpu_backend.hpp"
+#include "piracer/bigmul.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+namespace piracer {
+
+#if PIRACER_HAVE_CUDA
+    // Defined in cuda_ntt.cu
+    namespace cuda_backend {
+        int device_count();
+        std::string describe();
+        std::unique_ptr<GPUContext> make_context();
+        std::unique_ptr<GPUMultiplier> make_multiplier();
+        void* device_alloc(std::size_t bytes);
+        void device_free(void* ptr);
+        void device_copy(void* dst, const void* src, std::size_t bytes, bool to_device);
+    } // namespace cuda_backend
+#endif
+
+    namespace {
+        std::mutex g_stats_mutex;
+        GPUStats g_stats;
+
+        mpz_class from_bytes(const std::vector<uint8_t>& v) {
+            mpz_class z;
+            if (!v.empty()) mpz_import(z.get_mpz_t(), v.size(), -1, 1, 0, 0, v.data());
+            return z;
+        }
+
+        std::vector<uint8_t> to_bytes(const mpz_class& z) {
+            std::vector<uint8_t> v((mpz_sizeinbase(z.get_mpz_t(), 2) + 7) / 8);
+            std::size_t count = 0;
+            if (mpz_sgn(z.get_mpz_t()) != 0) mpz_export(v.data(), &count, -1, 1, 0, 0, z.get_mpz_t());
+            v.resize(count);
+            return v;
+        }
+
+        bool cuda_device_present() {
+#if PIRACER_HAVE_CUDA
+            return cuda_backend::device_count() > 0;
+#else
+            return false;
+#endif
+        }
+
+        // mul_big for every product, spread over the pool
+        class CPUMultiplier : public GPUMultiplier {
+        public:
+            void multiply_products(const std::vector<BatchProduct>& jobs, ThreadPool* pool) override {
+                const auto t0 = std::chrono::steady_clock::now();
+                {
+                    TaskGroup g(jobs.size() > 1 ? pool : nullptr);
+                    for (const BatchProduct& j : jobs) g.spawn([&j, pool] { mul_big(*j.out, *j.a, *j.b, pool); });
+                    g.sync();
+                }
+                last_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() /
+                           static_cast<double>(std::max<std::size_t>(jobs.size(), 1));
+            }
+
+            std::string backend_name() const override { return "cpu"; }
+            double get_multiplication_time_ms() const override { return last_ms_; }
+            std::size_t get_memory_usage_mb() const override { return 0; }
+
+            void benchmark(std::size_t digit_count, int iterations) override {
+                gmp_randclass rng(gmp_randinit_default);
+                rng.seed(12345);
+                const mp_bitcnt_t bits = static_cast<mp_bitcnt_t>(digit_count * 3.3219280948873626) + 1;
+                const mpz_class a = rng.get_z_bits(bits), b = rng.get_z_bits(bits);
+                mpz_class c;
+                const auto t0 = std::chrono::steady_clock::now();
+                for (int i = 0; i < iterations; ++i) mul_big(c, a, b);
+                last_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() /
+                           std::max(iterations, 1);
+            }
+
+        private:
+            double last_ms_ = 0.0;
+        };
+    } // namespace
+
+    // ---- GPUMultiplier byte interface --------------------------------------------
+
+    std::vector<uint8_t> GPUMultiplier::multiply(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+        const mpz_class x = from_bytes(a), y = from_bytes(b);
+        mpz_class z;
+        multiply_products(std::vector<BatchProduct>{{&x, &y, &z}});
+        return to_bytes(z);
+    }
+
+    std::vector<std::vector<uint8_t>> GPUMultiplier::multiply_batch(
+        const std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>>& pairs) {
+        std::vector<mpz_class> in(2 * pairs.size()), out(pairs.size());
+        std::vector<BatchProduct> jobs;
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            in[2 * i] = from_bytes(pairs[i].first);
+            in[2 * i + 1] = from_bytes(pairs[i].second);
+            jobs.push_back({&in[2 * i], &in[2 * i + 1], &out[i]});
+        }
+        multiply_products(jobs);
+        std::vector<std::vector<uint8_t>> result;
+        result.reserve(out.size());
+        for (const mpz_class& z : out) result.push_back(to_bytes(z));
+        return result;
+    }
+
+    // ---- Factory ------------------------------------------------------------------
+
+    std::unique_ptr<GPUContext> GPUBackendFactory::create_context(GPUBackend backend) {
+        if ((backend == GPUBackend::CUDA || backend == GPUBackend::Auto) && cuda_device_present()) {
+#if PIRACER_HAVE_CUDA
+            return cuda_backend::make_context();
+#endif
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<GPUMultiplier> GPUBackendFactory::create_multiplier(GPUBackend backend) {
+        switch (backend) {
+            case GPUBackend::Auto:
+#if PIRACER_HAVE_CUDA
+                if (cuda_device_present()) return cuda_backend::make_multiplier();
+#endif
+                return std::make_unique<CPUMultiplier>();
+            case GPUBackend::CPU:
+                return std::make_unique<CPUMultiplier>();
+            case GPUBackend::CUDA:
+#if PIRACER_HAVE_CUDA
+                if (cuda_device_present()) return cuda_backend::make_multiplier();
+                throw std::runtime_error("GPUBackendFactory: no CUDA device found");
+#else
+                throw std::runtime_error("GPUBackendFactory: built without CUDA (PIRACER_ENABLE_CUDA)");
+#endif
+            case GPUBackend::OpenCL:
+                break;
+        }
+        throw std::runtime_error("GPUBackendFactory: OpenCL backend not implemented");
+    }
+
+    bool GPUBackendFactory::is_backend_available(GPUBackend backend) {
+        switch (backend) {
+            case GPUBackend::CUDA:   return cuda_device_present();
+            case GPUBackend::OpenCL: return false;
+            case GPUBackend::CPU:
+            case GPUBackend::Auto:   return true;
+        }
+        return false;
+    }
+
+    GPUBackend GPUBackendFactory::get_best_available_backend() {
+        return cuda_device_present() ? GPUBackend::CUDA : GPUBackend::CPU;
+    }
+
+    std::string GPUBackendFactory::get_backend_info(GPUBackend backend) {
+        switch (backend) {
+            case GPUBackend::CUDA:
+#if PIRACER_HAVE_CUDA
+                return cuda_backend::describe();
+#else
+                return "CUDA: not built (configure with -DPIRACER_ENABLE_CUDA=ON)";
+#endif
+            case GPUBackend::OpenCL: return "OpenCL: not implemented";
+            case GPUBackend::CPU:    return "CPU: mul_big on the thread pool";
+            case GPUBackend::Auto:   return get_backend_info(get_best_available_backend());
+        }
+        return "";
+    }
+
+    // ---- Statistics and profiler --------------------------------------------------
+
+    GPUStats gpu_stats() {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        return g_stats;
+    }
+
+    void gpu_stats_add(const GPUStats& d) {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        g_stats.kernel_ms += d.kernel_ms;
+        g_stats.transfer_ms += d.transfer_ms;
+        g_stats.bytes_allocated += d.bytes_allocated;
+        g_stats.operations += d.operations;
+    }
+
+    void GPUProfiler::start_profiling() {
+        start_stats_ = gpu_stats();
+        start_time_ = std::chrono::high_resolution_clock::now();
+        is_profiling_ = true;
+    }
+
+    void GPUProfiler::stop_profiling() {
+        if (!is_profiling_) return;
+        const GPUStats now = gpu_stats();
+        const double ms =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time_).count();
+        current_result_.total_time_ms += ms;
+        current_result_.kernel_time_ms += now.kernel_ms - start_stats_.kernel_ms;
+        current_result_.memory_transfer_time_ms += now.transfer_ms - start_stats_.transfer_ms;
+        current_result_.memory_allocated_mb += (now.bytes_allocated - start_stats_.bytes_allocated) / (1024 * 1024);
+        current_result_.operations_performed += now.operations - start_stats_.operations;
+        // One butterfly or product is a few 64-bit multiply-adds: count it as one op
+        current_result_.throughput_gflops = current_result_.kernel_time_ms > 0
+            ? current_result_.operations_performed / (current_result_.kernel_time_ms * 1e6) : 0.0;
+        is_profiling_ = false;
+    }
+
+    GPUProfiler::ProfileResult GPUProfiler::get_results() const {
+        return current_result_;
+    }
+
+    void GPUProfiler::reset() {
+        current_result_ = ProfileResult{};
+        is_profiling_ = false;
+    }
+
+    bool GPUProfiler::export_to_csv(const std::string& filename) const {
+        std::ofstream f(filename);
+        if (!f) return false;
+        f << "total_ms,kernel_ms,transfer_ms,allocated_mb,operations,gops\n"
+          << current_result_.total_time_ms << "," << current_result_.kernel_time_ms << ","
+          << current_result_.memory_transfer_time_ms << "," << current_result_.memory_allocated_mb << ","
+          << current_result_.operations_performed << "," << current_result_.throughput_gflops << "\n";
+        return static_cast<bool>(f);
+    }
+
+    // ---- Device memory --------------------------------------------------------------
+
+    void* GPUMemoryManager::raw_allocate(size_t bytes) {
+#if PIRACER_HAVE_CUDA
+        void* p = cuda_backend::device_alloc(bytes);
+        allocations_.push_back({p, bytes, std::chrono::system_clock::now()});
+        total_allocated_ += bytes;
+        peak_usage_ = std::max(peak_usage_, total_allocated_);
+        return p;
+#else
+        (void)bytes;
+        throw std::runtime_error("GPUMemoryManager: built without CUDA (PIRACER_ENABLE_CUDA)");
+#endif
+    }
+
+    void GPUMemoryManager::raw_free(void* ptr) {
+        auto it = std::find_if(allocations_.begin(), allocations_.end(),
+                               [ptr](const Allocation& a) { return a.ptr == ptr; });
+        if (it == allocations_.end()) return;
+#if PIRACER_HAVE_CUDA
+        cuda_backend::device_free(ptr);
+#endif
+        total_allocated_ -= it->size;
+        allocations_.erase(it);
+    }
+
+    void GPUMemoryManager::raw_copy(void* dst, const void* src, size_t bytes, bool to_device) {
+#if PIRACER_HAVE_CUDA
+        cuda_backend::device_copy(dst, src, bytes, to_device);
+#else
+        (void)dst; (void)src; (void)bytes; (void)to_device;
+        throw std::runtime_error("GPUMemoryManager: built without CUDA (PIRACER_ENABLE_CUDA)");
+#endif
+    }
+
+    size_t GPUMemoryManager::get_total_allocated_mb() const { return total_allocated_ / (1024 * 1024); }
+    size_t GPUMemoryManager::get_peak_usage_mb() const { return peak_usage_ / (1024 * 1024); }
+    size_t GPUMemoryManager::get_allocation_count() const { return allocations_.size(); }
+
+    void GPUMemoryManager::clear_all() {
+#if PIRACER_HAVE_CUDA
+        for (const Allocation& a : allocations_) cuda_backend::device_free(a.ptr);
+#endif
+        allocations_.clear();
+        total_allocated_ = 0;
+    }
+
+} // namespace piracer
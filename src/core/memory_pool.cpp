@@ -0,0 +1,595 @@
+#include "piracer/memory_pool.hpp"
+#include "piracer/topology.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <gmp.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace piracer {
+
+    MemoryPool g_memory_pool;
+
+    namespace {
+        constexpr unsigned kChunkShift = 21;
+        static_assert((std::size_t(1) << kChunkShift) == MemoryPool::kChunkBytes, "chunk size");
+
+        // Per-thread cache size per class before surplus moves to the central list
+        constexpr std::size_t kCacheBytesPerClass = std::size_t(1) << 20;
+
+        constexpr std::size_t kPageBytes = 4096;
+
+        // Smallest arena worth running the pool on
+        constexpr unsigned kMinArenaShift = 30;
+
+        // ---- Size classes -------------------------------------------------------
+        // 16-byte steps up to 128, then four classes per power of two:
+        // 2^p * {1.25, 1.5, 1.75, 2}, so rounding wastes at most 20%.
+
+        inline unsigned bit_width(std::size_t x) {
+            unsigned n = 0;
+#if defined(__GNUC__) || defined(__clang__)
+            if (x) n = 64u - static_cast<unsigned>(__builtin_clzll(static_cast<unsigned long long>(x)));
+#else
+            while (x >> n) ++n;
+#endif
+            return n;
+        }
+
+        inline int class_of(std::size_t size) {
+            if (size <= 128) return size == 0 ? 0 : static_cast<int>((size + 15) / 16) - 1;
+            const unsigned p = bit_width(size - 1) - 1;  // 2^p < size <= 2^(p+1)
+            const std::size_t step = std::size_t(1) << (p - 2);
+            const std::size_t k = (size - (std::size_t(1) << p) + step - 1) / step;  // 1..4
+            return 8 + static_cast<int>(p - 7) * 4 + static_cast<int>(k) - 1;
+        }
+
+        inline std::size_t class_size(int c) {
+            if (c < 8) return static_cast<std::size_t>(c + 1) * 16;
+            const unsigned p = 7 + static_cast<unsigned>(c - 8) / 4;
+            const std::size_t k = static_cast<std::size_t>((c - 8) % 4) + 1;
+            return (std::size_t(1) << p) + k * (std::size_t(1) << (p - 2));
+        }
+
+        inline std::size_t cache_limit(int c) {
+            return std::max<std::size_t>(16, kCacheBytesPerClass / class_size(c));
+        }
+
+        // Thread caches belong to g_memory_pool; once a thread's cache has
+        // been destroyed its late frees go to the central lists
+        thread_local bool tls_cache_dead = false;
+    } // namespace
+
+    // Per-thread free lists and bump region of g_memory_pool
+    struct ThreadCache {
+        MemoryPool::FreeBlock* head[MemoryPool::kClasses] = {};
+        std::size_t count[MemoryPool::kClasses] = {};
+        char* bump = nullptr;
+        char* bump_end = nullptr;
+
+        // Live bytes allocated minus freed by this thread (may go negative);
+        // written only by the owner, read by total_used()
+        std::atomic<std::int64_t> used{0};
+
+        ThreadCache* prev = nullptr;
+        ThreadCache* next = nullptr;
+
+        ThreadCache() {
+            std::lock_guard<std::mutex> lock(g_memory_pool.caches_mutex_);
+            next = g_memory_pool.caches_;
+            if (next) next->prev = this;
+            g_memory_pool.caches_ = this;
+        }
+
+        ~ThreadCache() {
+            for (int c = 0; c < MemoryPool::kClasses; ++c) {
+                if (!head[c]) continue;
+                MemoryPool::FreeBlock* tail = head[c];
+                while (tail->next) tail = tail->next;
+                g_memory_pool.push_central(c, head[c], tail, count[c]);
+            }
+
+            // Short-lived threads (async I/O, thread pools being rebuilt)
+            // would otherwise strand most of a chunk each
+            if (bump) g_memory_pool.give_region(bump, bump_end);
+
+            std::lock_guard<std::mutex> lock(g_memory_pool.caches_mutex_);
+            if (prev) prev->next = next; else g_memory_pool.caches_ = next;
+            if (next) next->prev = prev;
+            g_memory_pool.small_used_.fetch_add(used.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            tls_cache_dead = true;
+        }
+
+        void add_used(std::int64_t delta) {
+            used.store(used.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+    };
+
+    namespace {
+        ThreadCache* thread_cache() {
+            if (tls_cache_dead) return nullptr;
+            thread_local ThreadCache cache;
+            return &cache;
+        }
+    } // namespace
+
+    MemoryPool::MemoryPool(size_t initial_size) : MemoryPool() {
+        reserve(initial_size);
+    }
+
+    // ---- Arena ----------------------------------------------------------------------
+
+    void MemoryPool::init_arena() {
+#if !defined(_WIN32) && defined(MAP_NORESERVE)
+        // Address space only: pages are backed as they are first touched
+        for (unsigned shift = kMaxShift; shift >= kMinArenaShift; --shift) {
+            const std::size_t bytes = std::size_t(1) << shift;
+            const std::size_t span = bytes + kChunkBytes;
+            void* raw = ::mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (raw == MAP_FAILED) continue;
+
+            // Trim to a 2 MiB-aligned window, so chunks and huge pages line up
+            const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+            const std::uintptr_t aligned = (start + kChunkBytes - 1) & ~(kChunkBytes - 1);
+            if (aligned > start) ::munmap(raw, aligned - start);
+            const std::uintptr_t end = start + span, used_end = aligned + bytes;
+            if (end > used_end) ::munmap(reinterpret_cast<void*>(used_end), end - used_end);
+
+            // Bookkeeping is sized for the whole arena; large calloc/malloc
+            // blocks are fresh mappings, so only the parts in use get backed
+            const std::size_t blocks = bytes >> kMinShift;
+            state_ = static_cast<std::uint8_t*>(std::calloc(blocks, 1));
+            slot_ = static_cast<std::uint32_t*>(std::malloc(blocks * sizeof(std::uint32_t)));
+            auto* lists = static_cast<std::uint32_t*>(std::malloc(2 * blocks * sizeof(std::uint32_t)));
+            if (!state_ || !slot_ || !lists) {
+                // Its bookkeeping shrinks with the arena: try the next size down
+                std::free(state_);
+                std::free(slot_);
+                std::free(lists);
+                state_ = nullptr;
+                slot_ = nullptr;
+                ::munmap(reinterpret_cast<void*>(aligned), bytes);
+                continue;
+            }
+
+            base_ = reinterpret_cast<char*>(aligned);
+            arena_bytes_ = bytes;
+            top_order_ = shift - kMinShift;
+            for (unsigned k = 0; k <= top_order_; ++k) {
+                free_list_[k] = lists;
+                lists += blocks >> k;  // at most that many free blocks of order k
+            }
+#ifdef MADV_HUGEPAGE
+            ::madvise(base_, bytes, MADV_HUGEPAGE);
+#endif
+            push_free(top_order_, 0);
+            return;
+        }
+#endif
+    }
+
+    bool MemoryPool::active() {
+        std::call_once(arena_once_, [this] { init_arena(); });
+        return base_ != nullptr;
+    }
+
+    // ---- Buddy system ---------------------------------------------------------------
+    // Blocks are indexed in units of 2^kMinShift bytes; a block of order k
+    // spans 2^k units and its buddy is index ^ 2^k. state_ holds 1 + k for
+    // the head of a free block, 0x80 | k for the head of an allocated one.
+
+    namespace {
+        constexpr std::uint8_t kAllocated = 0x80;
+    } // namespace
+
+    std::size_t MemoryPool::block_index(const void* p) const {
+        return static_cast<std::size_t>(static_cast<const char*>(p) - base_) >> kMinShift;
+    }
+
+    void MemoryPool::push_free(unsigned k, std::size_t i) {
+        free_list_[k][free_count_[k]] = static_cast<std::uint32_t>(i);
+        slot_[i] = static_cast<std::uint32_t>(free_count_[k]++);
+        state_[i] = static_cast<std::uint8_t>(1 + k);
+    }
+
+    void MemoryPool::remove_free(unsigned k, std::size_t i) {
+        const std::uint32_t pos = slot_[i];
+        const std::uint32_t last = free_list_[k][--free_count_[k]];
+        free_list_[k][pos] = last;
+        slot_[last] = pos;
+        state_[i] = 0;
+    }
+
+    void* MemoryPool::alloc_block(unsigned k) {
+        unsigned j = k;
+        while (j <= top_order_ && free_count_[j] == 0) ++j;
+        if (j > top_order_) return nullptr;
+
+        // Most recently freed first: its pages are the likeliest to be resident
+        const std::size_t i = free_list_[j][--free_count_[j]];
+        while (j > k) {
+            --j;
+            push_free(j, i + (std::size_t(1) << j));
+        }
+        state_[i] = static_cast<std::uint8_t>(kAllocated | k);
+        return base_ + (i << kMinShift);
+    }
+
+    void MemoryPool::free_block(std::size_t i) {
+        unsigned k = state_[i] & ~kAllocated;
+        state_[i] = 0;
+        while (k < top_order_) {
+            const std::size_t buddy = i ^ (std::size_t(1) << k);
+            if (state_[buddy] != 1 + k) break;
+            remove_free(k, buddy);
+            i &= ~(std::size_t(1) << k);
+            ++k;
+        }
+        push_free(k, i);
+    }
+
+    bool MemoryPool::grow_block(std::size_t i, unsigned k, unsigned target) {
+        if (target > top_order_) return false;
+        // Every buddy up to `target` must be free and on the right
+        for (unsigned j = k; j < target; ++j) {
+            if ((i >> j) & 1) return false;
+            if (state_[i + (std::size_t(1) << j)] != 1 + j) return false;
+        }
+        for (unsigned j = k; j < target; ++j) remove_free(j, i + (std::size_t(1) << j));
+        state_[i] = static_cast<std::uint8_t>(kAllocated | target);
+        return true;
+    }
+
+    namespace {
+        // Buddy order (relative to the minimum block) holding `size` bytes
+        inline unsigned order_of(std::size_t size, unsigned min_shift) {
+            const unsigned shift = bit_width(size - 1);
+            return shift > min_shift ? shift - min_shift : 0;
+        }
+    } // namespace
+
+    void MemoryPool::account(std::int64_t delta) {
+        const size_t now = allocated_.fetch_add(static_cast<size_t>(delta), std::memory_order_relaxed) +
+                           static_cast<size_t>(delta);
+        size_t peak = peak_allocated_.load(std::memory_order_relaxed);
+        while (now > peak && !peak_allocated_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+        }
+        peak = window_peak_.load(std::memory_order_relaxed);
+        while (now > peak && !window_peak_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+        }
+    }
+
+    // ---- Small blocks ---------------------------------------------------------------
+
+    char* MemoryPool::new_chunk() {
+        {
+            std::lock_guard<std::mutex> lock(chunk_mutex_);
+            if (spare_chunks_) {
+                FreeBlock* c = spare_chunks_;
+                spare_chunks_ = c->next;
+                return reinterpret_cast<char*>(c);
+            }
+        }
+        void* p;
+        {
+            std::lock_guard<std::mutex> lock(arena_mutex_);
+            p = alloc_block(kChunkShift - kMinShift);
+        }
+        if (!p) throw std::bad_alloc();
+        chunk_count_.fetch_add(1, std::memory_order_relaxed);
+        account(static_cast<std::int64_t>(kChunkBytes));
+        return static_cast<char*>(p);
+    }
+
+    void* MemoryPool::carve(size_t bytes) {
+        std::unique_lock<std::mutex> lock(chunk_mutex_);
+        if (static_cast<size_t>(bump_end_ - bump_) < bytes) {
+            lock.unlock();  // new_chunk() takes the lock itself
+            char* c = new_chunk();
+            lock.lock();
+            bump_ = c;
+            bump_end_ = c + kChunkBytes;
+        }
+        void* p = bump_;
+        bump_ += bytes;
+        return p;
+    }
+
+    void MemoryPool::give_region(char* begin, char* end) {
+        if (static_cast<size_t>(end - begin) < kMinRegionBytes) return;
+        auto* r = reinterpret_cast<Region*>(begin);
+        r->end = end;
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        r->next = regions_;
+        regions_ = r;
+    }
+
+    bool MemoryPool::take_region(size_t bytes, char*& begin, char*& end) {
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        for (Region** link = &regions_; *link; link = &(*link)->next) {
+            Region* r = *link;
+            if (static_cast<size_t>(r->end - reinterpret_cast<char*>(r)) < bytes) continue;
+            *link = r->next;
+            begin = reinterpret_cast<char*>(r);
+            end = r->end;
+            return true;
+        }
+        return false;
+    }
+
+    void MemoryPool::push_central(int c, FreeBlock* head, FreeBlock* tail, size_t n) {
+        Central& central = central_[c];
+        std::lock_guard<std::mutex> lock(central.mutex);
+        tail->next = central.head;
+        central.head = head;
+        central.count += n;
+    }
+
+    size_t MemoryPool::pop_central(int c, FreeBlock*& head, size_t max) {
+        Central& central = central_[c];
+        std::lock_guard<std::mutex> lock(central.mutex);
+        if (!central.head) return 0;
+        FreeBlock* first = central.head;
+        FreeBlock* last = first;
+        size_t n = 1;
+        while (n < max && last->next) {
+            last = last->next;
+            ++n;
+        }
+        central.head = last->next;
+        central.count -= n;
+        last->next = nullptr;
+        head = first;
+        return n;
+    }
+
+    void* MemoryPool::allocate_small(int c) {
+        const size_t bytes = class_size(c);
+        ThreadCache* t = this == &g_memory_pool ? thread_cache() : nullptr;
+        if (!t) {
+            FreeBlock* b = nullptr;
+            if (pop_central(c, b, 1) == 0) b = static_cast<FreeBlock*>(carve(bytes));
+            small_used_.fetch_add(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+            return b;
+        }
+
+        FreeBlock* b = t->head[c];
+        if (!b) {
+            t->count[c] = pop_central(c, t->head[c], cache_limit(c) / 2);
+            b = t->head[c];
+        }
+        if (b) {
+            t->head[c] = b->next;
+            --t->count[c];
+        } else {
+            if (static_cast<size_t>(t->bump_end - t->bump) < bytes) {
+                // The tail of the old chunk is not reused
+                if (!take_region(bytes, t->bump, t->bump_end)) {
+                    t->bump = new_chunk();
+                    t->bump_end = t->bump + kChunkBytes;
+                }
+            }
+            b = reinterpret_cast<FreeBlock*>(t->bump);
+            t->bump += bytes;
+        }
+        t->add_used(static_cast<std::int64_t>(bytes));
+        return b;
+    }
+
+    void MemoryPool::deallocate_small(void* ptr, int c) {
+        const size_t bytes = class_size(c);
+        auto* b = static_cast<FreeBlock*>(ptr);
+        ThreadCache* t = this == &g_memory_pool ? thread_cache() : nullptr;
+        if (!t) {
+            small_used_.fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+            push_central(c, b, b, 1);
+            return;
+        }
+
+        b->next = t->head[c];
+        t->head[c] = b;
+        t->add_used(-static_cast<std::int64_t>(bytes));
+        if (++t->count[c] <= cache_limit(c)) return;
+
+        // Keep half, hand the rest to other threads
+        const size_t keep = t->count[c] / 2;
+        FreeBlock* last_kept = t->head[c];
+        for (size_t i = 1; i < keep; ++i) last_kept = last_kept->next;
+        FreeBlock* first = last_kept->next;
+        FreeBlock* tail = first;
+        while (tail->next) tail = tail->next;
+        last_kept->next = nullptr;
+        push_central(c, first, tail, t->count[c] - keep);
+        t->count[c] = keep;
+    }
+
+    // ---- Large blocks ---------------------------------------------------------------
+
+    void* MemoryPool::allocate_large(size_t size) {
+        const unsigned k = order_of(size, kMinShift);
+        void* p = nullptr;
+        if (k <= top_order_) {
+            std::lock_guard<std::mutex> lock(arena_mutex_);
+            p = alloc_block(k);
+        }
+        if (!p) {
+            // Arena exhausted or fragmented: deallocate() sends this to std::free.
+            // Page alignment still holds, as callers of large blocks rely on it.
+            p = std::aligned_alloc(kPageBytes, (size + kPageBytes - 1) / kPageBytes * kPageBytes);
+            if (!p) throw std::bad_alloc();
+        } else {
+            const std::int64_t bytes = std::int64_t(1) << (k + kMinShift);
+            account(bytes);
+            large_used_.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        const size_t interleave = interleave_bytes_.load(std::memory_order_relaxed);
+        if (interleave && size >= interleave) numa_interleave(p, size);
+        return p;
+    }
+
+    void MemoryPool::deallocate_large(void* ptr) {
+        std::int64_t bytes;
+        {
+            std::lock_guard<std::mutex> lock(arena_mutex_);
+            const std::size_t i = block_index(ptr);
+            bytes = std::int64_t(1) << ((state_[i] & ~kAllocated) + kMinShift);
+            free_block(i);
+        }
+        account(-bytes);
+        large_used_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    // ---- Public interface -----------------------------------------------------------
+
+    void* MemoryPool::allocate(size_t size) {
+        if (!active()) {
+            void* p = std::malloc(size ? size : 1);
+            if (!p) throw std::bad_alloc();
+            return p;
+        }
+        if (size <= kMaxSmallBytes) return allocate_small(class_of(size));
+        return allocate_large(size);
+    }
+
+    void MemoryPool::deallocate(void* ptr, size_t size) {
+        if (!ptr) return;
+        if (!active() || !owns(ptr)) {
+            std::free(ptr);
+            return;
+        }
+        if (size <= kMaxSmallBytes) {
+            deallocate_small(ptr, class_of(size));
+        } else {
+            deallocate_large(ptr);
+        }
+    }
+
+    void* MemoryPool::reallocate(void* ptr, size_t old_size, size_t new_size) {
+        if (!ptr) return allocate(new_size);
+        if (!active() || !owns(ptr)) {
+            void* p = std::realloc(ptr, new_size ? new_size : 1);
+            if (!p) throw std::bad_alloc();
+            return p;
+        }
+
+        const bool old_small = old_size <= kMaxSmallBytes, new_small = new_size <= kMaxSmallBytes;
+        if (old_small && new_small && class_of(old_size) == class_of(new_size)) return ptr;
+        if (!old_small && !new_small) {
+            // Shrinking keeps the block; growing takes free right-hand buddies
+            const unsigned target = order_of(new_size, kMinShift);
+            std::int64_t delta = 0;
+            {
+                std::lock_guard<std::mutex> lock(arena_mutex_);
+                const std::size_t i = block_index(ptr);
+                const unsigned k = state_[i] & ~kAllocated;
+                if (target <= k) return ptr;
+                if (grow_block(i, k, target)) {
+                    delta = (std::int64_t(1) << (target + kMinShift)) - (std::int64_t(1) << (k + kMinShift));
+                }
+            }
+            if (delta) {
+                account(delta);
+                large_used_.fetch_add(delta, std::memory_order_relaxed);
+                return ptr;
+            }
+        }
+
+        void* q = allocate(new_size);
+        std::memcpy(q, ptr, std::min(old_size, new_size));
+        deallocate(ptr, old_size);
+        return q;
+    }
+
+    size_t MemoryPool::total_used() const {
+        std::int64_t sum = small_used_.load(std::memory_order_relaxed) + large_used_.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(caches_mutex_);
+            for (const ThreadCache* t = caches_; t; t = t->next) sum += t->used.load(std::memory_order_relaxed);
+        }
+        return sum > 0 ? static_cast<size_t>(sum) : 0;
+    }
+
+    void MemoryPool::clear() {
+        if (!active()) return;
+        FreeBlock* spare = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(chunk_mutex_);
+            spare = spare_chunks_;
+            spare_chunks_ = nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(arena_mutex_);
+        while (spare) {
+            FreeBlock* next = spare->next;
+            free_block(block_index(spare));
+            chunk_count_.fetch_sub(1, std::memory_order_relaxed);
+            account(-static_cast<std::int64_t>(kChunkBytes));
+            spare = next;
+        }
+#ifdef MADV_DONTNEED
+        for (unsigned k = 0; k <= top_order_; ++k) {
+            for (size_t n = 0; n < free_count_[k]; ++n) {
+                ::madvise(base_ + (std::size_t(free_list_[k][n]) << kMinShift),
+                          std::size_t(1) << (k + kMinShift), MADV_DONTNEED);
+            }
+        }
+#endif
+    }
+
+    void MemoryPool::reserve(size_t size) {
+        if (!active()) return;
+        for (size_t have = 0; have < size; have += kChunkBytes) {
+            char* c = new_chunk();
+            std::lock_guard<std::mutex> lock(chunk_mutex_);
+            auto* b = reinterpret_cast<FreeBlock*>(c);
+            b->next = spare_chunks_;
+            spare_chunks_ = b;
+        }
+    }
+
+    // ---- GMP hook -----------------------------------------------------------------
+    namespace {
+        bool g_gmp_installed = false;
+
+        // GMP cannot recover from a failed allocation either: report and abort as it does
+        [[noreturn]] void out_of_memory(size_t size) {
+            std::fprintf(stderr, "PiRacer: cannot allocate %zu bytes\n", size);
+            std::abort();
+        }
+
+        void* gmp_allocate(size_t size) {
+            try {
+                return g_memory_pool.allocate(size);
+            } catch (const std::bad_alloc&) {
+                out_of_memory(size);
+            }
+        }
+
+        void* gmp_reallocate(void* ptr, size_t old_size, size_t new_size) {
+            try {
+                return g_memory_pool.reallocate(ptr, old_size, new_size);
+            } catch (const std::bad_alloc&) {
+                out_of_memory(new_size);
+            }
+        }
+
+        void gmp_free(void* ptr, size_t size) {
+            g_memory_pool.deallocate(ptr, size);
+        }
+    } // namespace
+
+    void install_gmp_allocator() {
+        if (g_gmp_installed || !g_memory_pool.active()) return;
+        mp_set_memory_functions(&gmp_allocate, &gmp_reallocate, &gmp_free);
+        g_gmp_installed = true;
+    }
+
+    bool gmp_allocator_installed() { return g_gmp_installed; }
+
+} // namespace piracer
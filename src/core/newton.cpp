@@ -0,0 +1,97 @@
+#include "piracer/newton.hpp"
+#include "piracer/bigmul.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace piracer {
+
+    namespace {
+        // Below this precision GMP's own division / square root is used
+        constexpr long kBaseBits = 4096;
+
+        // Bits every step carries beyond its target, so the truncation
+        // errors stay below the last place
+        constexpr long kGuardBits = 32;
+
+        // x >> n (floor, also for negative x), in place
+        void shift_down(mpz_class& x, long n) {
+            if (n > 0) mpz_fdiv_q_2exp(x.get_mpz_t(), x.get_mpz_t(), static_cast<mp_bitcnt_t>(n));
+        }
+
+        long bit_length(const mpz_class& x) {
+            return static_cast<long>(mpz_sizeinbase(x.get_mpz_t(), 2));
+        }
+    } // namespace
+
+    void reciprocal_fixed(mpz_class& y, const mpz_class& d, long bits, ThreadPool* pool) {
+        if (sgn(d) <= 0) throw std::invalid_argument("reciprocal_fixed: d must be positive");
+        const long n = bit_length(d);
+
+        // Only the leading bits + guard of d can influence the result
+        if (bits <= kBaseBits) {
+            const long keep = std::min(n, bits + kGuardBits);
+            mpz_class dt = d;
+            shift_down(dt, n - keep);
+            mpz_class num;
+            mpz_setbit(num.get_mpz_t(), static_cast<mp_bitcnt_t>(keep + bits));
+            mpz_fdiv_q(y.get_mpz_t(), num.get_mpz_t(), dt.get_mpz_t());
+            return;
+        }
+
+        // y_h at half precision, then y = y_h + y_h * (1 - d * y_h)
+        const long h = bits / 2 + kGuardBits;
+        mpz_class yh;
+        reciprocal_fixed(yh, d, h, pool);
+
+        const long keep = std::min(n, bits + kGuardBits);
+        mpz_class e = d;
+        shift_down(e, n - keep);
+        mul_big(e, e, yh, pool);  // (d / 2^n) * y_h, scaled by 2^(keep + h)
+
+        mpz_class one;
+        mpz_setbit(one.get_mpz_t(), static_cast<mp_bitcnt_t>(keep + h));
+        e = one - e;  // ~2^-h, scaled by 2^(keep + h)
+        const long drop = std::max(keep + h - bits - kGuardBits, 0L);
+        shift_down(e, drop);
+
+        mul_big(e, e, yh, pool);
+        shift_down(e, 2 * h + keep - drop - bits);
+        mpz_mul_2exp(y.get_mpz_t(), yh.get_mpz_t(), static_cast<mp_bitcnt_t>(bits - h));
+        y += e;
+    }
+
+    void inv_sqrt_fixed(mpz_class& r, unsigned long x, long bits, ThreadPool* pool) {
+        if (x == 0) throw std::invalid_argument("inv_sqrt_fixed: x must be positive");
+
+        // floor(sqrt(2^(2 bits) / x))
+        if (bits <= kBaseBits) {
+            mpz_class num;
+            mpz_setbit(num.get_mpz_t(), static_cast<mp_bitcnt_t>(2 * bits));
+            mpz_fdiv_q_ui(num.get_mpz_t(), num.get_mpz_t(), x);
+            mpz_sqrt(r.get_mpz_t(), num.get_mpz_t());
+            return;
+        }
+
+        // r_h at half precision, then r = r_h + r_h * (1 - x * r_h^2) / 2
+        const long h = bits / 2 + kGuardBits;
+        mpz_class rh;
+        inv_sqrt_fixed(rh, x, h, pool);
+
+        mpz_class e;
+        mul_big(e, rh, rh, pool);  // r_h^2, scaled by 2^(2h)
+        e *= x;
+
+        mpz_class one;
+        mpz_setbit(one.get_mpz_t(), static_cast<mp_bitcnt_t>(2 * h));
+        e = one - e;  // ~2^-h, scaled by 2^(2h)
+        const long drop = std::max(2 * h - bits - kGuardBits, 0L);
+        shift_down(e, drop);
+
+        mul_big(e, e, rh, pool);
+        shift_down(e, 3 * h - drop + 1 - bits);
+        mpz_mul_2exp(r.get_mpz_t(), rh.get_mpz_t(), static_cast<mp_bitcnt_t>(bits - h));
+        r += e;
+    }
+
+} // namespace piracer
@@ -0,0 +1,772 @@
+#include "piracer/profiler.hpp"
+#include "piracer/memory_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PIRACER_HAVE_PERF 1
+#else
+#define PIRACER_HAVE_PERF 0
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+    std::unique_ptr<PerformanceProfiler> g_profiler = std::make_unique<PerformanceProfiler>();
+
+    namespace profiling {
+        std::atomic<bool> g_enabled{false};
+
+        namespace {
+            std::atomic<bool> g_hardware{true};
+            std::atomic<const char*> g_phase{nullptr};
+
+            const char* kCounterNames[kCounters] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+            // ---- Hardware counters (one group per thread) -----------------------
+
+            // Event groups of the calling thread; every event that opens is
+            // read with the group leader in one read()
+            class PerfGroup {
+            public:
+                // `configs` are PERF_COUNT_HW_* values; slot[i] < 0 where event i failed
+                bool open(const std::uint64_t* configs, int n) {
+                    n_ = n;
+#if PIRACER_HAVE_PERF
+                    int pos = 0;
+                    for (int i = 0; i < n; ++i) {
+                        perf_event_attr attr;
+                        std::memset(&attr, 0, sizeof(attr));
+                        attr.type = PERF_TYPE_HARDWARE;
+                        attr.size = sizeof(attr);
+                        attr.config = configs[i];
+                        attr.exclude_kernel = 1;
+                        attr.exclude_hv = 1;
+                        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+                        const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+                        slot_[i] = -1;
+                        fds_[i] = fd;
+                        if (fd < 0) {
+                            if (leader_ < 0) return false;  // no leader: nothing works
+                            continue;
+                        }
+                        if (leader_ < 0) leader_ = fd;
+                        slot_[i] = pos++;
+                    }
+                    return leader_ >= 0;
+#else
+                    (void)configs;
+                    return false;
+#endif
+                }
+
+                // Counts since open, scaled up if the kernel multiplexed the group
+                bool read(std::uint64_t* out) const {
+#if PIRACER_HAVE_PERF
+                    if (leader_ < 0) return false;
+                    std::uint64_t buf[3 + kMaxEvents];
+                    if (::read(leader_, buf, sizeof(buf)) < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) return false;
+                    const std::uint64_t nr = buf[0], enabled = buf[1], running = buf[2];
+                    const double scale = running > 0 && running < enabled ? static_cast<double>(enabled) / running : 1.0;
+                    for (int i = 0; i < n_; ++i) {
+                        const int s = slot_[i];
+                        out[i] = s >= 0 && static_cast<std::uint64_t>(s) < nr
+                                     ? static_cast<std::uint64_t>(static_cast<double>(buf[3 + s]) * scale)
+                                     : 0;
+                    }
+                    return true;
+#else
+                    (void)out;
+                    return false;
+#endif
+                }
+
+                void close() {
+#if PIRACER_HAVE_PERF
+                    for (int i = 0; i < n_; ++i) {
+                        if (fds_[i] >= 0) ::close(fds_[i]);
+                        fds_[i] = -1;
+                    }
+#endif
+                    leader_ = -1;
+                }
+
+                ~PerfGroup() { close(); }
+
+            private:
+                static constexpr int kMaxEvents = 4;
+                int fds_[kMaxEvents] = {-1, -1, -1, -1};
+                int slot_[kMaxEvents] = {-1, -1, -1, -1};
+                int leader_ = -1;
+                int n_ = 0;
+            };
+
+#if PIRACER_HAVE_PERF
+            const std::uint64_t kSectionEvents[kCounters] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+#else
+            const std::uint64_t kSectionEvents[kCounters] = {0, 0, 0, 0};
+#endif
+
+            // ---- Per-thread section tables ----------------------------------------
+
+            // Written by its own thread only (relaxed stores), read by exports
+            struct SectionRecord {
+                std::atomic<const char*> phase{nullptr};
+                std::atomic<const char*> name{nullptr};
+                std::atomic<std::uint64_t> calls{0};
+                std::atomic<std::uint64_t> counted{0};
+                std::atomic<std::uint64_t> wall_ns{0};
+                std::atomic<std::uint64_t> counters[kCounters] = {};
+            };
+
+            void bump(std::atomic<std::uint64_t>& x, std::uint64_t v) {
+                x.store(x.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+            }
+
+            struct ThreadRecord {
+                static constexpr std::size_t kMaxSections = 128;
+                SectionRecord sections[kMaxSections];
+                std::atomic<std::size_t> used{0};
+                std::atomic<std::uint64_t> dropped{0};  // calls beyond kMaxSections sections
+
+                SectionRecord* find(const char* phase, const char* name) {
+                    const std::size_t n = used.load(std::memory_order_relaxed);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        SectionRecord& r = sections[i];
+                        if (r.name.load(std::memory_order_relaxed) == name &&
+                            r.phase.load(std::memory_order_relaxed) == phase) return &r;
+                    }
+                    if (n == kMaxSections) {
+                        bump(dropped, 1);
+                        return nullptr;
+                    }
+                    SectionRecord& r = sections[n];
+                    r.phase.store(phase, std::memory_order_relaxed);
+                    r.name.store(name, std::memory_order_relaxed);
+                    used.store(n + 1, std::memory_order_release);
+                    return &r;
+                }
+
+                void clear() {
+                    const std::size_t n = used.load(std::memory_order_acquire);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        SectionRecord& r = sections[i];
+                        r.calls = 0;
+                        r.counted = 0;
+                        r.wall_ns = 0;
+                        for (auto& c : r.counters) c = 0;
+                    }
+                    dropped = 0;
+                }
+            };
+
+            // Records outlive their threads so exports still see them
+            struct Registry {
+                std::mutex mutex;
+                std::vector<std::unique_ptr<ThreadRecord>> threads;
+                std::vector<const char*> phases;  // in order of first use
+                std::set<std::string> interned;   // names from the string API
+            };
+
+            Registry& registry() {
+                static Registry r;
+                return r;
+            }
+
+            const char* intern(const std::string& s) {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                return reg.interned.insert(s).first->c_str();
+            }
+
+            struct ThreadState {
+                ThreadRecord* record = nullptr;
+                PerfGroup perf;
+                bool perf_tried = false;
+                bool perf_ok = false;
+                std::vector<std::pair<const char*, Sample>> open;  // start_section stack
+                std::vector<const char*> open_phase;
+
+                ThreadRecord& get() {
+                    if (!record) {
+                        auto r = std::make_unique<ThreadRecord>();
+                        record = r.get();
+                        Registry& reg = registry();
+                        std::lock_guard<std::mutex> lock(reg.mutex);
+                        reg.threads.push_back(std::move(r));
+                    }
+                    return *record;
+                }
+
+                Sample sample() {
+                    if (!perf_tried && g_hardware.load(std::memory_order_relaxed)) {
+                        perf_tried = true;
+                        perf_ok = perf.open(kSectionEvents, kCounters);
+                    }
+                    Sample s;
+                    if (perf_ok) s.counted = perf.read(s.counters);
+                    s.wall_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+                    return s;
+                }
+
+                void record_section(const char* phase, const char* name, const Sample& start) {
+                    const Sample end = sample();
+                    SectionRecord* r = get().find(phase, name);
+                    if (!r) return;
+                    bump(r->calls, 1);
+                    bump(r->wall_ns, end.wall_ns - start.wall_ns);
+                    if (start.counted && end.counted) {
+                        bump(r->counted, 1);
+                        for (int i = 0; i < kCounters; ++i) bump(r->counters[i], end.counters[i] - start.counters[i]);
+                    }
+                }
+            };
+
+            thread_local ThreadState t_state;
+
+            // ---- Aggregation --------------------------------------------------------
+
+            struct SectionTotals {
+                std::string phase, name;
+                std::uint64_t calls = 0, counted = 0, wall_ns = 0;
+                std::uint64_t counters[kCounters] = {};
+                std::size_t threads = 0;
+
+                double ipc() const {
+                    return counters[kCycles] ? static_cast<double>(counters[kInstructions]) / counters[kCycles] : 0.0;
+                }
+            };
+
+            // Every thread's sections merged by (phase, name), in phase order
+            // and by wall time within a phase
+            std::vector<SectionTotals> collect() {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                std::map<std::pair<std::string, std::string>, SectionTotals> merged;
+                for (const auto& t : reg.threads) {
+                    const std::size_t n = t->used.load(std::memory_order_acquire);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        const SectionRecord& r = t->sections[i];
+                        const std::uint64_t calls = r.calls.load(std::memory_order_relaxed);
+                        if (calls == 0) continue;
+                        const char* phase = r.phase.load(std::memory_order_relaxed);
+                        SectionTotals& s = merged[{phase ? phase : "", r.name.load(std::memory_order_relaxed)}];
+                        s.calls += calls;
+                        s.counted += r.counted.load(std::memory_order_relaxed);
+                        s.wall_ns += r.wall_ns.load(std::memory_order_relaxed);
+                        for (int c = 0; c < kCounters; ++c) s.counters[c] += r.counters[c].load(std::memory_order_relaxed);
+                        ++s.threads;
+                    }
+                }
+
+                std::map<std::string, std::size_t> order{{"", 0}};
+                for (const char* p : reg.phases) order.emplace(p, order.size());
+                std::vector<SectionTotals> out;
+                for (auto& entry : merged) {
+                    entry.second.phase = entry.first.first;
+                    entry.second.name = entry.first.second;
+                    out.push_back(entry.second);
+                }
+                std::sort(out.begin(), out.end(), [&](const SectionTotals& a, const SectionTotals& b) {
+                    const std::size_t pa = order.count(a.phase) ? order[a.phase] : order.size();
+                    const std::size_t pb = order.count(b.phase) ? order[b.phase] : order.size();
+                    return pa != pb ? pa < pb : a.wall_ns > b.wall_ns;
+                });
+                return out;
+            }
+
+            std::string json_escape(const std::string& s) {
+                std::string out;
+                for (char c : s) {
+                    if (c == '"' || c == '\\') out.push_back('\\');
+                    if (static_cast<unsigned char>(c) < 0x20) continue;
+                    out.push_back(c);
+                }
+                return out;
+            }
+
+            const char* metric_name(ProfilerMetric m) {
+                switch (m) {
+                    case ProfilerMetric::CPU_TIME:      return "cpu_time";
+                    case ProfilerMetric::WALL_TIME:     return "wall_time";
+                    case ProfilerMetric::MEMORY_USAGE:  return "memory_usage";
+                    case ProfilerMetric::CACHE_MISSES:  return "cache_misses";
+                    case ProfilerMetric::BRANCH_MISSES: return "branch_misses";
+                    case ProfilerMetric::INSTRUCTIONS:  return "instructions";
+                    case ProfilerMetric::CYCLES:        return "cycles";
+                    case ProfilerMetric::CUSTOM:        return "custom";
+                }
+                return "custom";
+            }
+        } // namespace
+
+        void set_phase(const char* phase) {
+            if (phase) {
+                Registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                if (std::find(reg.phases.begin(), reg.phases.end(), phase) == reg.phases.end()) reg.phases.push_back(phase);
+            }
+            g_phase.store(phase, std::memory_order_relaxed);
+        }
+
+        const char* current_phase() {
+            return g_phase.load(std::memory_order_relaxed);
+        }
+
+        void Scope::begin(const char* name) {
+            name_ = name;
+            phase_ = current_phase();
+            start_ = t_state.sample();
+        }
+
+        void Scope::end() {
+            t_state.record_section(phase_, name_, start_);
+        }
+
+        namespace {
+            // Installs `phase`, returning the one it replaces
+            const char* swap_phase(const char* phase) {
+                const char* previous = current_phase();
+                if (enabled()) set_phase(phase);
+                return previous;
+            }
+        } // namespace
+
+        PhaseScope::PhaseScope(const char* phase) : previous_(swap_phase(phase)), scope_("stage") {}
+
+        PhaseScope::~PhaseScope() {
+            if (enabled()) g_phase.store(previous_, std::memory_order_relaxed);
+        }
+    } // namespace profiling
+
+    // ---- PerformanceProfiler ----------------------------------------------------
+
+    PerformanceProfiler::PerformanceProfiler() : profiler_start_(std::chrono::steady_clock::now()) {}
+
+    void PerformanceProfiler::enable(bool on, bool hardware_counters) {
+        profiling::g_hardware.store(hardware_counters, std::memory_order_relaxed);
+        profiling::g_enabled.store(on, std::memory_order_relaxed);
+    }
+
+    bool PerformanceProfiler::hardware_counters_available() const {
+        profiling::t_state.sample();
+        return profiling::t_state.perf_ok;
+    }
+
+    void PerformanceProfiler::start_section(const std::string& name, const std::string& category) {
+        if (!enabled()) return;
+        const char* key = profiling::intern(name);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            categories_[name] = category;
+        }
+        profiling::ThreadState& t = profiling::t_state;
+        t.open_phase.push_back(profiling::current_phase());
+        t.open.emplace_back(key, t.sample());
+    }
+
+    void PerformanceProfiler::end_section(const std::string& name) {
+        profiling::ThreadState& t = profiling::t_state;
+        for (std::size_t i = t.open.size(); i-- > 0;) {
+            if (name != t.open[i].first) continue;
+            t.record_section(t.open_phase[i], t.open[i].first, t.open[i].second);
+            t.open.erase(t.open.begin() + static_cast<std::ptrdiff_t>(i));
+            t.open_phase.erase(t.open_phase.begin() + static_cast<std::ptrdiff_t>(i));
+            return;
+        }
+    }
+
+    void PerformanceProfiler::add_metric(const std::string& name, ProfilerMetric metric, double value,
+                                         const std::string& unit, const std::string& category) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.emplace_back(name, category, metric, value, unit);
+    }
+
+    PerformanceProfiler::ProfilingResult PerformanceProfiler::get_results() const {
+        update_memory_usage();
+        ProfilingResult r;
+        std::lock_guard<std::mutex> lock(mutex_);
+        r.events = events_;
+        for (const PerformanceEvent& e : events_) r.metric_values[e.name].push_back(e.value);
+
+        for (const profiling::SectionTotals& s : profiling::collect()) {
+            const std::string key = s.phase.empty() ? s.name : s.phase + "/" + s.name;
+            auto cat = categories_.find(s.name);
+            const std::string category = cat != categories_.end() ? cat->second : "section";
+            r.section_times[key] = s.wall_ns / 1e6;
+            r.events.emplace_back(key, category, ProfilerMetric::WALL_TIME, s.wall_ns / 1e6, "ms");
+            if (s.counted) {
+                r.events.emplace_back(key, category, ProfilerMetric::CYCLES, static_cast<double>(s.counters[profiling::kCycles]));
+                r.events.emplace_back(key, category, ProfilerMetric::INSTRUCTIONS,
+                                      static_cast<double>(s.counters[profiling::kInstructions]));
+                r.events.emplace_back(key, category, ProfilerMetric::CACHE_MISSES,
+                                      static_cast<double>(s.counters[profiling::kCacheMisses]));
+                r.events.emplace_back(key, category, ProfilerMetric::BRANCH_MISSES,
+                                      static_cast<double>(s.counters[profiling::kBranchMisses]));
+            }
+        }
+        r.total_time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - profiler_start_).count();
+        r.total_events = r.events.size();
+        return r;
+    }
+
+    bool PerformanceProfiler::export_to_csv(const std::string& filename) const {
+        std::ofstream f(filename);
+        if (!f) return false;
+        f << "kind,phase,name,calls,threads,wall_ms,cycles,instructions,ipc,cache_misses,branch_misses,value,unit\n";
+        for (const profiling::SectionTotals& s : profiling::collect()) {
+            f << "section," << s.phase << "," << s.name << "," << s.calls << "," << s.threads << ","
+              << s.wall_ns / 1e6 << ",";
+            if (s.counted) {
+                f << s.counters[profiling::kCycles] << "," << s.counters[profiling::kInstructions] << ","
+                  << s.ipc() << "," << s.counters[profiling::kCacheMisses] << ","
+                  << s.counters[profiling::kBranchMisses];
+            } else {
+                f << ",,,,";
+            }
+            f << ",,\n";
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const PerformanceEvent& e : events_) {
+            f << "metric,," << e.name << ",,,,,,,,," << e.value << "," << e.unit << "\n";
+        }
+        return static_cast<bool>(f);
+    }
+
+    bool PerformanceProfiler::export_to_json(const std::string& filename) const {
+        std::ofstream f(filename);
+        if (!f) return false;
+        const std::vector<profiling::SectionTotals> sections = profiling::collect();
+        bool counted = false;
+        for (const auto& s : sections) counted = counted || s.counted > 0;
+
+        f << std::setprecision(6) << "{\n  \"hardware_counters\": " << (counted ? "true" : "false")
+          << ",\n  \"peak_memory_mb\": " << get_peak_memory_usage_mb() << ",\n  \"sections\": [";
+        for (std::size_t i = 0; i < sections.size(); ++i) {
+            const profiling::SectionTotals& s = sections[i];
+            f << (i ? ",\n" : "\n") << "    {\"phase\": \"" << profiling::json_escape(s.phase) << "\", \"name\": \""
+              << profiling::json_escape(s.name) << "\", \"calls\": " << s.calls << ", \"threads\": " << s.threads
+              << ", \"wall_ms\": " << s.wall_ns / 1e6;
+            if (s.counted) {
+                for (int c = 0; c < profiling::kCounters; ++c) {
+                    f << ", \"" << profiling::kCounterNames[c] << "\": " << s.counters[c];
+                }
+                f << ", \"ipc\": " << s.ipc();
+            }
+            f << "}";
+        }
+        f << "\n  ],\n  \"metrics\": [";
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t i = 0; i < events_.size(); ++i) {
+            const PerformanceEvent& e = events_[i];
+            f << (i ? ",\n" : "\n") << "    {\"name\": \"" << profiling::json_escape(e.name) << "\", \"category\": \""
+              << profiling::json_escape(e.category) << "\", \"metric\": \"" << profiling::metric_name(e.metric)
+              << "\", \"value\": " << e.value << ", \"unit\": \"" << profiling::json_escape(e.unit) << "\"}";
+        }
+        f << "\n  ]\n}\n";
+        return static_cast<bool>(f);
+    }
+
+    bool PerformanceProfiler::export_to_html(const std::string& filename) const {
+        std::ofstream f(filename);
+        if (!f) return false;
+        f << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>PiRacer profile</title></head><body>\n"
+          << "<table border=\"1\" cellspacing=\"0\" cellpadding=\"3\">\n"
+          << "<tr><th>phase</th><th>section</th><th>calls</th><th>threads</th><th>wall ms</th>"
+          << "<th>IPC</th><th>cache misses</th><th>branch misses</th></tr>\n";
+        for (const profiling::SectionTotals& s : profiling::collect()) {
+            f << "<tr><td>" << s.phase << "</td><td>" << s.name << "</td><td>" << s.calls << "</td><td>"
+              << s.threads << "</td><td>" << s.wall_ns / 1e6 << "</td>";
+            if (s.counted) {
+                f << "<td>" << s.ipc() << "</td><td>" << s.counters[profiling::kCacheMisses] << "</td><td>"
+                  << s.counters[profiling::kBranchMisses] << "</td>";
+            } else {
+                f << "<td></td><td></td><td></td>";
+            }
+            f << "</tr>\n";
+        }
+        f << "</table>\n</body></html>\n";
+        return static_cast<bool>(f);
+    }
+
+    std::string PerformanceProfiler::generate_report() const {
+        std::ostringstream os;
+        os << std::left << std::setw(10) << "phase" << std::setw(24) << "section" << std::right << std::setw(10)
+           << "calls" << std::setw(12) << "wall ms" << std::setw(8) << "IPC" << std::setw(14) << "cache miss"
+           << std::setw(14) << "branch miss" << "\n";
+        os << std::fixed;
+        for (const profiling::SectionTotals& s : profiling::collect()) {
+            os << std::left << std::setw(10) << s.phase << std::setw(24) << s.name << std::right << std::setw(10)
+               << s.calls << std::setw(12) << std::setprecision(3) << s.wall_ns / 1e6;
+            if (s.counted) {
+                os << std::setw(8) << std::setprecision(2) << s.ipc() << std::setw(14)
+                   << s.counters[profiling::kCacheMisses] << std::setw(14) << s.counters[profiling::kBranchMisses];
+            }
+            os << "\n";
+        }
+        return os.str();
+    }
+
+    void PerformanceProfiler::reset() {
+        {
+            profiling::Registry& reg = profiling::registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (const auto& t : reg.threads) t->clear();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.clear();
+        categories_.clear();
+        profiler_start_ = std::chrono::steady_clock::now();
+        peak_memory_usage_ = 0;
+    }
+
+    size_t PerformanceProfiler::get_current_memory_usage_mb() const {
+#if defined(__linux__)
+        unsigned long size = 0, resident = 0;
+        if (FILE* f = std::fopen("/proc/self/statm", "r")) {
+            if (std::fscanf(f, "%lu %lu", &size, &resident) != 2) resident = 0;
+            std::fclose(f);
+        }
+        return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / (1024 * 1024);
+#else
+        return g_memory_pool.total_allocated() / (1024 * 1024);
+#endif
+    }
+
+    size_t PerformanceProfiler::get_peak_memory_usage_mb() const {
+        update_memory_usage();
+        return peak_memory_usage_;
+    }
+
+    void PerformanceProfiler::update_memory_usage() const {
+        size_t peak = get_current_memory_usage_mb();
+#if defined(__unix__) || defined(__APPLE__)
+        rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#if defined(__APPLE__)
+            peak = std::max(peak, static_cast<size_t>(ru.ru_maxrss) / (1024 * 1024));  // bytes
+#else
+            peak = std::max(peak, static_cast<size_t>(ru.ru_maxrss) / 1024);  // KiB
+#endif
+        }
+#endif
+        peak_memory_usage_ = std::max(peak_memory_usage_, peak);
+    }
+
+    // ---- CacheProfiler ------------------------------------------------------------
+
+    namespace {
+        // One-shot counting of `n` hardware events around `code` on this thread
+        bool count_events(const std::uint64_t* configs, int n, std::uint64_t* out, const std::function<void()>& code) {
+            profiling::PerfGroup group;
+            std::uint64_t before[4] = {}, after[4] = {};
+            const bool ok = group.open(configs, n) && group.read(before);
+            code();
+            if (!ok || !group.read(after)) return false;
+            for (int i = 0; i < n; ++i) out[i] = after[i] - before[i];
+            return true;
+        }
+
+        size_t system_cache_value(int name, size_t fallback) {
+#if defined(__linux__) && defined(_SC_LEVEL1_DCACHE_LINESIZE)
+            const long v = sysconf(name);
+            if (v > 0) return static_cast<size_t>(v);
+#else
+            (void)name;
+#endif
+            return fallback;
+        }
+    } // namespace
+
+    CacheProfiler::CacheProfiler() {
+#if defined(__linux__) && defined(_SC_LEVEL1_DCACHE_LINESIZE)
+        cache_line_size_ = system_cache_value(_SC_LEVEL1_DCACHE_LINESIZE, cache_line_size_);
+        l1_cache_size_ = system_cache_value(_SC_LEVEL1_DCACHE_SIZE, l1_cache_size_);
+        l2_cache_size_ = system_cache_value(_SC_LEVEL2_CACHE_SIZE, l2_cache_size_);
+        l3_cache_size_ = system_cache_value(_SC_LEVEL3_CACHE_SIZE, l3_cache_size_);
+#endif
+    }
+
+    CacheProfiler::CacheAnalysis CacheProfiler::analyze_cache_performance(const void* data, size_t size,
+                                                                          size_t access_pattern) {
+        const size_t stride = access_pattern ? access_pattern : cache_line_size_;
+        const auto* bytes = static_cast<const volatile unsigned char*>(data);
+        const size_t steps = size ? (size + stride - 1) / stride : 0;
+
+        CacheAnalysis a{};
+        a.cache_line_size = cache_line_size_;
+        a.total_memory_footprint = size;
+
+        unsigned sum = 0;
+        std::uint64_t counts[2] = {};
+#if PIRACER_HAVE_PERF
+        const std::uint64_t events[2] = {PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+#else
+        const std::uint64_t events[2] = {0, 0};
+#endif
+        const bool counted = count_events(events, 2, counts, [&] {
+            for (size_t i = 0; i < size; i += stride) sum += bytes[i];
+        });
+        (void)sum;
+
+        if (counted && counts[0] > 0) {
+            a.total_accesses = static_cast<size_t>(counts[0]);
+            a.cache_misses = static_cast<size_t>(std::min(counts[1], counts[0]));
+        } else {
+            // Every line touched misses once the data cannot stay in L1
+            a.total_accesses = steps;
+            const size_t lines = size / cache_line_size_ + 1;
+            a.cache_misses = size > l1_cache_size_ ? std::min(steps, lines) : 0;
+        }
+        a.cache_hits = a.total_accesses - a.cache_misses;
+        a.miss_rate = a.total_accesses ? static_cast<double>(a.cache_misses) / a.total_accesses : 0.0;
+        a.hit_rate = a.total_accesses ? 1.0 - a.miss_rate : 0.0;
+        return a;
+    }
+
+    std::vector<CacheProfiler::CacheAnalysis> CacheProfiler::simulate_cache_configs(const void*, size_t size) {
+        std::vector<CacheAnalysis> out;
+        const size_t lines = (size + cache_line_size_ - 1) / cache_line_size_;
+        for (size_t level : {l1_cache_size_, l2_cache_size_, l3_cache_size_}) {
+            CacheAnalysis a{};
+            a.cache_line_size = cache_line_size_;
+            a.total_memory_footprint = size;
+            a.total_accesses = lines;
+            a.cache_misses = size > level ? lines : 0;
+            a.cache_hits = lines - a.cache_misses;
+            a.miss_rate = lines ? static_cast<double>(a.cache_misses) / lines : 0.0;
+            a.hit_rate = lines ? 1.0 - a.miss_rate : 0.0;
+            out.push_back(a);
+        }
+        return out;
+    }
+
+    size_t CacheProfiler::get_cache_line_size() const { return cache_line_size_; }
+    size_t CacheProfiler::get_l1_cache_size() const { return l1_cache_size_; }
+    size_t CacheProfiler::get_l2_cache_size() const { return l2_cache_size_; }
+    size_t CacheProfiler::get_l3_cache_size() const { return l3_cache_size_; }
+
+    // ---- BranchProfiler -----------------------------------------------------------
+
+    BranchProfiler::BranchAnalysis BranchProfiler::analyze_branch_performance(const std::function<void()>& code) {
+#if PIRACER_HAVE_PERF
+        const std::uint64_t events[2] = {PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+#else
+        const std::uint64_t events[2] = {0, 0};
+#endif
+        std::uint64_t counts[2] = {};
+        BranchAnalysis a{};
+        if (count_events(events, 2, counts, code)) {
+            a.total_branches = static_cast<size_t>(counts[0]);
+            a.mispredicted_branches = static_cast<size_t>(std::min(counts[1], counts[0]));
+            a.prediction_accuracy = counts[0] ? 1.0 - static_cast<double>(counts[1]) / counts[0] : 0.0;
+        }
+        branch_stats_["run " + std::to_string(branch_stats_.size() + 1)] = a;
+        return a;
+    }
+
+    std::map<std::string, BranchProfiler::BranchAnalysis> BranchProfiler::get_branch_statistics() const {
+        return branch_stats_;
+    }
+
+    void BranchProfiler::reset_counters() {
+        branch_stats_.clear();
+    }
+
+    // ---- PerformanceComparator ----------------------------------------------------
+
+    double PerformanceComparator::measure_execution_time(const std::function<void()>& func, int iterations) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) func();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        return iterations > 0 ? ms / iterations : 0.0;
+    }
+
+    size_t PerformanceComparator::measure_memory_usage(const std::function<void()>& func) {
+        // The pool sees every GMP limb; without it, only resident growth shows
+        if (gmp_allocator_installed()) {
+            const size_t base = g_memory_pool.total_allocated();
+            g_memory_pool.reset_window_peak();
+            func();
+            const size_t peak = g_memory_pool.window_peak();
+            return peak > base ? peak - base : 0;
+        }
+        PerformanceProfiler p;
+        const size_t before = p.get_current_memory_usage_mb();
+        func();
+        const size_t after = p.get_current_memory_usage_mb();
+        return after > before ? (after - before) * 1024 * 1024 : 0;
+    }
+
+    PerformanceComparator::ComparisonResult PerformanceComparator::compare_implementations(
+        const std::string& name_a, const std::function<void()>& impl_a,
+        const std::string& name_b, const std::function<void()>& impl_b, int iterations) {
+        ComparisonResult r;
+        r.implementation_a = name_a;
+        r.implementation_b = name_b;
+
+        const double ta = measure_execution_time(impl_a, iterations);
+        const double tb = measure_execution_time(impl_b, iterations);
+        const size_t ma = measure_memory_usage(impl_a);
+        const size_t mb = measure_memory_usage(impl_b);
+        r.speedup_factor = tb > 0 ? ta / tb : 0.0;
+        r.memory_ratio = mb > 0 ? static_cast<double>(ma) / mb : (ma == 0 ? 1.0 : 0.0);
+
+        std::ostringstream speed;
+        speed << std::fixed << std::setprecision(2);
+        if (r.speedup_factor > 1.0) {
+            speed << r.speedup_factor << "x faster";
+            r.advantages_b.push_back(speed.str());
+        } else if (r.speedup_factor > 0.0 && r.speedup_factor < 1.0) {
+            speed << 1.0 / r.speedup_factor << "x faster";
+            r.advantages_a.push_back(speed.str());
+        }
+        if (ma < mb) r.advantages_a.push_back("less memory");
+        if (mb < ma) r.advantages_b.push_back("less memory");
+
+        r.recommendation = r.speedup_factor > 1.0 ? name_b : name_a;
+        return r;
+    }
+
+    std::string PerformanceComparator::generate_comparison_report(const std::vector<ComparisonResult>& results) {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3);
+        for (const ComparisonResult& r : results) {
+            os << r.implementation_a << " vs " << r.implementation_b << ": time ratio " << r.speedup_factor
+               << ", memory ratio " << r.memory_ratio << " -> " << r.recommendation << "\n";
+            for (const std::string& s : r.advantages_a) os << "  " << r.implementation_a << ": " << s << "\n";
+            for (const std::string& s : r.advantages_b) os << "  " << r.implementation_b << ": " << s << "\n";
+        }
+        return os.str();
+    }
+
+    bool PerformanceComparator::export_comparison_to_csv(const std::string& filename,
+                                                         const std::vector<ComparisonResult>& results) const {
+        std::ofstream f(filename);
+        if (!f) return false;
+        f << "implementation_a,implementation_b,speedup_factor,memory_ratio,recommendation\n";
+        for (const ComparisonResult& r : results) {
+            f << r.implementation_a << "," << r.implementation_b << "," << r.speedup_factor << ","
+              << r.memory_ratio << "," << r.recommendation << "\n";
+        }
+        return static_cast<bool>(f);
+    }
+
+} // namespace piracer
@@ -184,4 +184,71 @@ namespace piracer {
         }
     }
     
-} // namespace piracer 
\ No newline at end of file
+    namespace {
+        std::atomic<std::size_t> g_next_slot{0};
+    } // namespace
+
+    ProgressCounters::ProgressCounters(const ProgressCounters& other) {
+        *this = other;
+    }
+
+    ProgressCounters& ProgressCounters::operator=(const ProgressCounters& other) {
+        for (std::size_t i = 0; i < kSlots; ++i) {
+            slots_[i].value.store(other.slots_[i].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    void ProgressCounters::add(std::uint64_t work) {
+        static thread_local const std::size_t slot = g_next_slot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+        slots_[slot].value.fetch_add(work, std::memory_order_relaxed);
+    }
+
+    std::uint64_t ProgressCounters::sum() const {
+        std::uint64_t total = 0;
+        for (const Slot& s : slots_) total += s.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    void ProgressCounters::reset() {
+        for (Slot& s : slots_) s.value.store(0, std::memory_order_relaxed);
+    }
+
+    ProgressReporter::ProgressReporter(Progress* prog, std::uint64_t total, std::chrono::milliseconds period)
+        : period_(period) {
+        if (!prog || prog->reporting.exchange(true)) return;
+        prog_ = prog;
+        prog_->counters.reset();
+        prog_->done = 0;
+        prog_->total = static_cast<std::size_t>(total);
+        if (prog_->tracker) prog_->tracker->set_total(prog_->total);
+
+        thread_ = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, period_, [this] { return stop_; })) publish();
+        });
+    }
+
+    ProgressReporter::~ProgressReporter() {
+        if (!prog_) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+
+        // The writers are done: this sample is exact
+        publish();
+        if (prog_->tracker) prog_->tracker->report_event(ProgressEventType::COMPLETED, "Computation finished");
+        prog_->reporting = false;
+    }
+
+    void ProgressReporter::publish() {
+        const std::size_t done = static_cast<std::size_t>(prog_->counters.sum());
+        prog_->done = std::min(done, prog_->total);
+        if (prog_->tick) prog_->tick(prog_->done, prog_->total, prog_->user);
+        if (prog_->tracker) prog_->tracker->update(prog_->done);
+    }
+
+} // namespace piracer
@@ -0,0 +1,394 @@
+#include "piracer/radix.hpp"
+#include "piracer/bigmul.hpp"
+#include "piracer/digit_sink.hpp"
+#include "piracer/simd.hpp"
+#include "piracer/thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace piracer {
+
+    namespace {
+        // Digits per leaf, converted by mpz_get_str into a stack buffer
+        constexpr std::size_t kLeafDigits = 2048;
+
+        // Subtrees below this many digits are converted on the calling thread
+        constexpr std::size_t kParallelDigits = std::size_t(1) << 16;
+
+        // Hex digits per task in mpz_to_hex
+        constexpr std::size_t kHexBlockDigits = std::size_t(1) << 20;
+
+        // Guard bits every fraction node carries beyond its digit count
+        constexpr std::size_t kGuardBits = 64;
+
+        // Smallest k with n <= kLeafDigits * 2^k
+        std::size_t level_of(std::size_t n) {
+            std::size_t k = 0;
+            while ((kLeafDigits << k) < n) ++k;
+            return k;
+        }
+
+        // powers[k] = 10^(kLeafDigits * 2^k)
+        std::vector<mpz_class> decimal_powers(std::size_t digits, ThreadPool* pool) {
+            std::vector<mpz_class> powers;
+            if (digits <= kLeafDigits) return powers;
+
+            powers.emplace_back();
+            mpz_ui_pow_ui(powers.back().get_mpz_t(), 10, kLeafDigits);
+            while ((kLeafDigits << powers.size()) < digits) {
+                mpz_class next;
+                mul_big(next, powers.back(), powers.back(), pool);
+                powers.push_back(std::move(next));
+            }
+            return powers;
+        }
+
+        // Write n < 10^digits into out[0, digits) with digits <= kLeafDigits * 2^k
+        void convert(char* out, std::size_t digits, mpz_class& n, std::size_t k,
+                     const std::vector<mpz_class>& powers, ThreadPool* pool) {
+            // Values that fit the lower half of this level skip the division
+            while (k > 0 && digits <= (kLeafDigits << (k - 1))) --k;
+
+            if (k == 0) {
+                char buf[kLeafDigits + 2];
+                if (mpz_sizeinbase(n.get_mpz_t(), 10) > digits + 1) {
+                    throw std::invalid_argument("mpz_to_decimal: value has more digits than requested");
+                }
+                mpz_get_str(buf, 10, n.get_mpz_t());
+                const std::size_t len = std::strlen(buf);
+                if (len > digits) {
+                    throw std::invalid_argument("mpz_to_decimal: value has more digits than requested");
+                }
+                std::memset(out, '0', digits - len);
+                std::memcpy(out + digits - len, buf, len);
+                return;
+            }
+
+            // n = hi * 10^low + lo; n itself is no longer needed once split
+            const std::size_t low = kLeafDigits << (k - 1);
+            mpz_class hi, lo;
+            mpz_tdiv_qr(hi.get_mpz_t(), lo.get_mpz_t(), n.get_mpz_t(), powers[k - 1].get_mpz_t());
+            mpz_class().swap(n);
+
+            TaskGroup g(digits >= kParallelDigits ? pool : nullptr);
+            g.spawn([&] { convert(out, digits - low, hi, k - 1, powers, pool); });
+            convert(out + digits - low, low, lo, k - 1, powers, pool);
+            g.sync();
+        }
+
+        // Fraction nodes hold f / 2^b, a truncation (never an overestimate) of
+        // the exact fraction whose first n digits they produce. b exceeds
+        // n*log2(10) by the guard bits plus one bit per tree level, so the
+        // error reaching a right child is at most the parent's plus one ulp.
+        std::size_t fraction_bits(std::size_t n) {
+            return static_cast<std::size_t>(static_cast<double>(n) * 3.3219280948873626) + 1 +
+                   kGuardBits + level_of(n);
+        }
+
+        // A truncated value whose top 32 bits (of b) are all ones may sit just
+        // below a carry that the exact value produces
+        bool near_carry(const mpz_class& x, std::size_t b) {
+            return mpz_scan0(x.get_mpz_t(), b - 32) >= b;
+        }
+
+        struct FractionTree {
+            const std::vector<mpz_class>& powers;
+            const mpz_class& r;
+            std::size_t s;
+            ThreadPool* pool;
+        };
+
+        // Digits [offset, offset + n) of r / 2^s computed exactly: the
+        // fallback for nodes whose truncated value is too close to a carry.
+        // Expected about once in 2^32 nodes.
+        void exact_digits(char* out, std::size_t offset, std::size_t n, const FractionTree& t) {
+            mpz_class x, m;
+            mpz_ui_pow_ui(x.get_mpz_t(), 10, offset + n);
+            mul_big(x, x, t.r, t.pool);
+            mpz_fdiv_q_2exp(x.get_mpz_t(), x.get_mpz_t(), t.s);
+            mpz_ui_pow_ui(m.get_mpz_t(), 10, n);
+            mpz_fdiv_r(x.get_mpz_t(), x.get_mpz_t(), m.get_mpz_t());
+            mpz_to_decimal(out, n, std::move(x), t.pool);
+        }
+
+        // Split node f / 2^b (n digits) into its top `hi` digits (f_hi / 2^b_hi)
+        // and the remaining lo digits (f_lo / 2^b_lo). Consumes f; returns
+        // false if the split is ambiguous.
+        bool split_node(std::size_t n, mpz_class& f, std::size_t b, const FractionTree& t,
+                        std::size_t& hi, mpz_class& f_hi, std::size_t& b_hi,
+                        mpz_class& f_lo, std::size_t& b_lo) {
+            const std::size_t k = level_of(n);
+            hi = kLeafDigits << (k - 1);
+            b_hi = fraction_bits(hi);
+            b_lo = fraction_bits(n - hi);
+
+            mpz_fdiv_q_2exp(f_hi.get_mpz_t(), f.get_mpz_t(), b - b_hi);
+            mul_big(f_lo, f, t.powers[k - 1], t.pool);
+            mpz_class().swap(f);
+            mpz_fdiv_r_2exp(f_lo.get_mpz_t(), f_lo.get_mpz_t(), b);
+            if (near_carry(f_lo, b)) return false;
+            mpz_fdiv_q_2exp(f_lo.get_mpz_t(), f_lo.get_mpz_t(), b - b_lo);
+            return true;
+        }
+
+        // Digits [offset, offset + n) from the node f / 2^b into out[0, n)
+        void fraction_node(char* out, std::size_t offset, std::size_t n, mpz_class& f, std::size_t b,
+                           const FractionTree& t) {
+            if (level_of(n) == 0) {
+                mpz_class x;
+                mpz_ui_pow_ui(x.get_mpz_t(), 10, n);
+                x *= f;
+                if (near_carry(x, b)) {
+                    exact_digits(out, offset, n, t);
+                    return;
+                }
+                mpz_fdiv_q_2exp(x.get_mpz_t(), x.get_mpz_t(), b);
+
+                char buf[kLeafDigits + 2];
+                mpz_get_str(buf, 10, x.get_mpz_t());
+                const std::size_t len = std::strlen(buf);
+                std::memset(out, '0', n - len);
+                std::memcpy(out + n - len, buf, len);
+                return;
+            }
+
+            // The top hi digits come from the same fraction at lower precision,
+            // the rest from frac(f * 10^hi)
+            std::size_t hi, b_hi, b_lo;
+            mpz_class f_hi, f_lo;
+            if (!split_node(n, f, b, t, hi, f_hi, b_hi, f_lo, b_lo)) {
+                exact_digits(out, offset, n, t);
+                return;
+            }
+
+            TaskGroup g(n >= kParallelDigits ? t.pool : nullptr);
+            g.spawn([&] { fraction_node(out, offset, hi, f_hi, b_hi, t); });
+            fraction_node(out + hi, offset + hi, n - hi, f_lo, b_lo, t);
+            g.sync();
+        }
+
+        // Streaming variant: subtrees up to the scratch size are converted
+        // there and handed to the sink; larger ones are walked left to right
+        void stream_node(DigitSink& sink, std::vector<char>& scratch, std::size_t offset, std::size_t n,
+                         mpz_class& f, std::size_t b, const FractionTree& t) {
+            if (n <= scratch.size()) {
+                fraction_node(scratch.data(), offset, n, f, b, t);
+                sink.write(scratch.data(), n);
+                return;
+            }
+
+            std::size_t hi, b_hi, b_lo;
+            mpz_class f_hi, f_lo;
+            if (!split_node(n, f, b, t, hi, f_hi, b_hi, f_lo, b_lo)) {
+                std::vector<char> all(n);
+                exact_digits(all.data(), offset, n, t);
+                sink.write(all.data(), n);
+                return;
+            }
+            stream_node(sink, scratch, offset, hi, f_hi, b_hi, t);
+            stream_node(sink, scratch, offset + hi, n - hi, f_lo, b_lo, t);
+        }
+
+        // Check 0 <= r < 2^s and return the root node f / 2^b for `digits` digits
+        mpz_class fraction_root(const mpz_class& r, std::size_t s, std::size_t b) {
+            if (r < 0 || (r != 0 && mpz_sizeinbase(r.get_mpz_t(), 2) > s)) {
+                throw std::invalid_argument("fraction_to_decimal: need 0 <= r < 2^s");
+            }
+            mpz_class f;
+            if (s >= b) {
+                mpz_fdiv_q_2exp(f.get_mpz_t(), r.get_mpz_t(), s - b);
+            } else {
+                mpz_mul_2exp(f.get_mpz_t(), r.get_mpz_t(), b - s);
+            }
+            return f;
+        }
+
+        // Bits [pos, pos + 4) of the limb array, zero outside it (pos may be negative)
+        inline unsigned nibble_at(const mp_limb_t* limbs, std::size_t nlimbs, std::ptrdiff_t pos) {
+            constexpr std::ptrdiff_t kBits = GMP_NUMB_BITS;
+            if (pos < 0) {
+                return pos > -4 && nlimbs > 0 ? static_cast<unsigned>(limbs[0] << -pos) & 15u : 0u;
+            }
+            const std::size_t limb = static_cast<std::size_t>(pos / kBits);
+            const unsigned off = static_cast<unsigned>(pos % kBits);
+            if (limb >= nlimbs) return 0;
+            mp_limb_t v = limbs[limb] >> off;
+            if (off > kBits - 4 && limb + 1 < nlimbs) v |= limbs[limb + 1] << (kBits - off);
+            return static_cast<unsigned>(v) & 15u;
+        }
+
+        // The fraction held in the low `s` bits of a limb array
+        struct HexSource {
+            const mp_limb_t* limbs;
+            std::size_t nlimbs;
+            std::size_t s;
+        };
+
+        HexSource hex_source(const mpz_class& r, std::size_t s) {
+            return {mpz_limbs_read(r.get_mpz_t()), mpz_size(r.get_mpz_t()), s};
+        }
+
+#if GMP_NUMB_BITS == 64
+        // Bits [pos, pos + 64) of the limb array, zero outside it (pos may be negative)
+        inline std::uint64_t window_at(const mp_limb_t* limbs, std::size_t nlimbs, std::ptrdiff_t pos) {
+            if (pos <= -64 || nlimbs == 0) return 0;
+            if (pos < 0) return limbs[0] << -pos;
+            const std::size_t limb = static_cast<std::size_t>(pos) / 64;
+            const unsigned off = static_cast<unsigned>(pos) % 64;
+            const std::uint64_t lo = limb < nlimbs ? limbs[limb] : 0;
+            if (off == 0) return lo;
+            const std::uint64_t hi = limb + 1 < nlimbs ? limbs[limb + 1] : 0;
+            return (lo >> off) | (hi << (64 - off));
+        }
+#endif
+
+        // out[i] for i in [begin, end) = hex digit i after the point
+        void emit_hex(char* out, std::size_t begin, std::size_t end, const HexSource& src) {
+            static const char kHex[] = "0123456789abcdef";
+            std::size_t i = begin;
+#if GMP_NUMB_BITS == 64
+            // Sixteen digits i .. i + 15 are the 64 bits from s - 4 (i + 16) up
+            constexpr std::size_t kWords = 256;
+            std::uint64_t words[kWords];
+            while (end - i >= 16) {
+                const std::size_t m = std::min(kWords, (end - i) / 16);
+                for (std::size_t k = 0; k < m; ++k) {
+                    const std::ptrdiff_t pos = static_cast<std::ptrdiff_t>(src.s) -
+                                               4 * static_cast<std::ptrdiff_t>(i + 16 * (k + 1));
+                    words[k] = window_at(src.limbs, src.nlimbs, pos);
+                }
+                simd::hex_expand(out + (i - begin), words, m);
+                i += 16 * m;
+            }
+#endif
+            for (; i < end; ++i) {
+                const std::ptrdiff_t pos = static_cast<std::ptrdiff_t>(src.s) - 4 * static_cast<std::ptrdiff_t>(i) - 4;
+                out[i - begin] = kHex[nibble_at(src.limbs, src.nlimbs, pos)];
+            }
+        }
+
+        // Hex digits [begin, end) into out, in parallel blocks
+        void hex_range(char* out, std::size_t begin, std::size_t end, const HexSource& src, ThreadPool* pool) {
+            TaskGroup g(end - begin >= 2 * kHexBlockDigits ? pool : nullptr);
+            for (std::size_t b = begin + kHexBlockDigits; b < end; b += kHexBlockDigits) {
+                g.spawn([=, &src] { emit_hex(out + (b - begin), b, std::min(end, b + kHexBlockDigits), src); });
+            }
+            emit_hex(out, begin, std::min(end, begin + kHexBlockDigits), src);
+            g.sync();
+        }
+
+        // Streams the digits block by block; with a pool the next block is
+        // converted while the current one is being written
+        void hex_stream(DigitSink& sink, std::size_t digits, const HexSource& src, ThreadPool* pool,
+                        std::size_t block_digits) {
+            const std::size_t block = std::max<std::size_t>(1, std::min(digits, block_digits));
+            std::vector<char> cur(block), next(pool && digits > block ? block : 0);
+            if (digits == 0) return;
+            hex_range(cur.data(), 0, block, src, pool);
+            for (std::size_t begin = 0; begin < digits; begin += block) {
+                const std::size_t end = std::min(digits, begin + block);
+                const std::size_t next_end = std::min(digits, end + block);
+                if (next.empty()) {
+                    sink.write(cur.data(), end - begin);
+                    if (end < digits) hex_range(cur.data(), end, next_end, src, pool);
+                    continue;
+                }
+                {
+                    TaskGroup g(pool);
+                    if (end < digits) g.spawn([&] { hex_range(next.data(), end, next_end, src, pool); });
+                    sink.write(cur.data(), end - begin);
+                    g.sync();
+                }
+                cur.swap(next);
+            }
+        }
+
+        void check_hex_fraction(const mpz_class& r, std::size_t s) {
+            if (r < 0 || (r != 0 && mpz_sizeinbase(r.get_mpz_t(), 2) > s)) {
+                throw std::invalid_argument("fraction_to_hex: need 0 <= r < 2^s");
+            }
+        }
+    } // namespace
+
+    void mpz_to_decimal(char* out, std::size_t digits, mpz_class n, ThreadPool* pool) {
+        if (n < 0) throw std::invalid_argument("mpz_to_decimal: negative value");
+        if (digits == 0) {
+            if (n != 0) throw std::invalid_argument("mpz_to_decimal: value has more digits than requested");
+            return;
+        }
+
+        const std::vector<mpz_class> powers = decimal_powers(digits, pool);
+        convert(out, digits, n, powers.size(), powers, pool);
+    }
+
+    void fraction_to_decimal(char* out, std::size_t digits, const mpz_class& r, std::size_t s,
+                             ThreadPool* pool) {
+        const std::size_t b = fraction_bits(digits);
+        mpz_class f = fraction_root(r, s, b);
+        if (digits == 0) return;
+
+        const std::vector<mpz_class> powers = decimal_powers(digits, pool);
+        const FractionTree t{powers, r, s, pool};
+        fraction_node(out, 0, digits, f, b, t);
+    }
+
+    void fraction_to_decimal(DigitSink& sink, std::size_t digits, const mpz_class& r, std::size_t s,
+                             ThreadPool* pool, std::size_t block_digits) {
+        const std::size_t b = fraction_bits(digits);
+        mpz_class f = fraction_root(r, s, b);
+        if (digits == 0) return;
+
+        const std::vector<mpz_class> powers = decimal_powers(digits, pool);
+        const FractionTree t{powers, r, s, pool};
+        std::vector<char> scratch(std::max(kLeafDigits, std::min(digits, block_digits)));
+        stream_node(sink, scratch, 0, digits, f, b, t);
+    }
+
+    void fraction_to_hex(char* out, std::size_t digits, const mpz_class& r, std::size_t s, ThreadPool* pool) {
+        check_hex_fraction(r, s);
+        hex_range(out, 0, digits, hex_source(r, s), pool);
+    }
+
+    void fraction_to_hex(DigitSink& sink, std::size_t digits, const mpz_class& r, std::size_t s,
+                         ThreadPool* pool, std::size_t block_digits) {
+        check_hex_fraction(r, s);
+        hex_stream(sink, digits, hex_source(r, s), pool, block_digits);
+    }
+
+    void fraction_to_hex(char* out, std::size_t digits, const mp_limb_t* limbs, std::size_t nlimbs, std::size_t s,
+                         ThreadPool* pool) {
+        hex_range(out, 0, digits, HexSource{limbs, nlimbs, s}, pool);
+    }
+
+    void fraction_to_hex(DigitSink& sink, std::size_t digits, const mp_limb_t* limbs, std::size_t nlimbs,
+                         std::size_t s, ThreadPool* pool, std::size_t block_digits) {
+        hex_stream(sink, digits, HexSource{limbs, nlimbs, s}, pool, block_digits);
+    }
+
+    void mpz_to_hex(char* out, std::size_t digits, const mpz_class& n, ThreadPool* pool) {
+        if (n < 0) throw std::invalid_argument("mpz_to_hex: negative value");
+        if (n != 0 && mpz_sizeinbase(n.get_mpz_t(), 2) > 4 * digits) {
+            throw std::invalid_argument("mpz_to_hex: value has more digits than requested");
+        }
+        // n < 16^digits is the fraction n / 2^(4 * digits)
+        hex_range(out, 0, digits, hex_source(n, 4 * digits), pool);
+    }
+
+    std::string mpz_to_decimal_string(const mpz_class& n, ThreadPool* pool) {
+        const bool neg = n < 0;
+        mpz_class a = neg ? mpz_class(-n) : n;
+
+        // sizeinbase may overshoot by one: convert padded, then drop the zero
+        const std::size_t digits = mpz_sizeinbase(a.get_mpz_t(), 10);
+        std::string out(digits + (neg ? 1 : 0), '-');
+        mpz_to_decimal(&out[neg ? 1 : 0], digits, std::move(a), pool);
+        const std::size_t first = neg ? 1 : 0;
+        if (digits > 1 && out[first] == '0') out.erase(first, 1);
+        return out;
+    }
+
+} // namespace piracer
@@ -1,9 +1,51 @@
 #include "piracer/selftest.hpp"
 #include "piracer/format.hpp"
 #include "piracer/chudnovsky.hpp"
+#include "piracer/pipeline.hpp"
+#include "piracer/constants.hpp"
+#include "piracer/bigmul.hpp"
+#include "piracer/radix.hpp"
+#include "piracer/digit_sink.hpp"
+#include "piracer/disk_int.hpp"
+#include "piracer/memory_pool.hpp"
+#include "piracer/newton.hpp"
+#include "piracer/checkpoint.hpp"
+#include "piracer/bsplit.hpp"
+#include "piracer/bbp.hpp"
+#include "piracer/distributed.hpp"
+#include "piracer/gpu_backend.hpp"
+#include "piracer/simd.hpp"
+#include "piracer/thread_pool.hpp"
+#include "piracer/tuning.hpp"
+#include "piracer/service.hpp"
+#include "piracer/socket.hpp"
 
 #include <mpfr.h>
+#include <gmpxx.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 namespace piracer {
     bool self_test(std::size_t digits, std::string* message) {
@@ -33,4 +75,1388 @@ namespace piracer {
         }
         return ok;
     }
-} // namespace piracer
\ No newline at end of file
+
+    namespace {
+        // Each suite returns false with `why` set at its first failure
+
+        std::size_t first_mismatch(const std::string& a, const std::string& b) {
+            std::size_t i = 0, n = std::min(a.size(), b.size());
+            while (i < n && a[i] == b[i]) ++i;
+            return i;
+        }
+
+        // `n` digits of x in `base`, zero-padded (x < base^n)
+        std::string padded(const mpz_class& x, int base, std::size_t n) {
+            std::string s = x.get_str(base);
+            return s.size() < n ? std::string(n - s.size(), '0') + s : s;
+        }
+
+        // ---- pool: task completion, exceptions and idle waits --------------
+
+        bool test_pool(std::string& why) {
+            ThreadPool pool(2);
+
+            // A throwing spawn() task is retired like any other, so wait_all
+            // returns (a hang here is the failure ctest's timeout reports)
+            std::atomic<int> ran{0};
+            for (int i = 0; i < 16; ++i) {
+                pool.spawn([&ran, i] {
+                    ++ran;
+                    if (i % 3 == 0) throw std::runtime_error("spawned task failed");
+                });
+            }
+            pool.wait_all();
+            if (ran != 16 || pool.in_flight() != 0) {
+                why = "wait_all returned with tasks still running";
+                return false;
+            }
+
+            // submit() and TaskGroup hand the exception to the caller
+            auto failed = pool.submit([]() -> int { throw std::runtime_error("submitted task failed"); });
+            try {
+                failed.get();
+                why = "submit() lost the task's exception";
+                return false;
+            } catch (const std::runtime_error&) {
+            }
+            try {
+                TaskGroup g(&pool);
+                for (int i = 0; i < 4; ++i) {
+                    g.spawn([i] {
+                        if (i == 2) throw std::runtime_error("group child failed");
+                    });
+                }
+                g.sync();
+                why = "TaskGroup::sync lost a child's exception";
+                return false;
+            } catch (const std::runtime_error&) {
+            }
+            pool.wait_all();
+
+            // The workers still run tasks after all that
+            if (pool.submit([] { return 7; }).get() != 7) {
+                why = "pool stopped working after exceptions";
+                return false;
+            }
+
+            // A helper with nothing to run sleeps: waiting on a sleeping child
+            // must cost far less CPU time than the child takes
+            const std::clock_t cpu0 = std::clock();
+            {
+                TaskGroup g(&pool);
+                g.spawn([] { std::this_thread::sleep_for(std::chrono::milliseconds(300)); });
+                g.sync();
+            }
+            const double cpu = double(std::clock() - cpu0) / CLOCKS_PER_SEC;
+            if (cpu > 0.1) {
+                why = "TaskGroup::sync used " + std::to_string(cpu) + " s of CPU waiting for 0.3 s";
+                return false;
+            }
+            why = "tasks retired, exceptions delivered, waits sleep";
+            return true;
+        }
+
+        // ---- mul: mul_ntt against mpz_mul ------------------------------------
+
+        // Puts the kernel chosen at startup back after forcing others
+        struct KernelRestore {
+            simd::ntt::Kernel kind = simd::ntt::kernels().kind;
+            ~KernelRestore() { simd::ntt::force_kernel(kind); }
+        };
+
+        bool test_mul(std::string& why) {
+            using simd::ntt::Kernel;
+            gmp_randclass rng(gmp_randinit_default);
+            rng.seed(20240601);
+            ThreadPool pool(2);
+            KernelRestore restore;
+
+            // (limbs of a, limbs of b): tiny, odd, power-of-two and unbalanced
+            // shapes, across the transform-length steps
+            const std::size_t shapes[][2] = {{1, 1}, {2, 1}, {3, 3}, {17, 5}, {64, 64}, {255, 256},
+                                             {1000, 1000}, {1000, 7}, {4096, 4096}, {5000, 333},
+                                             {20000, 20000}, {65536, 1024}};
+            for (Kernel k : {Kernel::Scalar, Kernel::AVX2, Kernel::AVX512, Kernel::NEON}) {
+                if (!simd::ntt::kernel_available(k)) continue;
+                simd::ntt::force_kernel(k);
+                const std::string kname = simd::ntt::kernel_name(k);
+                for (const auto& shape : shapes) {
+                    const mpz_class a = rng.get_z_bits(shape[0] * GMP_NUMB_BITS);
+                    const mpz_class b = rng.get_z_bits(shape[1] * GMP_NUMB_BITS);
+                    // All-ones operands carry through every coefficient
+                    const mpz_class ones = (mpz_class(1) << (shape[0] * GMP_NUMB_BITS)) - 1;
+                    const struct {
+                        const char* what;
+                        mpz_class x, y;
+                    } cases[] = {{"random", a, b}, {"negative", -a, b}, {"square", a, a},
+                                 {"all-ones", ones, ones}, {"zero", a, mpz_class(0)}};
+                    for (const auto& c : cases) {
+                        const mpz_class expected = c.x * c.y;
+                        for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+                            mpz_class got;
+                            mul_ntt(c.x, c.y, got, p);
+                            if (got != expected) {
+                                why = std::string(c.what) + " " + std::to_string(shape[0]) + "x" +
+                                      std::to_string(shape[1]) + " limbs differs from mpz_mul (" + kname +
+                                      " kernel" + (p ? ", pool" : "") + ")";
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+            why = "mul_ntt matches mpz_mul";
+            return true;
+        }
+
+        // ---- radix: fraction_to_decimal next to digit boundaries -------------
+
+        bool test_radix(std::string& why) {
+            gmp_randclass rng(gmp_randinit_default);
+            rng.seed(31415926);
+            ThreadPool pool(2);
+
+            // floor(r * 10^d / 2^s) by mpz_get_str, both ways of ours
+            auto check = [&](const mpz_class& r, std::size_t s, std::size_t d, const std::string& what) {
+                mpz_class ten_d;
+                mpz_ui_pow_ui(ten_d.get_mpz_t(), 10, d);
+                const std::string expected = padded((r * ten_d) >> s, 10, d);
+                std::string got(d, '\0');
+                fraction_to_decimal(&got[0], d, r, s, &pool);
+                StringSink sink;
+                fraction_to_decimal(sink, d, r, s, nullptr, 777);
+                const std::string* bad = got != expected ? &got : sink.str != expected ? &sink.str : nullptr;
+                if (bad) {
+                    why = what + " at " + std::to_string(d) + " digits differs at digit " +
+                          std::to_string(first_mismatch(*bad, expected)) + (bad == &got ? "" : " (streamed)");
+                    return false;
+                }
+                return true;
+            };
+
+            for (std::size_t d : {1, 19, 20, 64, 1000, 5000, 40000}) {
+                mpz_class ten_d;
+                mpz_ui_pow_ui(ten_d.get_mpz_t(), 10, d);
+                const std::size_t s0 = mpz_sizeinbase(ten_d.get_mpz_t(), 2);
+                for (std::size_t s : {s0 + 1, s0 + 64, s0 + 1000}) {
+                    // Just above and just below K / 10^d: the digits of K
+                    // then only zeros, or of K - 1 then only nines
+                    const mpz_class K = rng.get_z_range(ten_d);
+                    mpz_class hi = K << s;
+                    mpz_cdiv_q(hi.get_mpz_t(), hi.get_mpz_t(), ten_d.get_mpz_t());
+                    if (!check(hi, s, d, "just above a boundary") || !check(hi - 1, s, d, "just below a boundary"))
+                        return false;
+
+                    // Runs of nines and zeros past the digits shown, and
+                    // across the blocks inside them
+                    std::string n = padded(rng.get_z_range(ten_d), 10, d);
+                    for (std::size_t i = 0; i < d; i += 997) {
+                        const std::size_t len = std::min<std::size_t>(25, d - i);
+                        n.replace(i, len, len, i % 2 ? '0' : '9');
+                    }
+                    n += std::string(30, '9') + "1";
+                    mpz_class r(n, 10);
+                    r <<= s;
+                    mpz_class ten_m;
+                    mpz_ui_pow_ui(ten_m.get_mpz_t(), 10, n.size());
+                    r /= ten_m;
+                    if (!check(r, s, d, "digit runs")) return false;
+
+                    if (!check(rng.get_z_bits(s), s, d, "random fraction")) return false;
+                }
+            }
+            why = "fraction_to_decimal matches mpz_get_str";
+            return true;
+        }
+
+        // ---- checkpoint: binary round trips and corruption -------------------
+
+        bool same_checkpoint(const BinaryCheckpoint& a, const BinaryCheckpoint& b) {
+            if (a.digits != b.digits || a.base != b.base || a.num_threads != b.num_threads ||
+                a.completed_terms != b.completed_terms || a.total_terms != b.total_terms ||
+                a.algorithm_name != b.algorithm_name || a.segments.size() != b.segments.size())
+                return false;
+            for (std::size_t i = 0; i < a.segments.size(); ++i) {
+                const auto& x = a.segments[i];
+                const auto& y = b.segments[i];
+                if (x.begin != y.begin || x.end != y.end || x.state.P != y.state.P || x.state.Q != y.state.Q ||
+                    x.state.T != y.state.T)
+                    return false;
+            }
+            return true;
+        }
+
+        bool test_checkpoint(std::string& why) {
+            BinaryCheckpoint data;
+            data.digits = 5000;
+            data.base = 16;
+            data.num_threads = 3;
+            data.completed_terms = 350;
+            data.total_terms = 400;
+            for (const auto& range : {std::make_pair(0L, 200L), std::make_pair(200L, 350L), std::make_pair(350L, 351L)}) {
+                CheckpointSegment seg;
+                seg.begin = static_cast<std::uint64_t>(range.first);
+                seg.end = static_cast<std::uint64_t>(range.second);
+                seg.state = bsplit_chudnovsky(range.first, range.second);
+                data.segments.push_back(std::move(seg));
+            }
+
+            const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+            const std::filesystem::path file =
+                std::filesystem::temp_directory_path() / ("piracer-selftest-" + std::to_string(stamp) + ".ckpt");
+            struct Remove {
+                std::filesystem::path p;
+                ~Remove() {
+                    std::error_code ec;
+                    std::filesystem::remove(p, ec);
+                }
+            } remove{file};
+
+            BinaryCheckpoint back;
+            if (!save_binary_checkpoint(file.string(), data) || !is_binary_checkpoint(file.string()) ||
+                !load_binary_checkpoint(file.string(), back) || !same_checkpoint(data, back)) {
+                why = "file round trip lost data";
+                return false;
+            }
+
+            // The stream encoding is the file's, byte for byte
+            std::string bytes;
+            send_binary_checkpoint(data, [&](const void* p, std::size_t n) {
+                bytes.append(static_cast<const char*>(p), n);
+                return true;
+            });
+            std::string on_disk;
+            {
+                std::ifstream in(file, std::ios::binary);
+                on_disk.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
+            if (bytes != on_disk) {
+                why = "stream encoding differs from the file";
+                return false;
+            }
+            auto receive = [](const std::string& enc, BinaryCheckpoint& out, std::uint64_t max_bytes) {
+                std::size_t at = 0;
+                return receive_binary_checkpoint(
+                    [&](void* p, std::size_t n) {
+                        if (enc.size() - at < n) return false;
+                        std::memcpy(p, enc.data() + at, n);
+                        at += n;
+                        return true;
+                    },
+                    out, max_bytes);
+            };
+            BinaryCheckpoint streamed;
+            if (!receive(bytes, streamed, 0) || !same_checkpoint(data, streamed)) {
+                why = "stream round trip lost data";
+                return false;
+            }
+            if (receive(bytes, streamed, bytes.size() - 1)) {
+                why = "stream larger than max_bytes accepted";
+                return false;
+            }
+            if (receive(bytes.substr(0, bytes.size() - 1), streamed, 0)) {
+                why = "truncated stream accepted";
+                return false;
+            }
+
+            // One flipped bit anywhere (header, segment table, limbs, the
+            // last byte) must fail the checksums
+            for (std::size_t at : {std::size_t{8}, on_disk.size() / 3, on_disk.size() / 2, on_disk.size() - 1}) {
+                std::string bad = on_disk;
+                bad[at] = static_cast<char>(bad[at] ^ 0x10);
+                {
+                    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+                    out.write(bad.data(), static_cast<std::streamsize>(bad.size()));
+                }
+                BinaryCheckpoint ignored;
+                if (load_binary_checkpoint(file.string(), ignored)) {
+                    why = "file with byte " + std::to_string(at) + " flipped was loaded";
+                    return false;
+                }
+                if (receive(bad, ignored, 0)) {
+                    why = "stream with byte " + std::to_string(at) + " flipped was received";
+                    return false;
+                }
+            }
+            why = "round trips match, corruption refused";
+            return true;
+        }
+
+        // ---- bbp: digit extraction against known hex digits of π -------------
+
+        bool test_bbp(std::string& why) {
+            ThreadPool pool(2);
+            // Published values: the first digits (the Blowfish P-array), and
+            // hex digits 10^6 onward (Bailey, Borwein and Plouffe, 1997)
+            const struct {
+                std::uint64_t position;
+                const char* digits;
+            } known[] = {{0, "243f6a8885a308d313198a2e03707344a4093822299f31d0082efa98ec4e6c89"},
+                         {999999, "26c65e52cb4593"}};
+            for (const auto& k : known) {
+                const std::string got = pi_hex_digits_bbp(k.position, std::strlen(k.digits), &pool);
+                if (got != k.digits) {
+                    why = "digits at " + std::to_string(k.position) + ": got " + got + ", expected " + k.digits;
+                    return false;
+                }
+            }
+
+            // Every window length at a few offsets, against the series
+            const std::string hex = compute_pi_base(3000, 16);
+            for (std::uint64_t position : {1, 15, 16, 1000, 2900}) {
+                for (std::size_t count : {std::size_t{1}, std::size_t{13}, kBBPMaxDigits}) {
+                    const std::string got = pi_hex_digits_bbp(position, count, position % 2 ? &pool : nullptr);
+                    if (got != hex.substr(2 + position, count)) {
+                        why = std::to_string(count) + " digits at " + std::to_string(position) +
+                              " differ from the series";
+                        return false;
+                    }
+                }
+            }
+            why = "BBP digits match";
+            return true;
+        }
+
+        // ---- range: run_range windows against the full result ----------------
+
+        bool test_range(std::string& why) {
+            const std::size_t digits = 20000;
+            for (int base : {10, 16}) {
+                ComputeOptions opts;
+                opts.digits = digits;
+                opts.base = base;
+                opts.threads = 2;
+                const std::string full = PiPipeline(opts).run_to_string();
+                // Windows at both ends, across the BBP/series switch for hex
+                const std::size_t windows[][2] = {{0, 1},      {0, 64},    {1, 1},       {999, 40}, {12345, 321},
+                                                  {0, digits}, {7, 19000}, {digits - 1, 1}};
+                for (const auto& w : windows) {
+                    const std::string expected = full.substr(2 + w[0], w[1]);
+                    const std::string got = PiPipeline(opts).run_range(w[0], w[1]);
+                    if (got != expected) {
+                        why = "base " + std::to_string(base) + " window [" + std::to_string(w[0]) + ", +" +
+                              std::to_string(w[1]) + ") differs at digit " +
+                              std::to_string(w[0] + first_mismatch(got, expected));
+                        return false;
+                    }
+                }
+                if (compute_pi_digit_range(4321, 100, base, 1) != full.substr(2 + 4321, 100)) {
+                    why = "compute_pi_digit_range differs in base " + std::to_string(base);
+                    return false;
+                }
+            }
+            why = "ranges match the full output";
+            return true;
+        }
+
+        // ---- constants: e, log 2, Ramanujan π --------------------------------
+
+        // "X." plus `digits` digits of x = sum / one, as compute_series_constant prints it
+        std::string fixed(const mpz_class& sum, const mpz_class& one, int base, std::size_t digits) {
+            mpz_class scale;
+            mpz_ui_pow_ui(scale.get_mpz_t(), static_cast<unsigned long>(base), digits);
+            const mpz_class v = sum * scale / one;
+            const mpz_class integer = v / scale;
+            // Hex values below one are printed "0x0." (format.hpp)
+            const std::string head = base == 16 && integer == 0 ? "0x0" : integer.get_str(base);
+            return head + "." + padded(v % scale, base, digits);
+        }
+
+        // Plain term-by-term sums, scaled by 2^bits: e = sum 1/k!, log 2 = sum 1/(k 2^k)
+        mpz_class reference_e(std::size_t bits) {
+            mpz_class term = mpz_class(1) << bits, sum = term;
+            for (unsigned long k = 1; term != 0; ++k) {
+                term /= k;
+                sum += term;
+            }
+            return sum;
+        }
+
+        mpz_class reference_log2(std::size_t bits) {
+            mpz_class sum = 0;
+            for (unsigned long k = 1; k < bits; ++k) sum += (mpz_class(1) << (bits - k)) / k;
+            return sum;
+        }
+
+        bool test_constants(std::string& why) {
+            const std::size_t digits = 3000;
+            const std::size_t bits = digits * 4 + 64;
+            const mpz_class one = mpz_class(1) << bits;
+            const mpz_class e = reference_e(bits), log2 = reference_log2(bits);
+
+            const struct {
+                const char* name;
+                const char* known;  // published decimal digits
+            } constants[] = {{"e", "2.71828182845904523536028747135266249775724709369995"},
+                             {"log2", "0.69314718055994530941723212145817656807550013436025"},
+                             {"pi-ramanujan", "3.14159265358979323846264338327950288419716939937510"}};
+            for (const auto& c : constants) {
+                for (int base : {10, 16}) {
+                    const std::string got = compute_series_constant(c.name, digits, base, 2);
+                    std::string expected;
+                    if (std::strcmp(c.name, "e") == 0) expected = fixed(e, one, base, digits);
+                    else if (std::strcmp(c.name, "log2") == 0) expected = fixed(log2, one, base, digits);
+                    else expected = compute_pi_base(digits, base);
+                    if (base == 10 && got.compare(0, std::strlen(c.known), c.known) != 0) {
+                        why = std::string(c.name) + " does not start with its known digits";
+                        return false;
+                    }
+                    if (got != expected) {
+                        why = std::string(c.name) + " in base " + std::to_string(base) + " differs at char index " +
+                              std::to_string(first_mismatch(got, expected));
+                        return false;
+                    }
+                }
+            }
+            why = "e, log2 and pi-ramanujan match";
+            return true;
+        }
+
+        // ---- service: coalescing, series reuse and request validation ------
+
+        // Unique path under the temp directory, removed with the guard
+        struct TempPath {
+            std::filesystem::path p;
+            explicit TempPath(const std::string& what) {
+                const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+                p = std::filesystem::temp_directory_path() / ("piracer-selftest-" + std::to_string(stamp) + what);
+            }
+            ~TempPath() {
+                std::error_code ec;
+                std::filesystem::remove_all(p, ec);
+            }
+        };
+
+#ifndef _WIN32
+        // Sends `request` on a fresh connection to the Unix socket at `path`;
+        // the reply's first line (and no more than that), or "" on failure
+        std::string ask_unix_socket(const std::string& path, const std::string& request) {
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, path.c_str(), std::min(path.size() + 1, sizeof(addr.sun_path) - 1));
+            const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) return "";
+            std::string reply;
+            // The server thread may still be binding: retry for a while
+            for (int attempt = 0; attempt < 200; ++attempt) {
+                if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0) {
+                    SocketReader in(fd);
+                    if (send_line(fd, request)) in.line(reply);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            ::close(fd);
+            return reply;
+        }
+#endif
+
+        bool test_service(std::string& why) {
+            ServiceOptions sopts;
+            sopts.threads = 2;
+            sopts.max_digits = 100000;
+            PiService service(sopts);
+
+            // Two requests at once for what nobody holds yet: one computation
+            {
+                std::promise<void> go;
+                std::shared_future<void> start = go.get_future().share();
+                auto ask = [&] {
+                    start.wait();
+                    return service.get(60000, 10);
+                };
+                auto first = std::async(std::launch::async, ask);
+                auto second = std::async(std::launch::async, ask);
+                go.set_value();
+                const PiDigits a = first.get(), b = second.get();
+                const PiService::Stats st = service.stats();
+                if (st.computed != 1 || st.coalesced + st.hits != 1 || a.owner != b.owner) {
+                    why = "two concurrent requests ran " + std::to_string(st.computed) + " computations";
+                    return false;
+                }
+            }
+
+            // Longer requests extend the kept series; the digits are a fresh run's
+            for (int base : {10, 16}) {
+                const std::size_t digits = 90000;
+                const PiService::Stats before = service.stats();
+                const PiDigits d = service.get(digits, base);
+                const PiService::Stats after = service.stats();
+                if (after.extended != before.extended + 1 || after.reused_terms <= before.reused_terms) {
+                    why = "base " + std::to_string(base) + " request did not extend the kept series";
+                    return false;
+                }
+                const std::string fresh = compute_pi_base(digits, base);
+                if (d.text != fresh) {
+                    why = "extended series differs from a fresh run in base " + std::to_string(base) +
+                          " at char index " + std::to_string(first_mismatch(std::string(d.text), fresh));
+                    return false;
+                }
+            }
+            const PiDigits prefix = service.get(1000, 10);
+            if (!prefix.cached || prefix.text != compute_pi_base(1000, 10)) {
+                why = "a shorter request was not a slice of the kept result";
+                return false;
+            }
+
+            // Bad sizes are refused by get() itself
+            for (std::size_t digits : {std::size_t{0}, sopts.max_digits + 1}) {
+                try {
+                    service.get(digits, 10);
+                    why = "get(" + std::to_string(digits) + ") was accepted";
+                    return false;
+                } catch (const std::invalid_argument&) {
+                }
+            }
+
+#ifndef _WIN32
+            // ... and every malformed request line gets ERR, not a computation
+            TempPath sock(".sock");
+            std::thread([&service, path = sock.p.string()] {
+                try {
+                    serve_unix_socket(service, path);
+                } catch (const std::exception&) {
+                }
+            }).detach();  // serves until the process exits
+
+            const PiService::Stats before = service.stats();
+            for (const char* bad : {"-5", "123abc", "1e6", "+7", "0x10", "99999999999999999999999", "0", "100001",
+                                    "5 oct", "5 dec extra"}) {
+                const std::string reply = ask_unix_socket(sock.p.string(), bad);
+                if (reply.compare(0, 4, "ERR ") != 0) {
+                    why = "request \"" + std::string(bad) + "\" got \"" + reply + "\" instead of ERR";
+                    return false;
+                }
+            }
+            if (service.stats().computed != before.computed) {
+                why = "a malformed request started a computation";
+                return false;
+            }
+            if (ask_unix_socket(sock.p.string(), "100 hex") != "OK " + std::to_string(compute_pi_base(100, 16).size())) {
+                why = "a valid socket request was not answered OK";
+                return false;
+            }
+#endif
+            why = "requests coalesced, series extended, bad requests refused";
+            return true;
+        }
+
+        // ---- distributed: one loopback worker against local bsplit --------
+
+#ifndef _WIN32
+        // A TCP port on 127.0.0.1 that was free a moment ago (0 if none)
+        int free_loopback_port() {
+            const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) return 0;
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t len = sizeof(addr);
+            int port = 0;
+            if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0 &&
+                ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0)
+                port = ntohs(addr.sin_port);
+            ::close(fd);
+            return port;
+        }
+
+        // True once something accepts connections on 127.0.0.1:port
+        bool wait_for_loopback(int port) {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(static_cast<std::uint16_t>(port));
+            for (int attempt = 0; attempt < 500; ++attempt) {
+                const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+                const bool up = fd >= 0 && ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+                if (fd >= 0) ::close(fd);
+                if (up) return true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return false;
+        }
+#endif
+
+        bool test_distributed(std::string& why) {
+#ifndef _WIN32
+            const int port = free_loopback_port();
+            if (port == 0) {
+                why = "no free loopback port";
+                return false;
+            }
+            const std::string address = "127.0.0.1:" + std::to_string(port);
+            std::thread([address] {
+                try {
+                    serve_bsplit_worker(address, 2, std::size_t(1) << 30);
+                } catch (const std::exception&) {
+                }
+            }).detach();  // serves until the process exits
+            if (!wait_for_loopback(port)) {
+                why = "worker on " + address + " never started listening";
+                return false;
+            }
+
+            // Ranges from 0 and from inside the series, with and without P
+            const long ranges[][2] = {{0, 1500}, {333, 2400}};
+            for (const auto& r : ranges) {
+                for (bool need_p : {true, false}) {
+                    const BSplitTriplet expected = bsplit_chudnovsky(r[0], r[1], nullptr, need_p);
+                    const BSplitTriplet got = bsplit_chudnovsky_distributed(r[0], r[1], {address}, 2, nullptr, need_p);
+                    if (got.Q != expected.Q || got.T != expected.T || (need_p && got.P != expected.P)) {
+                        why = "[" + std::to_string(r[0]) + ", " + std::to_string(r[1]) + ")" +
+                              (need_p ? "" : " without P") + " differs from local bsplit";
+                        return false;
+                    }
+                }
+            }
+            why = "loopback worker matches local bsplit";
+            return true;
+#else
+            why = "TCP workers are not available on this platform";
+            return true;
+#endif
+        }
+
+        // ---- memory: MemoryPool size classes, reuse and cross-thread frees ----
+
+        // Fills [p, p + n) from `seed`, or checks that it still holds it
+        void fill_block(void* p, std::size_t n, unsigned seed) {
+            auto* b = static_cast<unsigned char*>(p);
+            for (std::size_t i = 0; i < n; i += 61) b[i] = static_cast<unsigned char>(seed + i / 61);
+            b[n - 1] = static_cast<unsigned char>(seed ^ 0x5a);
+        }
+
+        bool block_intact(const void* p, std::size_t n, unsigned seed) {
+            const auto* b = static_cast<const unsigned char*>(p);
+            for (std::size_t i = 0; i < n; i += 61)
+                if (b[i] != static_cast<unsigned char>(seed + i / 61) && i != n - 1) return false;
+            return b[n - 1] == static_cast<unsigned char>(seed ^ 0x5a);
+        }
+
+        bool test_memory(std::string& why) {
+            MemoryPool& pool = g_memory_pool;
+            if (!pool.active()) {
+                // Pass-through to malloc: only the round trip is left to check
+                void* p = pool.allocate(1000);
+                fill_block(p, 1000, 1);
+                const bool ok = block_intact(p, 1000, 1);
+                pool.deallocate(p, 1000);
+                why = ok ? "no arena on this host, malloc pass-through works" : "pass-through block corrupted";
+                return ok;
+            }
+            const std::size_t used0 = pool.total_used();
+
+            // Every kind of size class, the small/large boundary and large
+            // buddies of several orders
+            const std::size_t sizes[] = {1, 16, 17, 128, 129, 1000, 4096, 65536, 100000,
+                                         MemoryPool::kMaxSmallBytes, MemoryPool::kMaxSmallBytes + 1,
+                                         std::size_t(1) << 20, (std::size_t(3) << 20) + 5};
+            for (std::size_t size : sizes) {
+                const bool small = size <= MemoryPool::kMaxSmallBytes;
+                void* p = pool.allocate(size);
+                const std::size_t align = small ? 16 : 4096;
+                if (reinterpret_cast<std::uintptr_t>(p) % align != 0) {
+                    why = std::to_string(size) + "-byte block not " + std::to_string(align) + "-byte aligned";
+                    return false;
+                }
+                fill_block(p, size, static_cast<unsigned>(size));
+                if (!block_intact(p, size, static_cast<unsigned>(size))) {
+                    why = std::to_string(size) + "-byte block does not hold its bytes";
+                    return false;
+                }
+                const std::size_t held = pool.total_allocated();
+                pool.deallocate(p, size);
+                void* q = pool.allocate(size);
+                // A freed small block is the next one of its class; a large
+                // one is reused without taking more of the arena
+                if (small ? q != p : pool.total_allocated() > held) {
+                    why = std::to_string(size) + "-byte block was not reused after its free";
+                    return false;
+                }
+                pool.deallocate(q, size);
+            }
+            if (pool.total_used() != used0) {
+                why = "total_used did not return to its start after the frees";
+                return false;
+            }
+
+            // Reallocation keeps the contents, within and across classes and
+            // from small to large
+            {
+                std::size_t size = 40;
+                void* p = pool.allocate(size);
+                fill_block(p, size, 7);
+                for (std::size_t next : {std::size_t(48), std::size_t(5000), std::size_t(300000), std::size_t(2) << 20}) {
+                    p = pool.reallocate(p, size, next);
+                    if (!block_intact(p, size, 7)) {
+                        why = "reallocate from " + std::to_string(size) + " to " + std::to_string(next) +
+                              " bytes lost the contents";
+                        return false;
+                    }
+                    size = next;
+                    fill_block(p, size, 7);
+                }
+                pool.deallocate(p, size);
+            }
+
+            // Blocks allocated on one thread and freed on another: the freeing
+            // thread's cache takes them, the next allocation there reuses one
+            {
+                std::vector<std::pair<void*, std::size_t>> blocks;
+                std::thread([&] {
+                    for (unsigned i = 0; i < 600; ++i) {
+                        const std::size_t size = i % 100 == 99 ? (std::size_t(1) << 20) : 24 + (i % 7) * 300;
+                        void* p = pool.allocate(size);
+                        fill_block(p, size, i);
+                        blocks.push_back({p, size});
+                    }
+                }).join();
+                bool intact = true, reused = false;
+                std::thread([&] {
+                    for (unsigned i = 0; i < blocks.size(); ++i) {
+                        intact = intact && block_intact(blocks[i].first, blocks[i].second, i);
+                        pool.deallocate(blocks[i].first, blocks[i].second);
+                    }
+                    void* p = pool.allocate(24);
+                    for (const auto& b : blocks) reused = reused || b.first == p;
+                    pool.deallocate(p, 24);
+                }).join();
+                if (!intact || !reused) {
+                    why = !intact ? "a block changed between its threads" : "blocks freed across threads were not reused";
+                    return false;
+                }
+            }
+
+            // Several threads at once, each checking its own blocks
+            std::atomic<bool> ok{true};
+            {
+                std::vector<std::thread> threads;
+                for (unsigned t = 0; t < 4; ++t) {
+                    threads.emplace_back([&pool, &ok, t] {
+                        std::vector<std::pair<void*, std::size_t>> live;
+                        unsigned x = 12345 + t;
+                        for (unsigned i = 0; i < 20000 && ok; ++i) {
+                            x = x * 1103515245u + 12345u;
+                            if (live.size() < 64 && (x >> 16) % 3 != 0) {
+                                const std::size_t size = 1 + ((x >> 8) % 8 == 0 ? (x >> 4) % 600000 : (x >> 4) % 3000);
+                                void* p = pool.allocate(size);
+                                fill_block(p, size, t * 1000 + static_cast<unsigned>(live.size()));
+                                live.push_back({p, size});
+                            } else if (!live.empty()) {
+                                const auto b = live.back();
+                                live.pop_back();
+                                if (!block_intact(b.first, b.second, t * 1000 + static_cast<unsigned>(live.size())))
+                                    ok = false;
+                                pool.deallocate(b.first, b.second);
+                            }
+                        }
+                        for (const auto& b : live) pool.deallocate(b.first, b.second);
+                    });
+                }
+                for (auto& th : threads) th.join();
+            }
+            if (!ok) {
+                why = "a block was overwritten while threads shared the pool";
+                return false;
+            }
+            if (pool.total_used() != used0) {
+                why = "total_used did not return to its start after the threads";
+                return false;
+            }
+            why = "blocks aligned, intact and reused, across threads too";
+            return true;
+        }
+
+        // ---- newton: fixed-point reciprocal and inverse square root ---------
+
+        // |got - floor(v * 2^scale)| for the MPFR value v, in units of the last place
+        mpz_class ulps_off(const mpz_class& got, mpfr_t v, long scale) {
+            mpfr_mul_2si(v, v, scale, MPFR_RNDN);
+            mpz_class ref;
+            mpfr_get_z(ref.get_mpz_t(), v, MPFR_RNDD);
+            return abs(got - ref);
+        }
+
+        bool test_newton(std::string& why) {
+            gmp_randclass rng(gmp_randinit_default);
+            rng.seed(16180339);
+            ThreadPool pool(2);
+            // Results are "within a few units of the last place" (newton.hpp)
+            const long kTolerance = 4;
+
+            // Below, at and above the 4096-bit base case, with one to five
+            // Newton steps, past the pipeline's 2^20-bit switch last
+            for (long bits : {1000L, 4096L, 4097L, 9000L, 50001L, 300000L, (1L << 20) + 123}) {
+                const mpfr_prec_t prec = static_cast<mpfr_prec_t>(bits + 128);
+                mpfr_t v;
+                mpfr_init2(v, prec);
+
+                // Divisors shorter and longer than the result, powers of two
+                // and just below them
+                const mpz_class big = rng.get_z_bits(static_cast<mp_bitcnt_t>(bits + 5000)) | 1;
+                const mpz_class divisors[] = {mpz_class(3), mpz_class(10005), rng.get_z_bits(bits / 3) | 1, big,
+                                              mpz_class(1) << (bits / 2), (mpz_class(1) << (bits + 77)) - 1};
+                for (const mpz_class& d : divisors) {
+                    for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+                        mpz_class y;
+                        reciprocal_fixed(y, d, bits, p);
+                        const long n = static_cast<long>(mpz_sizeinbase(d.get_mpz_t(), 2));
+                        mpfr_set_z(v, d.get_mpz_t(), MPFR_RNDN);  // rounded to prec: d's leading bits
+                        mpfr_ui_div(v, 1, v, MPFR_RNDN);
+                        if (ulps_off(y, v, n + bits) > kTolerance) {
+                            why = "reciprocal_fixed of a " + std::to_string(n) + "-bit divisor at " +
+                                  std::to_string(bits) + " bits is off by more than " + std::to_string(kTolerance) +
+                                  " ulps" + (p ? " (pool)" : "");
+                            mpfr_clear(v);
+                            return false;
+                        }
+                    }
+                }
+
+                for (unsigned long x : {1UL, 2UL, 3UL, 10005UL, 4294967291UL}) {
+                    for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+                        mpz_class r;
+                        inv_sqrt_fixed(r, x, bits, p);
+                        mpfr_set_ui(v, x, MPFR_RNDN);
+                        mpfr_rec_sqrt(v, v, MPFR_RNDN);
+                        if (ulps_off(r, v, bits) > kTolerance) {
+                            why = "inv_sqrt_fixed(" + std::to_string(x) + ") at " + std::to_string(bits) +
+                                  " bits is off by more than " + std::to_string(kTolerance) + " ulps" +
+                                  (p ? " (pool)" : "");
+                            mpfr_clear(v);
+                            return false;
+                        }
+                    }
+                }
+                mpfr_clear(v);
+            }
+
+            // The pipeline switches its finish to these above 2^20 bits
+            std::string message;
+            if (!self_test(330000, &message)) {
+                why = "330000 digits (Newton finish) against MPFR: " + message;
+                return false;
+            }
+            why = "reciprocal and inverse sqrt within " + std::to_string(kTolerance) + " ulps of MPFR";
+            return true;
+        }
+
+        // ---- disk: streamed out-of-core multiply and add against GMP --------
+
+        bool test_disk(std::string& why) {
+            TempPath dir("-disk");
+            ScratchSpace space(dir.p.string());
+            ThreadPool pool(2);
+            gmp_randclass rng(gmp_randinit_default);
+            rng.seed(14142135);
+
+            // Small blocks so every operand spans many of them
+            const std::size_t s = 64;
+            const mp_bitcnt_t block_bits = static_cast<mp_bitcnt_t>(s) * GMP_NUMB_BITS;
+            auto spill = [&space](mpz_class x) { return DiskInt::spill(space, x); };
+            auto check = [&why](const DiskInt& got, const mpz_class& want, const std::string& what) {
+                mpz_class x;
+                got.load(x);
+                if (x == want) return true;
+                why = what + " differs from GMP";
+                return false;
+            };
+
+            DiskMath m;
+            m.space = &space;
+            m.block_limbs = s;
+            const mpz_class one_block = rng.get_z_bits(block_bits - 7);
+            const mpz_class a = rng.get_z_bits(37 * block_bits + 5);
+            const mpz_class b = rng.get_z_bits(11 * block_bits);
+            const mpz_class pairs[][2] = {{a, b}, {-a, b}, {a, -b}, {-a, -b}, {b, a}, {one_block, a},
+                                          {one_block, -one_block}, {a, 0}, {0, -b}};
+            for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+                m.pool = p;
+                for (const auto& pair : pairs) {
+                    const DiskInt x = spill(pair[0]), y = spill(pair[1]);
+                    const std::string sizes = std::to_string(x.limbs()) + " x " + std::to_string(y.limbs()) +
+                                              " limbs" + (p ? " (pool)" : "");
+                    if (!check(disk_mul(x, y, m), pair[0] * pair[1], "disk_mul of " + sizes) ||
+                        !check(disk_add(x, y, m), pair[0] + pair[1], "disk_add of " + sizes)) {
+                        return false;
+                    }
+                }
+            }
+
+            // A carry and a borrow that run across every block boundary, and
+            // a difference that cancels all but the lowest block
+            const mpz_class top = mpz_class(1) << (9 * block_bits);
+            const mpz_class near = top + rng.get_z_bits(block_bits / 2);
+            const mpz_class edges[][2] = {{top - 1, 1}, {top, -1}, {-1, top}, {near, -top}, {-near, top}};
+            for (const auto& pair : edges) {
+                const DiskInt x = spill(pair[0]), y = spill(pair[1]);
+                if (!check(disk_add(x, y, m), pair[0] + pair[1],
+                           "disk_add carrying across " + std::to_string(x.limbs() / s) + " blocks")) {
+                    return false;
+                }
+            }
+
+            if (space.bytes_on_disk() != 0) {
+                why = std::to_string(space.bytes_on_disk()) + " bytes of spill files left behind";
+                return false;
+            }
+            why = "products and signed sums match GMP across block boundaries";
+            return true;
+        }
+
+        // ---- resume: a run stopped after its first checkpoint, then resumed ----
+
+        bool test_resume(std::string& why) {
+            TempPath ckpt("-resume.ckpt");
+            const std::size_t digits = 1000000;  // 16 checkpointed subtrees
+            ComputeOptions opts;
+            opts.digits = digits;
+            opts.checkpoint = ckpt.p.string();
+            opts.checkpoint_interval = std::chrono::seconds(0);  // save every finished subtree
+            const std::string fresh = PiPipeline(opts).run_to_string();
+            if (std::filesystem::exists(ckpt.p)) {
+                why = "a finished run left its checkpoint behind";
+                return false;
+            }
+
+            // Stop as soon as the first save is on disk
+            CancelToken token;
+            std::atomic<bool> over{false};
+            std::thread stopper([&] {
+                while (!over.load() && !std::filesystem::exists(ckpt.p)) std::this_thread::yield();
+                token.cancel();
+            });
+            ComputeOptions first = opts;
+            first.cancel = &token;
+            bool cancelled = false;
+            try {
+                PiPipeline(first).run_to_string();
+            } catch (const ComputeCancelled&) {
+                cancelled = true;
+            }
+            over = true;
+            stopper.join();
+            if (!cancelled || !is_binary_checkpoint(ckpt.p.string())) {
+                why = cancelled ? "the stopped run left no checkpoint" : "the run finished before its first checkpoint";
+                return false;
+            }
+
+            // On a different thread count: the split points do not depend on it
+            ComputeOptions second = opts;
+            second.threads = 2;
+            ComputeReport report;
+            const std::string resumed = PiPipeline(second).run_to_string(&report);
+            if (report.resumed_terms == 0 || report.resumed_terms >= report.terms) {
+                why = "resumed " + std::to_string(report.resumed_terms) + " of " + std::to_string(report.terms) +
+                      " terms, expected part of the series";
+                return false;
+            }
+            if (resumed != fresh) {
+                why = "resumed digits differ from a fresh run at " + std::to_string(first_mismatch(resumed, fresh));
+                return false;
+            }
+            if (std::filesystem::exists(ckpt.p)) {
+                why = "the resumed run left its checkpoint behind";
+                return false;
+            }
+            why = "resumed " + std::to_string(report.resumed_terms) + " of " + std::to_string(report.terms) +
+                  " terms; digits match a fresh run, checkpoint removed";
+            return true;
+        }
+
+        // ---- cancel: a run past its deadline before it starts ---------------
+
+        bool test_cancel(std::string& why) {
+            TempPath ckpt("-cancel.ckpt"), out("-cancel.txt");
+            const std::size_t digits = 200000;
+            const long n = PiPipeline::series_terms(digits, 10);
+
+            // A checkpoint of an earlier attempt at the same run: the left half
+            BinaryCheckpoint saved;
+            saved.digits = digits;
+            saved.total_terms = static_cast<std::size_t>(n);
+            saved.completed_terms = static_cast<std::size_t>(n / 2);
+            saved.segments.push_back({0, static_cast<std::uint64_t>(n / 2), bsplit_chudnovsky(0, n / 2)});
+            if (!save_binary_checkpoint(ckpt.p.string(), saved)) {
+                why = "cannot write " + ckpt.p.string();
+                return false;
+            }
+
+            CancelToken token;
+            token.set_deadline(CancelToken::clock::now() - std::chrono::seconds(1));
+            for (int threads : {1, 3}) {
+                ComputeOptions opts;
+                opts.digits = digits;
+                opts.threads = threads;
+                opts.checkpoint = ckpt.p.string();
+                opts.cancel = &token;
+                const std::string run = "a run on " + std::to_string(threads) + " thread(s) ";
+
+                // The sink the CLI writes --out through
+                std::unique_ptr<FdSink> sink = FdSink::open_file(out.p.string());
+                bool stopped = false;
+                try {
+                    PiPipeline(opts).run(*sink);
+                } catch (const ComputeCancelled& e) {
+                    stopped = e.deadline();
+                }
+                sink->finish();
+                if (!stopped) {
+                    why = run + "past its deadline did not throw ComputeCancelled (deadline)";
+                    return false;
+                }
+                if (sink->bytes_written() != 0 || std::filesystem::file_size(out.p) != 0) {
+                    why = run + "stopped by its deadline wrote digits";
+                    return false;
+                }
+                BinaryCheckpoint kept;
+                if (!load_binary_checkpoint(ckpt.p.string(), kept) || !same_checkpoint(kept, saved)) {
+                    why = run + "stopped by its deadline lost or changed the checkpoint";
+                    return false;
+                }
+            }
+            why = "ComputeCancelled before any digit; checkpoint kept as it was";
+            return true;
+        }
+
+        // ---- sinks: FdSink buffering and ChunkedFileSink splitting ----------
+
+        std::string read_file(const std::filesystem::path& path) {
+            std::ifstream in(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        bool test_sinks(std::string& why) {
+            TempPath dir("-sinks");
+            std::filesystem::create_directories(dir.p);
+
+            // Pieces that fill the 4 MiB buffer exactly, cross its end, and
+            // bypass it whole or after topping it up
+            const std::size_t cap = FdSink::kDefaultBuffer;
+            const std::size_t pieces[] = {1, 4095, cap - 4096, cap, 17, cap + 5, 2 * cap - 17 - 5, 3};
+
+            // Digits of π, repeated to the length of the pieces
+            const std::string pi = compute_pi(100000);
+            std::string digits;
+            while (digits.size() < 5 * cap + 3) digits.append(pi, 2, std::string::npos);
+            digits.resize(5 * cap + 3);
+            const std::filesystem::path single = dir.p / "pi.txt";
+            {
+                std::unique_ptr<FdSink> sink = FdSink::open_file(single.string());
+                std::size_t at = 0;
+                for (std::size_t n : pieces) {
+                    sink->write(digits.data() + at, n);
+                    at += n;
+                    // Only whole buffers (or whole multiples of them, bypassing) reach the file
+                    if (sink->bytes_written() % cap != 0) {
+                        why = "FdSink wrote " + std::to_string(sink->bytes_written()) + " bytes before finish";
+                        return false;
+                    }
+                }
+                sink->finish();
+                if (sink->bytes_written() != at) {
+                    why = "FdSink reports " + std::to_string(sink->bytes_written()) + " of " + std::to_string(at) +
+                          " bytes";
+                    return false;
+                }
+            }
+            const std::string on_disk = read_file(single);
+            if (on_disk != digits) {
+                why = "FdSink file differs at byte " + std::to_string(first_mismatch(on_disk, digits));
+                return false;
+            }
+
+            // The file names, and framing in the current file: with a digit
+            // count that fills the last file exactly, and with one that does not
+            const std::size_t per_file = 1000;
+            for (std::size_t count : {3000, 3517}) {
+                const std::filesystem::path base = dir.p / ("chunked-" + std::to_string(count) + ".txt");
+                ChunkedFileSink sink(base.string(), per_file, 4096);
+                sink.write_text("3.", 2);
+                for (std::size_t at = 0, step = 1; at < count; at += step, step = step * 3 + 1) {
+                    sink.write(digits.data() + at, std::min(step, count - at));
+                }
+                sink.write_text("\n", 1);
+                sink.finish();
+
+                const std::size_t files = (count + per_file - 1) / per_file;
+                if (sink.files_written() != files) {
+                    why = "ChunkedFileSink wrote " + std::to_string(sink.files_written()) + " files for " +
+                          std::to_string(count) + " digits";
+                    return false;
+                }
+                for (std::size_t i = 0; i <= files; ++i) {
+                    const std::string name = ChunkedFileSink::chunk_name(base.string(), i);
+                    const std::string expected = dir.p.string() + "/chunked-" + std::to_string(count) + " - " +
+                                                 std::to_string(i) + ".txt";
+                    if (std::filesystem::path(name) != std::filesystem::path(expected) ||
+                        std::filesystem::exists(name) != (i < files)) {
+                        why = "chunk " + std::to_string(i) + " of " + std::to_string(count) + " digits: '" + name + "'";
+                        return false;
+                    }
+                    if (i == files) break;
+                    const std::size_t lo = i * per_file, hi = std::min(count, lo + per_file);
+                    const std::string want =
+                        (i == 0 ? "3." : "") + digits.substr(lo, hi - lo) + (i + 1 == files ? "\n" : "");
+                    if (read_file(name) != want) {
+                        why = "'" + name + "' holds the wrong digits";
+                        return false;
+                    }
+                }
+            }
+            if (ChunkedFileSink::chunk_name("run.d/pi", 7) != "run.d/pi - 7.txt") {
+                why = "a dot in the directory was taken for an extension";
+                return false;
+            }
+            why = "bytes on disk match across buffer boundaries and file splits";
+            return true;
+        }
+
+        // ---- progress: per-thread counters after multithreaded runs ---------
+
+        bool test_progress(std::string& why) {
+            // More threads than slots, so some share one
+            ProgressCounters counters;
+            const std::size_t threads = ProgressCounters::kSlots + 16;
+            {
+                std::vector<std::thread> adders;
+                for (std::size_t t = 0; t < threads; ++t) {
+                    adders.emplace_back([&counters, t] {
+                        for (int i = 0; i < 1000; ++i) counters.add(t + 1);
+                    });
+                }
+                for (std::thread& a : adders) a.join();
+            }
+            const std::uint64_t added = 1000 * threads * (threads + 1) / 2;
+            if (counters.sum() != added) {
+                why = "ProgressCounters summed " + std::to_string(counters.sum()) + " of " + std::to_string(added);
+                return false;
+            }
+
+            // One Progress through runs of every in-memory variant: each
+            // reporter starts it over and must end it exactly at the total
+            struct Ticks {
+                std::size_t calls = 0, done = 0, total = 0;
+            } ticks;
+            Progress prog;
+            prog.user = &ticks;
+            prog.tick = [](std::size_t done, std::size_t total, void* user) {
+                auto* t = static_cast<Ticks*>(user);
+                ++t->calls;
+                t->done = done;
+                t->total = total;
+            };
+            const long n = 30000;
+            const std::uint64_t work = bsplit_work(0, n);
+            const BSplitTriplet reference = bsplit_chudnovsky(0, n);
+            const struct {
+                const char* what;
+                std::function<BSplitTriplet()> run;
+            } runs[] = {
+                {"parallel", [&] { return bsplit_chudnovsky_parallel(0, n, 4, &prog); }},
+                {"numa", [&] { return bsplit_chudnovsky_numa(0, n, 3, &prog); }},
+                {"resumable", [&] { return bsplit_chudnovsky_resumable(0, n, 4, &prog, true, {}, nullptr); }},
+                {"memory-bounded", [&] { return bsplit_chudnovsky_parallel(0, n, 4, &prog, true, 1 << 20); }},
+            };
+            for (const auto& r : runs) {
+                ticks = Ticks();
+                const BSplitTriplet S = r.run();
+                const std::string run = std::string(r.what) + " run";
+                if (S.Q != reference.Q || S.T != reference.T) {
+                    why = run + " computed the wrong series";
+                    return false;
+                }
+                if (prog.counters.sum() != work || prog.done != work || prog.total != work) {
+                    why = run + " counted " + std::to_string(prog.counters.sum()) + " (done " +
+                          std::to_string(prog.done) + ") of " + std::to_string(work);
+                    return false;
+                }
+                if (ticks.calls == 0 || ticks.done != work || ticks.total != work || prog.reporting) {
+                    why = run + ": the last tick was not the exact total";
+                    return false;
+                }
+
+                // A copy is a snapshot with no reporter
+                const Progress copy = prog;
+                if (copy.counters.sum() != work || copy.done != work || copy.tick != prog.tick || copy.reporting) {
+                    why = "a copy of the Progress of a " + run + " differs";
+                    return false;
+                }
+            }
+            why = "counters exact across " + std::to_string(threads) + " threads and every variant";
+            return true;
+        }
+
+        // ---- tuning: profile files and their host fingerprint ---------------
+
+        bool same_tuning(const TuningProfile& a, const TuningProfile& b) {
+            return a.ntt_threshold_limbs == b.ntt_threshold_limbs && a.threads == b.threads &&
+                   a.bsplit.leaf_terms == b.bsplit.leaf_terms &&
+                   a.bsplit.min_parallel_grain == b.bsplit.min_parallel_grain &&
+                   a.bsplit.tasks_per_thread == b.bsplit.tasks_per_thread;
+        }
+
+        bool test_tuning(std::string& why) {
+            TempPath dir("-tuning");
+            const std::string file = (dir.p / "cache" / "tuning.conf").string();  // directory made by the save
+
+            TuningProfile saved;
+            saved.ntt_threshold_limbs = 1234;
+            saved.threads = 6;
+            saved.bsplit.leaf_terms = 24;
+            saved.bsplit.min_parallel_grain = 96;
+            saved.bsplit.tasks_per_thread = 8;
+            if (!save_tuning(file, saved) || std::filesystem::exists(file + ".tmp")) {
+                why = "save_tuning to a new directory failed or left its temporary file";
+                return false;
+            }
+            TuningProfile loaded;
+            std::string reason;
+            if (!load_tuning(file, loaded, &reason) || !same_tuning(loaded, saved)) {
+                why = "profile did not round-trip: " + reason;
+                return false;
+            }
+
+            // Profiles that must be refused, leaving `out` as it was
+            const std::string text = read_file(file);
+            const std::string host = "host = " + host_fingerprint();
+            const std::size_t at = text.find(host);
+            if (at == std::string::npos) {
+                why = "saved profile has no host line";
+                return false;
+            }
+            std::string other_host = text, truncated = text;
+            other_host.insert(at + host.size(), " (another machine)");
+            truncated.erase(truncated.find("leaf_terms"));
+            const struct {
+                const char* what;
+                std::string text;
+                const char* reason;
+            } bad[] = {{"a profile from another host", other_host, "another host"},
+                       {"a profile cut off before leaf_terms", truncated, "incomplete"},
+                       {"a line without '='", text + "leaf_terms 12\n", "malformed"}};
+            for (const auto& b : bad) {
+                std::ofstream(file, std::ios::trunc) << b.text;
+                TuningProfile out = saved;
+                out.ntt_threshold_limbs = 99;
+                reason.clear();
+                if (load_tuning(file, out, &reason) || out.ntt_threshold_limbs != 99 ||
+                    reason.find(b.reason) == std::string::npos) {
+                    why = std::string(b.what) + " was not refused as expected (" + reason + ")";
+                    return false;
+                }
+            }
+            std::filesystem::remove(file);
+            TuningProfile out;
+            if (load_tuning(file, out, &reason)) {
+                why = "a missing profile loaded";
+                return false;
+            }
+            why = "profiles round-trip; other hosts and damaged files refused";
+            return true;
+        }
+
+        // ---- batch: multiply backends' batched products against mpz_mul -----
+
+        bool test_batch(std::string& why) {
+            gmp_randclass rng(gmp_randinit_default);
+            rng.seed(27182818);
+            ThreadPool pool(3);
+
+            // Sizes in limbs, from empty to well past the NTT threshold, equal
+            // and lopsided as tree levels hand them over
+            const std::size_t shapes[][2] = {{0, 5},       {1, 1},         {3, 700},      {64, 64},
+                                             {2000, 1999}, {30000, 30000}, {90000, 1200}, {150000, 140000}};
+            std::vector<mpz_class> a, b;
+            for (const auto& s : shapes) {
+                a.push_back(rng.get_z_bits(s[0] * GMP_NUMB_BITS));
+                b.push_back(rng.get_z_bits(s[1] * GMP_NUMB_BITS));
+                if (a.size() % 3 == 0) a.back() = -a.back();
+                if (a.size() % 4 == 0) b.back() = -b.back();
+            }
+            std::vector<mpz_class> expected(a.size());
+            for (std::size_t i = 0; i < a.size(); ++i) {
+                mpz_mul(expected[i].get_mpz_t(), a[i].get_mpz_t(), b[i].get_mpz_t());
+            }
+
+            std::vector<GPUBackend> backends = {GPUBackend::CPU};
+            if (GPUBackendFactory::get_best_available_backend() != GPUBackend::CPU) backends.push_back(GPUBackend::Auto);
+            for (GPUBackend backend : backends) {
+                std::unique_ptr<GPUMultiplier> mul = GPUBackendFactory::create_multiplier(backend);
+                for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+                    std::vector<mpz_class> out(a.size(), mpz_class(-1));
+                    std::vector<GPUMultiplier::BatchProduct> jobs;
+                    for (std::size_t i = 0; i < a.size(); ++i) jobs.push_back({&a[i], &b[i], &out[i]});
+                    mul->multiply_products(jobs, p);
+                    for (std::size_t i = 0; i < a.size(); ++i) {
+                        if (out[i] != expected[i]) {
+                            why = mul->backend_name() + " batch product " + std::to_string(shapes[i][0]) + " x " +
+                                  std::to_string(shapes[i][1]) + " limbs differs from mpz_mul" + (p ? " (pool)" : "");
+                            return false;
+                        }
+                    }
+                }
+
+                // The byte interface: little-endian magnitudes
+                auto bytes = [](const mpz_class& z) {
+                    std::vector<uint8_t> v((mpz_sizeinbase(z.get_mpz_t(), 2) + 7) / 8);
+                    std::size_t n = 0;
+                    mpz_export(v.data(), &n, -1, 1, 0, 0, z.get_mpz_t());
+                    v.resize(n);
+                    return v;
+                };
+                std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> pairs;
+                for (std::size_t i = 0; i < a.size(); ++i) pairs.emplace_back(bytes(abs(a[i])), bytes(abs(b[i])));
+                const std::vector<std::vector<uint8_t>> products = mul->multiply_batch(pairs);
+                for (std::size_t i = 0; i < a.size(); ++i) {
+                    if (products[i] != bytes(abs(expected[i]))) {
+                        why = mul->backend_name() + " byte product " + std::to_string(shapes[i][0]) + " x " +
+                              std::to_string(shapes[i][1]) + " limbs differs from mpz_mul";
+                        return false;
+                    }
+                }
+            }
+            why = "batched products match mpz_mul, signed and as bytes";
+            return true;
+        }
+
+        const struct {
+            const char* name;
+            bool (*run)(std::string& why);
+        } kSuites[] = {{"mul", test_mul},     {"radix", test_radix}, {"checkpoint", test_checkpoint},
+                       {"bbp", test_bbp},     {"range", test_range}, {"constants", test_constants},
+                       {"pool", test_pool},   {"service", test_service},
+                       {"distributed", test_distributed}, {"memory", test_memory},
+                       {"newton", test_newton}, {"disk", test_disk},
+                       {"resume", test_resume}, {"cancel", test_cancel},
+                       {"sinks", test_sinks}, {"progress", test_progress},
+                       {"tuning", test_tuning}, {"batch", test_batch}};
+    } // namespace
+
+    std::vector<std::string> self_test_suites() {
+        std::vector<std::string> names;
+        for (const auto& s : kSuites) names.push_back(s.name);
+        return names;
+    }
+
+    bool run_self_test_suite(const std::string& name, std::string* message) {
+        std::string why;
+        if (name == "all") {
+            for (const auto& s : kSuites) {
+                if (!s.run(why)) {
+                    if (message) *message = std::string(s.name) + ": " + why;
+                    return false;
+                }
+            }
+            if (message) *message = "OK - every suite passed";
+            return true;
+        }
+        for (const auto& s : kSuites) {
+            if (name != s.name) continue;
+            const bool ok = s.run(why);
+            if (message) *message = ok ? "OK - " + why : why;
+            return ok;
+        }
+        throw std::invalid_argument("unknown self-test suite: " + name);
+    }
+} // namespace piracer
@@ -0,0 +1,588 @@
+#include "piracer/simd.hpp"
+#include "piracer/montgomery.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PIRACER_SIMD_X86 1
+#include <immintrin.h>
+#define PIRACER_TARGET_SSSE3  __attribute__((target("ssse3")))
+#define PIRACER_TARGET_AVX2   __attribute__((target("avx2")))
+#define PIRACER_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define PIRACER_SIMD_X86 0
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define PIRACER_SIMD_NEON 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#else
+#define PIRACER_SIMD_NEON 0
+#endif
+
+namespace piracer {
+    namespace simd {
+
+        CPUFeatures get_cpu_features() {
+            static const CPUFeatures features = [] {
+                CPUFeatures f;
+#if PIRACER_SIMD_X86
+                __builtin_cpu_init();
+                f.sse2       = __builtin_cpu_supports("sse2");
+                f.sse3       = __builtin_cpu_supports("sse3");
+                f.ssse3      = __builtin_cpu_supports("ssse3");
+                f.sse4_1     = __builtin_cpu_supports("sse4.1");
+                f.sse4_2     = __builtin_cpu_supports("sse4.2");
+                f.avx        = __builtin_cpu_supports("avx");
+                f.avx2       = __builtin_cpu_supports("avx2");
+                f.avx512     = __builtin_cpu_supports("avx512f");
+                f.avx512ifma = __builtin_cpu_supports("avx512ifma");
+#elif PIRACER_SIMD_NEON
+                f.neon = true;  // baseline on AArch64
+#if defined(__linux__) && defined(HWCAP_SVE)
+                f.sve = (getauxval(AT_HWCAP) & HWCAP_SVE) != 0;
+#endif
+#endif
+                return f;
+            }();
+            return features;
+        }
+
+        bool has_avx512() { return get_cpu_features().avx512; }
+        bool has_neon() { return get_cpu_features().neon; }
+        bool has_sve() { return get_cpu_features().sve; }
+
+        void log_simd_capabilities() {
+            const CPUFeatures f = get_cpu_features();
+            std::cerr << "SIMD:";
+            if (f.sse2) std::cerr << " sse2";
+            if (f.sse3) std::cerr << " sse3";
+            if (f.ssse3) std::cerr << " ssse3";
+            if (f.sse4_1) std::cerr << " sse4.1";
+            if (f.sse4_2) std::cerr << " sse4.2";
+            if (f.avx) std::cerr << " avx";
+            if (f.avx2) std::cerr << " avx2";
+            if (f.avx512) std::cerr << " avx512f";
+            if (f.avx512ifma) std::cerr << " avx512ifma";
+            if (f.neon) std::cerr << " neon";
+            if (f.sve) std::cerr << " sve";
+            std::cerr << " (NTT kernel: " << ntt::kernels().name << ")\n";
+        }
+
+        namespace ntt {
+            namespace {
+#if PIRACER_HAVE_U128
+                // ---- Scalar reference kernels --------------------------------------
+
+                void dif_level_scalar(std::uint64_t* x, std::size_t n, std::size_t h, const std::uint64_t* w,
+                                      std::uint64_t p, std::uint64_t inv) {
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; ++j) {
+                            const std::uint64_t u = lo[j], v = hi[j];
+                            lo[j] = mont::add(u, v, p);
+                            hi[j] = mont::mul(mont::sub(u, v, p), w[j], p, inv);
+                        }
+                    }
+                }
+
+                void dit_level_scalar(std::uint64_t* x, std::size_t n, std::size_t h, const std::uint64_t* w,
+                                      std::uint64_t p, std::uint64_t inv) {
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; ++j) {
+                            const std::uint64_t u = lo[j];
+                            const std::uint64_t v = mont::mul(hi[j], w[j], p, inv);
+                            lo[j] = mont::add(u, v, p);
+                            hi[j] = mont::sub(u, v, p);
+                        }
+                    }
+                }
+
+                void pointwise_scalar(std::uint64_t* a, const std::uint64_t* b, std::size_t n,
+                                      std::uint64_t p, std::uint64_t inv) {
+                    for (std::size_t i = 0; i < n; ++i) a[i] = mont::mul(a[i], b[i], p, inv);
+                }
+
+                void scale_scalar(std::uint64_t* x, std::size_t n, std::uint64_t s,
+                                  std::uint64_t p, std::uint64_t inv) {
+                    for (std::size_t i = 0; i < n; ++i) x[i] = mont::mul(x[i], s, p, inv);
+                }
+
+                const Kernels kScalar = {
+                    Kernel::Scalar, "scalar",
+                    dif_level_scalar, dit_level_scalar, pointwise_scalar, scale_scalar
+                };
+#endif
+
+#if PIRACER_SIMD_X86 && PIRACER_HAVE_U128
+                // ---- AVX2: 4 lanes ---------------------------------------------------
+                // No 64x64-bit multiply exists, so products are assembled from four
+                // 32x32 -> 64 partial products (_mm256_mul_epu32). Residues are
+                // below 2^63, which makes the signed 64-bit compare usable.
+
+                PIRACER_TARGET_AVX2 inline __m256i mulhi_avx2(__m256i a, __m256i b) {
+                    const __m256i mask = _mm256_set1_epi64x(0xffffffffLL);
+                    const __m256i ah = _mm256_srli_epi64(a, 32), bh = _mm256_srli_epi64(b, 32);
+                    const __m256i ll = _mm256_mul_epu32(a, b);
+                    const __m256i lh = _mm256_mul_epu32(a, bh);
+                    const __m256i hl = _mm256_mul_epu32(ah, b);
+                    const __m256i hh = _mm256_mul_epu32(ah, bh);
+                    const __m256i t = _mm256_add_epi64(hl, _mm256_srli_epi64(ll, 32));
+                    const __m256i u = _mm256_add_epi64(lh, _mm256_and_si256(t, mask));
+                    return _mm256_add_epi64(_mm256_add_epi64(hh, _mm256_srli_epi64(t, 32)),
+                                            _mm256_srli_epi64(u, 32));
+                }
+
+                PIRACER_TARGET_AVX2 inline __m256i mullo_avx2(__m256i a, __m256i b) {
+                    const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)),
+                                                           _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b));
+                    return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+                }
+
+                PIRACER_TARGET_AVX2 inline __m256i mont_mul_avx2(__m256i a, __m256i b, __m256i p, __m256i inv) {
+                    const __m256i th = mulhi_avx2(a, b);
+                    const __m256i m  = mullo_avx2(mullo_avx2(a, b), inv);
+                    const __m256i mh = mulhi_avx2(m, p);
+                    const __m256i r  = _mm256_sub_epi64(th, mh);
+                    return _mm256_add_epi64(r, _mm256_and_si256(_mm256_cmpgt_epi64(mh, th), p));
+                }
+
+                PIRACER_TARGET_AVX2 inline __m256i add_avx2(__m256i a, __m256i b, __m256i p) {
+                    // s < 2p < 2^64; s - p has its sign bit set exactly when s < p
+                    const __m256i s = _mm256_add_epi64(a, b);
+                    const __m256i d = _mm256_sub_epi64(s, p);
+                    return _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(d), _mm256_castsi256_pd(s),
+                                                                _mm256_castsi256_pd(d)));
+                }
+
+                PIRACER_TARGET_AVX2 inline __m256i sub_avx2(__m256i a, __m256i b, __m256i p) {
+                    const __m256i d = _mm256_sub_epi64(a, b);
+                    return _mm256_add_epi64(d, _mm256_and_si256(_mm256_cmpgt_epi64(b, a), p));
+                }
+
+                PIRACER_TARGET_AVX2 void dif_level_avx2(std::uint64_t* x, std::size_t n, std::size_t h,
+                                                        const std::uint64_t* w, std::uint64_t p, std::uint64_t inv) {
+                    if (h < 4) return dif_level_scalar(x, n, h, w, p, inv);
+                    const __m256i vp = _mm256_set1_epi64x(static_cast<long long>(p));
+                    const __m256i vinv = _mm256_set1_epi64x(static_cast<long long>(inv));
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; j += 4) {
+                            const __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + j));
+                            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + j));
+                            const __m256i wj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + j));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lo + j), add_avx2(u, v, vp));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i*>(hi + j),
+                                                mont_mul_avx2(sub_avx2(u, v, vp), wj, vp, vinv));
+                        }
+                    }
+                }
+
+                PIRACER_TARGET_AVX2 void dit_level_avx2(std::uint64_t* x, std::size_t n, std::size_t h,
+                                                        const std::uint64_t* w, std::uint64_t p, std::uint64_t inv) {
+                    if (h < 4) return dit_level_scalar(x, n, h, w, p, inv);
+                    const __m256i vp = _mm256_set1_epi64x(static_cast<long long>(p));
+                    const __m256i vinv = _mm256_set1_epi64x(static_cast<long long>(inv));
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; j += 4) {
+                            const __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + j));
+                            const __m256i wj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + j));
+                            const __m256i v = mont_mul_avx2(
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi + j)), wj, vp, vinv);
+                            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lo + j), add_avx2(u, v, vp));
+                            _mm256_storeu_si256(reinterpret_cast<__m256i*>(hi + j), sub_avx2(u, v, vp));
+                        }
+                    }
+                }
+
+                PIRACER_TARGET_AVX2 void pointwise_avx2(std::uint64_t* a, const std::uint64_t* b, std::size_t n,
+                                                        std::uint64_t p, std::uint64_t inv) {
+                    const __m256i vp = _mm256_set1_epi64x(static_cast<long long>(p));
+                    const __m256i vinv = _mm256_set1_epi64x(static_cast<long long>(inv));
+                    std::size_t i = 0;
+                    for (; i + 4 <= n; i += 4) {
+                        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                        const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), mont_mul_avx2(x, y, vp, vinv));
+                    }
+                    pointwise_scalar(a + i, b + i, n - i, p, inv);
+                }
+
+                PIRACER_TARGET_AVX2 void scale_avx2(std::uint64_t* x, std::size_t n, std::uint64_t s,
+                                                    std::uint64_t p, std::uint64_t inv) {
+                    const __m256i vp = _mm256_set1_epi64x(static_cast<long long>(p));
+                    const __m256i vinv = _mm256_set1_epi64x(static_cast<long long>(inv));
+                    const __m256i vs = _mm256_set1_epi64x(static_cast<long long>(s));
+                    std::size_t i = 0;
+                    for (; i + 4 <= n; i += 4) {
+                        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+                        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x + i), mont_mul_avx2(v, vs, vp, vinv));
+                    }
+                    scale_scalar(x + i, n - i, s, p, inv);
+                }
+
+                const Kernels kAVX2 = {
+                    Kernel::AVX2, "avx2",
+                    dif_level_avx2, dit_level_avx2, pointwise_avx2, scale_avx2
+                };
+
+                // ---- AVX-512F: 8 lanes -----------------------------------------------
+                // GCC 12 reports its own _mm512_undefined_* placeholders as
+                // maybe-uninitialized once these helpers are inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+                // Same product assembly as AVX2; unsigned mask compares and
+                // min_epu64 replace the sign tricks. IFMA (52-bit multiply-add) does
+                // not apply: the NTT primes are 62-bit.
+
+                PIRACER_TARGET_AVX512 inline __m512i mulhi_avx512(__m512i a, __m512i b) {
+                    const __m512i mask = _mm512_set1_epi64(0xffffffffLL);
+                    const __m512i ah = _mm512_srli_epi64(a, 32), bh = _mm512_srli_epi64(b, 32);
+                    const __m512i ll = _mm512_mul_epu32(a, b);
+                    const __m512i lh = _mm512_mul_epu32(a, bh);
+                    const __m512i hl = _mm512_mul_epu32(ah, b);
+                    const __m512i hh = _mm512_mul_epu32(ah, bh);
+                    const __m512i t = _mm512_add_epi64(hl, _mm512_srli_epi64(ll, 32));
+                    const __m512i u = _mm512_add_epi64(lh, _mm512_and_si512(t, mask));
+                    return _mm512_add_epi64(_mm512_add_epi64(hh, _mm512_srli_epi64(t, 32)),
+                                            _mm512_srli_epi64(u, 32));
+                }
+
+                PIRACER_TARGET_AVX512 inline __m512i mullo_avx512(__m512i a, __m512i b) {
+                    const __m512i cross = _mm512_add_epi64(_mm512_mul_epu32(a, _mm512_srli_epi64(b, 32)),
+                                                           _mm512_mul_epu32(_mm512_srli_epi64(a, 32), b));
+                    return _mm512_add_epi64(_mm512_mul_epu32(a, b), _mm512_slli_epi64(cross, 32));
+                }
+
+                PIRACER_TARGET_AVX512 inline __m512i mont_mul_avx512(__m512i a, __m512i b, __m512i p, __m512i inv) {
+                    const __m512i th = mulhi_avx512(a, b);
+                    const __m512i m  = mullo_avx512(mullo_avx512(a, b), inv);
+                    const __m512i mh = mulhi_avx512(m, p);
+                    const __m512i r  = _mm512_sub_epi64(th, mh);
+                    return _mm512_mask_add_epi64(r, _mm512_cmplt_epu64_mask(th, mh), r, p);
+                }
+
+                PIRACER_TARGET_AVX512 inline __m512i add_avx512(__m512i a, __m512i b, __m512i p) {
+                    const __m512i s = _mm512_add_epi64(a, b);
+                    return _mm512_min_epu64(s, _mm512_sub_epi64(s, p));
+                }
+
+                PIRACER_TARGET_AVX512 inline __m512i sub_avx512(__m512i a, __m512i b, __m512i p) {
+                    const __m512i d = _mm512_sub_epi64(a, b);
+                    return _mm512_mask_add_epi64(d, _mm512_cmplt_epu64_mask(a, b), d, p);
+                }
+
+                PIRACER_TARGET_AVX512 void dif_level_avx512(std::uint64_t* x, std::size_t n, std::size_t h,
+                                                            const std::uint64_t* w, std::uint64_t p,
+                                                            std::uint64_t inv) {
+                    if (h < 8) return dif_level_avx2(x, n, h, w, p, inv);
+                    const __m512i vp = _mm512_set1_epi64(static_cast<long long>(p));
+                    const __m512i vinv = _mm512_set1_epi64(static_cast<long long>(inv));
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; j += 8) {
+                            const __m512i u = _mm512_loadu_si512(lo + j);
+                            const __m512i v = _mm512_loadu_si512(hi + j);
+                            const __m512i wj = _mm512_loadu_si512(w + j);
+                            _mm512_storeu_si512(lo + j, add_avx512(u, v, vp));
+                            _mm512_storeu_si512(hi + j, mont_mul_avx512(sub_avx512(u, v, vp), wj, vp, vinv));
+                        }
+                    }
+                }
+
+                PIRACER_TARGET_AVX512 void dit_level_avx512(std::uint64_t* x, std::size_t n, std::size_t h,
+                                                            const std::uint64_t* w, std::uint64_t p,
+                                                            std::uint64_t inv) {
+                    if (h < 8) return dit_level_avx2(x, n, h, w, p, inv);
+                    const __m512i vp = _mm512_set1_epi64(static_cast<long long>(p));
+                    const __m512i vinv = _mm512_set1_epi64(static_cast<long long>(inv));
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; j += 8) {
+                            const __m512i u = _mm512_loadu_si512(lo + j);
+                            const __m512i v = mont_mul_avx512(_mm512_loadu_si512(hi + j),
+                                                              _mm512_loadu_si512(w + j), vp, vinv);
+                            _mm512_storeu_si512(lo + j, add_avx512(u, v, vp));
+                            _mm512_storeu_si512(hi + j, sub_avx512(u, v, vp));
+                        }
+                    }
+                }
+
+                PIRACER_TARGET_AVX512 void pointwise_avx512(std::uint64_t* a, const std::uint64_t* b, std::size_t n,
+                                                            std::uint64_t p, std::uint64_t inv) {
+                    const __m512i vp = _mm512_set1_epi64(static_cast<long long>(p));
+                    const __m512i vinv = _mm512_set1_epi64(static_cast<long long>(inv));
+                    std::size_t i = 0;
+                    for (; i + 8 <= n; i += 8) {
+                        _mm512_storeu_si512(a + i, mont_mul_avx512(_mm512_loadu_si512(a + i),
+                                                                   _mm512_loadu_si512(b + i), vp, vinv));
+                    }
+                    pointwise_scalar(a + i, b + i, n - i, p, inv);
+                }
+
+                PIRACER_TARGET_AVX512 void scale_avx512(std::uint64_t* x, std::size_t n, std::uint64_t s,
+                                                        std::uint64_t p, std::uint64_t inv) {
+                    const __m512i vp = _mm512_set1_epi64(static_cast<long long>(p));
+                    const __m512i vinv = _mm512_set1_epi64(static_cast<long long>(inv));
+                    const __m512i vs = _mm512_set1_epi64(static_cast<long long>(s));
+                    std::size_t i = 0;
+                    for (; i + 8 <= n; i += 8) {
+                        _mm512_storeu_si512(x + i, mont_mul_avx512(_mm512_loadu_si512(x + i), vs, vp, vinv));
+                    }
+                    scale_scalar(x + i, n - i, s, p, inv);
+                }
+
+                const Kernels kAVX512 = {
+                    Kernel::AVX512, "avx512",
+                    dif_level_avx512, dit_level_avx512, pointwise_avx512, scale_avx512
+                };
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+#if PIRACER_SIMD_NEON && PIRACER_HAVE_U128
+                // ---- NEON: 2 lanes ---------------------------------------------------
+                // 64-bit products from vmull_u32 partial products, unsigned compares
+                // from vcltq_u64.
+
+                inline uint64x2_t mulhi_neon(uint64x2_t a, uint64x2_t b) {
+                    const uint64x2_t mask = vdupq_n_u64(0xffffffffULL);
+                    const uint32x2_t al = vmovn_u64(a), ah = vshrn_n_u64(a, 32);
+                    const uint32x2_t bl = vmovn_u64(b), bh = vshrn_n_u64(b, 32);
+                    const uint64x2_t ll = vmull_u32(al, bl);
+                    const uint64x2_t t = vmlal_u32(vshrq_n_u64(ll, 32), ah, bl);
+                    const uint64x2_t u = vmlal_u32(vandq_u64(t, mask), al, bh);
+                    const uint64x2_t hh = vmull_u32(ah, bh);
+                    return vaddq_u64(vaddq_u64(hh, vshrq_n_u64(t, 32)), vshrq_n_u64(u, 32));
+                }
+
+                inline uint64x2_t mullo_neon(uint64x2_t a, uint64x2_t b) {
+                    const uint32x2_t al = vmovn_u64(a), ah = vshrn_n_u64(a, 32);
+                    const uint32x2_t bl = vmovn_u64(b), bh = vshrn_n_u64(b, 32);
+                    const uint64x2_t cross = vmlal_u32(vmull_u32(al, bh), ah, bl);
+                    return vaddq_u64(vmull_u32(al, bl), vshlq_n_u64(cross, 32));
+                }
+
+                inline uint64x2_t mont_mul_neon(uint64x2_t a, uint64x2_t b, uint64x2_t p, uint64x2_t inv) {
+                    const uint64x2_t th = mulhi_neon(a, b);
+                    const uint64x2_t m  = mullo_neon(mullo_neon(a, b), inv);
+                    const uint64x2_t mh = mulhi_neon(m, p);
+                    const uint64x2_t r  = vsubq_u64(th, mh);
+                    return vaddq_u64(r, vandq_u64(vcltq_u64(th, mh), p));
+                }
+
+                inline uint64x2_t add_neon(uint64x2_t a, uint64x2_t b, uint64x2_t p) {
+                    const uint64x2_t s = vaddq_u64(a, b);
+                    return vbslq_u64(vcltq_u64(s, p), s, vsubq_u64(s, p));
+                }
+
+                inline uint64x2_t sub_neon(uint64x2_t a, uint64x2_t b, uint64x2_t p) {
+                    const uint64x2_t d = vsubq_u64(a, b);
+                    return vaddq_u64(d, vandq_u64(vcltq_u64(a, b), p));
+                }
+
+                void dif_level_neon(std::uint64_t* x, std::size_t n, std::size_t h, const std::uint64_t* w,
+                                    std::uint64_t p, std::uint64_t inv) {
+                    if (h < 2) return dif_level_scalar(x, n, h, w, p, inv);
+                    const uint64x2_t vp = vdupq_n_u64(p), vinv = vdupq_n_u64(inv);
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; j += 2) {
+                            const uint64x2_t u = vld1q_u64(lo + j), v = vld1q_u64(hi + j);
+                            vst1q_u64(lo + j, add_neon(u, v, vp));
+                            vst1q_u64(hi + j, mont_mul_neon(sub_neon(u, v, vp), vld1q_u64(w + j), vp, vinv));
+                        }
+                    }
+                }
+
+                void dit_level_neon(std::uint64_t* x, std::size_t n, std::size_t h, const std::uint64_t* w,
+                                    std::uint64_t p, std::uint64_t inv) {
+                    if (h < 2) return dit_level_scalar(x, n, h, w, p, inv);
+                    const uint64x2_t vp = vdupq_n_u64(p), vinv = vdupq_n_u64(inv);
+                    for (std::size_t i = 0; i < n; i += 2 * h) {
+                        std::uint64_t* lo = x + i;
+                        std::uint64_t* hi = x + i + h;
+                        for (std::size_t j = 0; j < h; j += 2) {
+                            const uint64x2_t u = vld1q_u64(lo + j);
+                            const uint64x2_t v = mont_mul_neon(vld1q_u64(hi + j), vld1q_u64(w + j), vp, vinv);
+                            vst1q_u64(lo + j, add_neon(u, v, vp));
+                            vst1q_u64(hi + j, sub_neon(u, v, vp));
+                        }
+                    }
+                }
+
+                void pointwise_neon(std::uint64_t* a, const std::uint64_t* b, std::size_t n,
+                                    std::uint64_t p, std::uint64_t inv) {
+                    const uint64x2_t vp = vdupq_n_u64(p), vinv = vdupq_n_u64(inv);
+                    std::size_t i = 0;
+                    for (; i + 2 <= n; i += 2) {
+                        vst1q_u64(a + i, mont_mul_neon(vld1q_u64(a + i), vld1q_u64(b + i), vp, vinv));
+                    }
+                    pointwise_scalar(a + i, b + i, n - i, p, inv);
+                }
+
+                void scale_neon(std::uint64_t* x, std::size_t n, std::uint64_t s,
+                                std::uint64_t p, std::uint64_t inv) {
+                    const uint64x2_t vp = vdupq_n_u64(p), vinv = vdupq_n_u64(inv), vs = vdupq_n_u64(s);
+                    std::size_t i = 0;
+                    for (; i + 2 <= n; i += 2) {
+                        vst1q_u64(x + i, mont_mul_neon(vld1q_u64(x + i), vs, vp, vinv));
+                    }
+                    scale_scalar(x + i, n - i, s, p, inv);
+                }
+
+                const Kernels kNEON = {
+                    Kernel::NEON, "neon",
+                    dif_level_neon, dit_level_neon, pointwise_neon, scale_neon
+                };
+#endif
+
+                const Kernels* kernel_table(Kernel k) {
+                    switch (k) {
+#if PIRACER_HAVE_U128
+                    case Kernel::Scalar: return &kScalar;
+#endif
+#if PIRACER_SIMD_X86 && PIRACER_HAVE_U128
+                    case Kernel::AVX2:   return get_cpu_features().avx2 ? &kAVX2 : nullptr;
+                    case Kernel::AVX512: return get_cpu_features().avx512 ? &kAVX512 : nullptr;
+#endif
+#if PIRACER_SIMD_NEON && PIRACER_HAVE_U128
+                    case Kernel::NEON:   return get_cpu_features().neon ? &kNEON : nullptr;
+#endif
+                    default:             return nullptr;
+                    }
+                }
+
+                const Kernels* select_best() {
+                    for (Kernel k : {Kernel::AVX512, Kernel::AVX2, Kernel::NEON, Kernel::Scalar}) {
+                        if (const Kernels* t = kernel_table(k)) return t;
+                    }
+                    throw std::runtime_error("NTT kernels require 128-bit integer support");
+                }
+
+                std::atomic<const Kernels*> g_active{nullptr};
+            } // namespace
+
+            const Kernels& kernels() {
+                const Kernels* k = g_active.load(std::memory_order_acquire);
+                if (!k) {
+                    k = select_best();
+                    g_active.store(k, std::memory_order_release);
+                }
+                return *k;
+            }
+
+            bool kernel_available(Kernel k) {
+                return kernel_table(k) != nullptr;
+            }
+
+            void force_kernel(Kernel k) {
+                const Kernels* t = kernel_table(k);
+                if (!t) throw std::invalid_argument(std::string("NTT kernel not available: ") + kernel_name(k));
+                g_active.store(t, std::memory_order_release);
+            }
+
+            const char* kernel_name(Kernel k) {
+                switch (k) {
+                case Kernel::Scalar: return "scalar";
+                case Kernel::AVX2:   return "avx2";
+                case Kernel::AVX512: return "avx512";
+                case Kernel::NEON:   return "neon";
+                }
+                return "unknown";
+            }
+        } // namespace ntt
+
+        namespace {
+            const char kHexDigits[] = "0123456789abcdef";
+
+            void hex_expand_scalar(char* out, const std::uint64_t* words, std::size_t n) {
+                // Two digits per lookup
+                static const auto pairs = [] {
+                    struct Table { char c[256][2]; } t;
+                    for (int b = 0; b < 256; ++b) {
+                        t.c[b][0] = kHexDigits[b >> 4];
+                        t.c[b][1] = kHexDigits[b & 15];
+                    }
+                    return t;
+                }();
+                for (std::size_t i = 0; i < n; ++i, out += 16) {
+                    const std::uint64_t w = words[i];
+                    for (int k = 0; k < 8; ++k) {
+                        const unsigned b = static_cast<unsigned>(w >> (56 - 8 * k)) & 0xff;
+                        out[2 * k] = pairs.c[b][0];
+                        out[2 * k + 1] = pairs.c[b][1];
+                    }
+                }
+            }
+
+#if PIRACER_SIMD_X86
+            // Bytes most significant first, split into high/low nibbles,
+            // interleaved and mapped through pshufb
+            PIRACER_TARGET_SSSE3 void hex_expand_ssse3(char* out, const std::uint64_t* words, std::size_t n) {
+                const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kHexDigits));
+                const __m128i low = _mm_set1_epi8(0x0f);
+                const __m128i reverse = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+                std::size_t i = 0;
+                for (; i + 2 <= n; i += 2, out += 32) {
+                    // Two words, each byte-reversed in its own half
+                    const __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i)), reverse);
+                    const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+                    const __m128i lo = _mm_and_si128(v, low);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(table, _mm_unpacklo_epi8(hi, lo)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_shuffle_epi8(table, _mm_unpackhi_epi8(hi, lo)));
+                }
+                if (i < n) hex_expand_scalar(out, words + i, n - i);
+            }
+#endif
+
+#if PIRACER_SIMD_NEON
+            void hex_expand_neon(char* out, const std::uint64_t* words, std::size_t n) {
+                const uint8x16_t table = vld1q_u8(reinterpret_cast<const std::uint8_t*>(kHexDigits));
+                for (std::size_t i = 0; i < n; ++i, out += 16) {
+                    const uint8x8_t v = vrev64_u8(vcreate_u8(words[i]));
+                    const uint8x8x2_t z = vzip_u8(vshr_n_u8(v, 4), vand_u8(v, vdup_n_u8(0x0f)));
+                    vst1q_u8(reinterpret_cast<std::uint8_t*>(out), vqtbl1q_u8(table, vcombine_u8(z.val[0], z.val[1])));
+                }
+            }
+#endif
+
+            using HexExpand = void (*)(char*, const std::uint64_t*, std::size_t);
+
+            HexExpand select_hex_expand() {
+#if PIRACER_SIMD_X86
+                if (get_cpu_features().ssse3) return hex_expand_ssse3;
+#endif
+#if PIRACER_SIMD_NEON
+                return hex_expand_neon;
+#else
+                return hex_expand_scalar;
+#endif
+            }
+        } // namespace
+
+        void hex_expand(char* out, const std::uint64_t* words, std::size_t n) {
+            static const HexExpand impl = select_hex_expand();
+            impl(out, words, n);
+        }
+
+    } // namespace simd
+} // namespace piracer
@@ -0,0 +1,105 @@
+#include "piracer/socket.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+#ifndef _WIN32
+    bool send_all(int fd, const void* data, std::size_t n) {
+        const char* p = static_cast<const char*>(data);
+        while (n > 0) {
+            const ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            p += w;
+            n -= static_cast<std::size_t>(w);
+        }
+        return true;
+    }
+
+    bool send_line(int fd, const std::string& line) {
+        const std::string s = line + "\n";
+        return send_all(fd, s.data(), s.size());
+    }
+
+    bool SocketReader::line(std::string& out) {
+        for (;;) {
+            const auto nl = buf_.find('\n', pos_);
+            if (nl != std::string::npos) {
+                out.assign(buf_, pos_, nl - pos_);
+                pos_ = nl + 1;
+                if (!out.empty() && out.back() == '\r') out.pop_back();
+                return true;
+            }
+            if (buf_.size() - pos_ > 4096 || !fill()) return false;
+        }
+    }
+
+    bool SocketReader::exact(void* data, std::size_t n) {
+        char* p = static_cast<char*>(data);
+        const std::size_t have = std::min(n, buf_.size() - pos_);
+        std::memcpy(p, buf_.data() + pos_, have);
+        pos_ += have;
+        p += have;
+        n -= have;
+        while (n > 0) {
+            const ssize_t r = ::recv(fd_, p, n, MSG_WAITALL);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            p += r;
+            n -= static_cast<std::size_t>(r);
+        }
+        return true;
+    }
+
+    bool SocketReader::fill() {
+        buf_.erase(0, pos_);
+        pos_ = 0;
+        char chunk[4096];
+        for (;;) {
+            const ssize_t r = ::recv(fd_, chunk, sizeof(chunk), 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            buf_.append(chunk, static_cast<std::size_t>(r));
+            return true;
+        }
+    }
+
+    void serve_connections(int listener, const std::function<void(int fd)>& handle,
+                           const std::function<void(const std::string&)>& log) {
+        std::mutex m;
+        std::condition_variable idle;
+        std::size_t active = 0;
+        for (;;) {
+            const int fd = ::accept(listener, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (log) log(std::string("accept: ") + std::strerror(errno));
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m);
+                ++active;
+            }
+            std::thread([&handle, &m, &idle, &active, fd] {
+                handle(fd);
+                std::lock_guard<std::mutex> lock(m);
+                if (--active == 0) idle.notify_all();
+            }).detach();
+        }
+        std::unique_lock<std::mutex> lock(m);
+        idle.wait(lock, [&] { return active == 0; });
+    }
+#endif
+
+} // namespace piracer
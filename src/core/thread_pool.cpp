@@ -1,23 +1,41 @@
 #include "piracer/thread_pool.hpp"
+#include "piracer/topology.hpp"
 #include <algorithm>
+#include <utility>
 
 namespace piracer {
-    
-    ThreadPool::ThreadPool(size_t num_threads) : stop(false) {
+
+    namespace {
+        // Identity of the calling thread: owning pool and worker index
+        thread_local const ThreadPool* tls_pool = nullptr;
+        thread_local int tls_index = -1;
+
+        // Nesting of tasks run while helping inside TaskGroup::sync()
+        thread_local int tls_depth = 0;
+    }
+
+    ThreadPool::ThreadPool(size_t num_threads) : ThreadPool(num_threads, {}) {}
+
+    ThreadPool::ThreadPool(size_t num_threads, std::vector<int> cpus) : cpus_(std::move(cpus)) {
+        queues.reserve(num_threads);
+        for (size_t i = 0; i < num_threads; ++i) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+
         // Create worker threads
         for (size_t i = 0; i < num_threads; ++i) {
-            workers.emplace_back(&ThreadPool::worker_function, this);
+            workers.emplace_back(&ThreadPool::worker_function, this, i);
         }
     }
-    
+
     ThreadPool::~ThreadPool() {
         {
-            std::lock_guard<std::mutex> lock(queue_mutex);
+            std::lock_guard<std::mutex> lock(sleep_mutex);
             stop = true;
         }
-        
+
         condition.notify_all();
-        
+
         // Join all threads
         for (std::thread& worker : workers) {
             if (worker.joinable()) {
@@ -25,45 +43,256 @@ namespace piracer {
             }
         }
     }
-    
-    void ThreadPool::worker_function() {
-        while (true) {
-            std::function<void()> task;
-            
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                
-                // Wait for task or stop signal
-                condition.wait(lock, [this] { 
-                    return stop || !tasks.empty(); 
-                });
-                
-                if (stop && tasks.empty()) {
-                    return;
+
+    int ThreadPool::current_worker() const {
+        return tls_pool == this ? tls_index : -1;
+    }
+
+    void ThreadPool::spawn(Task task) {
+        if (stop) {
+            throw std::runtime_error("submit on stopped ThreadPool");
+        }
+
+        const int self = current_worker();
+        WorkQueue& q = self >= 0 ? *queues[self] : injection;
+        pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        wake_one();
+    }
+
+    void ThreadPool::wake_one() {
+        // Pairs with the re-check under sleep_mutex in worker_function and
+        // wait_for_work, so a thread going to sleep either sees the new task
+        // or gets notified.
+        if (sleeping.load() > 0 || helping.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            condition.notify_one();
+            help_condition.notify_one();
+        }
+    }
+
+    void ThreadPool::wait_for_work(const std::function<bool()>& done) {
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        helping.fetch_add(1);
+        help_condition.wait(lock, [&] { return stop || queued.load() > 0 || done(); });
+        helping.fetch_sub(1);
+    }
+
+    void ThreadPool::notify_waiters() {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        help_condition.notify_all();
+    }
+
+    bool ThreadPool::find_task(int self, Task& out) {
+        if (self >= 0) {
+            WorkQueue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                out = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(injection.mutex);
+            if (!injection.tasks.empty()) {
+                out = std::move(injection.tasks.front());
+                injection.tasks.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        return steal(self, out);
+    }
+
+    bool ThreadPool::steal(int thief, Task& out) {
+        const size_t n = queues.size();
+        if (n == 0 || queued.load() == 0) return false;
+
+        // Start right after the thief so victims are spread evenly. The first
+        // pass skips busy deques; if any was skipped, the second pass waits
+        // for their locks, so false means every deque was seen empty. Otherwise
+        // a helper would find queued > 0 in wait_for_work and never sleep.
+        const size_t start = thief >= 0 ? static_cast<size_t>(thief) + 1 : 0;
+        bool contended = false;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t k = 0; k < n; ++k) {
+                const size_t victim = (start + k) % n;
+                if (static_cast<int>(victim) == thief) continue;
+
+                WorkQueue& q = *queues[victim];
+                std::unique_lock<std::mutex> lock(q.mutex, std::defer_lock);
+                if (pass == 0 && !lock.try_lock()) {
+                    contended = true;
+                    continue;
                 }
-                
-                if (!tasks.empty()) {
-                    task = std::move(tasks.front());
-                    tasks.pop();
+                if (pass == 1) lock.lock();
+                if (q.tasks.empty()) continue;
+
+                out = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                queued.fetch_sub(1);
+                WorkQueue& mine = thief >= 0 ? *queues[thief] : injection;
+                mine.stolen.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (!contended || queued.load() == 0) break;
+        }
+        return false;
+    }
+
+    void ThreadPool::run(Task& task, int self) {
+        using clock = std::chrono::steady_clock;
+        WorkQueue& mine = self >= 0 ? *queues[self] : injection;
+
+        // Only the outermost task is timed: nested ones run inside its span
+        const bool outer = tls_depth++ == 0;
+        auto t0 = outer ? clock::now() : clock::time_point{};
+        std::exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        --tls_depth;
+        task = nullptr;  // release captures before signalling completion
+
+        mine.executed.fetch_add(1, std::memory_order_relaxed);
+        if (outer) {
+            mine.busy_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count(),
+                std::memory_order_relaxed);
+        }
+
+        // A task that threw is retired all the same, or wait_all() would hang
+        if (pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done_condition.notify_all();
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    bool ThreadPool::try_run_one() {
+        Task task;
+        const int self = current_worker();
+        if (!find_task(self, task)) return false;
+        try {
+            run(task, self);
+        } catch (...) {
+            // Not the caller's: the task came from whoever spawned it (see spawn)
+        }
+        return true;
+    }
+
+    void ThreadPool::worker_function(size_t index) {
+        tls_pool = this;
+        tls_index = static_cast<int>(index);
+        if (!cpus_.empty()) pin_thread_to_cpu(cpus_[index % cpus_.size()]);
+
+        while (true) {
+            Task task;
+            if (find_task(tls_index, task)) {
+                try {
+                    run(task, tls_index);
+                } catch (...) {
+                    // Dropped (see spawn); it must not end the worker
                 }
+                continue;
             }
-            
-            if (task) {
-                task();
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleeping.fetch_add(1);
+            auto t0 = std::chrono::steady_clock::now();
+
+            // Wait for task or stop signal
+            condition.wait(lock, [this] {
+                return stop || queued.load() > 0;
+            });
+
+            sleeping.fetch_sub(1);
+            queues[index]->idle_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - t0).count(),
+                std::memory_order_relaxed);
+            if (stop && queued.load() == 0) {
+                return;
             }
         }
     }
-    
+
     void ThreadPool::wait_all() {
-        // Wait for all tasks to complete
-        while (true) {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            if (tasks.empty()) {
-                break;
-            }
-            lock.unlock();
-            std::this_thread::yield();
+        // A worker waiting for quiescence would wait for its own task
+        if (current_worker() >= 0) {
+            throw std::logic_error("ThreadPool::wait_all called from a worker thread");
         }
+
+        // Wait for all tasks to complete (running ones included)
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_condition.wait(lock, [this] { return pending.load() == 0; });
+    }
+
+    ThreadPool::Stats ThreadPool::stats() const {
+        Stats s;
+        auto add = [&s](const WorkQueue& q) {
+            s.tasks_executed += q.executed.load(std::memory_order_relaxed);
+            s.tasks_stolen   += q.stolen.load(std::memory_order_relaxed);
+            s.busy_seconds   += q.busy_ns.load(std::memory_order_relaxed) * 1e-9;
+            s.idle_seconds   += q.idle_ns.load(std::memory_order_relaxed) * 1e-9;
+        };
+        for (const auto& q : queues) add(*q);
+        add(injection);
+        s.wall_seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - created).count();
+        return s;
+    }
+
+    TaskGroup::~TaskGroup() {
+        // Children reference this group: never leave while they are running
+        wait();
+    }
+
+    void TaskGroup::wait() {
+        // Help while there is runnable work; otherwise sleep until a task is
+        // spawned anywhere in the pool or the last child ends
+        while (pending_.load(std::memory_order_acquire) > 0) {
+            if (pool_->try_run_one()) continue;
+            pool_->wait_for_work([this] { return pending_.load(std::memory_order_acquire) == 0; });
+        }
+
+        // The last child decrements under the lock: once we hold it, that
+        // child has left finish_one() and the group may be destroyed.
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+
+    void TaskGroup::finish_one() {
+        // Decrement and notify under the lock (see TaskGroup::wait)
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pool_->notify_waiters();
+        }
+    }
+
+    void TaskGroup::sync() {
+        if (pool_) wait();
+
+        std::exception_ptr e;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::swap(e, error_);
+        }
+        if (e) std::rethrow_exception(e);
     }
-    
-} // namespace piracer 
\ No newline at end of file
+
+    void TaskGroup::record_error(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = e;
+    }
+
+} // namespace piracer
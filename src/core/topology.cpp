@@ -0,0 +1,220 @@
+#include "piracer/topology.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <filesystem>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace piracer {
+
+    namespace {
+#ifdef __linux__
+        const char* const kCpuDir = "/sys/devices/system/cpu/cpu";
+
+        int read_int(const std::string& path, int fallback) {
+            std::ifstream in(path);
+            int v;
+            return (in >> v) ? v : fallback;
+        }
+
+        int node_of(int cpu) {
+            std::error_code ec;
+            const std::string dir = kCpuDir + std::to_string(cpu);
+            for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+                const std::string name = entry.path().filename().string();
+                if (name.size() > 4 && name.compare(0, 4, "node") == 0) {
+                    try {
+                        return std::stoi(name.substr(4));
+                    } catch (...) {
+                    }
+                }
+            }
+            return 0;
+        }
+
+        // Cache id of the level-3 cache, or the first CPU sharing it
+        int l3_of(int cpu, int fallback) {
+            const std::string base = kCpuDir + std::to_string(cpu) + "/cache/index";
+            for (int i = 0; i < 8; ++i) {
+                const std::string dir = base + std::to_string(i);
+                if (read_int(dir + "/level", -1) != 3) continue;
+                const int id = read_int(dir + "/id", -1);
+                // The list ("0-3,8-11") starts with its lowest CPU
+                return id >= 0 ? id : read_int(dir + "/shared_cpu_list", fallback);
+            }
+            return fallback;
+        }
+
+        std::vector<CpuInfo> discover() {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            if (sched_getaffinity(0, sizeof(mask), &mask) != 0) return {};
+
+            std::vector<CpuInfo> cpus;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (!CPU_ISSET(cpu, &mask)) continue;
+                const std::string topo = kCpuDir + std::to_string(cpu) + "/topology/";
+                CpuInfo c;
+                c.cpu = cpu;
+                c.socket = std::max(0, read_int(topo + "physical_package_id", 0));
+                c.core = read_int(topo + "core_id", cpu);
+                c.node = node_of(cpu);
+                c.l3 = l3_of(cpu, c.socket);
+                cpus.push_back(c);
+            }
+            return cpus;
+        }
+#else
+        std::vector<CpuInfo> discover() {
+            return {};
+        }
+#endif
+
+        // Core and L3 ids are only unique within a socket: renumber densely
+        void normalize(std::vector<CpuInfo>& cpus) {
+            std::map<std::pair<int, int>, int> cores, l3s;
+            for (CpuInfo& c : cpus) {
+                c.core = cores.emplace(std::make_pair(c.socket, c.core), static_cast<int>(cores.size())).first->second;
+                c.l3 = l3s.emplace(std::make_pair(c.socket, c.l3), static_cast<int>(l3s.size())).first->second;
+            }
+        }
+    } // namespace
+
+    Topology::Topology(std::vector<CpuInfo> cpus) : cpus_(std::move(cpus)) {
+        if (cpus_.empty()) {
+            const unsigned n = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned i = 0; i < n; ++i) {
+                CpuInfo c;
+                c.cpu = c.core = static_cast<int>(i);
+                cpus_.push_back(c);
+            }
+        }
+        normalize(cpus_);
+
+        std::set<int> sockets, nodes, l3s;
+        for (const CpuInfo& c : cpus_) {
+            sockets.insert(c.socket);
+            nodes.insert(c.node);
+            l3s.insert(c.l3);
+        }
+        nodes_.assign(nodes.begin(), nodes.end());
+        sockets_ = static_cast<int>(sockets.size());
+        l3_domains_ = static_cast<int>(l3s.size());
+    }
+
+    const Topology& Topology::get() {
+        static const Topology topology(discover());
+        return topology;
+    }
+
+    std::vector<int> Topology::cpus_of_node(int node) const {
+        std::vector<int> first, siblings;
+        std::set<int> seen;
+        for (const CpuInfo& c : cpus_) {
+            if (c.node != node) continue;
+            (seen.insert(c.core).second ? first : siblings).push_back(c.cpu);
+        }
+        first.insert(first.end(), siblings.begin(), siblings.end());
+        return first;
+    }
+
+    std::string Topology::describe() const {
+        auto plural = [](int n, const char* what) {
+            return std::to_string(n) + " " + what + (n == 1 ? "" : "s");
+        };
+        return plural(sockets_, "socket") + ", " + plural(static_cast<int>(nodes_.size()), "NUMA node") + ", " +
+               plural(l3_domains_, "L3 domain") + ", " + plural(static_cast<int>(cpus_.size()), "CPU");
+    }
+
+    // ---- Affinity -------------------------------------------------------------------
+
+    bool pin_thread_to_cpus(const std::vector<int>& cpus) {
+        if (cpus.empty()) return false;
+#ifdef __linux__
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &mask);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#elif defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < static_cast<int>(8 * sizeof(DWORD_PTR))) mask |= DWORD_PTR(1) << cpu;
+        }
+        return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        return false;
+#endif
+    }
+
+    bool pin_thread_to_cpu(int cpu) {
+        return pin_thread_to_cpus({cpu});
+    }
+
+    ScopedAffinity::ScopedAffinity(const std::vector<int>& cpus) {
+#ifdef __linux__
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask) != 0) return;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) saved_.push_back(cpu);
+        }
+        pinned_ = pin_thread_to_cpus(cpus);
+#else
+        (void)cpus;  // nothing to restore to: leave the thread alone
+#endif
+    }
+
+    ScopedAffinity::~ScopedAffinity() {
+        if (pinned_) pin_thread_to_cpus(saved_);
+    }
+
+    // ---- Memory policy --------------------------------------------------------------
+
+    bool numa_interleave(void* p, std::size_t bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+        const std::vector<int>& nodes = Topology::get().nodes();
+        if (nodes.size() < 2) return false;
+
+        constexpr int kMpolInterleave = 3;  // <linux/mempolicy.h>, without libnuma
+        constexpr std::size_t kWords = 16;  // up to 1024 nodes
+        unsigned long mask[kWords] = {};
+        constexpr std::size_t kBits = 8 * sizeof(unsigned long);
+        for (int node : nodes) {
+            if (node >= 0 && static_cast<std::size_t>(node) < kWords * kBits) {
+                mask[static_cast<std::size_t>(node) / kBits] |= 1ul << (static_cast<std::size_t>(node) % kBits);
+            }
+        }
+        // The range must start on a page; round inwards
+        const long page = ::sysconf(_SC_PAGESIZE);
+        const std::uintptr_t ps = page > 0 ? static_cast<std::uintptr_t>(page) : 4096;
+        const std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(p) + ps - 1) & ~(ps - 1);
+        const std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(p) + bytes) & ~(ps - 1);
+        if (end <= begin) return false;
+        return ::syscall(SYS_mbind, begin, end - begin, kMpolInterleave, mask, kWords * kBits + 1, 0) == 0;
+#else
+        (void)p;
+        (void)bytes;
+        return false;
+#endif
+    }
+
+} // namespace piracer
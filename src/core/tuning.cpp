@@ -0,0 +1,256 @@
+#include "piracer/tuning.hpp"
+#include "piracer/atomic_file.hpp"
+#include "piracer/bigmul.hpp"
+#include "piracer/simd.hpp"
+#include "piracer/thread_pool.hpp"
+#include "piracer/version.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <gmpxx.h>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace piracer {
+
+    namespace {
+        std::string trim(const std::string& s) {
+            const auto b = s.find_first_not_of(" \t\r\n");
+            if (b == std::string::npos) return "";
+            const auto e = s.find_last_not_of(" \t\r\n");
+            return s.substr(b, e - b + 1);
+        }
+
+        std::string host_name() {
+#if defined(__unix__) || defined(__APPLE__)
+            char buf[256] = {};
+            if (gethostname(buf, sizeof(buf) - 1) == 0 && buf[0]) return buf;
+#endif
+            if (const char* h = std::getenv("COMPUTERNAME")) return h;
+            if (const char* h = std::getenv("HOSTNAME")) return h;
+            return "localhost";
+        }
+
+        std::string cpu_model() {
+            std::ifstream f("/proc/cpuinfo");
+            std::string line;
+            while (std::getline(f, line)) {
+                if (line.compare(0, 10, "model name") != 0) continue;
+                const auto colon = line.find(':');
+                if (colon != std::string::npos) return trim(line.substr(colon + 1));
+            }
+            return "unknown cpu";
+        }
+
+        // Best of `reps` timed runs of `f`, in seconds, after one warm-up run
+        template <typename F>
+        double best_seconds(F&& f, int reps = 3) {
+            f();
+            double best = 1e300;
+            for (int i = 0; i < reps; ++i) {
+                const auto t0 = std::chrono::steady_clock::now();
+                f();
+                best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+            }
+            return best;
+        }
+
+        void say(const TuneOptions& opts, const std::string& line) {
+            if (opts.log) opts.log(line);
+        }
+
+        std::string ms(double seconds) {
+            std::ostringstream os;
+            os.setf(std::ios::fixed);
+            os.precision(3);
+            os << seconds * 1e3 << " ms";
+            return os.str();
+        }
+
+        // First size from which mul_ntt beats mpz_mul at this size and the
+        // next one (a single win can be noise)
+        std::size_t tune_ntt_threshold(const TuneOptions& opts, ThreadPool* pool) {
+            constexpr std::size_t kFirst = std::size_t(1) << 13, kLast = std::size_t(1) << 20;
+            gmp_randclass rng(gmp_randinit_default);
+            rng.seed(12345);
+            std::size_t candidate = 0;
+            for (std::size_t limbs = kFirst; limbs <= kLast; limbs *= 2) {
+                const mpz_class x = rng.get_z_bits(static_cast<mp_bitcnt_t>(limbs * GMP_NUMB_BITS));
+                const mpz_class y = rng.get_z_bits(static_cast<mp_bitcnt_t>(limbs * GMP_NUMB_BITS));
+                mpz_class z;
+                const double gmp = best_seconds([&] { mpz_mul(z.get_mpz_t(), x.get_mpz_t(), y.get_mpz_t()); });
+                double ntt;
+                try {
+                    ntt = best_seconds([&] { mul_ntt(x, y, z, pool); });
+                } catch (const std::length_error&) {
+                    break;  // past the transform length limit
+                }
+                say(opts, "mul " + std::to_string(limbs) + " limbs: gmp " + ms(gmp) + ", ntt " + ms(ntt));
+                if (ntt < gmp) {
+                    if (candidate) return candidate;
+                    candidate = limbs;
+                } else {
+                    candidate = 0;
+                }
+            }
+            // Never clearly ahead within the sweep: keep GMP beyond it
+            return candidate ? candidate : 2 * kLast;
+        }
+
+        // Picks the value of `field` with the fastest `run`. The value in
+        // effect stays unless another one is clearly (3%) faster: the tree
+        // shape moves times by a few percent, about as much as the noise.
+        template <typename Run>
+        long tune_field(const TuneOptions& opts, const char* what, long BSplitTuning::*field,
+                        const std::vector<long>& values, Run&& run) {
+            BSplitTuning t = bsplit_tuning();
+            const long current = t.*field;
+            long best = current;
+            double best_time = 1e300, current_time = 1e300;
+            for (long v : values) {
+                t.*field = v;
+                set_bsplit_tuning(t);
+                const double s = best_seconds(run);
+                say(opts, std::string(what) + " " + std::to_string(v) + ": " + ms(s));
+                if (v == current) current_time = s;
+                if (s < best_time) {
+                    best_time = s;
+                    best = v;
+                }
+            }
+            if (current_time <= best_time * 1.03) best = current;
+            t.*field = best;
+            set_bsplit_tuning(t);
+            return best;
+        }
+    } // namespace
+
+    TuningProfile current_tuning() {
+        TuningProfile t;
+        t.ntt_threshold_limbs = ntt_threshold_limbs();
+        t.bsplit = bsplit_tuning();
+        return t;
+    }
+
+    void apply_tuning(const TuningProfile& t) {
+        set_ntt_threshold_limbs(t.ntt_threshold_limbs);
+        set_bsplit_tuning(t.bsplit);
+    }
+
+    std::string host_fingerprint() {
+        std::ostringstream os;
+        os << host_name() << " | " << cpu_model() << " | " << std::thread::hardware_concurrency() << " threads | "
+           << simd::ntt::kernels().name << " | piracer " << version;
+        return os.str();
+    }
+
+    std::string default_tuning_file() {
+        if (const char* f = std::getenv("PIRACER_TUNING_FILE")) return f;
+        std::filesystem::path dir;
+        if (const char* x = std::getenv("XDG_CACHE_HOME"); x && *x) {
+            dir = x;
+        } else if (const char* h = std::getenv("HOME"); h && *h) {
+            dir = std::filesystem::path(h) / ".cache";
+        } else {
+            return "";
+        }
+        return (dir / "piracer" / ("tuning-" + host_name() + ".conf")).string();
+    }
+
+    bool load_tuning(const std::string& file, TuningProfile& out, std::string* why) {
+        auto fail = [&](const std::string& reason) {
+            if (why) *why = reason;
+            return false;
+        };
+        std::ifstream f(file);
+        if (!f) return fail("no tuning profile at '" + file + "'");
+
+        std::map<std::string, std::string> kv;
+        std::string line;
+        while (std::getline(f, line)) {
+            line = trim(line);
+            if (line.empty() || line[0] == '#') continue;
+            const auto eq = line.find('=');
+            if (eq == std::string::npos) return fail("malformed line in '" + file + "': " + line);
+            kv[trim(line.substr(0, eq))] = trim(line.substr(eq + 1));
+        }
+        if (kv["host"] != host_fingerprint()) return fail("tuning profile '" + file + "' was made on another host");
+
+        try {
+            TuningProfile t;
+            t.ntt_threshold_limbs = static_cast<std::size_t>(std::stoull(kv.at("ntt_threshold_limbs")));
+            t.bsplit.leaf_terms = std::stol(kv.at("leaf_terms"));
+            t.bsplit.min_parallel_grain = std::stol(kv.at("min_parallel_grain"));
+            t.bsplit.tasks_per_thread = std::stol(kv.at("tasks_per_thread"));
+            if (kv.count("threads")) t.threads = std::stoi(kv["threads"]);
+            out = t;
+        } catch (const std::exception&) {
+            return fail("tuning profile '" + file + "' is incomplete or malformed");
+        }
+        return true;
+    }
+
+    bool save_tuning(const std::string& file, const TuningProfile& t) {
+        std::error_code ec;
+        const std::filesystem::path path(file);
+        if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+
+        // Concurrent runs never read half a profile
+        return write_file_atomically(file, [&t](std::ostream& f) {
+            f << "# piracer tuning profile (piracer --tune)\n"
+              << "host = " << host_fingerprint() << "\n"
+              << "threads = " << t.threads << "\n"
+              << "ntt_threshold_limbs = " << t.ntt_threshold_limbs << "\n"
+              << "leaf_terms = " << t.bsplit.leaf_terms << "\n"
+              << "min_parallel_grain = " << t.bsplit.min_parallel_grain << "\n"
+              << "tasks_per_thread = " << t.bsplit.tasks_per_thread << "\n";
+            return f.good();
+        });
+    }
+
+    TuningProfile run_tuning(const TuneOptions& opts) {
+        const TuningProfile saved = current_tuning();
+        const int threads = std::max(1, opts.threads);
+        TuningProfile result;
+        result.threads = threads;
+
+        try {
+            std::unique_ptr<ThreadPool> pool;
+            if (threads > 1) pool = std::make_unique<ThreadPool>(static_cast<std::size_t>(threads - 1));
+            result.ntt_threshold_limbs = tune_ntt_threshold(opts, pool.get());
+            set_ntt_threshold_limbs(result.ntt_threshold_limbs);
+            pool.reset();
+
+            // The base case only shows at the bottom of the tree: a small one suffices
+            constexpr long kSerialTerms = long(1) << 13;
+            tune_field(opts, "leaf_terms", &BSplitTuning::leaf_terms, {8, 12, 16, 24, 32, 48, 64},
+                       [] { bsplit_chudnovsky(0, kSerialTerms, nullptr, false); });
+
+            if (threads > 1) {
+                constexpr long kParallelTerms = long(1) << 16;
+                auto run = [threads] { bsplit_chudnovsky_parallel(0, kParallelTerms, threads, nullptr, false); };
+                tune_field(opts, "tasks_per_thread", &BSplitTuning::tasks_per_thread, {4, 8, 16, 32, 64}, run);
+                tune_field(opts, "min_parallel_grain", &BSplitTuning::min_parallel_grain,
+                           {16, 32, 64, 128, 256, 512}, run);
+            }
+            result.bsplit = bsplit_tuning();
+        } catch (...) {
+            apply_tuning(saved);
+            throw;
+        }
+        apply_tuning(saved);
+        return result;
+    }
+
+} // namespace piracer